@@ -265,6 +265,48 @@ function(add_long_test name)
   add_gtest(${name} PREFIX "lt_" DISABLED ${ARGN})
 endfunction(add_long_test)
 
+# Performance tests are built on top of Google Benchmark, if available.
+# They are NOT registered in CTest, but could be run all at once by the
+# `perf` target, which stores the results in JSON under ${CMAKE_BINARY_DIR}.
+find_package(benchmark QUIET)
+if(benchmark_FOUND)
+  message(STATUS "Found Google Benchmark, performance tests will be available")
+  if(NOT TARGET perf)
+    add_custom_target(perf)
+  endif()
+else()
+  message(STATUS "Google Benchmark NOT available, so performance tests NOT be ENABLED")
+endif()
+
 function(add_perf_test name)
-  add_gtest(${name} PREFIX "pt_" DISABLED ${ARGN})
+  set(oneValueArgs TIMEOUT)
+  set(multiValueArgs SOURCE LIBRARY INCLUDE_DIRECTORY DEPEND)
+  cmake_parse_arguments(params "" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
+
+  if(params_UNPARSED_ARGUMENTS)
+    message(FATAL_ERROR "Unknown keywords given to add_perf_test(): \"${params_UNPARSED_ARGUMENTS}\".")
+  endif()
+
+  if(benchmark_FOUND)
+    if(NOT params_SOURCE)
+      set(params_SOURCE ${name}.cpp)
+    endif()
+
+    set(target "pt_${name}")
+    add_executable(${target} ${params_SOURCE})
+    if(params_DEPEND)
+      add_dependencies(${target} ${params_DEPEND})
+    endif()
+    if(params_INCLUDE_DIRECTORY)
+      set_target_properties(${target} PROPERTIES INCLUDE_DIRECTORIES ${params_INCLUDE_DIRECTORY})
+    endif()
+    target_link_libraries(${target} ${params_LIBRARY} benchmark::benchmark ${CMAKE_THREAD_LIBS_INIT})
+
+    add_custom_target(run_${target}
+      COMMAND ${target} --benchmark_out=${CMAKE_BINARY_DIR}/${name}.json --benchmark_out_format=json
+      DEPENDS ${target}
+      WORKING_DIRECTORY ${CMAKE_BINARY_DIR}
+      COMMENT "Running performance test ${name}, results will be stored in ${name}.json")
+    add_dependencies(perf run_${target})
+  endif()
 endfunction(add_perf_test)
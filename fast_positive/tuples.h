@@ -95,8 +95,12 @@ struct iovec {
 #endif
 
 #ifdef __cplusplus
-#include <limits> // for numeric_limits<>
-#include <string> // for std::string
+#include <iterator>    // for std::forward_iterator_tag
+#include <limits>      // for numeric_limits<>
+#include <memory>      // for std::allocator<>
+#include <string>      // for std::string
+#include <type_traits> // for std::decay<>
+#include <utility>     // for std::swap()
 
 extern "C" {
 #endif
@@ -302,7 +306,8 @@ enum fptu_bits {
   fptu_ct_reserve_bits = 1u, // резерв в идентификаторе поля
   fptu_unit_size = 4u,       // размер одного юнита
   // количество служебных (зарезервированных) бит в заголовке кортежа,
-  // для признаков сортированности и отсутствия повторяющихся полей
+  // для признаков сортированности и наличия служебного дескриптора
+  // (карты присутствия тегов либо отпечатка раскладки)
   fptu_lx_bits = 2u,
 
   // производные константы и параметры
@@ -335,6 +340,11 @@ enum fptu_bits {
   fptu_lx_mask = ((UINT32_C(1) << fptu_lx_bits) - 1u) << fptu_lt_bits,
   // маска для получения размера массива дескрипторов из заголовка кортежа
   fptu_lt_mask = (UINT32_C(1) << fptu_lt_bits) - 1u,
+  // признак служебного дескриптора в начале массива, его вид определяется
+  // тегом: fptu_bloom_ct для карты присутствия тегов (см. fptu_take_bloom)
+  // или fptu_layout_ct для отпечатка раскладки (см. fptu_layout_stamp),
+  // оставшийся бит зарезервирован под признак сортированности
+  fptu_lx_bloom = UINT32_C(1) << fptu_lt_bits,
   // максимальное кол-во полей/колонок в одном кортеже
   fptu_max_fields = fptu_lt_mask,
 
@@ -552,6 +562,58 @@ FPTU_API const char *fptu_check(const fptu_rw *pt);
  * модифицируемой формы кортежа. */
 FPTU_API fptu_ro fptu_take_noshrink(const fptu_rw *pt);
 
+/* Тоже что fptu_take_noshrink(), но дополнительно формирует в кортеже
+ * карту присутствия тегов (bloom) размером 64 бита, посредством которой
+ * поиск отсутствующих полей завершается без просмотра дескрипторов.
+ *
+ * Карта размещается как удаленное поле с тегом fptu_bloom_ct в самом
+ * начале дескрипторов, а ее наличие отмечается битом fptu_lx_bloom
+ * в заголовке. Поэтому кортеж остается читаемым и без поддержки карты.
+ * Для карты требуется один свободный дескриптор и 8 байт для данных,
+ * при их отсутствии результат совпадает с fptu_take_noshrink().
+ *
+ * Карта строится за один проход по дескрипторам, т.е. имеет смысл
+ * для кортежей, которые читаются многократно. С ростом количества полей
+ * карта заполняется и отсекает все меньше промахов. При fptu_fetch()
+ * карта отбрасывается.
+ *
+ * Результат валиден до изменения модифицируемой формы кортежа,
+ * в том числе посредством fptu_take() и fptu_take_noshrink(). */
+FPTU_API fptu_ro fptu_take_bloom_noshrink(const fptu_rw *pt);
+
+/* Фиксированная раскладка ("struct mode").
+ *
+ * Предназначена для схем, в которых все поля фиксированного размера
+ * и всегда присутствуют. Кортеж-шаблон строится обычным образом,
+ * т.е. посредством fptu_init() и fptu_insert_xyz() со значениями
+ * по-умолчанию, после чего fptu_layout_stamp() размещает в буфере
+ * его копию с отпечатком раскладки. Далее каждая запись формируется
+ * копированием этого образа и записью значений по смещениям,
+ * которые возвращает fptu_layout_offset().
+ *
+ * Отпечаток размещается как удаленное поле с тегом fptu_layout_ct
+ * в самом начале дескрипторов, 8 байт его данных располагаются последними,
+ * а наличие отмечается тем же битом fptu_lx_bloom в заголовке, что и для
+ * карты присутствия (вид определяется тегом дескриптора). Поэтому такой
+ * кортеж является обычным и читается без поддержки раскладки. Читатели,
+ * сверив fptu_layout_fingerprint() с отпечатком шаблона, получают значения
+ * по постоянным смещениям без поиска дескрипторов. При fptu_fetch()
+ * отпечаток отбрасывается.
+ *
+ * fptu_layout_stamp() возвращает пустой fptu_ro (units == NULL),
+ * если шаблон содержит поля переменной длины, удаленные поля, карту
+ * присутствия тегов, либо не помещается в буфер. Требуемый размер
+ * буфера возвращает fptu_layout_space().
+ *
+ * fptu_layout_offset() возвращает смещение значения поля в байтах
+ * от начала кортежа, либо 0 если поля нет или оно переменной длины.
+ * Значение fptu_uint16 хранится в самом дескрипторе. */
+FPTU_API size_t fptu_layout_space(fptu_ro tmpl);
+FPTU_API fptu_ro fptu_layout_stamp(fptu_ro tmpl, void *space,
+                                   size_t buffer_bytes);
+FPTU_API size_t fptu_layout_offset(fptu_ro ro, unsigned column,
+                                   fptu_type type);
+
 /* Строит в указанном буфере модифицируемую форму кортежа из сериализованной.
  * Проверка корректности данных в сериализованной форме не производится.
  * Сериализованная форма не модифицируется и не требуется после возврата из
@@ -559,11 +621,37 @@ FPTU_API fptu_ro fptu_take_noshrink(const fptu_rw *pt);
  * Аргумент more_items резервирует кол-во полей, которые можно будет добавить
  * в создаваемую модифицируемую форму.
  *
+ * Для записей одинаковой формы fptu_fetch() служит и "штампом": кортеж-шаблон
+ * (дескрипторы и значения по-умолчанию) строится один раз, а каждая запись
+ * получается одним memcpy() после проверки заголовка из нескольких сравнений.
+ * Затем значения обновляются посредством fptu_update_xyz(), либо записью
+ * по указателям, полученным от fptu_lookup(). Карта присутствия тегов
+ * и отпечаток раскладки в шаблоне отбрасываются.
+ *
  * Возвращает указатель на созданный в буфере объект, либо nullptr, если
  * заданы неверные параметры или размер буфера недостаточен. */
 FPTU_API fptu_rw *fptu_fetch(fptu_ro ro, void *buffer_space,
                              size_t buffer_bytes, unsigned more_items);
 
+/* Аналог fptu_fetch(), который дополнительно переупорядочивает поля так,
+ * чтобы часто используемые оказались в начале массива дескрипторов.
+ * Поиск полей производится линейно начиная с первого дескриптора, поэтому
+ * при таком размещении дескрипторы горячих полей попадают в первую
+ * кэш-линию и находятся быстрее.
+ *
+ * Теги (тип и номер колонки) в hot перечисляются в порядке возрастания
+ * частоты обращений, т.е. последний является самым горячим, как и в
+ * результате fptu_profile_order(). Остальные поля, как и элементы
+ * коллекций, сохраняют взаимный порядок. Мертвые поля отбрасываются.
+ *
+ * Буфер не должен пересекаться с исходной сериализованной формой, а
+ * требования к его размеру как у fptu_fetch(). Возвращает указатель на
+ * созданный в буфере объект, либо nullptr при неверных параметрах или
+ * нехватке памяти для временного порядка полей. */
+FPTU_API fptu_rw *fptu_fetch_hot(fptu_ro ro, void *buffer_space,
+                                 size_t buffer_bytes, unsigned more_items,
+                                 const uint16_t *hot, size_t hot_count);
+
 /* Проверяет содержимое сериализованной формы на корректность. Одновременно
  * возвращает размер буфера, который потребуется для модифицируемой формы,
  * с учетом добавляемых more_items полей и more_payload данных.
@@ -582,6 +670,21 @@ FPTU_API size_t fptu_get_buffer_size(fptu_ro ro, unsigned more_items,
  * использовать как признак инвалидации итераторов. */
 FPTU_API bool fptu_shrink(fptu_rw *pt);
 
+/* Облегченная дефрагментация, которая удаляет из заголовка только мертвые
+ * дескрипторы, пересчитывая смещения живых, но не перемещая данные.
+ * Имеет смысл когда мусор в основном состоит из дескрипторов, например
+ * после удаления полей fptu_null и fptu_uint16, так как последующие
+ * поиск и перебор полей уже не просматривают удаленные поля.
+ *
+ * Подряд идущие данные удаленных полей остаются на месте в виде одного
+ * удаленного поля, а пустота в конце данных отрезается. Поэтому после
+ * вызова fptu_junkspace() возвращает практически только объем мусора
+ * в данных, который освобождается лишь посредством fptu_shrink().
+ *
+ * Возвращает true если заголовок был изменен, что можно использовать
+ * как признак инвалидации итераторов. */
+FPTU_API bool fptu_shrink_header(fptu_rw *pt);
+
 /* Производит дефрагментацию модифицируемой формы кортежа при наличии
  * пустот/мусора после удаления полей.
  * Возвращает true если была произведена дефрагментация, что можно
@@ -600,6 +703,25 @@ static __inline fptu_ro fptu_take(fptu_rw *pt) {
   return fptu_take_noshrink(pt);
 }
 
+/* Записывает в буфер dst сериализованную форму кортежа без мусора,
+ * т.е. совмещает дефрагментацию и копирование в один проход по данным.
+ * Исходная модифицируемая форма не изменяется. Размер результата
+ * определяется живыми полями, поэтому буфера размером
+ * fptu_take_noshrink(pt).total_bytes достаточно всегда, а при точном
+ * учете мусора и на fptu_junkspace(pt) меньше.
+ *
+ * Возвращает размещенный в dst кортеж, либо пустой fptu_ro (units == NULL)
+ * при недостаточном размере буфера. */
+FPTU_API fptu_ro fptu_take_compact_into(const fptu_rw *pt, void *dst,
+                                        size_t dst_size);
+
+/* Тоже что fptu_take(), но с картой присутствия тегов,
+ * см. fptu_take_bloom_noshrink(). */
+static __inline fptu_ro fptu_take_bloom(fptu_rw *pt) {
+  fptu_cond_shrink(pt);
+  return fptu_take_bloom_noshrink(pt);
+}
+
 /* Если в аргументе type_or_filter взведен бит fptu_filter,
  * то type_or_filter интерпретируется как битовая маска типов.
  * Соответственно, будут удалены все поля с заданным column и попадающие
@@ -662,6 +784,19 @@ FPTU_API int fptu_upsert_opaque_iov(fptu_rw *pt, unsigned column,
                                     const struct iovec value);
 FPTU_API int fptu_upsert_nested(fptu_rw *pt, unsigned column, fptu_ro ro);
 
+/* Варианты со сбором значения из нескольких фрагментов, аналогично readv().
+ * Фрагменты копируются подряд непосредственно в место, выделенное под поле,
+ * без промежуточного буфера. Для строки фрагменты не должны содержать
+ * нулевых символов, а терминирующий ноль добавляется автоматически. Для
+ * вложенного кортежа заголовок может быть разбит между фрагментами, а
+ * суммарный размер должен соответствовать заголовку. */
+FPTU_API int fptu_upsert_opaque_gather(fptu_rw *pt, unsigned column,
+                                       const struct iovec *iov, size_t iovcnt);
+FPTU_API int fptu_upsert_string_gather(fptu_rw *pt, unsigned column,
+                                       const struct iovec *iov, size_t iovcnt);
+FPTU_API int fptu_upsert_nested_gather(fptu_rw *pt, unsigned column,
+                                       const struct iovec *iov, size_t iovcnt);
+
 // TODO
 // FPTU_API int fptu_upsert_array_uint16(fptu_rw* pt, uint_fast16_t ct, size_t
 // array_length,
@@ -724,6 +859,13 @@ FPTU_API int fptu_insert_opaque_iov(fptu_rw *pt, unsigned column,
                                     const struct iovec value);
 FPTU_API int fptu_insert_nested(fptu_rw *pt, unsigned column, fptu_ro ro);
 
+FPTU_API int fptu_insert_opaque_gather(fptu_rw *pt, unsigned column,
+                                       const struct iovec *iov, size_t iovcnt);
+FPTU_API int fptu_insert_string_gather(fptu_rw *pt, unsigned column,
+                                       const struct iovec *iov, size_t iovcnt);
+FPTU_API int fptu_insert_nested_gather(fptu_rw *pt, unsigned column,
+                                       const struct iovec *iov, size_t iovcnt);
+
 // TODO
 // FPTU_API int fptu_insert_array_uint16(fptu_rw* pt, uint_fast16_t ct, size_t
 // array_length,
@@ -783,6 +925,13 @@ FPTU_API int fptu_update_opaque_iov(fptu_rw *pt, unsigned column,
                                     const struct iovec value);
 FPTU_API int fptu_update_nested(fptu_rw *pt, unsigned column, fptu_ro ro);
 
+FPTU_API int fptu_update_opaque_gather(fptu_rw *pt, unsigned column,
+                                       const struct iovec *iov, size_t iovcnt);
+FPTU_API int fptu_update_string_gather(fptu_rw *pt, unsigned column,
+                                       const struct iovec *iov, size_t iovcnt);
+FPTU_API int fptu_update_nested_gather(fptu_rw *pt, unsigned column,
+                                       const struct iovec *iov, size_t iovcnt);
+
 // TODO
 // FPTU_API int fptu_update_array_uint16(fptu_rw* pt, uint_fast16_t ct, size_t
 // array_length,
@@ -812,6 +961,20 @@ FPTU_API const fptu_field *fptu_lookup_ro(fptu_ro ro, unsigned column,
 FPTU_API fptu_field *fptu_lookup(fptu_rw *pt, unsigned column,
                                  int type_or_filter);
 
+/* Поиск с подсказкой позиции для потока кортежей одинаковой формы.
+ *
+ * В hint передается индекс дескриптора, найденного в предыдущем кортеже.
+ * Если дескриптор по этому индексу удовлетворяет критерию, то он
+ * возвращается без просмотра остальных, иначе выполняется обычный
+ * поиск и в hint сохраняется индекс найденного поля. При отсутствии
+ * поля hint не изменяется. Начальное значение hint может быть любым.
+ *
+ * Для коллекций (повторяющихся полей) по подсказке может быть найден
+ * не первый экземпляр, а тот, что совпал с подсказкой. */
+FPTU_API const fptu_field *fptu_lookup_ro_hint(fptu_ro ro, unsigned column,
+                                               int type_or_filter,
+                                               unsigned *hint);
+
 /* Возвращает "итераторы" по кортежу, в виде указателей.
  * Гарантируется что begin меньше, либо равно end.
  * В возвращаемом диапазоне могут буть удаленные поля,
@@ -856,6 +1019,16 @@ FPTU_API size_t fptu_field_count_ex(const fptu_rw *pt, fptu_field_filter filter,
 FPTU_API size_t fptu_field_count_ro_ex(fptu_ro ro, fptu_field_filter filter,
                                        void *context, void *param);
 
+/* Подсчет количества полей сразу для нескольких тегов за один проход.
+ * Для каждого tags[i] в counts[i] записывается количество полей с таким
+ * тегом, возвращается общее количество подсчитанных полей.
+ * Количество тегов n_tags не должно превышать fptu_max_fields, иначе
+ * counts обнуляется и возвращается 0. */
+FPTU_API size_t fptu_field_count_tags(const fptu_rw *pt, const uint16_t *tags,
+                                      size_t n_tags, size_t *counts);
+FPTU_API size_t fptu_field_count_tags_ro(fptu_ro ro, const uint16_t *tags,
+                                         size_t n_tags, size_t *counts);
+
 FPTU_API fptu_type fptu_field_type(const fptu_field *pf);
 FPTU_API int fptu_field_column(const fptu_field *pf);
 FPTU_API struct iovec fptu_field_as_iovec(const fptu_field *pf);
@@ -943,10 +1116,327 @@ FPTU_API fptu_lge fptu_cmp_opaque_iov(fptu_ro ro, unsigned column,
 FPTU_API fptu_lge fptu_cmp_binary(const void *left_data, size_t left_len,
                                   const void *right_data, size_t right_len);
 
+/* Сравнение двух полей.
+ *
+ * Поля одинакового типа сравниваются по значению, в том числе массивы
+ * (лексикографически). Числовые поля разных типов (int32/int64,
+ * uint16/uint32/uint64, fp32/fp64) сравниваются точно, без потерь
+ * при приведении типов. Если значения несравнимы (поля разных
+ * не-числовых типов, либо NaN при смешанном сравнении целого с
+ * плавающим), то возвращается fptu_ic. */
 FPTU_API fptu_lge fptu_cmp_fields(const fptu_field *left,
                                   const fptu_field *right);
 FPTU_API fptu_lge fptu_cmp_tuples(fptu_ro left, fptu_ro right);
 
+//----------------------------------------------------------------------------
+/* Сортировка кортежей по нескольким колонкам.
+ *
+ * Ключ сортировки задается упорядоченным массивом fptu_keydef, где первый
+ * элемент является наиболее значимым. Для каждой колонки указывается тип
+ * (без fptu_farray, массивы и вложенные кортежи не поддерживаются),
+ * направление сортировки и для cstr/opaque ширина в байтах, которую
+ * данное поле занимает в нормализованном ключе.
+ *
+ * fptu_cmp_keys() сравнивает два кортежа согласно спецификации ключа.
+ * Отсутствующее поле считается меньше любого присутствующего.
+ *
+ * fptu_key_build() за один проход по дескрипторам кортежа формирует
+ * нормализованный ключ фиксированного размера fptu_key_size(), который
+ * сравнивается посредством memcmp() и пригоден для поразрядной сортировки:
+ *  - перед значением каждого поля следует байт присутствия;
+ *  - целые числа записываются big-endian, у знаковых инвертируется
+ *    старший бит;
+ *  - у чисел с плавающей точкой инвертируется либо знаковый бит, либо
+ *    (для отрицательных) все биты, при этом -0.0 приводится к +0.0;
+ *  - строки и opaque-данные дополняются нулями до заданной ширины,
+ *    для opaque дополнительно записывается длина (2 байта);
+ *  - для обратного порядка все байты поля инвертируются.
+ *
+ * Длинные строки и opaque-данные урезаются до заданной ширины, поэтому
+ * при равенстве нормализованных ключей порядок следует уточнить
+ * посредством fptu_cmp_keys().
+ *
+ * Ключ может включать не более fptu_max_fields колонок, для более длинной
+ * спецификации fptu_key_size() возвращает 0, fptu_key_build() - FPTU_EINVAL,
+ * а fptu_cmp_keys() - fptu_ic. */
+
+typedef struct fptu_keydef {
+  uint16_t column;
+  uint8_t type;       /* fptu_type */
+  uint8_t descending; /* 0 - по возрастанию, иначе по убыванию */
+  uint16_t width;     /* ширина в байтах, только для fptu_cstr и fptu_opaque */
+} fptu_keydef;
+
+FPTU_API size_t fptu_key_size(const fptu_keydef *spec, size_t count);
+FPTU_API int fptu_key_build(fptu_ro ro, const fptu_keydef *spec, size_t count,
+                            void *key, size_t key_bytes);
+FPTU_API fptu_lge fptu_cmp_keys(fptu_ro left, fptu_ro right,
+                                const fptu_keydef *spec, size_t count);
+
+//----------------------------------------------------------------------------
+/* Дельта между двумя версиями кортежа.
+ *
+ * fptu_diff() формирует в diff дельту, т.е. кортеж содержащий только
+ * добавленные, удаленные и измененные поля. Сравнение производится по
+ * тегам, поэтому результат не зависит от физического порядка полей.
+ * Коллекции (повторы полей с одинаковым тегом) сравниваются целиком в
+ * порядке добавления элементов, и при любом отличии передаются целиком.
+ * Удаление всех полей с некоторым тегом кодируется маркером - полем
+ * fptu_uint16 в колонке fptu_max_cols, значением которого является тег.
+ * Поэтому эта колонка не должна использоваться в исходных кортежах.
+ *
+ * fptu_patch() применяет дельту к модифицируемой форме кортежа, после
+ * чего она совпадает с new_ro по fptu_cmp_tuples(). Место для изменений
+ * проверяется заранее, поэтому при ошибке кортеж остается неизменным.
+ * Содержимое дельты не проверяется, при получении из ненадежного
+ * источника следует использовать fptu_check_ro().
+ *
+ * Обе функции возвращают FPTU_OK, либо код ошибки
+ * (FPTU_EINVAL или FPTU_ENOSPACE). */
+FPTU_API int fptu_diff(fptu_ro old_ro, fptu_ro new_ro, fptu_rw *diff);
+FPTU_API int fptu_patch(fptu_rw *pt, fptu_ro diff);
+
+//----------------------------------------------------------------------------
+/* Профилирование формы кортежей.
+ *
+ * Профиль накапливает статистику по выборке кортежей и позволяет подобрать
+ * порядок добавления полей и резервы для fptu_alloc() вместо ручного
+ * угадывания:
+ *  - распределение количества полей и размеров полей переменной длины
+ *    (гистограммы по степеням двойки, см. fptu_profile_bucket());
+ *  - частоту тегов и их позиции в массиве дескрипторов, в том числе
+ *    попадание в первую кэш-линию (fptu_profile_line_items дескрипторов);
+ *  - долю мусора, т.е. удаленных, но не вычищенных полей.
+ *
+ * Профиль размещается в буфере размером fptu_profile_space(tags_limit)
+ * посредством fptu_profile_init(), либо посредством fptu_profile_alloc()
+ * с освобождением через free(). Теги сверх tags_limit не учитываются,
+ * а их экземпляры подсчитываются в tags_overflow.
+ *
+ * fptu_profile_add() учитывает один кортеж, возвращая FPTU_OK или
+ * FPTU_EINVAL. Содержимое кортежа не проверяется, при получении из
+ * ненадежного источника следует использовать fptu_check_ro().
+ *
+ * fptu_profile_order() заполняет tags рекомендуемым порядком добавления
+ * полей: от редких к частым. Поиск полей начинается с последнего
+ * добавленного, поэтому при таком порядке самые частые поля окажутся
+ * в первой кэш-линии заголовка. При нехватке места в tags выдаются только
+ * самые частые теги. Возвращает количество заполненных элементов,
+ * либо 0 при нехватке памяти для временного массива порядка.
+ *
+ * Рекомендуемые резервы для fptu_alloc() и fptu_space() содержатся
+ * в items_max и data_bytes_max, т.е. это максимальные количество живых
+ * полей и объем их данных среди учтенных кортежей. */
+
+enum fptu_profile_defs {
+  fptu_profile_buckets = 16,
+  /* дескрипторов в первой 64-байтной кэш-линии выровненного кортежа,
+   * которая также содержит заголовок размером в один юнит */
+  fptu_profile_line_items = 64 / fptu_unit_size - 1,
+};
+
+typedef struct fptu_profile_tag {
+  uint64_t samples;     /* количество кортежей с полями данного тега */
+  uint64_t fields;      /* общее количество полей, с учетом коллекций */
+  uint64_t first_line;  /* сколько полей было в первой кэш-линии */
+  uint64_t position;    /* сумма позиций дескрипторов (от начала) */
+  uint64_t last_sample; /* служебное: номер последнего кортежа с тегом */
+  uint16_t tag;         /* тип и номер колонки */
+} fptu_profile_tag;
+
+typedef struct fptu_profile {
+  uint64_t samples;        /* количество учтенных кортежей */
+  uint64_t fields_total;   /* общее количество живых полей */
+  uint64_t items_max;      /* максимальное количество живых полей */
+  uint64_t data_bytes_max; /* максимальный объем данных живых полей */
+  uint64_t junk_items;     /* мертвые дескрипторы */
+  uint64_t junk_bytes;     /* данные мертвых полей */
+  uint64_t total_bytes;    /* суммарный размер кортежей */
+  uint64_t fields_histogram[fptu_profile_buckets];
+  uint64_t varlen_histogram[fptu_profile_buckets]; /* размеры в байтах */
+  uint64_t tags_overflow;
+  size_t tags_limit, tags_used;
+  fptu_profile_tag tags[1];
+} fptu_profile;
+
+/* Номер корзины гистограммы для значения: 0 для нуля, иначе 1 + log2(n),
+ * но не более fptu_profile_buckets - 1. */
+FPTU_API unsigned fptu_profile_bucket(size_t n);
+FPTU_API size_t fptu_profile_space(size_t tags_limit);
+FPTU_API fptu_profile *fptu_profile_init(void *buffer_space,
+                                         size_t buffer_bytes,
+                                         size_t tags_limit);
+FPTU_API fptu_profile *fptu_profile_alloc(size_t tags_limit);
+FPTU_API int fptu_profile_add(fptu_profile *profile, fptu_ro ro);
+FPTU_API const fptu_profile_tag *
+fptu_profile_lookup(const fptu_profile *profile, uint_fast16_t tag);
+FPTU_API size_t fptu_profile_order(const fptu_profile *profile, uint16_t *tags,
+                                   size_t limit);
+
+//----------------------------------------------------------------------------
+/* Сериализация в JSON.
+ *
+ * Кортеж выводится JSON-объектом, поля в порядке их добавления, а
+ * коллекции (повторы тега) массивом. Имена полей предоставляет функция
+ * схемы tag2name по тегу (типу и номеру колонки), в том числе для
+ * вложенных кортежей. Без схемы, либо если функция вернула nullptr,
+ * именем является номер колонки, а с опцией fptu_json_skip_unknown
+ * такие поля пропускаются.
+ *
+ * Контекст схемы для вложенного кортежа предоставляет функция nested по
+ * тегу поля, а без нее (nullptr) используется контекст объемлющего
+ * кортежа. Функция nested общая для сериализации и разбора JSON.
+ *
+ * Значения выводятся без printf(): целые числа как есть, числа с плавающей
+ * точкой в кратчайшей форме обеспечивающей точное обратное преобразование
+ * (целые значения с суффиксом ".0"), NaN и бесконечности как null. Время
+ * выводится строкой ISO-8601 с точностью до наносекунд, а бинарные данные
+ * (opaque, b96..b256) строкой в шестнадцатеричном виде.
+ *
+ * fptu_tuple2json() передает результат порциями в функцию-приемник, а
+ * ненулевой код возврата приемника прерывает вывод и возвращается.
+ *
+ * fptu_tuple2json_buffer() выводит в буфер, дополняя результат нулем.
+ * Если буфера недостаточно, то возвращается FPTU_ENOSPACE, а в length
+ * все равно записывается полный размер результата (без учета нуля).
+ *
+ * Обе функции возвращают FPTU_OK, либо код ошибки. Содержимое кортежа не
+ * проверяется, при получении из ненадежного источника следует
+ * использовать fptu_check_ro(). */
+
+typedef int fptu_emit_func(void *output_ctx, const char *text, size_t length);
+typedef const char *fptu_tag2name_func(const void *schema_ctx,
+                                       uint_fast16_t tag);
+typedef const void *fptu_nested_func(const void *schema_ctx,
+                                     uint_fast16_t tag);
+
+enum fptu_json_options {
+  fptu_json_default = 0,
+  fptu_json_skip_unknown = 1 /* пропускать поля не известные схеме */
+};
+
+FPTU_API int fptu_tuple2json(fptu_ro ro, fptu_emit_func *output,
+                             void *output_ctx, fptu_tag2name_func *tag2name,
+                             fptu_nested_func *nested, const void *schema_ctx,
+                             unsigned options);
+FPTU_API int fptu_tuple2json_buffer(fptu_ro ro, char *buffer, size_t bytes,
+                                    size_t *length,
+                                    fptu_tag2name_func *tag2name,
+                                    fptu_nested_func *nested,
+                                    const void *schema_ctx, unsigned options);
+
+/* Разбор JSON.
+ *
+ * fptu_json2tuple() добавляет поля JSON-объекта в кортеж посредством
+ * fptu_insert_xyz(), без промежуточного представления: вложенные объекты
+ * формируются сразу в свободном месте кортежа, а массивы добавляются
+ * коллекцией (повторами тега). Теги полей (тип и номер колонки)
+ * предоставляет функция схемы name2tag по имени, в том числе для вложенных
+ * объектов, контекст схемы которых предоставляет функция nested (как и для
+ * fptu_tuple2json). Функция name2tag получает имя без завершающего нуля и
+ * возвращает тег, либо -1 для неизвестного имени.
+ *
+ * Значения приводятся к типу из схемы: целые числа с проверкой диапазона,
+ * числа с плавающей точкой с корректным округлением, время из строки
+ * ISO-8601 в UTC, бинарные данные из строки в шестнадцатеричном виде,
+ * null как NaN для fp32/fp64. Неизвестные схеме имена из цифр считаются
+ * номерами колонок, а тип определяется по значению: строка как cstr,
+ * целое число как int64 (либо uint64), прочие числа как fp64, true/false
+ * как uint16, объект как nested. Остальные неизвестные имена приводят к
+ * ошибке FPTU_ENOFIELD, а с опцией fptu_json_skip_unknown пропускаются
+ * все не известные схеме поля. Таким образом, результат fptu_tuple2json()
+ * разбирается обратно с той же схемой.
+ *
+ * fptu_json_estimate() проверяет синтаксис и вычисляет верхнюю оценку
+ * размера для размещения результата, т.е. кортеж из буфера размером
+ * fptu_space(items, data_bytes) гарантированно вместит все поля.
+ *
+ * Обе функции возвращают FPTU_OK, либо код ошибки: FPTU_EINVAL для
+ * некорректного JSON или неприводимого значения и FPTU_ENOSPACE при
+ * нехватке места. При ошибке в кортеже может остаться часть полей. */
+
+typedef int fptu_name2tag_func(const void *schema_ctx, const char *name,
+                               size_t length);
+
+FPTU_API int fptu_json_estimate(const char *json, size_t length,
+                                size_t *items, size_t *data_bytes);
+FPTU_API int fptu_json2tuple(fptu_rw *pt, const char *json, size_t length,
+                             fptu_name2tag_func *name2tag,
+                             fptu_nested_func *nested, const void *schema_ctx,
+                             unsigned options);
+
+//----------------------------------------------------------------------------
+/* Интерфейс внешней схемы.
+ *
+ * Схема сопоставляет именам колонок теги (тип и номер колонки), а
+ * колонкам вложенных кортежей также подсхемы. Колонки с признаком
+ * collection допускают повторы, т.е. являются массивами, как и колонки
+ * с типами fptu_farray.
+ *
+ * Поиск по имени производится посредством совершенной хэш-функции,
+ * которая строится при создании схемы, т.е. одним вычислением хэша и
+ * одним сравнением для проверки имени. Предполагается, что теги
+ * получаются по именам однократно, а доступ к полям производится по тегам.
+ *
+ * Схема размещается в буфере размером fptu_schema_space() посредством
+ * fptu_schema_init(), либо посредством fptu_schema_alloc() с
+ * освобождением через free(). Имена копируются внутрь схемы, а подсхемы
+ * только связываются и должны существовать пока используется схема.
+ * Обе функции возвращают nullptr при неверных параметрах, в том числе
+ * при повторах имен или тегов, а также при наличии подсхемы у колонки
+ * с типом отличным от fptu_nested.
+ *
+ * fptu_schema_name2tag(), fptu_schema_tag2name() и fptu_schema_nested()
+ * совместимы с функциями схемы для fptu_json2tuple() и fptu_tuple2json().
+ * Последняя возвращает подсхему колонки для вложенных кортежей, либо саму
+ * схему если подсхемы нет.
+ *
+ * fptu_schema_check() проверяет кортеж на соответствие схеме, включая
+ * вложенные кортежи при наличии подсхем. Возвращает FPTU_OK, либо
+ * FPTU_ENOFIELD для полей вне схемы и FPTU_EINVAL для повторов полей
+ * не являющихся коллекциями. fptu_schema_check_field() проверяет тег
+ * перед добавлением поля, что удобно в отладочных сборках:
+ *   assert(fptu_schema_check_field(schema, tag) == FPTU_OK); */
+
+typedef struct fptu_schema fptu_schema;
+
+typedef struct fptu_schema_column {
+  const char *name;          /* имя колонки */
+  const fptu_schema *nested; /* подсхема для fptu_nested, либо nullptr */
+  uint16_t tag;              /* тип и номер колонки */
+  bool collection;           /* допускаются повторы */
+} fptu_schema_column;
+
+FPTU_API size_t fptu_schema_space(const fptu_schema_column *columns,
+                                  size_t count);
+FPTU_API fptu_schema *fptu_schema_init(void *buffer_space, size_t buffer_bytes,
+                                       const fptu_schema_column *columns,
+                                       size_t count);
+FPTU_API fptu_schema *fptu_schema_alloc(const fptu_schema_column *columns,
+                                        size_t count);
+
+/* Колонки схемы в порядке их перечисления при создании. */
+FPTU_API size_t fptu_schema_count(const fptu_schema *schema);
+FPTU_API const fptu_schema_column *
+fptu_schema_columns(const fptu_schema *schema);
+
+/* Поиск колонки по имени (без завершающего нуля) и по тегу. */
+FPTU_API const fptu_schema_column *
+fptu_schema_find(const fptu_schema *schema, const char *name, size_t length);
+FPTU_API const fptu_schema_column *fptu_schema_get(const fptu_schema *schema,
+                                                   uint_fast16_t tag);
+
+FPTU_API int fptu_schema_name2tag(const void *schema, const char *name,
+                                  size_t length);
+FPTU_API const char *fptu_schema_tag2name(const void *schema,
+                                          uint_fast16_t tag);
+FPTU_API const void *fptu_schema_nested(const void *schema,
+                                        uint_fast16_t tag);
+
+FPTU_API int fptu_schema_check_field(const fptu_schema *schema,
+                                     uint_fast16_t tag);
+FPTU_API int fptu_schema_check(const fptu_schema *schema, fptu_ro ro);
+
 FPTU_API const char *fptu_type_name(const fptu_type);
 
 //----------------------------------------------------------------------------
@@ -957,6 +1447,17 @@ FPTU_API bool fptu_is_ordered(const fptu_field *begin, const fptu_field *end);
 FPTU_API uint16_t *fptu_tags(uint16_t *const first,
                              const fptu_field *const begin,
                              const fptu_field *const end);
+/* Основа fptu_field_count_tags() для произвольного диапазона дескрипторов,
+ * с тем же ограничением n_tags <= fptu_max_fields. */
+FPTU_API size_t fptu_tags_count(const fptu_field *const begin,
+                                const fptu_field *const end,
+                                const uint16_t *tags, size_t n_tags,
+                                size_t *counts);
+/* Как fptu_tags(), но также заполняет counts количеством полей для
+ * каждого тега. Размер обоих буферов должен быть не меньше end - begin. */
+FPTU_API uint16_t *fptu_tags_histogram(uint16_t *const first, size_t *counts,
+                                       const fptu_field *const begin,
+                                       const fptu_field *const end);
 FPTU_API bool fptu_is_under_valgrind(void);
 
 typedef struct fptu_version_info {
@@ -985,6 +1486,29 @@ extern FPTU_API const fptu_version_info fptu_version;
 #endif /* HAVE_FPTU_VERSIONINFO */
 extern FPTU_API const fptu_build_info fptu_build;
 
+/* Счетчики горячих путей, которые ведутся раздельно для каждого потока
+ * при сборке с опцией ENABLE_STATISTICS (см. HAVE_FPTU_STATISTICS).
+ * Позволяют оценить фрагментацию кортежей и стоимость поиска полей,
+ * в том числе для выбора резервов при fptu_alloc() и fptu_fetch(). */
+typedef struct fptu_stat {
+  uint64_t lookup_hits;        /* успешные поиски полей */
+  uint64_t lookup_misses;      /* поиски отсутствующих полей */
+  uint64_t lookup_scanned;     /* просмотренные при поиске дескрипторы */
+  uint64_t enospace;           /* нехватка места при добавлении полей */
+  uint64_t shrinks;            /* дефрагментации посредством fptu_shrink() */
+  uint64_t shrink_moved_bytes; /* перемещенные при дефрагментации байты */
+  uint64_t junk_units;         /* мусор (юниты) от удаления полей */
+  uint64_t cmp_fastpath;       /* сравнения упорядоченных, пустых или
+                                  побайтно равных кортежей */
+  uint64_t cmp_slowpath;       /* сравнения неупорядоченных кортежей */
+} fptu_stat;
+
+/* Копирует в stat счетчики текущего потока. Возвращает false и обнуляет
+ * stat, если библиотека собрана без поддержки статистики. */
+FPTU_API bool fptu_stat_snapshot(fptu_stat *stat);
+/* Обнуляет счетчики текущего потока. */
+FPTU_API void fptu_stat_reset(void);
+
 //----------------------------------------------------------------------------
 /* Сервисные функции (будет пополнятся). */
 
@@ -1010,6 +1534,74 @@ static __inline fptu_payload *fptu_field_payload(fptu_field *pf) {
   return (fptu_payload *)&pf->body[pf->offset];
 }
 
+/* Карта присутствия тегов (bloom), см. fptu_take_bloom_noshrink(). */
+enum fptu_bloom {
+  fptu_bloom_ct = (fptu_co_dead << fptu_co_shift) | fptu_fr_mask | fptu_uint64
+};
+
+/* Номер бита тега в карте присутствия. */
+static __inline unsigned fptu_bloom_bit(uint_fast16_t ct) {
+  return (unsigned)(((uint32_t)ct * UINT32_C(2654435761)) >> 26);
+}
+
+/* Возвращает дескриптор карты присутствия тегов, либо NULL если ее нет.
+ * Размер кортежа должен быть уже проверен. */
+static __inline const fptu_field *fptu_bloom_field(fptu_ro ro) {
+  const uint_fast16_t items = ro.units[0].varlen.tuple_items;
+  const fptu_field *pf = &ro.units[1].field;
+  return ((items & fptu_lx_bloom) && (items & fptu_lt_mask) &&
+          pf->ct == fptu_bloom_ct)
+             ? pf
+             : NULL;
+}
+
+/* Возвращает false, если поля с тегом ct в кортеже заведомо нет. */
+static __inline bool fptu_bloom_test(const fptu_field *bloom,
+                                     uint_fast16_t ct) {
+  const fptu_payload *payload =
+      (const fptu_payload *)&bloom->body[bloom->offset];
+  return ((payload->u64 >> fptu_bloom_bit(ct)) & 1) != 0;
+}
+
+/* Фиксированная раскладка ("struct mode"), см. fptu_layout_stamp(). */
+enum fptu_layout {
+  fptu_layout_ct = (fptu_co_dead << fptu_co_shift) | fptu_fr_mask | fptu_int64
+};
+
+/* Возвращает дескриптор отпечатка раскладки, либо NULL если его нет. */
+static __inline const fptu_field *fptu_layout_field(fptu_ro ro) {
+  const fptu_field *pf = &ro.units[1].field;
+  if (ro.total_bytes < fptu_unit_size ||
+      ro.total_bytes !=
+          fptu_unit_size + fptu_unit_size * (size_t)ro.units[0].varlen.brutto)
+    return NULL;
+  return ((ro.units[0].varlen.tuple_items & fptu_lx_bloom) &&
+          (ro.units[0].varlen.tuple_items & fptu_lt_mask) &&
+          pf->ct == fptu_layout_ct)
+             ? pf
+             : NULL;
+}
+
+/* Возвращает отпечаток раскладки, либо 0 если кортеж его не несет.
+ * Совпадение с отпечатком шаблона позволяет читать значения по смещениям,
+ * полученным от fptu_layout_offset() для шаблона. */
+static __inline uint64_t fptu_layout_fingerprint(fptu_ro ro) {
+  const fptu_field *pf = fptu_layout_field(ro);
+  return pf ? ((const fptu_payload *)&pf->body[pf->offset])->u64 : 0;
+}
+
+/* Служебное поле в начале дескрипторов (карта присутствия тегов или
+ * отпечаток раскладки), либо NULL. Данные служебного поля занимают
+ * последние 8 байт кортежа. Размер кортежа должен быть уже проверен. */
+static __inline const fptu_field *fptu_service_field(fptu_ro ro) {
+  const uint_fast16_t items = ro.units[0].varlen.tuple_items;
+  const fptu_field *pf = &ro.units[1].field;
+  return ((items & fptu_lx_bloom) && (items & fptu_lt_mask) &&
+          (pf->ct == fptu_bloom_ct || pf->ct == fptu_layout_ct))
+             ? pf
+             : NULL;
+}
+
 #ifdef __cplusplus
 }
 
@@ -1048,6 +1640,11 @@ FPTU_API std::string format(const char *fmt, ...)
 #endif
     ;
 FPTU_API std::string hexadecimal(const void *data, size_t bytes);
+FPTU_API std::string to_json(const fptu_ro &ro,
+                             fptu_tag2name_func *tag2name = nullptr,
+                             fptu_nested_func *nested = nullptr,
+                             const void *schema_ctx = nullptr,
+                             unsigned options = fptu_json_default);
 
 inline const fptu_field *begin(const fptu_ro &ro) { return fptu_begin_ro(ro); }
 
@@ -1065,6 +1662,127 @@ inline const fptu_field *end(const fptu_rw &rw) { return fptu_end_rw(&rw); }
 
 inline const fptu_field *end(const fptu_rw *rw) { return fptu_end_rw(rw); }
 
+/* Отбор полей по типу или маске типов, аналогично type_or_filter
+ * в fptu_first(), но с маской в параметре шаблона. */
+template <int TYPE_OR_FILTER> struct type_filter {
+  bool operator()(const fptu_field *pf) const {
+    return (TYPE_OR_FILTER & fptu_filter)
+               ? (TYPE_OR_FILTER & (INT32_C(1) << fptu_field::type(pf->ct)))
+                     != 0
+               : fptu_field::type(pf->ct) == TYPE_OR_FILTER;
+  }
+};
+
+/* Тоже, но дополнительно с номером колонки, как в fptu_first(). */
+template <int TYPE_OR_FILTER> struct column_filter {
+  unsigned column;
+
+  bool operator()(const fptu_field *pf) const {
+    return fptu_field::colnum(pf->ct) == column &&
+           type_filter<TYPE_OR_FILTER>()(pf);
+  }
+};
+
+/* Диапазон полей для range-for, отобранных предикатом PREDICATE.
+ *
+ * В отличие от fptu_first_ex() и fptu_next_ex() предикат вызывается
+ * не через указатель на функцию, а встраивается в цикл перебора. Поэтому
+ * проход по диапазону не дороже написанного вручную цикла по дескрипторам.
+ * Удаленные поля пропускаются до вызова предиката. */
+template <class PREDICATE> class field_range {
+  const fptu_field *begin_, *end_;
+  PREDICATE predicate_;
+
+  const fptu_field *seek(const fptu_field *pf) const {
+    while (pf < end_ && (pf->ct >= (fptu_co_dead << fptu_co_shift) ||
+                         !predicate_(pf)))
+      ++pf;
+    return pf;
+  }
+
+public:
+  class iterator {
+    friend class field_range;
+    const fptu_field *pf_;
+    const field_range *range_;
+
+    iterator(const fptu_field *pf, const field_range *range)
+        : pf_(pf), range_(range) {}
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef const fptu_field value_type;
+    typedef ptrdiff_t difference_type;
+    typedef const fptu_field *pointer;
+    typedef const fptu_field &reference;
+
+    reference operator*() const { return *pf_; }
+    pointer operator->() const { return pf_; }
+    iterator &operator++() {
+      pf_ = range_->seek(pf_ + 1);
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator prev(*this);
+      ++*this;
+      return prev;
+    }
+    bool operator==(const iterator &other) const { return pf_ == other.pf_; }
+    bool operator!=(const iterator &other) const { return pf_ != other.pf_; }
+  };
+
+  field_range(const fptu_field *begin, const fptu_field *end,
+              const PREDICATE &predicate = PREDICATE())
+      : begin_(begin), end_(end), predicate_(predicate) {}
+
+  iterator begin() const { return iterator(seek(begin_), this); }
+  iterator end() const { return iterator(end_, this); }
+};
+
+/* Поля кортежа заданных типов, например fptu::fields<fptu_any_int>(ro). */
+template <int TYPE_OR_FILTER>
+inline field_range<type_filter<TYPE_OR_FILTER>> fields(const fptu_ro &ro) {
+  return field_range<type_filter<TYPE_OR_FILTER>>(fptu_begin_ro(ro),
+                                                  fptu_end_ro(ro));
+}
+
+template <int TYPE_OR_FILTER>
+inline field_range<type_filter<TYPE_OR_FILTER>> fields(const fptu_rw *pt) {
+  return field_range<type_filter<TYPE_OR_FILTER>>(fptu_begin_rw(pt),
+                                                  fptu_end_rw(pt));
+}
+
+/* Поля кортежа заданной колонки и типов, включая коллекции. */
+template <int TYPE_OR_FILTER>
+inline field_range<column_filter<TYPE_OR_FILTER>> fields(const fptu_ro &ro,
+                                                         unsigned column) {
+  const column_filter<TYPE_OR_FILTER> filter = {column};
+  return field_range<column_filter<TYPE_OR_FILTER>>(fptu_begin_ro(ro),
+                                                    fptu_end_ro(ro), filter);
+}
+
+template <int TYPE_OR_FILTER>
+inline field_range<column_filter<TYPE_OR_FILTER>> fields(const fptu_rw *pt,
+                                                         unsigned column) {
+  const column_filter<TYPE_OR_FILTER> filter = {column};
+  return field_range<column_filter<TYPE_OR_FILTER>>(fptu_begin_rw(pt),
+                                                    fptu_end_rw(pt), filter);
+}
+
+/* Поля кортежа, отобранные произвольным предикатом, в том числе лямбдой
+ * вида bool(const fptu_field *). */
+template <class PREDICATE>
+inline field_range<PREDICATE> fields(const fptu_ro &ro,
+                                     const PREDICATE &predicate) {
+  return field_range<PREDICATE>(fptu_begin_ro(ro), fptu_end_ro(ro), predicate);
+}
+
+template <class PREDICATE>
+inline field_range<PREDICATE> fields(const fptu_rw *pt,
+                                     const PREDICATE &predicate) {
+  return field_range<PREDICATE>(fptu_begin_rw(pt), fptu_end_rw(pt), predicate);
+}
+
 static inline int64_t cast_wide(int8_t value) { return value; }
 static inline int64_t cast_wide(int16_t value) { return value; }
 static inline int64_t cast_wide(int32_t value) { return value; }
@@ -1171,6 +1889,15 @@ inline bool is_within<double_t, uint64_t, uint64_t>(double_t value,
   return value >= begin && value <= end;
 }
 
+/* Значение не переполняет float, при этом NaN и бесконечности допустимы. */
+template <typename VALUE_TYPE>
+inline bool is_fp32_compatible(VALUE_TYPE value) {
+  const double_t wide = (double_t)value;
+  return !(wide < -FLT_MAX || wide > FLT_MAX) ||
+         wide == std::numeric_limits<double_t>::infinity() ||
+         wide == -std::numeric_limits<double_t>::infinity();
+}
+
 template <fptu_type field_type, typename RESULT_TYPE>
 static RESULT_TYPE get_number(const fptu_field *field) {
   assert(field != nullptr);
@@ -1212,7 +1939,7 @@ static RESULT_TYPE get_number(const fptu_field *field) {
                      std::numeric_limits<RESULT_TYPE>::max()));
     return (RESULT_TYPE)fptu_field_payload(field)->fp32;
   case fptu_fp64:
-    assert(is_within(fptu_field_payload(field)->fp32,
+    assert(is_within(fptu_field_payload(field)->fp64,
                      std::numeric_limits<RESULT_TYPE>::lowest(),
                      std::numeric_limits<RESULT_TYPE>::max()));
     return (RESULT_TYPE)fptu_field_payload(field)->fp64;
@@ -1229,7 +1956,7 @@ static void set_number(fptu_field *field, const VALUE_TYPE &value) {
     assert(false);
     break;
   case fptu_uint16:
-    assert(is_within(value, 0, INT16_MAX));
+    assert(is_within(value, 0, UINT16_MAX));
     field->offset = (uint16_t)value;
     break;
   case fptu_uint32:
@@ -1249,11 +1976,10 @@ static void set_number(fptu_field *field, const VALUE_TYPE &value) {
     fptu_field_payload(field)->i64 = (int64_t)value;
     break;
   case fptu_fp32:
-    assert(value >= FLT_MIN && value <= FLT_MAX);
+    assert(is_fp32_compatible(value));
     fptu_field_payload(field)->fp32 = (float)value;
     break;
   case fptu_fp64:
-    assert(value >= DBL_MIN && value <= DBL_MAX);
     fptu_field_payload(field)->fp64 = (double)value;
     break;
   }
@@ -1269,7 +1995,7 @@ static int upsert_number(fptu_rw *pt, unsigned colnum,
     assert(false);
     return 0;
   case fptu_uint16:
-    assert(is_within(value, 0, INT16_MAX));
+    assert(is_within(value, 0, UINT16_MAX));
     return fptu_upsert_uint16(pt, colnum, (uint_fast16_t)value);
   case fptu_uint32:
     assert(is_within(value, 0u, UINT32_MAX));
@@ -1284,14 +2010,513 @@ static int upsert_number(fptu_rw *pt, unsigned colnum,
     assert(is_within(value, INT64_MIN, INT64_MAX));
     return fptu_upsert_int64(pt, colnum, (int_fast64_t)value);
   case fptu_fp32:
-    assert(value >= FLT_MIN && value <= FLT_MAX);
+    assert(is_fp32_compatible(value));
     return fptu_upsert_fp32(pt, colnum, (float_t)value);
   case fptu_fp64:
-    assert(value >= DBL_MIN && value <= DBL_MAX);
     return fptu_upsert_fp64(pt, colnum, (double_t)value);
   }
 }
 
+template <fptu_type field_type, typename VALUE_TYPE>
+static int insert_number(fptu_rw *pt, unsigned colnum,
+                         const VALUE_TYPE &value) {
+  static_assert(fptu_any_number & (INT32_C(1) << field_type),
+                "field_type must be numerical");
+  switch (field_type) {
+  default:
+    assert(false);
+    return 0;
+  case fptu_uint16:
+    assert(is_within(value, 0, UINT16_MAX));
+    return fptu_insert_uint16(pt, colnum, (uint_fast16_t)value);
+  case fptu_uint32:
+    assert(is_within(value, 0u, UINT32_MAX));
+    return fptu_insert_uint32(pt, colnum, (uint_fast32_t)value);
+  case fptu_uint64:
+    assert(is_within(value, 0u, UINT64_MAX));
+    return fptu_insert_uint64(pt, colnum, (uint_fast64_t)value);
+  case fptu_int32:
+    assert(is_within(value, INT32_MIN, INT32_MAX));
+    return fptu_insert_int32(pt, colnum, (int_fast32_t)value);
+  case fptu_int64:
+    assert(is_within(value, INT64_MIN, INT64_MAX));
+    return fptu_insert_int64(pt, colnum, (int_fast64_t)value);
+  case fptu_fp32:
+    assert(is_fp32_compatible(value));
+    return fptu_insert_fp32(pt, colnum, (float_t)value);
+  case fptu_fp64:
+    return fptu_insert_fp64(pt, colnum, (double_t)value);
+  }
+}
+
+/* Колонка с известными при компиляции номером и типом. Поиск выполняется
+ * с константными аргументами, а тег доступен как constexpr, в том числе
+ * для кода генерируемого утилитой fptu_gen. */
+template <unsigned COLUMN, fptu_type TYPE> struct column_traits {
+  static_assert(COLUMN <= fptu_max_cols, "column number is out of range");
+  static constexpr unsigned column = COLUMN;
+  static constexpr fptu_type type = TYPE;
+  static constexpr uint_fast16_t tag =
+      (uint_fast16_t)((COLUMN << fptu_co_shift) | TYPE);
+
+  static const fptu_field *lookup(const fptu_ro &ro) {
+    return fptu_lookup_ro(ro, COLUMN, TYPE);
+  }
+  static fptu_field *lookup(fptu_rw *pt) {
+    return fptu_lookup(pt, COLUMN, TYPE);
+  }
+};
+
+template <unsigned COLUMN, fptu_type TYPE>
+constexpr unsigned column_traits<COLUMN, TYPE>::column;
+template <unsigned COLUMN, fptu_type TYPE>
+constexpr fptu_type column_traits<COLUMN, TYPE>::type;
+template <unsigned COLUMN, fptu_type TYPE>
+constexpr uint_fast16_t column_traits<COLUMN, TYPE>::tag;
+
+/* Преобразование между полями и значениями C++ для tuple_ro::get(),
+ * tuple_rw::set() и tuple_rw::insert(). Для чисел тип поля задается тегом,
+ * а значение приводится к T. Для остальных типов C++ тип поля должен
+ * соответствовать T, иначе возвращается FPTU_EINVAL (get() при этом
+ * возвращает T(), либо пустое значение как fptu_field_xyz()). */
+template <typename T> struct value_traits {
+  static_assert(std::numeric_limits<T>::is_specialized,
+                "T must be numerical or have a value_traits<> specialization");
+
+  static T get(const fptu_field *pf, int &error) {
+    switch (pf->type()) {
+    default:
+      error = FPTU_EINVAL;
+      return T();
+    case fptu_uint16:
+      return get_number<fptu_uint16, T>(pf);
+    case fptu_int32:
+      return get_number<fptu_int32, T>(pf);
+    case fptu_uint32:
+      return get_number<fptu_uint32, T>(pf);
+    case fptu_fp32:
+      return get_number<fptu_fp32, T>(pf);
+    case fptu_int64:
+      return get_number<fptu_int64, T>(pf);
+    case fptu_uint64:
+      return get_number<fptu_uint64, T>(pf);
+    case fptu_fp64:
+      return get_number<fptu_fp64, T>(pf);
+    }
+  }
+
+  static int upsert(fptu_rw *pt, uint_fast16_t tag, const T &value) {
+    const unsigned colnum = (unsigned)fptu_field::colnum(tag);
+    switch (fptu_field::type(tag)) {
+    default:
+      return FPTU_EINVAL;
+    case fptu_uint16:
+      return upsert_number<fptu_uint16>(pt, colnum, value);
+    case fptu_int32:
+      return upsert_number<fptu_int32>(pt, colnum, value);
+    case fptu_uint32:
+      return upsert_number<fptu_uint32>(pt, colnum, value);
+    case fptu_fp32:
+      return upsert_number<fptu_fp32>(pt, colnum, value);
+    case fptu_int64:
+      return upsert_number<fptu_int64>(pt, colnum, value);
+    case fptu_uint64:
+      return upsert_number<fptu_uint64>(pt, colnum, value);
+    case fptu_fp64:
+      return upsert_number<fptu_fp64>(pt, colnum, value);
+    }
+  }
+
+  static int insert(fptu_rw *pt, uint_fast16_t tag, const T &value) {
+    const unsigned colnum = (unsigned)fptu_field::colnum(tag);
+    switch (fptu_field::type(tag)) {
+    default:
+      return FPTU_EINVAL;
+    case fptu_uint16:
+      return insert_number<fptu_uint16>(pt, colnum, value);
+    case fptu_int32:
+      return insert_number<fptu_int32>(pt, colnum, value);
+    case fptu_uint32:
+      return insert_number<fptu_uint32>(pt, colnum, value);
+    case fptu_fp32:
+      return insert_number<fptu_fp32>(pt, colnum, value);
+    case fptu_int64:
+      return insert_number<fptu_int64>(pt, colnum, value);
+    case fptu_uint64:
+      return insert_number<fptu_uint64>(pt, colnum, value);
+    case fptu_fp64:
+      return insert_number<fptu_fp64>(pt, colnum, value);
+    }
+  }
+};
+
+template <> struct value_traits<const char *> {
+  static const char *get(const fptu_field *pf, int &error) {
+    if (pf->type() != fptu_cstr)
+      error = FPTU_EINVAL;
+    return fptu_field_cstr(pf);
+  }
+  static int upsert(fptu_rw *pt, uint_fast16_t tag, const char *value) {
+    return (fptu_field::type(tag) == fptu_cstr)
+               ? fptu_upsert_cstr(pt, (unsigned)fptu_field::colnum(tag), value)
+               : FPTU_EINVAL;
+  }
+  static int insert(fptu_rw *pt, uint_fast16_t tag, const char *value) {
+    return (fptu_field::type(tag) == fptu_cstr)
+               ? fptu_insert_cstr(pt, (unsigned)fptu_field::colnum(tag), value)
+               : FPTU_EINVAL;
+  }
+};
+
+template <> struct value_traits<std::string> {
+  static std::string get(const fptu_field *pf, int &error) {
+    if (pf->type() != fptu_cstr)
+      error = FPTU_EINVAL;
+    const char *cstr = fptu_field_cstr(pf);
+    return cstr ? std::string(cstr) : std::string();
+  }
+  static int upsert(fptu_rw *pt, uint_fast16_t tag, const std::string &value) {
+    return (fptu_field::type(tag) == fptu_cstr)
+               ? fptu_upsert_string(pt, (unsigned)fptu_field::colnum(tag),
+                                    value.data(), value.size())
+               : FPTU_EINVAL;
+  }
+  static int insert(fptu_rw *pt, uint_fast16_t tag, const std::string &value) {
+    return (fptu_field::type(tag) == fptu_cstr)
+               ? fptu_insert_string(pt, (unsigned)fptu_field::colnum(tag),
+                                    value.data(), value.size())
+               : FPTU_EINVAL;
+  }
+};
+
+template <> struct value_traits<fptu_time> {
+  static fptu_time get(const fptu_field *pf, int &error) {
+    if (pf->type() != fptu_datetime)
+      error = FPTU_EINVAL;
+    return fptu_field_datetime(pf);
+  }
+  static int upsert(fptu_rw *pt, uint_fast16_t tag, const fptu_time &value) {
+    return (fptu_field::type(tag) == fptu_datetime)
+               ? fptu_upsert_datetime(pt, (unsigned)fptu_field::colnum(tag),
+                                      value)
+               : FPTU_EINVAL;
+  }
+  static int insert(fptu_rw *pt, uint_fast16_t tag, const fptu_time &value) {
+    return (fptu_field::type(tag) == fptu_datetime)
+               ? fptu_insert_datetime(pt, (unsigned)fptu_field::colnum(tag),
+                                      value)
+               : FPTU_EINVAL;
+  }
+};
+
+template <> struct value_traits<struct iovec> {
+  static struct iovec get(const fptu_field *pf, int &error) {
+    if (pf->type() != fptu_opaque)
+      error = FPTU_EINVAL;
+    return fptu_field_opaque(pf);
+  }
+  static int upsert(fptu_rw *pt, uint_fast16_t tag, const struct iovec &value) {
+    return (fptu_field::type(tag) == fptu_opaque)
+               ? fptu_upsert_opaque(pt, (unsigned)fptu_field::colnum(tag),
+                                    value.iov_base, value.iov_len)
+               : FPTU_EINVAL;
+  }
+  static int insert(fptu_rw *pt, uint_fast16_t tag, const struct iovec &value) {
+    return (fptu_field::type(tag) == fptu_opaque)
+               ? fptu_insert_opaque(pt, (unsigned)fptu_field::colnum(tag),
+                                    value.iov_base, value.iov_len)
+               : FPTU_EINVAL;
+  }
+};
+
+template <> struct value_traits<fptu_ro> {
+  static fptu_ro get(const fptu_field *pf, int &error) {
+    if (pf->type() != fptu_nested)
+      error = FPTU_EINVAL;
+    return fptu_field_nested(pf);
+  }
+  static int upsert(fptu_rw *pt, uint_fast16_t tag, const fptu_ro &value) {
+    return (fptu_field::type(tag) == fptu_nested)
+               ? fptu_upsert_nested(pt, (unsigned)fptu_field::colnum(tag),
+                                    value)
+               : FPTU_EINVAL;
+  }
+  static int insert(fptu_rw *pt, uint_fast16_t tag, const fptu_ro &value) {
+    return (fptu_field::type(tag) == fptu_nested)
+               ? fptu_insert_nested(pt, (unsigned)fptu_field::colnum(tag),
+                                    value)
+               : FPTU_EINVAL;
+  }
+};
+
+/* Не владеющее представление сериализованной формы кортежа. */
+class tuple_ro {
+  fptu_ro ro_;
+
+public:
+  tuple_ro() {
+    ro_.units = nullptr;
+    ro_.total_bytes = 0;
+  }
+  tuple_ro(const fptu_ro &ro) : ro_(ro) {}
+  operator const fptu_ro &() const { return ro_; }
+  const fptu_ro &ro() const { return ro_; }
+  const void *data() const { return ro_.units; }
+  size_t size() const { return ro_.total_bytes; }
+  const char *check() const { return fptu_check_ro(ro_); }
+
+  const fptu_field *begin() const { return fptu_begin_ro(ro_); }
+  const fptu_field *end() const { return fptu_end_ro(ro_); }
+  const fptu_field *lookup(uint_fast16_t tag) const {
+    return fptu_lookup_ro(ro_, (unsigned)fptu_field::colnum(tag),
+                          fptu_field::type(tag));
+  }
+  bool has(uint_fast16_t tag) const { return lookup(tag) != nullptr; }
+
+  /* Возвращает значение поля, либо T() если поле отсутствует (ошибка
+   * FPTU_ENOFIELD) или тип поля не приводится к T (ошибка FPTU_EINVAL). */
+  template <typename T> T get(uint_fast16_t tag, int *error = nullptr) const {
+    const fptu_field *pf = lookup(tag);
+    int rc = pf ? FPTU_SUCCESS : FPTU_ENOFIELD;
+    const T value = pf ? value_traits<T>::get(pf, rc) : T();
+    if (error)
+      *error = rc;
+    return value;
+  }
+};
+
+/* Владеющая модифицируемая форма кортежа в буфере от ALLOCATOR.
+ *
+ * При нехватке места set() и insert() перемещают кортеж в буфер большего
+ * размера, как минимум удваивая запас для полей и данных, поэтому
+ * FPTU_ENOSPACE возвращается только при достижении предельного размера
+ * кортежа. Указатели на поля, а также результаты take() и rw(), при этом
+ * становятся недействительными. Нехватка памяти сообщается исключением
+ * от ALLOCATOR, как в контейнерах STL. */
+template <class ALLOCATOR = std::allocator<fptu_unit>>
+class basic_tuple_rw
+    : private std::allocator_traits<ALLOCATOR>::template rebind_alloc<
+          fptu_unit> {
+  typedef typename std::allocator_traits<ALLOCATOR>::template rebind_alloc<
+      fptu_unit>
+      allocator_type;
+  typedef std::allocator_traits<allocator_type> allocator_traits;
+
+  fptu_rw *pt_;
+  size_t units_; /* размер буфера в юнитах */
+
+  void release() {
+    if (pt_)
+      allocator_traits::deallocate(*this, (fptu_unit *)pt_, units_);
+    pt_ = nullptr;
+    units_ = 0;
+  }
+
+  /* Перемещает кортеж в буфер с запасом не менее more_items полей и
+   * more_payload байт данных, но и не менее текущей емкости. */
+  bool grow(size_t more_items, size_t more_payload) {
+    const fptu_ro ro = fptu_take(pt_);
+    const size_t items_capacity = pt_->pivot - 1;
+    const size_t payload_capacity = (pt_->end - pt_->pivot) * fptu_unit_size;
+    if (more_items < items_capacity)
+      more_items = items_capacity;
+    if (more_items < 4)
+      more_items = 4;
+    if (more_items > fptu_max_fields)
+      more_items = fptu_max_fields;
+    if (more_payload < payload_capacity)
+      more_payload = payload_capacity;
+    if (more_payload < 64)
+      more_payload = 64;
+    if (more_payload > fptu_max_tuple_bytes)
+      more_payload = fptu_max_tuple_bytes;
+
+    const size_t units =
+        fptu_get_buffer_size(ro, (unsigned)more_items, (unsigned)more_payload) /
+        fptu_unit_size;
+    if (units <= units_)
+      return false;
+
+    fptu_unit *buffer = allocator_traits::allocate(*this, units);
+    fptu_rw *pt = fptu_fetch(ro, buffer, units * fptu_unit_size,
+                             (unsigned)more_items);
+    assert(pt != nullptr);
+    release();
+    pt_ = pt;
+    units_ = units;
+    return true;
+  }
+
+public:
+  explicit basic_tuple_rw(size_t items_limit = 16, size_t data_bytes = 256,
+                          const ALLOCATOR &allocator = ALLOCATOR())
+      : allocator_type(allocator), pt_(nullptr), units_(0) {
+    if (items_limit > fptu_max_fields)
+      items_limit = fptu_max_fields;
+    const size_t units = fptu_space(items_limit, data_bytes) / fptu_unit_size;
+    fptu_unit *buffer = allocator_traits::allocate(*this, units);
+    pt_ = fptu_init(buffer, units * fptu_unit_size, items_limit);
+    assert(pt_ != nullptr);
+    units_ = units;
+  }
+
+  /* Копирует сериализованную форму, корректность которой не проверяется. */
+  explicit basic_tuple_rw(const fptu_ro &source, size_t more_items = 16,
+                          size_t more_payload = 256,
+                          const ALLOCATOR &allocator = ALLOCATOR())
+      : allocator_type(allocator), pt_(nullptr), units_(0) {
+    if (more_items > fptu_max_fields)
+      more_items = fptu_max_fields;
+    const size_t units =
+        fptu_get_buffer_size(source, (unsigned)more_items,
+                             (unsigned)more_payload) /
+        fptu_unit_size;
+    fptu_unit *buffer = allocator_traits::allocate(*this, units);
+    pt_ = fptu_fetch(source, buffer, units * fptu_unit_size,
+                     (unsigned)more_items);
+    units_ = units;
+    if (pt_ == nullptr) {
+      allocator_traits::deallocate(*this, buffer, units);
+      units_ = 0;
+    }
+  }
+
+  basic_tuple_rw(const basic_tuple_rw &) = delete;
+  basic_tuple_rw &operator=(const basic_tuple_rw &) = delete;
+  basic_tuple_rw(basic_tuple_rw &&other) noexcept
+      : allocator_type(std::move(other)), pt_(other.pt_),
+        units_(other.units_) {
+    other.pt_ = nullptr;
+    other.units_ = 0;
+  }
+  basic_tuple_rw &operator=(basic_tuple_rw &&other) noexcept {
+    std::swap(static_cast<allocator_type &>(*this),
+              static_cast<allocator_type &>(other));
+    std::swap(pt_, other.pt_);
+    std::swap(units_, other.units_);
+    return *this;
+  }
+  ~basic_tuple_rw() { release(); }
+
+  /* Кортеж отсутствует после перемещения, либо если источник для
+   * копирования некорректен. В этом случае set() и insert() возвращают
+   * FPTU_EINVAL, erase() возвращает -FPTU_EINVAL (как fptu_erase()),
+   * take() и take_noshrink() пустой tuple_ro, shrink() и reserve()
+   * false, а поля не находятся. */
+  bool valid() const { return pt_ != nullptr; }
+  fptu_rw *rw() const { return pt_; }
+  size_t capacity() const { return units_ * fptu_unit_size; }
+  tuple_ro take() { return valid() ? tuple_ro(fptu_take(pt_)) : tuple_ro(); }
+  tuple_ro take_noshrink() const {
+    return valid() ? tuple_ro(fptu_take_noshrink(pt_)) : tuple_ro();
+  }
+  const char *check() const { return fptu_check(pt_); }
+  int clear() { return fptu_clear(pt_); }
+  bool shrink() { return valid() && fptu_shrink(pt_); }
+
+  /* Обеспечивает место для more_items полей и more_payload байт данных. */
+  bool reserve(size_t more_items, size_t more_payload) {
+    if (!valid())
+      return false;
+    if (fptu_space4items(pt_) >= more_items &&
+        fptu_space4data(pt_) >= more_payload)
+      return true;
+    fptu_cond_shrink(pt_);
+    if (fptu_space4items(pt_) >= more_items &&
+        fptu_space4data(pt_) >= more_payload)
+      return true;
+    return grow(more_items, more_payload) &&
+           fptu_space4items(pt_) >= more_items &&
+           fptu_space4data(pt_) >= more_payload;
+  }
+
+  const fptu_field *lookup(uint_fast16_t tag) const {
+    if (!valid())
+      return nullptr;
+    return fptu_lookup(pt_, (unsigned)fptu_field::colnum(tag),
+                       fptu_field::type(tag));
+  }
+  bool has(uint_fast16_t tag) const { return lookup(tag) != nullptr; }
+
+  /* Возвращает значение поля, либо T() если поле отсутствует (ошибка
+   * FPTU_ENOFIELD) или тип поля не приводится к T (ошибка FPTU_EINVAL). */
+  template <typename T> T get(uint_fast16_t tag, int *error = nullptr) const {
+    const fptu_field *pf = lookup(tag);
+    int rc = pf ? FPTU_SUCCESS : FPTU_ENOFIELD;
+    const T value = pf ? value_traits<T>::get(pf, rc) : T();
+    if (error)
+      *error = rc;
+    return value;
+  }
+
+  /* Обновляет первый экземпляр поля, либо добавляет поле. */
+  template <typename T> int set(uint_fast16_t tag, const T &value) {
+    /* строковые литералы сводятся к const char * */
+    typedef typename std::decay<const T>::type value_type;
+    if (!valid())
+      return FPTU_EINVAL;
+    for (;;) {
+      const int rc = value_traits<value_type>::upsert(pt_, tag, value);
+      if (rc != FPTU_ENOSPACE || !grow(0, 0))
+        return rc;
+    }
+  }
+
+  /* Добавляет еще один экземпляр поля. */
+  template <typename T> int insert(uint_fast16_t tag, const T &value) {
+    /* строковые литералы сводятся к const char * */
+    typedef typename std::decay<const T>::type value_type;
+    if (!valid())
+      return FPTU_EINVAL;
+    for (;;) {
+      const int rc = value_traits<value_type>::insert(pt_, tag, value);
+      if (rc != FPTU_ENOSPACE || !grow(0, 0))
+        return rc;
+    }
+  }
+
+  /* Удаляет все экземпляры поля, возвращая их количество. */
+  int erase(uint_fast16_t tag) {
+    if (!valid())
+      return -FPTU_EINVAL;
+    return fptu_erase(pt_, (unsigned)fptu_field::colnum(tag),
+                      fptu_filter | (INT32_C(1) << fptu_field::type(tag)));
+  }
+};
+
+typedef basic_tuple_rw<> tuple_rw;
+
+/* Компаратор для std::sort() и т.п. по спецификации ключа сортировки,
+ * см. описание fptu_keydef. Спецификация не копируется. */
+class key_comparator {
+  const fptu_keydef *spec_;
+  size_t count_;
+
+public:
+  key_comparator(const fptu_keydef *spec, size_t count)
+      : spec_(spec), count_(count) {}
+  template <size_t N>
+  explicit key_comparator(const fptu_keydef (&spec)[N])
+      : spec_(spec), count_(N) {}
+
+  fptu_lge compare(const fptu_ro &left, const fptu_ro &right) const {
+    return fptu_cmp_keys(left, right, spec_, count_);
+  }
+  bool operator()(const fptu_ro &left, const fptu_ro &right) const {
+    return compare(left, right) == fptu_lt;
+  }
+
+  size_t key_size() const { return fptu_key_size(spec_, count_); }
+  int make_key(const fptu_ro &ro, void *key, size_t key_bytes) const {
+    return fptu_key_build(ro, spec_, count_, key, key_bytes);
+  }
+  std::string make_key(const fptu_ro &ro) const {
+    std::string key(key_size(), '\0');
+    make_key(ro, &key[0], key.size());
+    return key;
+  }
+};
+
 } /* namespace fptu */
 
 namespace std {
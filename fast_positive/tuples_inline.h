@@ -0,0 +1,237 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Встраиваемые (inline) варианты поиска и чтения полей.
+ *
+ * Функции повторяют семантику fptu_lookup_ro() и fptu_get_xyz(), но целиком
+ * определены в заголовке. Поэтому в горячих циклах исчезает вызов через PLT,
+ * а номер колонки и тип, будучи константами, сворачиваются компилятором
+ * в готовое значение дескриптора для сравнения.
+ *
+ * Заголовок подключается явно, экспортируемые функции библиотеки
+ * остаются как есть. Встраиваемые варианты не обновляют счетчики
+ * fptu_stat, даже если библиотека собрана с HAVE_FPTU_STATISTICS. */
+
+#pragma once
+#ifndef FAST_POSITIVE_TUPLES_INLINE_H
+#define FAST_POSITIVE_TUPLES_INLINE_H
+
+#include "fast_positive/tuples.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static __alwaysinline const fptu_field *
+fptu_inline_lookup_ro(fptu_ro ro, unsigned column, int type_or_filter) {
+  const fptu_field *begin, *end, *pf, *bloom;
+
+  if (ro.total_bytes < fptu_unit_size ||
+      ro.total_bytes !=
+          fptu_unit_size + fptu_unit_size * (size_t)ro.units[0].varlen.brutto ||
+      column > fptu_max_cols)
+    return NULL;
+
+  begin = &ro.units[1].field;
+  end = begin + (ro.units[0].varlen.tuple_items & fptu_lt_mask);
+  bloom = fptu_bloom_field(ro);
+  if (bloom)
+    ++begin;
+  if (type_or_filter & fptu_filter) {
+    for (pf = begin; pf < end; ++pf)
+      if ((unsigned)(pf->ct >> fptu_co_shift) == column &&
+          (type_or_filter & (1 << (pf->ct & fptu_ty_mask))))
+        return pf;
+  } else {
+    const uint_fast16_t ct =
+        (uint_fast16_t)((column << fptu_co_shift) | (unsigned)type_or_filter);
+    if (bloom && !fptu_bloom_test(bloom, ct))
+      return NULL;
+    for (pf = begin; pf < end; ++pf)
+      if (pf->ct == ct)
+        return pf;
+  }
+  return NULL;
+}
+
+/* Встраиваемый вариант fptu_lookup_ro_hint(). */
+static __alwaysinline const fptu_field *
+fptu_inline_lookup_ro_hint(fptu_ro ro, unsigned column, int type_or_filter,
+                           unsigned *hint) {
+  const fptu_field *pf;
+
+  if (ro.total_bytes >= fptu_unit_size &&
+      ro.total_bytes ==
+          fptu_unit_size + fptu_unit_size * (size_t)ro.units[0].varlen.brutto &&
+      column <= fptu_max_cols &&
+      *hint < (ro.units[0].varlen.tuple_items & fptu_lt_mask)) {
+    pf = &ro.units[1 + *hint].field;
+    if (type_or_filter & fptu_filter) {
+      if ((unsigned)(pf->ct >> fptu_co_shift) == column &&
+          (type_or_filter & (1 << (pf->ct & fptu_ty_mask))))
+        return pf;
+    } else if (pf->ct == (uint_fast16_t)((column << fptu_co_shift) |
+                                         (unsigned)type_or_filter))
+      return pf;
+  }
+
+  pf = fptu_inline_lookup_ro(ro, column, type_or_filter);
+  if (pf)
+    *hint = (unsigned)(pf - &ro.units[1].field);
+  return pf;
+}
+
+static __inline const fptu_payload *
+fptu_inline_payload(const fptu_field *pf) {
+  return (const fptu_payload *)&pf->body[pf->offset];
+}
+
+/* Общая часть всех fptu_inline_get_xyz(): поиск и код ошибки. */
+static __alwaysinline const fptu_field *
+fptu_inline_get(fptu_ro ro, unsigned column, int type, int *error) {
+  const fptu_field *pf = fptu_inline_lookup_ro(ro, column, type);
+  if (error)
+    *error = pf ? FPTU_SUCCESS : FPTU_ENOFIELD;
+  return pf;
+}
+
+//----------------------------------------------------------------------------
+
+static __inline uint_fast16_t fptu_inline_get_uint16(fptu_ro ro,
+                                                     unsigned column,
+                                                     int *error) {
+  const fptu_field *pf = fptu_inline_get(ro, column, fptu_uint16, error);
+  return pf ? pf->offset : FPTU_DENIL_UINT16;
+}
+
+static __inline int_fast32_t fptu_inline_get_int32(fptu_ro ro, unsigned column,
+                                                   int *error) {
+  const fptu_field *pf = fptu_inline_get(ro, column, fptu_int32, error);
+  return pf ? fptu_inline_payload(pf)->i32 : FPTU_DENIL_INT32;
+}
+
+static __inline uint_fast32_t fptu_inline_get_uint32(fptu_ro ro,
+                                                     unsigned column,
+                                                     int *error) {
+  const fptu_field *pf = fptu_inline_get(ro, column, fptu_uint32, error);
+  return pf ? fptu_inline_payload(pf)->u32 : FPTU_DENIL_UINT32;
+}
+
+static __inline int_fast64_t fptu_inline_get_int64(fptu_ro ro, unsigned column,
+                                                   int *error) {
+  const fptu_field *pf = fptu_inline_get(ro, column, fptu_int64, error);
+  return pf ? fptu_inline_payload(pf)->i64 : FPTU_DENIL_INT64;
+}
+
+static __inline uint_fast64_t fptu_inline_get_uint64(fptu_ro ro,
+                                                     unsigned column,
+                                                     int *error) {
+  const fptu_field *pf = fptu_inline_get(ro, column, fptu_uint64, error);
+  return pf ? fptu_inline_payload(pf)->u64 : FPTU_DENIL_UINT64;
+}
+
+static __inline double_t fptu_inline_get_fp64(fptu_ro ro, unsigned column,
+                                              int *error) {
+  const fptu_field *pf = fptu_inline_get(ro, column, fptu_fp64, error);
+  return pf ? fptu_inline_payload(pf)->fp64 : FPTU_DENIL_FP64;
+}
+
+static __inline float_t fptu_inline_get_fp32(fptu_ro ro, unsigned column,
+                                             int *error) {
+  const fptu_field *pf = fptu_inline_get(ro, column, fptu_fp32, error);
+  return pf ? fptu_inline_payload(pf)->fp32 : FPTU_DENIL_FP32;
+}
+
+static __inline fptu_time fptu_inline_get_datetime(fptu_ro ro, unsigned column,
+                                                   int *error) {
+  const fptu_field *pf = fptu_inline_get(ro, column, fptu_datetime, error);
+  if (!pf)
+    return FPTU_DENIL_TIME;
+  return fptu_inline_payload(pf)->dt;
+}
+
+//----------------------------------------------------------------------------
+
+static __inline const uint8_t *fptu_inline_get_96(fptu_ro ro, unsigned column,
+                                                  int *error) {
+  const fptu_field *pf = fptu_inline_get(ro, column, fptu_96, error);
+  return pf ? fptu_inline_payload(pf)->fixbin : FPTU_DENIL_FIXBIN;
+}
+
+static __inline const uint8_t *fptu_inline_get_128(fptu_ro ro, unsigned column,
+                                                   int *error) {
+  const fptu_field *pf = fptu_inline_get(ro, column, fptu_128, error);
+  return pf ? fptu_inline_payload(pf)->fixbin : FPTU_DENIL_FIXBIN;
+}
+
+static __inline const uint8_t *fptu_inline_get_160(fptu_ro ro, unsigned column,
+                                                   int *error) {
+  const fptu_field *pf = fptu_inline_get(ro, column, fptu_160, error);
+  return pf ? fptu_inline_payload(pf)->fixbin : FPTU_DENIL_FIXBIN;
+}
+
+static __inline const uint8_t *fptu_inline_get_256(fptu_ro ro, unsigned column,
+                                                   int *error) {
+  const fptu_field *pf = fptu_inline_get(ro, column, fptu_256, error);
+  return pf ? fptu_inline_payload(pf)->fixbin : FPTU_DENIL_FIXBIN;
+}
+
+static __inline const char *fptu_inline_get_cstr(fptu_ro ro, unsigned column,
+                                                 int *error) {
+  const fptu_field *pf = fptu_inline_get(ro, column, fptu_cstr, error);
+  return pf ? fptu_inline_payload(pf)->cstr : FPTU_DENIL_CSTR;
+}
+
+static __inline struct iovec fptu_inline_get_opaque(fptu_ro ro,
+                                                    unsigned column,
+                                                    int *error) {
+  const fptu_field *pf = fptu_inline_get(ro, column, fptu_opaque, error);
+  struct iovec io;
+  if (!pf) {
+    io.iov_base = FPTU_DENIL_FIXBIN;
+    io.iov_len = 0;
+  } else {
+    const fptu_payload *payload = fptu_inline_payload(pf);
+    io.iov_base = (void *)payload->other.data;
+    io.iov_len = payload->other.varlen.opaque_bytes;
+  }
+  return io;
+}
+
+static __inline fptu_ro fptu_inline_get_nested(fptu_ro ro, unsigned column,
+                                               int *error) {
+  const fptu_field *pf = fptu_inline_get(ro, column, fptu_nested, error);
+  fptu_ro tuple;
+  if (!pf) {
+    tuple.units = NULL;
+    tuple.total_bytes = 0;
+  } else {
+    const fptu_payload *payload = fptu_inline_payload(pf);
+    tuple.units = (const fptu_unit *)payload;
+    tuple.total_bytes =
+        fptu_unit_size * ((size_t)payload->other.varlen.brutto + 1);
+  }
+  return tuple;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FAST_POSITIVE_TUPLES_INLINE_H */
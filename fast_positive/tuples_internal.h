@@ -430,6 +430,16 @@ static __inline bool ct_match_fixedsize(uint_fast16_t ct, size_t units) {
 }
 
 size_t fptu_field_units(const fptu_field *pf);
+/* Отпечаток раскладки дескрипторов [begin, end) и data_units юнитов
+ * данных, либо 0 если раскладка не фиксированная. */
+uint64_t fptu_layout_digest(const fptu_field *begin, const fptu_field *end,
+                            size_t data_units);
+
+/* Элементы массива следуют сразу за первым 32-битным словом данных,
+ * в котором хранится брутто-размер и количество элементов. */
+static __inline const void *fptu_array_items(const fptu_payload *payload) {
+  return payload->other.data;
+}
 
 static __inline const void *fptu_ro_detent(fptu_ro ro) {
   return (char *)ro.sys.iov_base + ro.sys.iov_len;
@@ -441,6 +451,34 @@ static __inline const void *fptu_detent(const fptu_rw *rw) {
 
 fptu_field *fptu_lookup_ct(fptu_rw *pt, uint_fast16_t ct);
 
+#if HAVE_FPTU_STATISTICS
+extern __thread fptu_stat fptu_stat_tls;
+#define FPTU_STAT_ADD(counter, value) ((void)(fptu_stat_tls.counter += (value)))
+#else
+#define FPTU_STAT_ADD(counter, value) ((void)0)
+#endif /* HAVE_FPTU_STATISTICS */
+
+/* Учитывает результат поиска поля среди дескрипторов [begin, end). */
+static __inline const fptu_field *fptu_stat_lookup(const fptu_field *begin,
+                                                   const fptu_field *end,
+                                                   const fptu_field *found) {
+#if HAVE_FPTU_STATISTICS
+  if (found) {
+    FPTU_STAT_ADD(lookup_hits, 1);
+    FPTU_STAT_ADD(lookup_scanned, found - begin + 1);
+  } else {
+    FPTU_STAT_ADD(lookup_misses, 1);
+    FPTU_STAT_ADD(lookup_scanned, end - begin);
+  }
+#else
+  (void)begin;
+  (void)end;
+#endif /* HAVE_FPTU_STATISTICS */
+  return found;
+}
+fptu_field *fptu_append_copy(fptu_rw *pt, const fptu_field *src);
+fptu_field *fptu_append_tail(fptu_rw *pt, uint_fast16_t ct, size_t units);
+
 template <typename type>
 static __inline fptu_lge fptu_cmp2lge(type left, type right) {
   if (left == right)
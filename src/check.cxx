@@ -133,7 +133,21 @@ const char *fptu_check_ro(fptu_ro ro) {
   if (unlikely(pivot > detent))
     return "tuple.pivot > tuple.end";
 
-  if (fptu_lx_mask & ro.units[0].varlen.tuple_items) {
+  /* служебный дескриптор различается по тегу */
+  const fptu_field *bloom = nullptr, *layout = nullptr;
+  if (ro.units[0].varlen.tuple_items & fptu_lx_bloom) {
+    const fptu_field *service = fptu_service_field(ro);
+    if (unlikely(service == nullptr))
+      return "tuple.service is missing";
+    if (unlikely((const char *)fptu_field_payload(service) !=
+                 detent - sizeof(uint64_t)))
+      return "tuple.service is misplaced";
+    if (service->ct == fptu_bloom_ct)
+      bloom = service;
+    else
+      layout = service;
+  }
+  if ((fptu_lx_mask & ~fptu_lx_bloom) & ro.units[0].varlen.tuple_items) {
     // TODO: support for ordered tuples
   }
 
@@ -147,6 +161,8 @@ const char *fptu_check_ro(fptu_ro ro) {
       return bug;
 
     payload_total_bytes += units2bytes(payload_units);
+    if (bloom && !ct_is_dead(pf->ct) && !fptu_bloom_test(bloom, pf->ct))
+      return "tuple.bloom is inconsistent";
     // if (ct_is_dead(pf->ct))
     //    return "tuple.has_junk";
   }
@@ -157,6 +173,12 @@ const char *fptu_check_ro(fptu_ro ro) {
   if (unlikely(pivot + payload_total_bytes != detent))
     return "tuple.has_wholes";
 
+  if (layout &&
+      unlikely(fptu_layout_fingerprint(ro) !=
+               fptu_layout_digest(begin + 1, (const fptu_field *)pivot,
+                                  bytes2units(payload_total_bytes) - 2)))
+    return "tuple.layout is inconsistent";
+
   return nullptr;
 }
 
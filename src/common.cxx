@@ -54,23 +54,50 @@ __hot const fptu_field *fptu_lookup_ro(fptu_ro ro, unsigned column,
   const fptu_field *end =
       begin + (ro.units[0].varlen.tuple_items & fptu_lt_mask);
 
-  if (fptu_lx_mask & ro.units[0].varlen.tuple_items) {
+  const fptu_field *const bloom = fptu_bloom_field(ro);
+  if (bloom)
+    ++begin;
+  if ((fptu_lx_mask & ~fptu_lx_bloom) & ro.units[0].varlen.tuple_items) {
     // TODO: support for ordered tuples
   }
 
   if (type_or_filter & fptu_filter) {
     for (const fptu_field *pf = begin; pf < end; ++pf) {
       if (fptu_ct_match(pf, column, type_or_filter))
-        return pf;
+        return fptu_stat_lookup(begin, end, pf);
     }
   } else {
     uint_fast16_t ct = fptu_pack_coltype(column, type_or_filter);
+    if (bloom && !fptu_bloom_test(bloom, ct))
+      return fptu_stat_lookup(begin, begin, nullptr);
     for (const fptu_field *pf = begin; pf < end; ++pf) {
       if (pf->ct == ct)
-        return pf;
+        return fptu_stat_lookup(begin, end, pf);
     }
   }
-  return nullptr;
+  return fptu_stat_lookup(begin, end, nullptr);
+}
+
+__hot const fptu_field *fptu_lookup_ro_hint(fptu_ro ro, unsigned column,
+                                            int type_or_filter,
+                                            unsigned *hint) {
+  if (likely(ro.total_bytes >= fptu_unit_size &&
+             ro.total_bytes ==
+                 fptu_unit_size +
+                     fptu_unit_size * (size_t)ro.units[0].varlen.brutto &&
+             column <= fptu_max_cols &&
+             *hint < (ro.units[0].varlen.tuple_items & fptu_lt_mask))) {
+    const fptu_field *pf = &ro.units[1 + *hint].field;
+    if ((type_or_filter & fptu_filter)
+            ? fptu_ct_match(pf, column, type_or_filter)
+            : pf->ct == fptu_pack_coltype(column, type_or_filter))
+      return fptu_stat_lookup(pf, pf, pf);
+  }
+
+  const fptu_field *pf = fptu_lookup_ro(ro, column, type_or_filter);
+  if (pf)
+    *hint = (unsigned)(pf - &ro.units[1].field);
+  return pf;
 }
 
 __hot fptu_field *fptu_lookup_ct(fptu_rw *pt, uint_fast16_t ct) {
@@ -78,9 +105,9 @@ __hot fptu_field *fptu_lookup_ct(fptu_rw *pt, uint_fast16_t ct) {
   const fptu_field *pivot = &pt->units[pt->pivot].field;
   for (const fptu_field *pf = begin; pf < pivot; ++pf) {
     if (pf->ct == ct)
-      return (fptu_field *)pf;
+      return (fptu_field *)fptu_stat_lookup(begin, pivot, pf);
   }
-  return nullptr;
+  return (fptu_field *)fptu_stat_lookup(begin, pivot, nullptr);
 }
 
 __hot fptu_field *fptu_lookup(fptu_rw *pt, unsigned column,
@@ -93,9 +120,9 @@ __hot fptu_field *fptu_lookup(fptu_rw *pt, unsigned column,
     const fptu_field *pivot = &pt->units[pt->pivot].field;
     for (const fptu_field *pf = begin; pf < pivot; ++pf) {
       if (fptu_ct_match(pf, column, type_or_filter))
-        return (fptu_field *)pf;
+        return (fptu_field *)fptu_stat_lookup(begin, pivot, pf);
     }
-    return nullptr;
+    return (fptu_field *)fptu_stat_lookup(begin, pivot, nullptr);
   }
 
   return fptu_lookup_ct(pt, fptu_pack_coltype(column, type_or_filter));
@@ -121,3 +148,58 @@ __hot fptu_ro fptu_take_noshrink(const fptu_rw *pt) {
   tuple.total_bytes = (size_t)((char *)&pt->units[pt->tail] - (char *)payload);
   return tuple;
 }
+
+__hot fptu_ro fptu_take_bloom_noshrink(const fptu_rw *pt) {
+  assert(pt->head > 0);
+  /* нужны место под дескриптор карты перед head и под заголовок перед
+   * ним, 8 байт для данных после tail, а также запас в счетчиках */
+  if (unlikely(pt->head < 2 || pt->end - pt->tail < 2 ||
+               pt->pivot - pt->head >= fptu_max_fields ||
+               pt->tail - pt->head + 3 > UINT16_MAX))
+    return fptu_take_noshrink(pt);
+
+  const fptu_field *const begin = &pt->units[pt->head].field;
+  const fptu_field *const pivot = &pt->units[pt->pivot].field;
+  uint64_t bits = 0;
+  for (const fptu_field *pf = begin; pf < pivot; ++pf)
+    if (!ct_is_dead(pf->ct))
+      bits |= UINT64_C(1) << fptu_bloom_bit(pf->ct);
+
+  /* данные карты располагаются последними, после данных всех полей */
+  fptu_field *bloom = (fptu_field *)&pt->units[pt->head - 1];
+  bloom->ct = fptu_bloom_ct;
+  bloom->offset = (uint16_t)(pt->tail - (pt->head - 1));
+  fptu_field_payload(bloom)->u64 = bits;
+
+  fptu_ro tuple;
+  fptu_payload *payload = (fptu_payload *)&pt->units[pt->head - 2];
+  payload->other.varlen.brutto = (uint16_t)(pt->tail + 2 - (pt->head - 1));
+  payload->other.varlen.tuple_items =
+      (uint16_t)((pt->pivot - pt->head + 1) | fptu_lx_bloom);
+  tuple.units = (const fptu_unit *)payload;
+  tuple.total_bytes =
+      (size_t)((char *)&pt->units[pt->tail + 2] - (char *)payload);
+  return tuple;
+}
+
+//----------------------------------------------------------------------------
+
+#if HAVE_FPTU_STATISTICS
+__thread fptu_stat fptu_stat_tls;
+#endif /* HAVE_FPTU_STATISTICS */
+
+bool fptu_stat_snapshot(fptu_stat *stat) {
+#if HAVE_FPTU_STATISTICS
+  *stat = fptu_stat_tls;
+  return true;
+#else
+  memset(stat, 0, sizeof(fptu_stat));
+  return false;
+#endif /* HAVE_FPTU_STATISTICS */
+}
+
+void fptu_stat_reset(void) {
+#if HAVE_FPTU_STATISTICS
+  memset(&fptu_stat_tls, 0, sizeof(fptu_stat_tls));
+#endif /* HAVE_FPTU_STATISTICS */
+}
@@ -113,6 +113,197 @@ fptu_lge fptu_cmp_opaque_iov(fptu_ro ro, unsigned column,
 
 //----------------------------------------------------------------------------
 
+static __inline uint64_t load64(const uint8_t *ptr) {
+  uint64_t value;
+  memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+/* Номер первого (по адресу) отличающегося байта в ненулевом xor-слове. */
+static __inline unsigned first_diff_byte(uint64_t xor_word) {
+  assert(xor_word != 0);
+#if defined(__GNUC__) || defined(__clang__)
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  return (unsigned)__builtin_ctzll(xor_word) >> 3;
+#else
+  return (unsigned)__builtin_clzll(xor_word) >> 3;
+#endif
+#else
+  unsigned n = 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  while ((xor_word & 0xFF) == 0)
+    xor_word >>= 8, ++n;
+#else
+  while ((xor_word >> 56) == 0)
+    xor_word <<= 8, ++n;
+#endif
+  return n;
+#endif
+}
+
+/* Поиск первого отличающегося байта (SWAR): блоками по 32 байта с одной
+ * проверкой на блок, затем по 8 байт, затем хвост побайтно.
+ * Возвращает смещение отличия, либо bytes если блоки равны. */
+static __hot size_t fptu_mismatch(const uint8_t *left, const uint8_t *right,
+                                  size_t bytes) {
+  size_t i = 0;
+  while (i + 32 <= bytes) {
+    const uint64_t any = (load64(left + i) ^ load64(right + i)) |
+                         (load64(left + i + 8) ^ load64(right + i + 8)) |
+                         (load64(left + i + 16) ^ load64(right + i + 16)) |
+                         (load64(left + i + 24) ^ load64(right + i + 24));
+    if (any)
+      break;
+    i += 32;
+  }
+
+  for (; i + 8 <= bytes; i += 8) {
+    const uint64_t diff = load64(left + i) ^ load64(right + i);
+    if (diff)
+      return i + first_diff_byte(diff);
+  }
+
+  for (; i < bytes; ++i)
+    if (left[i] != right[i])
+      return i;
+  return bytes;
+}
+
+/* Лексикографическое сравнение массивов элементов фиксированного размера.
+ * Побитовое отличие ищется векторно, а затем найденная пара элементов
+ * сравнивается как числа. Побитово разные, но равные по значению элементы
+ * (например +0.0 и -0.0) не прерывают сравнение. */
+template <typename native>
+static __hot fptu_lge fptu_cmp_array_native(const fptu_payload *left,
+                                            const fptu_payload *right) {
+  const size_t left_len = left->other.varlen.array_length;
+  const size_t right_len = right->other.varlen.array_length;
+  const uint8_t *const l = (const uint8_t *)fptu_array_items(left);
+  const uint8_t *const r = (const uint8_t *)fptu_array_items(right);
+
+  const size_t bytes = std::min(left_len, right_len) * sizeof(native);
+  size_t offset = 0;
+  for (;;) {
+    offset += fptu_mismatch(l + offset, r + offset, bytes - offset);
+    if (offset >= bytes)
+      break;
+
+    offset -= offset % sizeof(native);
+    native left_item, right_item;
+    memcpy(&left_item, l + offset, sizeof(native));
+    memcpy(&right_item, r + offset, sizeof(native));
+    const fptu_lge cmp = fptu_cmp2lge(left_item, right_item);
+    if (cmp != fptu_eq)
+      return cmp;
+    offset += sizeof(native);
+  }
+
+  return fptu_cmp2lge(left_len, right_len);
+}
+
+static __hot fptu_lge fptu_cmp_array_fixbin(const fptu_payload *left,
+                                            const fptu_payload *right,
+                                            size_t itemsize) {
+  return fptu_cmp_binary(fptu_array_items(left),
+                         left->other.varlen.array_length * itemsize,
+                         fptu_array_items(right),
+                         right->other.varlen.array_length * itemsize);
+}
+
+static __hot fptu_lge fptu_cmp_array_cstr(const fptu_payload *left,
+                                          const fptu_payload *right) {
+  const size_t left_len = left->other.varlen.array_length;
+  const size_t right_len = right->other.varlen.array_length;
+  const char *l = (const char *)fptu_array_items(left);
+  const char *r = (const char *)fptu_array_items(right);
+
+  for (size_t n = std::min(left_len, right_len); n > 0; --n) {
+    const int diff = strcmp(l, r);
+    if (diff)
+      return fptu_diff2lge(diff);
+    const size_t len = strlen(l) + 1;
+    l += len;
+    r += len;
+  }
+  return fptu_cmp2lge(left_len, right_len);
+}
+
+static __hot fptu_lge fptu_cmp_array_varlen(const fptu_payload *left,
+                                            const fptu_payload *right,
+                                            bool nested) {
+  const size_t left_len = left->other.varlen.array_length;
+  const size_t right_len = right->other.varlen.array_length;
+  const fptu_unit *l = (const fptu_unit *)fptu_array_items(left);
+  const fptu_unit *r = (const fptu_unit *)fptu_array_items(right);
+
+  for (size_t n = std::min(left_len, right_len); n > 0; --n) {
+    fptu_lge cmp;
+    if (nested) {
+      fptu_ro left_item, right_item;
+      left_item.units = l;
+      left_item.total_bytes = units2bytes(l->varlen.brutto + (size_t)1);
+      right_item.units = r;
+      right_item.total_bytes = units2bytes(r->varlen.brutto + (size_t)1);
+      cmp = fptu_cmp_tuples(left_item, right_item);
+    } else {
+      cmp = fptu_cmp_binary(l + 1, l->varlen.opaque_bytes, r + 1,
+                            r->varlen.opaque_bytes);
+    }
+    if (cmp != fptu_eq)
+      return cmp;
+    l += l->varlen.brutto + 1;
+    r += r->varlen.brutto + 1;
+  }
+  return fptu_cmp2lge(left_len, right_len);
+}
+
+static __hot fptu_lge fptu_cmp_arrays(unsigned type, const fptu_payload *left,
+                                      const fptu_payload *right) {
+  assert(type & fptu_farray);
+  switch (type & ~(unsigned)fptu_farray) {
+  case fptu_null:
+    return fptu_cmp2lge<unsigned>(left->other.varlen.array_length,
+                                  right->other.varlen.array_length);
+  case fptu_uint16:
+    return fptu_cmp_array_native<uint16_t>(left, right);
+  case fptu_int32:
+    return fptu_cmp_array_native<int32_t>(left, right);
+  case fptu_uint32:
+    return fptu_cmp_array_native<uint32_t>(left, right);
+  case fptu_fp32:
+    return fptu_cmp_array_native<float>(left, right);
+  case fptu_int64:
+    return fptu_cmp_array_native<int64_t>(left, right);
+  case fptu_uint64:
+  case fptu_datetime:
+    return fptu_cmp_array_native<uint64_t>(left, right);
+  case fptu_fp64:
+    return fptu_cmp_array_native<double>(left, right);
+
+  case fptu_96:
+    return fptu_cmp_array_fixbin(left, right, 12);
+  case fptu_128:
+    return fptu_cmp_array_fixbin(left, right, 16);
+  case fptu_160:
+    return fptu_cmp_array_fixbin(left, right, 20);
+  case fptu_256:
+    return fptu_cmp_array_fixbin(left, right, 32);
+
+  case fptu_cstr:
+    return fptu_cmp_array_cstr(left, right);
+  case fptu_opaque:
+    return fptu_cmp_array_varlen(left, right, false);
+  case fptu_nested:
+    return fptu_cmp_array_varlen(left, right, true);
+
+  default:
+    assert(false);
+    return fptu_ic;
+  }
+}
+
+//----------------------------------------------------------------------------
+
 __hot static fptu_lge fptu_cmp_fields_same_type(const fptu_field *left,
                                                 const fptu_field *right) {
   assert(left != nullptr && right != nullptr);
@@ -165,21 +356,153 @@ __hot static fptu_lge fptu_cmp_fields_same_type(const fptu_field *left,
 
   default:
     /* fptu_farray */
-    // TODO: лексикографическое сравнение
+    return fptu_cmp_arrays(fptu_get_type(left->ct), payload_left,
+                           payload_right);
+  }
+}
+
+//----------------------------------------------------------------------------
+
+/* Точное сравнение чисел разных типов. Значения расширяются посредством
+ * fptu::cast_wide() до int64_t, uint64_t или double_t, после чего
+ * сравниваются без приведения к общему типу (и без потери точности). */
+
+static __inline fptu_lge cmp_wide(int64_t left, int64_t right) {
+  return fptu_cmp2lge(left, right);
+}
+
+static __inline fptu_lge cmp_wide(uint64_t left, uint64_t right) {
+  return fptu_cmp2lge(left, right);
+}
+
+static __inline fptu_lge cmp_wide(double_t left, double_t right) {
+  return fptu_cmp2lge(left, right);
+}
+
+static __inline fptu_lge cmp_wide(int64_t left, uint64_t right) {
+  if (left < 0)
+    return fptu_lt;
+  return fptu_cmp2lge((uint64_t)left, right);
+}
+
+static fptu_lge cmp_wide(int64_t left, double_t right) {
+  if (unlikely(std::isnan(right)))
     return fptu_ic;
+  /* 2^63 и -2^63 представимы точно */
+  if (right >= 9223372036854775808.0)
+    return fptu_lt;
+  if (right < -9223372036854775808.0)
+    return fptu_gt;
+
+  // целая часть right точно представима в int64_t
+  const double_t whole = std::trunc(right);
+  const int64_t integer = (int64_t)whole;
+  if (left != integer)
+    return fptu_cmp2lge(left, integer);
+  // при равенстве целых частей решает дробная часть right
+  return fptu_cmp2lge(whole, right);
+}
+
+static fptu_lge cmp_wide(uint64_t left, double_t right) {
+  if (unlikely(std::isnan(right)))
+    return fptu_ic;
+  /* 2^64 представимо точно */
+  if (right >= 18446744073709551616.0)
+    return fptu_lt;
+  if (right < 0)
+    return fptu_gt;
+
+  // целая часть right точно представима в uint64_t
+  const double_t whole = std::trunc(right);
+  const uint64_t integer = (uint64_t)whole;
+  if (left != integer)
+    return fptu_cmp2lge(left, integer);
+  // при равенстве целых частей решает дробная часть right
+  return fptu_cmp2lge(whole, right);
+}
+
+static __inline fptu_lge fptu_lge_reverse(fptu_lge cmp) {
+  switch (cmp) {
+  case fptu_lt:
+    return fptu_gt;
+  case fptu_gt:
+    return fptu_lt;
+  default:
+    return cmp;
   }
 }
 
+template <typename LEFT, typename RIGHT>
+static __inline fptu_lge cmp_wide(LEFT left, RIGHT right) {
+  return fptu_lge_reverse(cmp_wide(right, left));
+}
+
+template <typename LEFT>
+static fptu_lge cmp_number(LEFT left, const fptu_field *right) {
+  const fptu_payload *payload = fptu_field_payload(right);
+  switch (fptu_get_type(right->ct)) {
+  case fptu_uint16:
+    return cmp_wide(left, fptu::cast_wide(right->get_payload_uint16()));
+  case fptu_int32:
+    return cmp_wide(left, fptu::cast_wide(payload->i32));
+  case fptu_uint32:
+    return cmp_wide(left, fptu::cast_wide(payload->u32));
+  case fptu_fp32:
+    return cmp_wide(left, fptu::cast_wide(payload->fp32));
+  case fptu_int64:
+    return cmp_wide(left, fptu::cast_wide(payload->i64));
+  case fptu_uint64:
+    return cmp_wide(left, fptu::cast_wide(payload->u64));
+  case fptu_fp64:
+    return cmp_wide(left, fptu::cast_wide(payload->fp64));
+  default:
+    assert(false);
+    return fptu_ic;
+  }
+}
+
+static fptu_lge fptu_cmp_numbers(const fptu_field *left,
+                                 const fptu_field *right) {
+  const fptu_payload *payload = fptu_field_payload(left);
+  switch (fptu_get_type(left->ct)) {
+  case fptu_uint16:
+    return cmp_number(fptu::cast_wide(left->get_payload_uint16()), right);
+  case fptu_int32:
+    return cmp_number(fptu::cast_wide(payload->i32), right);
+  case fptu_uint32:
+    return cmp_number(fptu::cast_wide(payload->u32), right);
+  case fptu_fp32:
+    return cmp_number(fptu::cast_wide(payload->fp32), right);
+  case fptu_int64:
+    return cmp_number(fptu::cast_wide(payload->i64), right);
+  case fptu_uint64:
+    return cmp_number(fptu::cast_wide(payload->u64), right);
+  case fptu_fp64:
+    return cmp_number(fptu::cast_wide(payload->fp64), right);
+  default:
+    assert(false);
+    return fptu_ic;
+  }
+}
+
+static __inline bool fptu_is_number(unsigned type) {
+  return type < fptu_farray && (fptu_any_number & (INT32_C(1) << type)) != 0;
+}
+
 fptu_lge fptu_cmp_fields(const fptu_field *left, const fptu_field *right) {
   if (unlikely(left == nullptr))
     return right ? fptu_lt : fptu_eq;
   if (unlikely(right == nullptr))
     return fptu_gt;
 
-  if (likely(fptu_get_type(left->ct) == fptu_get_type(right->ct)))
+  const unsigned left_type = fptu_get_type(left->ct);
+  const unsigned right_type = fptu_get_type(right->ct);
+  if (likely(left_type == right_type))
     return fptu_cmp_fields_same_type(left, right);
 
-  // TODO: сравнение с кастингом?
+  if (fptu_is_number(left_type) && fptu_is_number(right_type))
+    return fptu_cmp_numbers(left, right);
+
   return fptu_ic;
 }
 
@@ -346,8 +669,10 @@ __hot fptu_lge fptu_cmp_tuples(fptu_ro left, fptu_ro right) {
 #ifdef NDEBUG /* только при выключенной отладке, ради тестирования */
   // fastpath если кортежи полностью равны "как есть"
   if (left.sys.iov_len == right.sys.iov_len &&
-      memcmp(left.sys.iov_base, right.sys.iov_base, left.sys.iov_len) == 0)
+      memcmp(left.sys.iov_base, right.sys.iov_base, left.sys.iov_len) == 0) {
+    FPTU_STAT_ADD(cmp_fastpath, 1);
     return fptu_eq;
+  }
 #endif /* NDEBUG */
 
   // начало и конец дескрипторов слева
@@ -359,14 +684,18 @@ __hot fptu_lge fptu_cmp_tuples(fptu_ro left, fptu_ro right) {
   const auto r_end = fptu_end_ro(right);
 
   // fastpath если хотя-бы один из кортежей пуст
-  if (unlikely(l_begin == l_end || r_begin == r_end))
+  if (unlikely(l_begin == l_end || r_begin == r_end)) {
+    FPTU_STAT_ADD(cmp_fastpath, 1);
     return fptu_cmp2lge(l_begin != l_end, r_begin != r_end);
+  }
 
   // fastpath если оба кортежа уже упорядоченные.
   if (likely(fptu_is_ordered(l_begin, l_end) &&
-             fptu_is_ordered(r_begin, r_end)))
+             fptu_is_ordered(r_begin, r_end))) {
+    FPTU_STAT_ADD(cmp_fastpath, 1);
     return fptu_cmp_tuples_fastpath(l_begin, l_end, r_begin, r_end);
+  }
 
-  // TODO: account perfomance penalty.
+  FPTU_STAT_ADD(cmp_slowpath, 1);
   return fptu_cmp_tuples_slowpath(l_begin, l_end, r_begin, r_end);
 }
@@ -19,6 +19,8 @@
 
 #include "fast_positive/tuples_internal.h"
 
+#include <algorithm>
+
 size_t fptu_space(size_t items, size_t data_bytes) {
   if (items > fptu_max_fields)
     items = fptu_max_fields;
@@ -72,11 +74,40 @@ size_t fptu_junkspace(const fptu_rw *pt) { return units2bytes(pt->junk); }
 
 //----------------------------------------------------------------------------
 
-fptu_rw *fptu_fetch(fptu_ro ro, void *space, size_t buffer_bytes,
-                    unsigned more_items) {
-  if (ro.total_bytes == 0)
-    return fptu_init(space, buffer_bytes, more_items);
+/* Размечает буфер под модифицируемую форму кортежа из items дескрипторов
+ * и payload_bytes данных с резервом на more_items полей. */
+static fptu_rw *fptu_fetch_place(void *space, size_t buffer_bytes,
+                                 unsigned more_items, size_t items,
+                                 size_t payload_bytes) {
+  if (unlikely(space == nullptr || more_items > fptu_max_fields))
+    return nullptr;
+  if (unlikely(buffer_bytes > fptu_buffer_limit))
+    return nullptr;
+
+  size_t reserve_items = items + more_items;
+  if (reserve_items > fptu_max_fields)
+    reserve_items = fptu_max_fields;
 
+  if (unlikely(buffer_bytes <
+               sizeof(fptu_rw) + units2bytes(reserve_items) + payload_bytes))
+    return nullptr;
+
+  fptu_rw *pt = (fptu_rw *)space;
+  pt->end = (unsigned)(buffer_bytes - sizeof(fptu_rw)) / fptu_unit_size + 1;
+  pt->pivot = (unsigned)reserve_items + 1;
+  pt->head = pt->pivot - (unsigned)items;
+  pt->tail = pt->pivot + (unsigned)(payload_bytes >> fptu_unit_shift);
+  pt->junk = 0;
+  return pt;
+}
+
+/* Размечает буфер под модифицируемую форму кортежа ro, не копируя
+ * ни дескрипторы, ни данные. Через begin и end возвращаются границы
+ * копируемой части кортежа, из которой исключена карта присутствия
+ * тегов: ее дескриптор первый, а данные последние в кортеже. */
+static fptu_rw *fptu_fetch_layout(fptu_ro ro, void *space, size_t buffer_bytes,
+                                  unsigned more_items, const char *&begin,
+                                  const char *&end) {
   if (unlikely(ro.units == nullptr))
     return nullptr;
   if (unlikely(ro.total_bytes < fptu_unit_size))
@@ -90,34 +121,111 @@ fptu_rw *fptu_fetch(fptu_ro ro, void *space, size_t buffer_bytes,
   size_t items = (size_t)ro.units[0].varlen.tuple_items & fptu_lt_mask;
   if (unlikely(items > fptu_max_fields))
     return nullptr;
-  if (unlikely(space == nullptr || more_items > fptu_max_fields))
-    return nullptr;
-  if (unlikely(buffer_bytes > fptu_buffer_limit))
-    return nullptr;
 
-  const char *end = (const char *)ro.units + ro.total_bytes;
-  const char *begin = (const char *)&ro.units[1];
+  end = (const char *)ro.units + ro.total_bytes;
+  begin = (const char *)&ro.units[1];
   const char *pivot = (const char *)begin + units2bytes(items);
   if (unlikely(pivot > end))
     return nullptr;
 
-  size_t reserve_items = items + more_items;
-  if (reserve_items > fptu_max_fields)
-    reserve_items = fptu_max_fields;
+  const fptu_field *const service = fptu_service_field(ro);
+  if (service) {
+    if (unlikely(end - pivot < (ptrdiff_t)sizeof(uint64_t) ||
+                 (const char *)fptu_field_payload(service) !=
+                     end - sizeof(uint64_t)))
+      return nullptr;
+    begin += fptu_unit_size;
+    end -= sizeof(uint64_t);
+    items -= 1;
+  }
 
-  ptrdiff_t payload_bytes = end - pivot;
-  if (unlikely(buffer_bytes <
-               sizeof(fptu_rw) + units2bytes(reserve_items) + payload_bytes))
+  return fptu_fetch_place(space, buffer_bytes, more_items, items,
+                          (size_t)(end - pivot));
+}
+
+fptu_rw *fptu_fetch(fptu_ro ro, void *space, size_t buffer_bytes,
+                    unsigned more_items) {
+  if (ro.total_bytes == 0)
+    return fptu_init(space, buffer_bytes, more_items);
+
+  const char *begin, *end;
+  fptu_rw *pt =
+      fptu_fetch_layout(ro, space, buffer_bytes, more_items, begin, end);
+  if (likely(pt != nullptr))
+    memcpy(&pt->units[pt->head], begin, (size_t)(end - begin));
+  return pt;
+}
+
+fptu_rw *fptu_fetch_hot(fptu_ro ro, void *space, size_t buffer_bytes,
+                        unsigned more_items, const uint16_t *hot,
+                        size_t hot_count) {
+  if (unlikely(hot_count > fptu_max_fields || (hot_count && !hot)))
     return nullptr;
+  if (ro.total_bytes == 0)
+    return fptu_init(space, buffer_bytes, more_items);
 
-  fptu_rw *pt = (fptu_rw *)space;
-  pt->end = (unsigned)(buffer_bytes - sizeof(fptu_rw)) / fptu_unit_size + 1;
-  pt->pivot = (unsigned)reserve_items + 1;
-  pt->head = pt->pivot - (unsigned)items;
-  pt->tail = pt->pivot + (unsigned)(payload_bytes >> fptu_unit_shift);
-  pt->junk = 0;
+  const char *from, *to;
+  fptu_rw *pt =
+      fptu_fetch_layout(ro, space, buffer_bytes, more_items, from, to);
+  if (unlikely(pt == nullptr))
+    return nullptr;
+
+  const fptu_field *const begin = (const fptu_field *)from;
+  const size_t items = pt->pivot - pt->head;
+
+  /* ранги горячих тегов и порядок полей, количество которых задается
+   * пользователем и может быть велико, поэтому не на стеке */
+  uint32_t *const ranks =
+      (uint32_t *)malloc(sizeof(uint32_t) * (hot_count + items + 2));
+  if (unlikely(ranks == nullptr))
+    return nullptr;
+  uint32_t *const order = ranks + hot_count + 1;
+
+  /* ранг 0 у самого горячего тега, а у прочих полей ранг hot_count,
+   * при этом тег в старших битах для поиска, а ранг в младших */
+  for (size_t i = 0; i < hot_count; ++i)
+    ranks[i] = (uint32_t)hot[i] << 16 | (uint32_t)(hot_count - 1 - i);
+  std::sort(ranks, ranks + hot_count);
+
+  /* ключ сортировки - ранг и исходная позиция поля, что сохраняет
+   * взаимный порядок полей с одинаковым рангом */
+  size_t live = 0;
+  for (size_t i = 0; i < items; ++i) {
+    const uint_fast16_t ct = begin[i].ct;
+    if (ct_is_dead(ct))
+      continue;
+    const uint32_t *const rank = std::lower_bound(
+        ranks, ranks + hot_count, (uint32_t)ct << 16);
+    const uint32_t key = (rank != ranks + hot_count && (*rank >> 16) == ct)
+                             ? (*rank & UINT16_MAX)
+                             : (uint32_t)hot_count;
+    order[live++] = key << 16 | (uint32_t)i;
+  }
+  std::sort(order, order + live);
+
+  /* данные размещаются в обратном порядке дескрипторов, как и при
+   * добавлении полей, т.е. аналогично fptu_shrink() */
+  pt->head = pt->pivot - (unsigned)live;
+  fptu_field *const dst = &pt->units[pt->head].field;
+  uint32_t *t = &pt->units[pt->pivot].data;
+  for (size_t i = live; i-- > 0;) {
+    const fptu_field *const src = &begin[order[i] & UINT16_MAX];
+    fptu_field f;
+    f.header = src->header;
+    if (fptu_get_type(f.ct) > fptu_uint16) {
+      const size_t u = fptu_field_units(src);
+      memcpy(t, fptu_field_payload(src), units2bytes(u));
+      const size_t offset = (size_t)(t - dst[i].body);
+      assert(offset <= fptu_limit);
+      f.offset = (uint16_t)offset;
+      t += u;
+    }
+    dst[i].header = f.header;
+  }
 
-  memcpy(&pt->units[pt->head], begin, ro.total_bytes - fptu_unit_size);
+  free(ranks);
+  assert(t <= &pt->units[pt->end].data);
+  pt->tail = (unsigned)(t - &pt->units[0].data);
   return pt;
 }
 
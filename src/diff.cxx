@@ -0,0 +1,224 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fast_positive/tuples_internal.h"
+
+#include <algorithm>
+
+/* Маркер удаления в дельте: поле uint16 в последней колонке,
+ * значением которого является тег удаляемых полей. */
+static __inline uint_fast16_t fptu_diff_marker() {
+  return fptu_pack_coltype(fptu_max_cols, fptu_uint16);
+}
+
+/* Побитовое совпадение полей с одинаковым тегом. В отличие от
+ * fptu_cmp_fields() различает -0.0 и +0.0, а NaN равен сам себе. */
+static bool fptu_field_same(const fptu_field *left, const fptu_field *right) {
+  assert(left->ct == right->ct);
+  const size_t units = fptu_field_units(left);
+  if (units != fptu_field_units(right))
+    return false;
+  if (units == 0)
+    return fptu_get_type(left->ct) == fptu_null ||
+           left->offset == right->offset;
+  if (fptu_get_type(left->ct) == fptu_cstr)
+    /* выравнивающие байты после '\0' могут быть любыми */
+    return strcmp(left->payload()->cstr, right->payload()->cstr) == 0;
+  return memcmp(left->payload(), right->payload(), units2bytes(units)) == 0;
+}
+
+/* Совпадение всех экземпляров коллекции в порядке их добавления,
+ * как и в fptu_cmp_tuples(). */
+static bool fptu_collection_same(const fptu_field *const l_begin,
+                                 const fptu_field *const l_end,
+                                 const fptu_field *const r_begin,
+                                 const fptu_field *const r_end,
+                                 const uint_fast16_t tag) {
+  const fptu_field *field_l = l_end, *field_r = r_end;
+  for (;;) {
+    while (--field_l >= l_begin && field_l->ct != tag)
+      ;
+    while (--field_r >= r_begin && field_r->ct != tag)
+      ;
+
+    const bool left_depleted = (field_l < l_begin);
+    const bool right_depleted = (field_r < r_begin);
+    if (left_depleted | right_depleted)
+      return left_depleted == right_depleted;
+    if (!fptu_field_same(field_l, field_r))
+      return false;
+  }
+}
+
+/* Копирует в дельту все экземпляры коллекции в порядке их добавления. */
+static int fptu_collection_copy(fptu_rw *diff, const fptu_field *const begin,
+                                const fptu_field *const end,
+                                const uint_fast16_t tag) {
+  for (const fptu_field *pf = end; --pf >= begin;) {
+    if (pf->ct == tag && unlikely(fptu_append_copy(diff, pf) == nullptr))
+      return FPTU_ENOSPACE;
+  }
+  return FPTU_OK;
+}
+
+int fptu_diff(fptu_ro old_ro, fptu_ro new_ro, fptu_rw *diff) {
+  if (unlikely(diff == nullptr))
+    return FPTU_EINVAL;
+
+  const fptu_field *const l_begin = fptu_begin_ro(old_ro);
+  const fptu_field *const l_end = fptu_end_ro(old_ro);
+  const fptu_field *const r_begin = fptu_begin_ro(new_ro);
+  const fptu_field *const r_end = fptu_end_ro(new_ro);
+  if (unlikely((!l_begin && old_ro.total_bytes) ||
+               (!r_begin && new_ro.total_bytes)))
+    return FPTU_EINVAL;
+
+  int rc = fptu_clear(diff);
+  if (unlikely(rc != FPTU_OK))
+    return rc;
+
+  const auto l_size = l_end - l_begin;
+  const auto r_size = r_end - r_begin;
+
+// буфер на стеке под сортированные теги полей
+#ifdef _MSC_VER /* FIXME: mustdie */
+  uint16_t *const buffer =
+      (uint16_t *)_malloca(sizeof(uint16_t) * (l_size + r_size + 1));
+#else
+  uint16_t buffer[l_size + r_size + 1];
+#endif
+
+  uint16_t *const tags_l_begin = buffer;
+  uint16_t *const tags_l_end = fptu_tags(tags_l_begin, l_begin, l_end);
+  uint16_t *const tags_r_begin = tags_l_end;
+  uint16_t *const tags_r_end = fptu_tags(tags_r_begin, r_begin, r_end);
+
+  /* идем по отсортированным тегам обоих кортежей, мертвые поля
+   * (их теги максимальны) пропускаются */
+  auto tags_l = tags_l_begin, tags_r = tags_r_begin;
+  for (;;) {
+    const bool left_depleted = (tags_l == tags_l_end) || ct_is_dead(*tags_l);
+    const bool right_depleted = (tags_r == tags_r_end) || ct_is_dead(*tags_r);
+    if (left_depleted & right_depleted)
+      return FPTU_OK;
+
+    const uint_fast16_t tag = (left_depleted || (!right_depleted &&
+                                                 *tags_r < *tags_l))
+                                  ? *tags_r
+                                  : *tags_l;
+    if (unlikely(tag == fptu_diff_marker()))
+      return FPTU_EINVAL;
+
+    const bool in_old = !left_depleted && *tags_l == tag;
+    const bool in_new = !right_depleted && *tags_r == tag;
+    if (!in_new || !in_old ||
+        !fptu_collection_same(l_begin, l_end, r_begin, r_end, tag)) {
+      if (in_old) {
+        rc = fptu_insert_uint16(diff, fptu_max_cols, tag);
+        if (unlikely(rc != FPTU_OK))
+          return rc;
+      }
+      if (in_new) {
+        rc = fptu_collection_copy(diff, r_begin, r_end, tag);
+        if (unlikely(rc != FPTU_OK))
+          return rc;
+      }
+    }
+
+    tags_l += in_old;
+    tags_r += in_new;
+  }
+}
+
+//----------------------------------------------------------------------------
+
+int fptu_patch(fptu_rw *pt, fptu_ro diff) {
+  const fptu_field *const begin = fptu_begin_ro(diff);
+  const fptu_field *const end = fptu_end_ro(diff);
+  if (unlikely(pt == nullptr || (!begin && diff.total_bytes)))
+    return FPTU_EINVAL;
+  if (begin == end)
+    return FPTU_OK;
+
+  /* собираем удаляемые теги и объем добавляемых полей */
+  const auto diff_size = end - begin;
+#ifdef _MSC_VER /* FIXME: mustdie */
+  uint16_t *const erase =
+      (uint16_t *)_malloca(sizeof(uint16_t) * (diff_size + 1));
+#else
+  uint16_t erase[diff_size + 1];
+#endif
+  size_t erase_count = 0, need_items = 0, need_units = 0;
+  for (const fptu_field *pf = begin; pf < end; ++pf) {
+    if (ct_is_dead(pf->ct))
+      continue;
+    if (pf->ct == fptu_diff_marker())
+      erase[erase_count++] = (uint16_t)pf->get_payload_uint16();
+    else {
+      need_items += 1;
+      need_units += fptu_field_units(pf);
+    }
+  }
+  std::sort(erase, erase + erase_count);
+
+  /* проверяем наличие места заранее, чтобы не оставить кортеж
+   * в частично измененном состоянии */
+  fptu_field *const pt_begin = &pt->units[pt->head].field;
+  fptu_field *const pt_end = &pt->units[pt->pivot].field;
+  size_t free_items = fptu_space4items(pt);
+  size_t free_units = pt->end - pt->tail;
+  bool dead = false;
+  for (const fptu_field *pf = pt_begin; pf < pt_end; ++pf) {
+    if (ct_is_dead(pf->ct) ||
+        std::binary_search(erase, erase + erase_count, pf->ct)) {
+      dead |= ct_is_dead(pf->ct);
+      free_items += 1;
+      free_units += fptu_field_units(pf);
+    }
+  }
+  if (unlikely(need_items > free_items || need_units > free_units)) {
+    FPTU_STAT_ADD(enospace, 1);
+    return FPTU_ENOSPACE;
+  }
+
+  if (erase_count) {
+    for (fptu_field *pf = pt_begin; pf < pt_end; ++pf) {
+      if (std::binary_search(erase, erase + erase_count, pf->ct))
+        fptu_erase_field(pt, pf);
+    }
+  }
+
+  /* устраняем дыры, чтобы новые поля добавлялись в порядке следования
+   * в дельте и порядок элементов коллекций сохранился. Удаленные поля
+   * учтены выше как свободное место, но pt->junk может их не отражать
+   * (например после fptu_fetch), поэтому тогда сжатие безусловное. */
+  if (dead)
+    fptu_shrink(pt);
+  else
+    fptu_cond_shrink(pt);
+  for (const fptu_field *pf = end; --pf >= begin;) {
+    if (ct_is_dead(pf->ct) || pf->ct == fptu_diff_marker())
+      continue;
+    if (unlikely(fptu_append_copy(pt, pf) == nullptr)) {
+      FPTU_STAT_ADD(enospace, 1);
+      return FPTU_ENOSPACE;
+    }
+  }
+  return FPTU_OK;
+}
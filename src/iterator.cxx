@@ -73,7 +73,8 @@ __hot const fptu_field *fptu_begin_ro(fptu_ro ro) {
                fptu_unit_size + units2bytes(ro.units[0].varlen.brutto)))
     return nullptr;
 
-  return &ro.units[1].field;
+  /* карта присутствия тегов не является полем */
+  return &ro.units[fptu_service_field(ro) ? 2 : 1].field;
 }
 
 __hot const fptu_field *fptu_end_ro(fptu_ro ro) {
@@ -149,3 +150,15 @@ size_t fptu_field_count_ro_ex(fptu_ro ro, fptu_field_filter filter,
 
   return count;
 }
+
+size_t fptu_field_count_tags(const fptu_rw *pt, const uint16_t *tags,
+                             size_t n_tags, size_t *counts) {
+  return fptu_tags_count(fptu_begin_rw(pt), fptu_end_rw(pt), tags, n_tags,
+                         counts);
+}
+
+size_t fptu_field_count_tags_ro(fptu_ro ro, const uint16_t *tags,
+                                size_t n_tags, size_t *counts) {
+  return fptu_tags_count(fptu_begin_ro(ro), fptu_end_ro(ro), tags, n_tags,
+                         counts);
+}
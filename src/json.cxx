@@ -0,0 +1,893 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fast_positive/tuples_internal.h"
+
+#include <algorithm>
+
+namespace {
+
+/* Потоковый вывод через окно в буфере. В режиме функции-приемника окном
+ * является локальный буфер, содержимое которого передается приемнику при
+ * заполнении. В режиме буфера пользователя при его переполнении вывод
+ * продолжается вхолостую, чтобы подсчитать требуемый размер. */
+class json_writer {
+  char *base_, *ptr_, *end_;
+  fptu_emit_func *const emit_;
+  void *const emit_ctx_;
+  size_t flushed_;
+  int rc_;
+  char local_[512];
+
+  __noinline void flush() {
+    const size_t length = (size_t)(ptr_ - base_);
+    flushed_ += length;
+    if (emit_) {
+      if (rc_ == FPTU_OK && length)
+        rc_ = emit_(emit_ctx_, base_, length);
+    } else if (base_ != local_)
+      rc_ = FPTU_ENOSPACE;
+    base_ = ptr_ = local_;
+    end_ = local_ + sizeof(local_);
+  }
+
+public:
+  /* максимальный размер, резервируемый посредством reserve() */
+  enum { reserve_max = 64 };
+
+  json_writer(fptu_emit_func *emit, void *emit_ctx)
+      : base_(local_), ptr_(local_), end_(local_ + sizeof(local_)),
+        emit_(emit), emit_ctx_(emit_ctx), flushed_(0), rc_(FPTU_OK) {}
+
+  json_writer(char *buffer, size_t bytes)
+      : base_(buffer), ptr_(buffer), end_(buffer + bytes), emit_(nullptr),
+        emit_ctx_(nullptr), flushed_(0), rc_(FPTU_OK) {}
+
+  /* Прерывать ли вывод: ошибки приемника, либо неверные данные. Нехватка
+   * места в буфере пользователя вывод не прерывает. */
+  bool aborted() const { return rc_ != FPTU_OK && rc_ != FPTU_ENOSPACE; }
+  void fail(int rc) {
+    if (rc_ == FPTU_OK || rc_ == FPTU_ENOSPACE)
+      rc_ = rc;
+  }
+
+  char *reserve(size_t bytes) {
+    assert(bytes <= reserve_max);
+    if (unlikely(ptr_ + bytes > end_))
+      flush();
+    return ptr_;
+  }
+  void commit(char *ptr) {
+    assert(ptr >= ptr_ && ptr <= end_);
+    ptr_ = ptr;
+  }
+
+  void put(char c) {
+    if (unlikely(ptr_ == end_))
+      flush();
+    *ptr_++ = c;
+  }
+
+  void write(const char *text, size_t length) {
+    while (unlikely(length > (size_t)(end_ - ptr_))) {
+      const size_t chunk = (size_t)(end_ - ptr_);
+      memcpy(ptr_, text, chunk);
+      ptr_ += chunk;
+      text += chunk;
+      length -= chunk;
+      flush();
+    }
+    memcpy(ptr_, text, length);
+    ptr_ += length;
+  }
+
+  /* Завершает вывод, возвращая код ошибки и общий объем вывода. */
+  int finish(size_t *length) {
+    if (emit_)
+      flush();
+    if (length)
+      *length = flushed_ + (size_t)(ptr_ - base_);
+    if (!emit_ && base_ != local_)
+      /* в буфере пользователя оставлено место для терминирующего нуля */
+      *ptr_ = '\0';
+    return rc_;
+  }
+};
+
+//----------------------------------------------------------------------------
+
+static const char json_digits2[201] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+
+static char *json_u64(uint64_t value, char *out) {
+  char tmp[20];
+  char *ptr = tmp + sizeof(tmp);
+  while (value >= 100) {
+    const unsigned i = (unsigned)(value % 100) * 2;
+    value /= 100;
+    *--ptr = json_digits2[i + 1];
+    *--ptr = json_digits2[i];
+  }
+  if (value < 10)
+    *--ptr = (char)('0' + value);
+  else {
+    const unsigned i = (unsigned)value * 2;
+    *--ptr = json_digits2[i + 1];
+    *--ptr = json_digits2[i];
+  }
+  const size_t length = (size_t)(tmp + sizeof(tmp) - ptr);
+  memcpy(out, ptr, length);
+  return out + length;
+}
+
+static char *json_i64(int64_t value, char *out) {
+  uint64_t magnitude = (uint64_t)value;
+  if (value < 0) {
+    *out++ = '-';
+    magnitude = 0 - magnitude;
+  }
+  return json_u64(magnitude, out);
+}
+
+/* Фиксированное количество цифр с ведущими нулями. */
+static char *json_fixed(unsigned value, unsigned width, char *out) {
+  for (unsigned i = width; i > 0; --i) {
+    out[i - 1] = (char)('0' + value % 10);
+    value /= 10;
+  }
+  return out + width;
+}
+
+//----------------------------------------------------------------------------
+
+/* Кратчайшее (в пределах гарантий Grisu2) десятичное представление чисел
+ * с плавающей точкой, которое при обратном преобразовании дает исходное
+ * значение. См. Florian Loitsch, "Printing Floating-Point Numbers Quickly
+ * and Accurately with Integers", PLDI 2010. */
+namespace grisu {
+
+struct diy_fp {
+  uint64_t f;
+  int e;
+  diy_fp(uint64_t f, int e) : f(f), e(e) {}
+};
+
+static __inline diy_fp multiply(const diy_fp &x, const diy_fp &y) {
+  const uint64_t mask32 = UINT32_MAX;
+  const uint64_t a = x.f >> 32, b = x.f & mask32;
+  const uint64_t c = y.f >> 32, d = y.f & mask32;
+  const uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+  uint64_t tmp = (bd >> 32) + (ad & mask32) + (bc & mask32);
+  tmp += UINT64_C(1) << 31; /* округление */
+  return diy_fp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64);
+}
+
+static __inline diy_fp normalize(diy_fp v) {
+  assert(v.f != 0);
+#ifdef __GNUC__
+  const int shift = __builtin_clzll(v.f);
+  v.f <<= shift;
+  v.e -= shift;
+#else
+  while ((v.f & (UINT64_C(1) << 63)) == 0) {
+    v.f <<= 1;
+    v.e -= 1;
+  }
+#endif
+  return v;
+}
+
+/* Степени 10^k для k = -348, -340, ..., 340. */
+static const uint64_t cached_f[87] = {
+    UINT64_C(0xfa8fd5a0081c0288), UINT64_C(0xbaaee17fa23ebf76),
+    UINT64_C(0x8b16fb203055ac76), UINT64_C(0xcf42894a5dce35ea),
+    UINT64_C(0x9a6bb0aa55653b2d), UINT64_C(0xe61acf033d1a45df),
+    UINT64_C(0xab70fe17c79ac6ca), UINT64_C(0xff77b1fcbebcdc4f),
+    UINT64_C(0xbe5691ef416bd60c), UINT64_C(0x8dd01fad907ffc3c),
+    UINT64_C(0xd3515c2831559a83), UINT64_C(0x9d71ac8fada6c9b5),
+    UINT64_C(0xea9c227723ee8bcb), UINT64_C(0xaecc49914078536d),
+    UINT64_C(0x823c12795db6ce57), UINT64_C(0xc21094364dfb5637),
+    UINT64_C(0x9096ea6f3848984f), UINT64_C(0xd77485cb25823ac7),
+    UINT64_C(0xa086cfcd97bf97f4), UINT64_C(0xef340a98172aace5),
+    UINT64_C(0xb23867fb2a35b28e), UINT64_C(0x84c8d4dfd2c63f3b),
+    UINT64_C(0xc5dd44271ad3cdba), UINT64_C(0x936b9fcebb25c996),
+    UINT64_C(0xdbac6c247d62a584), UINT64_C(0xa3ab66580d5fdaf6),
+    UINT64_C(0xf3e2f893dec3f126), UINT64_C(0xb5b5ada8aaff80b8),
+    UINT64_C(0x87625f056c7c4a8b), UINT64_C(0xc9bcff6034c13053),
+    UINT64_C(0x964e858c91ba2655), UINT64_C(0xdff9772470297ebd),
+    UINT64_C(0xa6dfbd9fb8e5b88f), UINT64_C(0xf8a95fcf88747d94),
+    UINT64_C(0xb94470938fa89bcf), UINT64_C(0x8a08f0f8bf0f156b),
+    UINT64_C(0xcdb02555653131b6), UINT64_C(0x993fe2c6d07b7fac),
+    UINT64_C(0xe45c10c42a2b3b06), UINT64_C(0xaa242499697392d3),
+    UINT64_C(0xfd87b5f28300ca0e), UINT64_C(0xbce5086492111aeb),
+    UINT64_C(0x8cbccc096f5088cc), UINT64_C(0xd1b71758e219652c),
+    UINT64_C(0x9c40000000000000), UINT64_C(0xe8d4a51000000000),
+    UINT64_C(0xad78ebc5ac620000), UINT64_C(0x813f3978f8940984),
+    UINT64_C(0xc097ce7bc90715b3), UINT64_C(0x8f7e32ce7bea5c70),
+    UINT64_C(0xd5d238a4abe98068), UINT64_C(0x9f4f2726179a2245),
+    UINT64_C(0xed63a231d4c4fb27), UINT64_C(0xb0de65388cc8ada8),
+    UINT64_C(0x83c7088e1aab65db), UINT64_C(0xc45d1df942711d9a),
+    UINT64_C(0x924d692ca61be758), UINT64_C(0xda01ee641a708dea),
+    UINT64_C(0xa26da3999aef774a), UINT64_C(0xf209787bb47d6b85),
+    UINT64_C(0xb454e4a179dd1877), UINT64_C(0x865b86925b9bc5c2),
+    UINT64_C(0xc83553c5c8965d3d), UINT64_C(0x952ab45cfa97a0b3),
+    UINT64_C(0xde469fbd99a05fe3), UINT64_C(0xa59bc234db398c25),
+    UINT64_C(0xf6c69a72a3989f5c), UINT64_C(0xb7dcbf5354e9bece),
+    UINT64_C(0x88fcf317f22241e2), UINT64_C(0xcc20ce9bd35c78a5),
+    UINT64_C(0x98165af37b2153df), UINT64_C(0xe2a0b5dc971f303a),
+    UINT64_C(0xa8d9d1535ce3b396), UINT64_C(0xfb9b7cd9a4a7443c),
+    UINT64_C(0xbb764c4ca7a44410), UINT64_C(0x8bab8eefb6409c1a),
+    UINT64_C(0xd01fef10a657842c), UINT64_C(0x9b10a4e5e9913129),
+    UINT64_C(0xe7109bfba19c0c9d), UINT64_C(0xac2820d9623bf429),
+    UINT64_C(0x80444b5e7aa7cf85), UINT64_C(0xbf21e44003acdd2d),
+    UINT64_C(0x8e679c2f5e44ff8f), UINT64_C(0xd433179d9c8cb841),
+    UINT64_C(0x9e19db92b4e31ba9), UINT64_C(0xeb96bf6ebadf77d9),
+    UINT64_C(0xaf87023b9bf0ee6b)
+};
+
+static const int16_t cached_e[87] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954,
+    -927, -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635,
+    -608, -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316,
+    -289, -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30, 56,
+    83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348, 375, 402, 428, 455,
+    481, 508, 534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800, 827, 853,
+    880, 907, 933, 960, 986, 1013, 1039, 1066
+};
+
+static diy_fp cached_power(int e, int *k10) {
+  const double dk = (-61 - e) * 0.30102999566398114 + 347;
+  int k = (int)dk;
+  if (dk - k > 0.0)
+    k++;
+  const unsigned index = (unsigned)((k >> 3) + 1);
+  assert(index < 87);
+  *k10 = -(-348 + (int)(index << 3));
+  return diy_fp(cached_f[index], cached_e[index]);
+}
+
+static const uint64_t pow10[20] = {
+    UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+    UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000),
+    UINT64_C(100000000), UINT64_C(1000000000), UINT64_C(10000000000),
+    UINT64_C(100000000000), UINT64_C(1000000000000), UINT64_C(10000000000000),
+    UINT64_C(100000000000000), UINT64_C(1000000000000000),
+    UINT64_C(10000000000000000), UINT64_C(100000000000000000),
+    UINT64_C(1000000000000000000), UINT64_C(10000000000000000000)};
+
+static __inline void round_weed(char *buffer, int length, uint64_t delta,
+                                uint64_t rest, uint64_t ten_kappa,
+                                uint64_t wp_w) {
+  while (rest < wp_w && delta - rest >= ten_kappa &&
+         (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+    buffer[length - 1]--;
+    rest += ten_kappa;
+  }
+}
+
+static void digit_gen(const diy_fp &w, const diy_fp &mp, uint64_t delta,
+                      char *buffer, int *length, int *k10) {
+  const diy_fp one(UINT64_C(1) << -mp.e, mp.e);
+  const uint64_t wp_w = mp.f - w.f;
+  uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+  uint64_t p2 = mp.f & (one.f - 1);
+
+  int kappa = 1;
+  while (kappa < 10 && p1 >= pow10[kappa])
+    kappa++;
+
+  *length = 0;
+  while (kappa > 0) {
+    const uint32_t divisor = (uint32_t)pow10[kappa - 1];
+    const uint32_t d = p1 / divisor;
+    p1 %= divisor;
+    if (d || *length)
+      buffer[(*length)++] = (char)('0' + d);
+    kappa--;
+    const uint64_t tmp = ((uint64_t)p1 << -one.e) + p2;
+    if (tmp <= delta) {
+      *k10 += kappa;
+      round_weed(buffer, *length, delta, tmp, pow10[kappa] << -one.e, wp_w);
+      return;
+    }
+  }
+
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    const char d = (char)(p2 >> -one.e);
+    if (d || *length)
+      buffer[(*length)++] = (char)('0' + d);
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta) {
+      *k10 += kappa;
+      round_weed(buffer, *length, delta, p2, one.f,
+                 (-kappa < 20) ? wp_w * pow10[-kappa] : 0);
+      return;
+    }
+  }
+}
+
+/* Генерирует цифры положительного значения f * 2^e с мантиссой из
+ * significand_bits бит (с учетом неявной единицы), так что результат
+ * равен buffer * 10^k10. */
+static void generate(uint64_t f, int e, unsigned significand_bits,
+                     char *buffer, int *length, int *k10) {
+  const uint64_t hidden = UINT64_C(1) << (significand_bits - 1);
+  diy_fp plus = normalize(diy_fp((f << 1) + 1, e - 1));
+  diy_fp minus = (f == hidden) ? diy_fp((f << 2) - 1, e - 2)
+                               : diy_fp((f << 1) - 1, e - 1);
+  minus.f <<= minus.e - plus.e;
+  minus.e = plus.e;
+
+  const diy_fp c_mk = cached_power(plus.e, k10);
+  const diy_fp w = multiply(normalize(diy_fp(f, e)), c_mk);
+  diy_fp wp = multiply(plus, c_mk);
+  diy_fp wm = multiply(minus, c_mk);
+  wm.f++;
+  wp.f--;
+  digit_gen(w, wp, wp.f - wm.f, buffer, length, k10);
+}
+
+static char *exponent(int k, char *out) {
+  *out++ = 'e';
+  if (k < 0) {
+    *out++ = '-';
+    k = -k;
+  }
+  return json_u64((unsigned)k, out);
+}
+
+/* Форматирует цифры buffer * 10^k с учетом порядка аналогично "%g",
+ * но без потери точности. Целые значения дополняются ".0", что позволяет
+ * отличать их от целочисленных полей. */
+static char *prettify(char *buffer, int length, int k) {
+  const int kk = length + k; /* 10^(kk-1) <= v < 10^kk */
+  if (0 <= k && kk <= 21) {
+    /* 1234e7 -> 12340000000.0 */
+    for (int i = length; i < kk; i++)
+      buffer[i] = '0';
+    buffer[kk] = '.';
+    buffer[kk + 1] = '0';
+    return &buffer[kk + 2];
+  }
+  if (0 < kk && kk <= 21) {
+    /* 1234e-2 -> 12.34 */
+    memmove(&buffer[kk + 1], &buffer[kk], (size_t)(length - kk));
+    buffer[kk] = '.';
+    return &buffer[length + 1];
+  }
+  if (-6 < kk && kk <= 0) {
+    /* 1234e-6 -> 0.001234 */
+    const int offset = 2 - kk;
+    memmove(&buffer[offset], &buffer[0], (size_t)length);
+    buffer[0] = '0';
+    buffer[1] = '.';
+    for (int i = 2; i < offset; i++)
+      buffer[i] = '0';
+    return &buffer[length + offset];
+  }
+  if (length == 1)
+    /* 1e30 */
+    return exponent(kk - 1, &buffer[1]);
+
+  /* 1234e30 -> 1.234e33 */
+  memmove(&buffer[2], &buffer[1], (size_t)(length - 1));
+  buffer[1] = '.';
+  return exponent(kk - 1, &buffer[length + 1]);
+}
+
+} /* namespace grisu */
+
+/* JSON не допускает NaN и бесконечностей, для них выводится null. */
+static char *json_fp64(double value, char *out) {
+  uint64_t u64;
+  memcpy(&u64, &value, sizeof(u64));
+  const unsigned biased = (unsigned)(u64 >> 52) & 0x7FF;
+  uint64_t f = u64 & ((UINT64_C(1) << 52) - 1);
+  if (unlikely(biased == 0x7FF)) {
+    memcpy(out, "null", 4);
+    return out + 4;
+  }
+  if (u64 >> 63)
+    *out++ = '-';
+  if (biased == 0 && f == 0) {
+    memcpy(out, "0.0", 3);
+    return out + 3;
+  }
+
+  int e = -1074;
+  if (biased) {
+    f += UINT64_C(1) << 52;
+    e = (int)biased - 1075;
+  }
+  int length, k10;
+  grisu::generate(f, e, 53, out, &length, &k10);
+  return grisu::prettify(out, length, k10);
+}
+
+static char *json_fp32(float value, char *out) {
+  uint32_t u32;
+  memcpy(&u32, &value, sizeof(u32));
+  const unsigned biased = (u32 >> 23) & 0xFF;
+  uint32_t f = u32 & ((UINT32_C(1) << 23) - 1);
+  if (unlikely(biased == 0xFF)) {
+    memcpy(out, "null", 4);
+    return out + 4;
+  }
+  if (u32 >> 31)
+    *out++ = '-';
+  if (biased == 0 && f == 0) {
+    memcpy(out, "0.0", 3);
+    return out + 3;
+  }
+
+  int e = -149;
+  if (biased) {
+    f += UINT32_C(1) << 23;
+    e = (int)biased - 150;
+  }
+  int length, k10;
+  grisu::generate(f, e, 24, out, &length, &k10);
+  return grisu::prettify(out, length, k10);
+}
+
+/* Время в формате ISO-8601 с точностью до наносекунд (с отбрасыванием
+ * остатка), например "2017-03-20T12:34:56.123456789Z". */
+static char *json_datetime(fptu_time time, char *out) {
+  const uint64_t seconds = time.fixedpoint >> 32;
+  const uint32_t nanoseconds =
+      (uint32_t)(((time.fixedpoint & UINT32_MAX) * UINT64_C(1000000000)) >>
+                 32);
+
+  /* дата по количеству дней от 1970-01-01, см. Howard Hinnant,
+   * "chrono-Compatible Low-Level Date Algorithms" */
+  const unsigned day_seconds = (unsigned)(seconds % 86400);
+  const uint64_t z = seconds / 86400 + 719468;
+  const uint64_t era = z / 146097;
+  const unsigned doe = (unsigned)(z - era * 146097);
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  const unsigned day = doy - (153 * mp + 2) / 5 + 1;
+  const unsigned month = (mp < 10) ? mp + 3 : mp - 9;
+  const unsigned year = (unsigned)(yoe + era * 400) + (month <= 2);
+
+  *out++ = '"';
+  out = json_fixed(year, 4, out);
+  *out++ = '-';
+  out = json_fixed(month, 2, out);
+  *out++ = '-';
+  out = json_fixed(day, 2, out);
+  *out++ = 'T';
+  out = json_fixed(day_seconds / 3600, 2, out);
+  *out++ = ':';
+  out = json_fixed(day_seconds / 60 % 60, 2, out);
+  *out++ = ':';
+  out = json_fixed(day_seconds % 60, 2, out);
+  *out++ = '.';
+  out = json_fixed(nanoseconds, 9, out);
+  *out++ = 'Z';
+  *out++ = '"';
+  return out;
+}
+
+//----------------------------------------------------------------------------
+
+static void json_string(json_writer &w, const char *text, size_t length) {
+  static const char hex[] = "0123456789abcdef";
+  const char *const end = text + length;
+  const char *run = text;
+  w.put('"');
+  for (const char *ptr = text; ptr < end; ++ptr) {
+    const unsigned char c = (unsigned char)*ptr;
+    if (likely(c >= 0x20 && c != '"' && c != '\\'))
+      continue;
+
+    w.write(run, (size_t)(ptr - run));
+    run = ptr + 1;
+    char *out = w.reserve(6);
+    *out++ = '\\';
+    switch (c) {
+    case '"':
+    case '\\':
+      *out++ = (char)c;
+      break;
+    case '\b':
+      *out++ = 'b';
+      break;
+    case '\f':
+      *out++ = 'f';
+      break;
+    case '\n':
+      *out++ = 'n';
+      break;
+    case '\r':
+      *out++ = 'r';
+      break;
+    case '\t':
+      *out++ = 't';
+      break;
+    default:
+      *out++ = 'u';
+      *out++ = '0';
+      *out++ = '0';
+      *out++ = hex[c >> 4];
+      *out++ = hex[c & 15];
+      break;
+    }
+    w.commit(out);
+  }
+  w.write(run, (size_t)(end - run));
+  w.put('"');
+}
+
+/* Бинарные данные выводятся строкой в шестнадцатеричном виде. */
+static void json_hex(json_writer &w, const void *data, size_t bytes) {
+  static const char hex[] = "0123456789abcdef";
+  const uint8_t *ptr = (const uint8_t *)data;
+  w.put('"');
+  while (bytes) {
+    const size_t chunk = std::min(bytes, (size_t)json_writer::reserve_max / 2);
+    char *out = w.reserve(chunk * 2);
+    for (size_t i = 0; i < chunk; ++i) {
+      *out++ = hex[ptr[i] >> 4];
+      *out++ = hex[ptr[i] & 15];
+    }
+    w.commit(out);
+    ptr += chunk;
+    bytes -= chunk;
+  }
+  w.put('"');
+}
+
+struct json_schema {
+  fptu_tag2name_func *tag2name;
+  fptu_nested_func *nested_ctx;
+  const void *schema_ctx;
+  unsigned options;
+
+  json_schema nested(uint_fast16_t tag) const {
+    json_schema result = *this;
+    if (nested_ctx)
+      result.schema_ctx = nested_ctx(schema_ctx, tag);
+    return result;
+  }
+};
+
+static void json_tuple(json_writer &w, fptu_ro ro, const json_schema &schema);
+
+/* Элементы массива фиксированного размера. */
+template <typename native, typename emitter>
+static void json_array_items(json_writer &w, const void *items,
+                             unsigned length, emitter emit) {
+  const native *array = (const native *)items;
+  for (unsigned i = 0; i < length; ++i) {
+    if (i)
+      w.put(',');
+    w.commit(emit(array[i], w.reserve(json_writer::reserve_max)));
+  }
+}
+
+static void json_value(json_writer &w, const fptu_field *pf,
+                       const json_schema &schema) {
+  const fptu_payload *payload = fptu_field_payload(pf);
+  char *out;
+
+  switch ((int /* hush 'not in enumerated' */)fptu_get_type(pf->ct)) {
+  default:
+  case fptu_null:
+  case fptu_null | fptu_farray:
+    w.write("null", 4);
+    return;
+  case fptu_uint16:
+    out = w.reserve(json_writer::reserve_max);
+    w.commit(json_u64(pf->get_payload_uint16(), out));
+    return;
+  case fptu_int32:
+    out = w.reserve(json_writer::reserve_max);
+    w.commit(json_i64(payload->i32, out));
+    return;
+  case fptu_uint32:
+    out = w.reserve(json_writer::reserve_max);
+    w.commit(json_u64(payload->u32, out));
+    return;
+  case fptu_fp32:
+    out = w.reserve(json_writer::reserve_max);
+    w.commit(json_fp32(payload->fp32, out));
+    return;
+  case fptu_int64:
+    out = w.reserve(json_writer::reserve_max);
+    w.commit(json_i64(payload->i64, out));
+    return;
+  case fptu_uint64:
+    out = w.reserve(json_writer::reserve_max);
+    w.commit(json_u64(payload->u64, out));
+    return;
+  case fptu_fp64:
+    out = w.reserve(json_writer::reserve_max);
+    w.commit(json_fp64(payload->fp64, out));
+    return;
+  case fptu_datetime:
+    out = w.reserve(json_writer::reserve_max);
+    w.commit(json_datetime(payload->dt, out));
+    return;
+  case fptu_96:
+    json_hex(w, payload->fixbin, 96 / 8);
+    return;
+  case fptu_128:
+    json_hex(w, payload->fixbin, 128 / 8);
+    return;
+  case fptu_160:
+    json_hex(w, payload->fixbin, 160 / 8);
+    return;
+  case fptu_256:
+    json_hex(w, payload->fixbin, 256 / 8);
+    return;
+  case fptu_cstr:
+    json_string(w, payload->cstr, strlen(payload->cstr));
+    return;
+  case fptu_opaque:
+    json_hex(w, payload->other.data, payload->other.varlen.opaque_bytes);
+    return;
+  case fptu_nested:
+    json_tuple(w, fptu_field_nested(pf), schema.nested(pf->ct));
+    return;
+  }
+
+  const unsigned length = payload->other.varlen.array_length;
+  const void *items = fptu_array_items(payload);
+  w.put('[');
+  switch ((int /* hush 'not in enumerated' */)fptu_get_type(pf->ct)) {
+  case fptu_uint16 | fptu_farray:
+    json_array_items<uint16_t>(w, items, length, [](uint16_t v, char *out) {
+      return json_u64(v, out);
+    });
+    break;
+  case fptu_int32 | fptu_farray:
+    json_array_items<int32_t>(w, items, length, [](int32_t v, char *out) {
+      return json_i64(v, out);
+    });
+    break;
+  case fptu_uint32 | fptu_farray:
+    json_array_items<uint32_t>(w, items, length, [](uint32_t v, char *out) {
+      return json_u64(v, out);
+    });
+    break;
+  case fptu_fp32 | fptu_farray:
+    json_array_items<float>(w, items, length, json_fp32);
+    break;
+  case fptu_int64 | fptu_farray:
+    json_array_items<int64_t>(w, items, length, json_i64);
+    break;
+  case fptu_uint64 | fptu_farray:
+    json_array_items<uint64_t>(w, items, length, json_u64);
+    break;
+  case fptu_fp64 | fptu_farray:
+    json_array_items<double>(w, items, length, json_fp64);
+    break;
+  case fptu_datetime | fptu_farray:
+    json_array_items<fptu_time>(w, items, length, json_datetime);
+    break;
+
+  case fptu_96 | fptu_farray:
+  case fptu_128 | fptu_farray:
+  case fptu_160 | fptu_farray:
+  case fptu_256 | fptu_farray: {
+    const size_t itemsize =
+        fptu_internal_map_t2b[fptu_get_type(pf->ct) & ~fptu_farray];
+    const uint8_t *array = (const uint8_t *)items;
+    for (unsigned i = 0; i < length; ++i) {
+      if (i)
+        w.put(',');
+      json_hex(w, array, itemsize);
+      array += itemsize;
+    }
+  } break;
+
+  case fptu_cstr | fptu_farray: {
+    const char *array = (const char *)items;
+    for (unsigned i = 0; i < length; ++i) {
+      if (i)
+        w.put(',');
+      const size_t bytes = strlen(array);
+      json_string(w, array, bytes);
+      array += bytes + 1;
+    }
+  } break;
+
+  case fptu_opaque | fptu_farray: {
+    const fptu_unit *array = (const fptu_unit *)items;
+    for (unsigned i = 0; i < length; ++i) {
+      if (i)
+        w.put(',');
+      json_hex(w, array + 1, array->varlen.opaque_bytes);
+      array += array->varlen.brutto + 1;
+    }
+  } break;
+
+  case fptu_nested | fptu_farray: {
+    const fptu_unit *array = (const fptu_unit *)items;
+    for (unsigned i = 0; i < length; ++i) {
+      fptu_ro nested;
+      nested.total_bytes = units2bytes(array->varlen.brutto + (size_t)1);
+      nested.units = array;
+      if (i)
+        w.put(',');
+      json_tuple(w, nested, schema.nested(pf->ct));
+      array += array->varlen.brutto + 1;
+    }
+  } break;
+  }
+  w.put(']');
+}
+
+/* Выводит ключ и возвращает false, если поле следует пропустить. */
+static bool json_key(json_writer &w, uint_fast16_t ct, bool first,
+                     const json_schema &schema) {
+  const char *name =
+      schema.tag2name ? schema.tag2name(schema.schema_ctx, ct) : nullptr;
+  if (!name && (schema.options & fptu_json_skip_unknown))
+    return false;
+
+  if (!first)
+    w.put(',');
+  if (name)
+    json_string(w, name, strlen(name));
+  else {
+    char *out = w.reserve(json_writer::reserve_max);
+    *out++ = '"';
+    out = json_u64(fptu_get_colnum(ct), out);
+    *out++ = '"';
+    w.commit(out);
+  }
+  w.put(':');
+  return true;
+}
+
+/* Поля выводятся в порядке добавления, а коллекции (повторы тега)
+ * массивом при первом вхождении тега. */
+static void json_tuple(json_writer &w, fptu_ro ro, const json_schema &schema) {
+  const fptu_field *const begin = fptu_begin_ro(ro);
+  const fptu_field *const end = fptu_end_ro(ro);
+  if (unlikely(!begin && ro.total_bytes)) {
+    w.fail(FPTU_EINVAL);
+    return;
+  }
+
+  const size_t items = end - begin;
+#ifdef _MSC_VER /* FIXME: mustdie */
+  uint16_t *const tags = (uint16_t *)_malloca(sizeof(uint16_t) * (items + 1));
+#else
+  uint16_t tags[items + 1];
+#endif
+
+  /* fptu_tags() отбрасывает дубликаты, поэтому коллекции есть только если
+   * живых тегов меньше чем живых полей */
+  size_t live = 0;
+  for (const fptu_field *pf = begin; pf < end; ++pf)
+    live += !ct_is_dead(pf->ct);
+  const uint16_t *tags_end = fptu_tags(tags, begin, end);
+  while (tags_end > tags && ct_is_dead(tags_end[-1]))
+    --tags_end;
+  size_t collections = 0;
+  if (unlikely((size_t)(tags_end - tags) < live)) {
+    /* переиспользуем буфер под отсортированный список тегов коллекций,
+     * за которым следуют признаки их вывода */
+    size_t n = 0;
+    for (const fptu_field *pf = begin; pf < end; ++pf)
+      if (!ct_is_dead(pf->ct))
+        tags[n++] = pf->ct;
+    std::sort(tags, tags + n);
+    for (size_t i = 1; i < n; ++i)
+      if (tags[i] == tags[i - 1] &&
+          (collections == 0 || tags[collections - 1] != tags[i]))
+        tags[collections++] = tags[i];
+    assert(collections * 2 <= items);
+    memset(tags + collections, 0, sizeof(uint16_t) * collections);
+  }
+
+  w.put('{');
+  bool first = true;
+  for (const fptu_field *pf = end; pf > begin && !w.aborted();) {
+    if (ct_is_dead((--pf)->ct))
+      continue;
+
+    uint16_t *done = nullptr;
+    if (unlikely(collections)) {
+      const uint16_t *it = std::lower_bound(tags, tags + collections, pf->ct);
+      if (it != tags + collections && *it == pf->ct) {
+        done = tags + collections + (it - tags);
+        if (*done)
+          continue;
+        *done = 1;
+      }
+    }
+    if (!json_key(w, pf->ct, first, schema))
+      continue;
+    first = false;
+    if (likely(!done)) {
+      json_value(w, pf, schema);
+      continue;
+    }
+
+    w.put('[');
+    json_value(w, pf, schema);
+    for (const fptu_field *next = pf; next > begin;) {
+      if ((--next)->ct == pf->ct) {
+        w.put(',');
+        json_value(w, next, schema);
+      }
+    }
+    w.put(']');
+  }
+  w.put('}');
+}
+
+} /* anonymous namespace */
+
+//----------------------------------------------------------------------------
+
+int fptu_tuple2json(fptu_ro ro, fptu_emit_func *output, void *output_ctx,
+                    fptu_tag2name_func *tag2name, fptu_nested_func *nested,
+                    const void *schema_ctx, unsigned options) {
+  if (unlikely(output == nullptr))
+    return FPTU_EINVAL;
+
+  json_writer w(output, output_ctx);
+  const json_schema schema = {tag2name, nested, schema_ctx, options};
+  json_tuple(w, ro, schema);
+  return w.finish(nullptr);
+}
+
+int fptu_tuple2json_buffer(fptu_ro ro, char *buffer, size_t bytes,
+                           size_t *length, fptu_tag2name_func *tag2name,
+                           fptu_nested_func *nested, const void *schema_ctx,
+                           unsigned options) {
+  if (unlikely(buffer == nullptr || bytes < 1))
+    return FPTU_EINVAL;
+
+  /* место для терминирующего нуля */
+  json_writer w(buffer, bytes - 1);
+  const json_schema schema = {tag2name, nested, schema_ctx, options};
+  json_tuple(w, ro, schema);
+  return w.finish(length);
+}
+
+namespace fptu {
+
+static int json_append(void *output_ctx, const char *text, size_t length) {
+  static_cast<std::string *>(output_ctx)->append(text, length);
+  return FPTU_OK;
+}
+
+std::string to_json(const fptu_ro &ro, fptu_tag2name_func *tag2name,
+                    fptu_nested_func *nested, const void *schema_ctx,
+                    unsigned options) {
+  std::string result;
+  fptu_tuple2json(ro, json_append, &result, tag2name, nested, schema_ctx,
+                  options);
+  return result;
+}
+
+} /* namespace fptu */
@@ -0,0 +1,262 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fast_positive/tuples_internal.h"
+
+/* Размер значения поля в нормализованном ключе, без байта присутствия.
+ * Возвращает -1 для неподдерживаемых типов. */
+static ptrdiff_t fptu_keydef_value_size(const fptu_keydef *def) {
+  if (unlikely(def->column > fptu_max_cols))
+    return -1;
+
+  switch (def->type) {
+  case fptu_null:
+    return 0;
+  case fptu_uint16:
+    return 2;
+  case fptu_int32:
+  case fptu_uint32:
+  case fptu_fp32:
+    return 4;
+  case fptu_int64:
+  case fptu_uint64:
+  case fptu_fp64:
+  case fptu_datetime:
+    return 8;
+  case fptu_96:
+    return 12;
+  case fptu_128:
+    return 16;
+  case fptu_160:
+    return 20;
+  case fptu_256:
+    return 32;
+  case fptu_cstr:
+    return def->width;
+  case fptu_opaque:
+    return def->width + 2;
+  default:
+    /* fptu_nested и массивы */
+    return -1;
+  }
+}
+
+size_t fptu_key_size(const fptu_keydef *spec, size_t count) {
+  /* ограничение заодно определяет размер буферов на стеке
+   * в fptu_key_build() и fptu_cmp_keys() */
+  if (unlikely(spec == nullptr || count == 0 || count > fptu_max_fields))
+    return 0;
+
+  size_t bytes = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const ptrdiff_t value_size = fptu_keydef_value_size(&spec[i]);
+    if (unlikely(value_size < 0))
+      return 0;
+    bytes += 1 + (size_t)value_size;
+  }
+  return bytes;
+}
+
+/* Поиск полей для всех колонок ключа за один проход по дескрипторам.
+ * Как и в fptu_lookup_ro() используется первое найденное поле. */
+static __hot void fptu_key_lookup(fptu_ro ro, const fptu_keydef *spec,
+                                  size_t count, const fptu_field **found) {
+  size_t missing = 0;
+  for (size_t i = 0; i < count; ++i) {
+    found[i] = nullptr;
+    missing += 1;
+  }
+
+  const fptu_field *const end = fptu_end_ro(ro);
+  for (const fptu_field *pf = fptu_begin_ro(ro); pf < end && missing; ++pf) {
+    if (ct_is_dead(pf->ct))
+      continue;
+    for (size_t i = 0; i < count; ++i) {
+      if (found[i] == nullptr &&
+          pf->ct == fptu_pack_coltype(spec[i].column,
+                                      (fptu_type)spec[i].type)) {
+        found[i] = pf;
+        missing -= 1;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+
+static __inline uint8_t *put_be16(uint8_t *ptr, uint16_t value) {
+  ptr[0] = (uint8_t)(value >> 8);
+  ptr[1] = (uint8_t)value;
+  return ptr + 2;
+}
+
+static __inline uint8_t *put_be32(uint8_t *ptr, uint32_t value) {
+  ptr[0] = (uint8_t)(value >> 24);
+  ptr[1] = (uint8_t)(value >> 16);
+  ptr[2] = (uint8_t)(value >> 8);
+  ptr[3] = (uint8_t)value;
+  return ptr + 4;
+}
+
+static __inline uint8_t *put_be64(uint8_t *ptr, uint64_t value) {
+  ptr = put_be32(ptr, (uint32_t)(value >> 32));
+  return put_be32(ptr, (uint32_t)value);
+}
+
+static __inline uint32_t order_fp32(float value) {
+  if (value == 0)
+    value = 0 /* -0.0 => +0.0 */;
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return (bits & UINT32_C(0x80000000)) ? ~bits : bits | UINT32_C(0x80000000);
+}
+
+static __inline uint64_t order_fp64(double value) {
+  if (value == 0)
+    value = 0 /* -0.0 => +0.0 */;
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return (bits & UINT64_C(0x8000000000000000))
+             ? ~bits
+             : bits | UINT64_C(0x8000000000000000);
+}
+
+static uint8_t *fptu_key_put(uint8_t *ptr, const fptu_keydef *def,
+                             size_t value_size, const fptu_field *pf) {
+  if (pf == nullptr) {
+    /* отсутствующее поле меньше любого присутствующего */
+    memset(ptr, 0, 1 + value_size);
+    return ptr + 1 + value_size;
+  }
+
+  *ptr++ = 1;
+  const fptu_payload *payload = fptu_field_payload(pf);
+  switch (def->type) {
+  case fptu_null:
+    return ptr;
+  case fptu_uint16:
+    return put_be16(ptr, (uint16_t)pf->get_payload_uint16());
+  case fptu_int32:
+    return put_be32(ptr, (uint32_t)payload->i32 ^ UINT32_C(0x80000000));
+  case fptu_uint32:
+    return put_be32(ptr, payload->u32);
+  case fptu_fp32:
+    return put_be32(ptr, order_fp32(payload->fp32));
+  case fptu_int64:
+    return put_be64(ptr,
+                    (uint64_t)payload->i64 ^ UINT64_C(0x8000000000000000));
+  case fptu_uint64:
+  case fptu_datetime:
+    return put_be64(ptr, payload->u64);
+  case fptu_fp64:
+    return put_be64(ptr, order_fp64(payload->fp64));
+
+  case fptu_96:
+  case fptu_128:
+  case fptu_160:
+  case fptu_256:
+    memcpy(ptr, payload->fixbin, value_size);
+    return ptr + value_size;
+
+  case fptu_cstr: {
+    /* strncpy() дополняет нулями, чего здесь и требуется */
+    strncpy((char *)ptr, payload->cstr, value_size);
+    return ptr + value_size;
+  }
+
+  case fptu_opaque: {
+    const size_t width = value_size - 2;
+    const size_t bytes = payload->other.varlen.opaque_bytes;
+    if (bytes >= width)
+      memcpy(ptr, payload->other.data, width);
+    else {
+      memcpy(ptr, payload->other.data, bytes);
+      memset(ptr + bytes, 0, width - bytes);
+    }
+    return put_be16(ptr + width, (uint16_t)bytes);
+  }
+
+  default:
+    assert(false);
+    __unreachable();
+    return ptr;
+  }
+}
+
+int fptu_key_build(fptu_ro ro, const fptu_keydef *spec, size_t count,
+                   void *key, size_t key_bytes) {
+  const size_t need = fptu_key_size(spec, count);
+  if (unlikely(need == 0 || key == nullptr))
+    return FPTU_EINVAL;
+  if (unlikely(key_bytes < need))
+    return FPTU_ENOSPACE;
+
+#ifdef _MSC_VER /* FIXME: mustdie */
+  const fptu_field **const found =
+      (const fptu_field **)_malloca(sizeof(const fptu_field *) * count);
+#else
+  const fptu_field *found[count];
+#endif
+  fptu_key_lookup(ro, spec, count, found);
+
+  uint8_t *ptr = (uint8_t *)key;
+  for (size_t i = 0; i < count; ++i) {
+    const fptu_keydef *def = &spec[i];
+    const size_t value_size = (size_t)fptu_keydef_value_size(def);
+    uint8_t *const begin = ptr;
+    ptr = fptu_key_put(ptr, def, value_size, found[i]);
+    assert(ptr == begin + 1 + value_size);
+    if (def->descending) {
+      for (uint8_t *p = begin; p < ptr; ++p)
+        *p = ~*p;
+    }
+  }
+
+  assert(ptr == (uint8_t *)key + need);
+  return FPTU_OK;
+}
+
+//----------------------------------------------------------------------------
+
+fptu_lge fptu_cmp_keys(fptu_ro left, fptu_ro right, const fptu_keydef *spec,
+                       size_t count) {
+  if (unlikely(fptu_key_size(spec, count) == 0))
+    return fptu_ic;
+
+#ifdef _MSC_VER /* FIXME: mustdie */
+  const fptu_field **const found =
+      (const fptu_field **)_malloca(sizeof(const fptu_field *) * count * 2);
+#else
+  const fptu_field *found[count * 2];
+#endif
+  const fptu_field **const found_l = found;
+  const fptu_field **const found_r = found + count;
+  fptu_key_lookup(left, spec, count, found_l);
+  fptu_key_lookup(right, spec, count, found_r);
+
+  for (size_t i = 0; i < count; ++i) {
+    fptu_lge cmp = fptu_cmp_fields(found_l[i], found_r[i]);
+    if (cmp == fptu_eq)
+      continue;
+    if (spec[i].descending && (cmp == fptu_lt || cmp == fptu_gt))
+      cmp = (cmp == fptu_lt) ? fptu_gt : fptu_lt;
+    return cmp;
+  }
+  return fptu_eq;
+}
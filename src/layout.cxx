@@ -0,0 +1,94 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fast_positive/tuples_internal.h"
+
+uint64_t fptu_layout_digest(const fptu_field *begin, const fptu_field *end,
+                            size_t data_units) {
+  uint64_t digest = UINT64_C(14695981039346656037) ^
+                    ((uint64_t)(end - begin) << 32 | data_units);
+  for (const fptu_field *pf = begin; pf < end; ++pf) {
+    if (ct_is_dead(pf->ct) || !ct_is_fixedsize(pf->ct))
+      return 0;
+    /* у fptu_uint16 вместо смещения хранится значение */
+    const uint32_t offset =
+        (fptu_get_type(pf->ct) == fptu_uint16) ? 0 : pf->offset;
+    digest = (digest ^ ((uint32_t)pf->ct << 16 | offset)) *
+             UINT64_C(1099511628211);
+  }
+  digest ^= digest >> 29;
+  return digest ? digest : 1;
+}
+
+size_t fptu_layout_space(fptu_ro tmpl) {
+  if (unlikely(tmpl.total_bytes < fptu_unit_size))
+    return 0;
+  return tmpl.total_bytes + units2bytes(3);
+}
+
+fptu_ro fptu_layout_stamp(fptu_ro tmpl, void *space, size_t buffer_bytes) {
+  fptu_ro tuple;
+  tuple.units = nullptr;
+  tuple.total_bytes = 0;
+
+  if (unlikely(tmpl.total_bytes == 0 || fptu_check_ro(tmpl) != nullptr))
+    return tuple;
+  const size_t items = tmpl.units[0].varlen.tuple_items;
+  if (unlikely((items & fptu_lx_mask) || items >= fptu_max_fields))
+    return tuple;
+  const size_t total_bytes = fptu_layout_space(tmpl);
+  if (unlikely(space == nullptr || buffer_bytes < total_bytes ||
+               total_bytes > fptu_max_tuple_bytes))
+    return tuple;
+
+  const fptu_field *const begin = &tmpl.units[1].field;
+  const size_t brutto = tmpl.units[0].varlen.brutto;
+  const uint64_t fingerprint =
+      fptu_layout_digest(begin, begin + items, brutto - items);
+  if (unlikely(fingerprint == 0))
+    return tuple;
+
+  /* отпечаток: дескриптор первый, а 8 байт данных последние */
+  fptu_unit *units = (fptu_unit *)space;
+  units[0].varlen.brutto = (uint16_t)(brutto + 3);
+  units[0].varlen.tuple_items = (uint16_t)((items + 1) | fptu_lx_bloom);
+  memcpy(&units[2], &tmpl.units[1], units2bytes(brutto));
+  fptu_field *marker = &units[1].field;
+  marker->ct = fptu_layout_ct;
+  marker->offset = (uint16_t)(brutto + 1);
+  fptu_field_payload(marker)->u64 = fingerprint;
+
+  tuple.units = units;
+  tuple.total_bytes = total_bytes;
+  return tuple;
+}
+
+size_t fptu_layout_offset(fptu_ro ro, unsigned column, fptu_type type) {
+  if (unlikely((unsigned)type < fptu_uint16 || (unsigned)type >= fptu_cstr))
+    return 0;
+
+  const fptu_field *pf = fptu_lookup_ro(ro, column, type);
+  if (unlikely(pf == nullptr))
+    return 0;
+
+  const char *value = (type == fptu_uint16)
+                          ? (const char *)&pf->offset
+                          : (const char *)fptu_field_payload(pf);
+  return (size_t)(value - (const char *)ro.units);
+}
@@ -181,7 +181,7 @@ array2str_native(uint_fast16_t ct, const fptu_payload *payload,
                    payload->other.varlen.array_length,
                    units2bytes(payload->other.varlen.brutto));
 
-  const native *array = (const native *)&payload->other.data[1];
+  const native *array = (const native *)fptu_array_items(payload);
   for (unsigned i = 0; i < payload->other.varlen.array_length; ++i)
     result += fptu::format(&comma_fmt[i == 0], array[i]);
 
@@ -196,7 +196,7 @@ static std::string array2str_fixbin(uint_fast16_t ct,
                    payload->other.varlen.array_length,
                    units2bytes(payload->other.varlen.brutto));
 
-  const uint8_t *array = (const uint8_t *)&payload->other.data[1];
+  const uint8_t *array = (const uint8_t *)fptu_array_items(payload);
   for (unsigned i = 0; i < payload->other.varlen.array_length; ++i) {
     if (i)
       result += ",";
@@ -307,7 +307,7 @@ __cold string to_string(const fptu_field &field) {
                      "datetime", payload->other.varlen.array_length,
                      units2bytes(payload->other.varlen.brutto));
 
-    const fptu_time *array = (const fptu_time *)&payload->other.data[1];
+    const fptu_time *array = (const fptu_time *)fptu_array_items(payload);
     for (unsigned i = 0; i < payload->other.varlen.array_length; ++i) {
       if (i)
         result += ",";
@@ -331,7 +331,7 @@ __cold string to_string(const fptu_field &field) {
                      "cstr", payload->other.varlen.array_length,
                      units2bytes(payload->other.varlen.brutto));
 
-    const char *array = (const char *)&payload->other.data[1];
+    const char *array = (const char *)fptu_array_items(payload);
     for (unsigned i = 0; i < payload->other.varlen.array_length; ++i) {
       result += fptu::format(&",%s"[i == 0], array);
       array += strlen(array) + 1;
@@ -345,7 +345,7 @@ __cold string to_string(const fptu_field &field) {
                      "opaque", payload->other.varlen.array_length,
                      units2bytes(payload->other.varlen.brutto));
 
-    const fptu_unit *array = (const fptu_unit *)&payload->other.data[1];
+    const fptu_unit *array = (const fptu_unit *)fptu_array_items(payload);
     for (unsigned i = 0; i < payload->other.varlen.array_length; ++i) {
       if (i)
         result += ",";
@@ -361,7 +361,7 @@ __cold string to_string(const fptu_field &field) {
                      "nested", payload->other.varlen.array_length,
                      units2bytes(payload->other.varlen.brutto));
 
-    const fptu_unit *array = (const fptu_unit *)&payload->other.data[1];
+    const fptu_unit *array = (const fptu_unit *)fptu_array_items(payload);
     for (unsigned i = 0; i < payload->other.varlen.array_length; ++i) {
       fptu_ro nested;
       nested.total_bytes = units2bytes(array->varlen.brutto + (size_t)1);
@@ -0,0 +1,934 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fast_positive/tuples_internal.h"
+
+namespace {
+
+enum json_limits {
+  /* глубина вложенности объектов */
+  json_depth_max = 64,
+  /* длина числа, для которого используется strtod() */
+  json_number_max = 128,
+  /* признак вывода типа поля по значению */
+  json_infer = -1,
+  /* признак пропуска поля */
+  json_skip = -2
+};
+
+struct json_parser {
+  const char *ptr;
+  const char *const end;
+  fptu_name2tag_func *const name2tag;
+  fptu_nested_func *const nested;
+  const void *schema_ctx;
+  const unsigned options;
+  unsigned depth;
+
+  json_parser(const char *json, size_t length, fptu_name2tag_func *name2tag,
+              fptu_nested_func *nested, const void *schema_ctx,
+              unsigned options)
+      : ptr(json), end(json + length), name2tag(name2tag), nested(nested),
+        schema_ctx(schema_ctx), options(options), depth(0) {}
+
+  void skip_ws() {
+    while (ptr < end &&
+           (*ptr == ' ' || *ptr == '\n' || *ptr == '\r' || *ptr == '\t'))
+      ++ptr;
+  }
+
+  /* Пропускает пробелы и ожидаемый символ. */
+  bool expect(char c) {
+    skip_ws();
+    if (unlikely(ptr == end || *ptr != c))
+      return false;
+    ++ptr;
+    return true;
+  }
+
+  bool literal(const char *text, size_t length) {
+    if (unlikely((size_t)(end - ptr) < length || memcmp(ptr, text, length)))
+      return false;
+    ptr += length;
+    return true;
+  }
+};
+
+/* Верхняя оценка размера кортежа для fptu_space(). */
+struct json_estimate {
+  size_t items;
+  size_t data_bytes;
+  size_t name_max; /* для декодирования имен с escape-последовательностями */
+};
+
+//----------------------------------------------------------------------------
+
+/* Ищет конец строки, т.е. первую кавычку, обратную косую черту, либо
+ * управляющий символ. Проверяется сразу по 8 байт без ветвлений внутри
+ * слова, что компиляторы хорошо векторизуют. */
+static const char *json_scan_plain(const char *ptr, const char *end) {
+  const uint64_t ones = UINT64_C(0x0101010101010101);
+  const uint64_t high = UINT64_C(0x8080808080808080);
+  while (end - ptr >= 8) {
+    uint64_t word;
+    memcpy(&word, ptr, 8);
+    const uint64_t quote = word ^ (ones * '"');
+    const uint64_t slash = word ^ (ones * '\\');
+    const uint64_t special = ((quote - ones) & ~quote) |
+                             ((slash - ones) & ~slash) |
+                             ((word - ones * 0x20) & ~word);
+    if (special & high)
+      break;
+    ptr += 8;
+  }
+  while (ptr < end && *ptr != '"' && *ptr != '\\' && (uint8_t)*ptr >= 0x20)
+    ++ptr;
+  return ptr;
+}
+
+/* Пропускает строку, начиная за открывающей кавычкой. Возвращает указатель
+ * на закрывающую кавычку либо nullptr, а также наличие escape-символов. */
+static const char *json_scan_string(const char *ptr, const char *end,
+                                    bool &escaped) {
+  escaped = false;
+  for (;;) {
+    ptr = json_scan_plain(ptr, end);
+    if (unlikely(ptr == end || (uint8_t)*ptr < 0x20))
+      return nullptr;
+    if (*ptr == '"')
+      return ptr;
+    /* содержимое escape-последовательностей проверяется при декодировании */
+    escaped = true;
+    ptr += 2;
+    if (unlikely(ptr > end))
+      return nullptr;
+  }
+}
+
+static int json_hexdigit(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  c |= 0x20;
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+static bool json_hex4(const char *ptr, const char *end, unsigned &code) {
+  if (unlikely(end - ptr < 4))
+    return false;
+  code = 0;
+  for (unsigned i = 0; i < 4; ++i) {
+    const int digit = json_hexdigit(ptr[i]);
+    if (unlikely(digit < 0))
+      return false;
+    code = (code << 4) + (unsigned)digit;
+  }
+  return true;
+}
+
+/* Декодирует содержимое строки с escape-последовательностями в UTF-8.
+ * Результат не длиннее исходной строки. Возвращает конец результата, либо
+ * nullptr при ошибке, в том числе для символа с кодом 0. */
+static char *json_unescape(const char *ptr, const char *end, char *out) {
+  while (ptr < end) {
+    if (*ptr != '\\') {
+      *out++ = *ptr++;
+      continue;
+    }
+    if (unlikely(++ptr == end))
+      return nullptr;
+    unsigned code;
+    switch (*ptr++) {
+    case '"':
+      *out++ = '"';
+      continue;
+    case '\\':
+      *out++ = '\\';
+      continue;
+    case '/':
+      *out++ = '/';
+      continue;
+    case 'b':
+      *out++ = '\b';
+      continue;
+    case 'f':
+      *out++ = '\f';
+      continue;
+    case 'n':
+      *out++ = '\n';
+      continue;
+    case 'r':
+      *out++ = '\r';
+      continue;
+    case 't':
+      *out++ = '\t';
+      continue;
+    case 'u':
+      if (unlikely(!json_hex4(ptr, end, code) || code == 0))
+        return nullptr;
+      ptr += 4;
+      break;
+    default:
+      return nullptr;
+    }
+
+    if (code >= 0xD800 && code <= 0xDFFF) {
+      /* суррогатная пара */
+      unsigned low;
+      if (unlikely(code > 0xDBFF || end - ptr < 6 || ptr[0] != '\\' ||
+                   ptr[1] != 'u' || !json_hex4(ptr + 2, end, low) ||
+                   low < 0xDC00 || low > 0xDFFF))
+        return nullptr;
+      ptr += 6;
+      code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+    }
+
+    if (code < 0x80)
+      *out++ = (char)code;
+    else if (code < 0x800) {
+      *out++ = (char)(0xC0 | (code >> 6));
+      *out++ = (char)(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+      *out++ = (char)(0xE0 | (code >> 12));
+      *out++ = (char)(0x80 | ((code >> 6) & 0x3F));
+      *out++ = (char)(0x80 | (code & 0x3F));
+    } else {
+      *out++ = (char)(0xF0 | (code >> 18));
+      *out++ = (char)(0x80 | ((code >> 12) & 0x3F));
+      *out++ = (char)(0x80 | ((code >> 6) & 0x3F));
+      *out++ = (char)(0x80 | (code & 0x3F));
+    }
+  }
+  return out;
+}
+
+static bool json_unhex(const char *ptr, size_t length, uint8_t *out) {
+  for (size_t i = 0; i < length; i += 2) {
+    const int hi = json_hexdigit(ptr[i]), lo = json_hexdigit(ptr[i + 1]);
+    if (unlikely((hi | lo) < 0))
+      return false;
+    *out++ = (uint8_t)(hi << 4 | lo);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+
+struct json_number {
+  const char *begin, *end;
+  uint64_t mantissa; /* не более 19 значащих цифр */
+  int exponent;      /* десятичный порядок для mantissa */
+  unsigned digits;
+  bool negative;
+  bool integer;   /* без дробной части и порядка */
+  bool truncated; /* отброшены ненулевые значащие цифры */
+};
+
+static __inline bool json_isdigit(char c) { return c >= '0' && c <= '9'; }
+
+static bool json_scan_number(const char *&ptr, const char *end,
+                             json_number &n) {
+  const char *p = ptr;
+  n.begin = p;
+  n.mantissa = 0;
+  n.exponent = 0;
+  n.digits = 0;
+  n.negative = false;
+  n.integer = true;
+  n.truncated = false;
+
+  if (p < end && *p == '-') {
+    n.negative = true;
+    ++p;
+  }
+  if (unlikely(p == end || !json_isdigit(*p)))
+    return false;
+
+  /* ведущие нули запрещены */
+  if (unlikely(*p == '0' && p + 1 < end && json_isdigit(p[1])))
+    return false;
+
+  bool fraction = false;
+  for (;;) {
+    const unsigned digit = (unsigned)(*p - '0');
+    if (n.digits < 19) {
+      n.mantissa = n.mantissa * 10 + digit;
+      n.digits += n.mantissa != 0;
+      n.exponent -= fraction;
+    } else {
+      n.exponent += !fraction;
+      n.truncated |= digit != 0;
+    }
+    if (++p == end)
+      break;
+    if (json_isdigit(*p))
+      continue;
+    if (*p != '.' || fraction)
+      break;
+    if (unlikely(++p == end || !json_isdigit(*p)))
+      return false;
+    fraction = true;
+    n.integer = false;
+  }
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    n.integer = false;
+    if (++p < end && (*p == '+' || *p == '-'))
+      ++p;
+    const bool negative = p[-1] == '-';
+    if (unlikely(p == end || !json_isdigit(*p)))
+      return false;
+    int exponent = 0;
+    do {
+      /* порядок больше 1e5 в любом случае дает ноль либо бесконечность */
+      if (exponent < 100000)
+        exponent = exponent * 10 + (*p - '0');
+    } while (++p < end && json_isdigit(*p));
+    n.exponent += negative ? -exponent : exponent;
+  }
+
+  ptr = n.end = p;
+  return true;
+}
+
+/* Целое значение числа без дробной части, с проверкой переполнения. */
+static bool json_integer(const json_number &n, uint64_t &value) {
+  if (unlikely(!n.integer))
+    return false;
+  value = 0;
+  for (const char *p = n.begin + n.negative; p < n.end; ++p) {
+    const unsigned digit = (unsigned)(*p - '0');
+    if (unlikely(value > (UINT64_MAX - digit) / 10))
+      return false;
+    value = value * 10 + digit;
+  }
+  return true;
+}
+
+static bool json_signed(const json_number &n, int64_t min, int64_t max,
+                        int64_t &value) {
+  uint64_t magnitude;
+  if (unlikely(!json_integer(n, magnitude)))
+    return false;
+  if (n.negative) {
+    if (unlikely(magnitude > (uint64_t)-(min + 1) + 1))
+      return false;
+    value = (int64_t)(0 - magnitude);
+  } else {
+    if (unlikely(magnitude > (uint64_t)max))
+      return false;
+    value = (int64_t)magnitude;
+  }
+  return true;
+}
+
+static bool json_unsigned(const json_number &n, uint64_t max,
+                          uint64_t &value) {
+  return json_integer(n, value) && (!n.negative || value == 0) && value <= max;
+}
+
+/* Число вне диапазона быстрого пути разбирается посредством strtod(),
+ * что требует локали с точкой в качестве десятичного разделителя. */
+static bool json_strtod(const json_number &n, double *fp64, float *fp32) {
+  const size_t length = (size_t)(n.end - n.begin);
+  if (unlikely(length >= json_number_max))
+    return false;
+  char buffer[json_number_max];
+  memcpy(buffer, n.begin, length);
+  buffer[length] = '\0';
+  if (fp64)
+    *fp64 = strtod(buffer, nullptr);
+  else
+    *fp32 = strtof(buffer, nullptr);
+  return true;
+}
+
+/* Мантисса и степень десяти представимы точно, поэтому результат
+ * единственной операции округляется корректно (Clinger). */
+static bool json_fp64(const json_number &n, double &value) {
+  static const double pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                 1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                 1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                 1e18, 1e19, 1e20, 1e21, 1e22};
+  if (likely(!n.truncated && n.mantissa <= UINT64_C(1) << 53 &&
+             n.exponent >= -22 && n.exponent <= 22)) {
+    value = (double)n.mantissa;
+    value = (n.exponent < 0) ? value / pow10[-n.exponent]
+                             : value * pow10[n.exponent];
+    if (n.negative)
+      value = -value;
+    return true;
+  }
+  return json_strtod(n, &value, nullptr);
+}
+
+static bool json_fp32(const json_number &n, float &value) {
+  static const float pow10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+                                1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+  if (likely(!n.truncated && n.mantissa <= UINT32_C(1) << 24 &&
+             n.exponent >= -10 && n.exponent <= 10)) {
+    value = (float)n.mantissa;
+    value = (n.exponent < 0) ? value / pow10[-n.exponent]
+                             : value * pow10[n.exponent];
+    if (n.negative)
+      value = -value;
+    return true;
+  }
+  return json_strtod(n, nullptr, &value);
+}
+
+static bool json_digits(const char *ptr, unsigned count, unsigned &value) {
+  value = 0;
+  for (unsigned i = 0; i < count; ++i) {
+    if (unlikely(!json_isdigit(ptr[i])))
+      return false;
+    value = value * 10 + (unsigned)(ptr[i] - '0');
+  }
+  return true;
+}
+
+/* Время в формате ISO-8601 в UTC, т.е. "2017-03-20T12:34:56.123456789Z",
+ * с необязательной дробной частью секунд. */
+static bool json_datetime(const char *ptr, const char *end, fptu_time &time) {
+  unsigned year, month, day, hour, minute, second;
+  if (unlikely(end - ptr < 20 || !json_digits(ptr, 4, year) ||
+               ptr[4] != '-' || !json_digits(ptr + 5, 2, month) ||
+               ptr[7] != '-' || !json_digits(ptr + 8, 2, day) ||
+               ptr[10] != 'T' || !json_digits(ptr + 11, 2, hour) ||
+               ptr[13] != ':' || !json_digits(ptr + 14, 2, minute) ||
+               ptr[16] != ':' || !json_digits(ptr + 17, 2, second)))
+    return false;
+  ptr += 19;
+
+  unsigned ns = 0, scale = 1000000000;
+  if (*ptr == '.') {
+    while (++ptr < end && json_isdigit(*ptr))
+      if (scale > 1) {
+        scale /= 10;
+        ns += (unsigned)(*ptr - '0') * scale;
+      }
+    if (unlikely(scale == 1000000000))
+      return false;
+  }
+  if (unlikely(ptr + 1 != end || *ptr != 'Z'))
+    return false;
+
+  static const uint8_t month_days[12] = {31, 29, 31, 30, 31, 30,
+                                         31, 31, 30, 31, 30, 31};
+  const bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+  if (unlikely(year < 1970 || month < 1 || month > 12 || day < 1 ||
+               day > month_days[month - 1] ||
+               (month == 2 && day == 29 && !leap) || hour > 23 ||
+               minute > 59 || second > 59))
+    return false;
+
+  /* количество дней от 1970-01-01, см. Howard Hinnant,
+   * "chrono-Compatible Low-Level Date Algorithms" */
+  const unsigned y = year - (month <= 2);
+  const unsigned era = y / 400;
+  const unsigned yoe = y - era * 400;
+  const unsigned mp = (month > 2) ? month - 3 : month + 9;
+  const unsigned doy = (153 * mp + 2) / 5 + day - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  const uint64_t seconds =
+      (uint64_t)(era * 146097 + doe - 719468) * 86400 + hour * 3600 +
+      minute * 60 + second;
+  if (unlikely(seconds > UINT32_MAX))
+    return false;
+
+  /* с округлением вверх, чтобы при выводе получить те же наносекунды */
+  const uint64_t fractional =
+      (((uint64_t)ns << 32) + UINT32_C(999999999)) / UINT32_C(1000000000);
+  time.fixedpoint = seconds << 32 | fractional;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+
+static int json_measure_object(json_parser &p, json_estimate &estimate);
+
+/* Пропускает значение, накапливая оценку размера полей. */
+static int json_measure_value(json_parser &p, json_estimate &estimate,
+                              bool in_array) {
+  p.skip_ws();
+  if (unlikely(p.ptr == p.end))
+    return FPTU_EINVAL;
+
+  switch (*p.ptr) {
+  case '{': {
+    json_estimate nested = {0, 0, 0};
+    const int rc = json_measure_object(p, nested);
+    if (unlikely(rc != FPTU_OK))
+      return rc;
+    /* вложенный кортеж формируется на месте, но с заголовком fptu_rw */
+    estimate.items += 1;
+    estimate.data_bytes +=
+        sizeof(fptu_rw) + units2bytes(nested.items) + nested.data_bytes;
+    return FPTU_OK;
+  }
+  case '[':
+    if (unlikely(in_array))
+      return FPTU_EINVAL;
+    ++p.ptr;
+    p.skip_ws();
+    if (p.ptr < p.end && *p.ptr == ']') {
+      ++p.ptr;
+      return FPTU_OK;
+    }
+    for (;;) {
+      const int rc = json_measure_value(p, estimate, true);
+      if (unlikely(rc != FPTU_OK))
+        return rc;
+      p.skip_ws();
+      if (unlikely(p.ptr == p.end))
+        return FPTU_EINVAL;
+      const char c = *p.ptr++;
+      if (c == ']')
+        return FPTU_OK;
+      if (unlikely(c != ','))
+        return FPTU_EINVAL;
+    }
+  case '"': {
+    bool escaped;
+    const char *const close = json_scan_string(p.ptr + 1, p.end, escaped);
+    if (unlikely(!close))
+      return FPTU_EINVAL;
+    /* строка, либо opaque в шестнадцатеричном виде с заголовком */
+    estimate.items += 1;
+    estimate.data_bytes +=
+        units2bytes(bytes2units((size_t)(close - p.ptr)) + 1);
+    p.ptr = close + 1;
+    return FPTU_OK;
+  }
+  case 't':
+    if (unlikely(!p.literal("true", 4)))
+      return FPTU_EINVAL;
+    break;
+  case 'f':
+    if (unlikely(!p.literal("false", 5)))
+      return FPTU_EINVAL;
+    break;
+  case 'n':
+    if (unlikely(!p.literal("null", 4)))
+      return FPTU_EINVAL;
+    break;
+  default:
+    json_number n;
+    if (unlikely(!json_scan_number(p.ptr, p.end, n)))
+      return FPTU_EINVAL;
+    break;
+  }
+  estimate.items += 1;
+  estimate.data_bytes += 8;
+  return FPTU_OK;
+}
+
+static int json_measure_object(json_parser &p, json_estimate &estimate) {
+  if (unlikely(!p.expect('{') || ++p.depth > json_depth_max))
+    return FPTU_EINVAL;
+  if (p.expect('}')) {
+    --p.depth;
+    return FPTU_OK;
+  }
+
+  for (;;) {
+    bool escaped;
+    const char *const close =
+        p.expect('"') ? json_scan_string(p.ptr, p.end, escaped) : nullptr;
+    if (unlikely(!close))
+      return FPTU_EINVAL;
+    if (escaped && estimate.name_max < (size_t)(close - p.ptr))
+      estimate.name_max = (size_t)(close - p.ptr);
+    p.ptr = close + 1;
+    if (unlikely(!p.expect(':')))
+      return FPTU_EINVAL;
+    const int rc = json_measure_value(p, estimate, false);
+    if (unlikely(rc != FPTU_OK))
+      return rc;
+    if (p.expect('}'))
+      break;
+    if (unlikely(!p.expect(',')))
+      return FPTU_EINVAL;
+  }
+
+  estimate.data_bytes += units2bytes(bytes2units(estimate.name_max));
+  estimate.name_max = 0;
+  --p.depth;
+  return FPTU_OK;
+}
+
+//----------------------------------------------------------------------------
+
+static __inline size_t json_tail_space(const fptu_rw *pt) {
+  return units2bytes(pt->end - pt->tail);
+}
+
+static int json_append_tail(fptu_rw *pt, unsigned col, fptu_type type,
+                            size_t units) {
+  return likely(fptu_append_tail(pt, fptu_pack_coltype(col, type), units))
+             ? FPTU_OK
+             : FPTU_ENOSPACE;
+}
+
+static int json_object(json_parser &p, fptu_rw *pt);
+
+/* Вложенный кортеж формируется непосредственно в свободном месте за
+ * хвостом, а затем сдвигается на место данных поля. */
+static int json_nested(json_parser &p, fptu_rw *pt, unsigned col) {
+  json_parser measure(p);
+  json_estimate estimate = {0, 0, 0};
+  int rc = json_measure_object(measure, estimate);
+  if (unlikely(rc != FPTU_OK))
+    return rc;
+  if (unlikely(estimate.items > fptu_max_fields))
+    return FPTU_EINVAL;
+
+  void *const space = &pt->units[pt->tail];
+  fptu_rw *nested = fptu_init(space, json_tail_space(pt), estimate.items);
+  if (unlikely(nested == nullptr))
+    return FPTU_ENOSPACE;
+  const void *const schema_ctx = p.schema_ctx;
+  if (p.nested)
+    p.schema_ctx = p.nested(schema_ctx, fptu_pack_coltype(col, fptu_nested));
+  rc = json_object(p, nested);
+  p.schema_ctx = schema_ctx;
+  if (unlikely(rc != FPTU_OK))
+    return rc;
+
+  const fptu_ro ro = fptu_take_noshrink(nested);
+  if (unlikely(ro.total_bytes > fptu_max_opaque_bytes))
+    return FPTU_EINVAL;
+  memmove(space, ro.units, ro.total_bytes);
+  return json_append_tail(pt, col, fptu_nested, bytes2units(ro.total_bytes));
+}
+
+static int json_string(json_parser &p, fptu_rw *pt, unsigned col, int type) {
+  bool escaped;
+  const char *const begin = p.ptr + 1;
+  const char *const close = json_scan_string(begin, p.end, escaped);
+  if (unlikely(!close))
+    return FPTU_EINVAL;
+  p.ptr = close + 1;
+  size_t length = (size_t)(close - begin);
+
+  switch (type) {
+  case json_infer:
+  case fptu_cstr:
+    if (likely(!escaped))
+      return fptu_insert_string(pt, col, begin, length);
+    else {
+      if (unlikely(json_tail_space(pt) <= length))
+        return FPTU_ENOSPACE;
+      char *const out = (char *)&pt->units[pt->tail];
+      char *const out_end = json_unescape(begin, close, out);
+      if (unlikely(!out_end))
+        return FPTU_EINVAL;
+      length = (size_t)(out_end - out);
+      if (unlikely(length >= fptu_max_field_bytes))
+        return FPTU_EINVAL;
+      const size_t units = bytes2units(length + 1);
+      memset(out_end, 0, units2bytes(units) - length);
+      return json_append_tail(pt, col, fptu_cstr, units);
+    }
+
+  case fptu_datetime: {
+    fptu_time time;
+    if (unlikely(escaped || !json_datetime(begin, close, time)))
+      return FPTU_EINVAL;
+    return fptu_insert_datetime(pt, col, time);
+  }
+
+  case fptu_96:
+  case fptu_128:
+  case fptu_160:
+  case fptu_256: {
+    uint8_t data[32];
+    const size_t bytes = fptu_internal_map_t2b[type];
+    assert(bytes <= sizeof(data));
+    if (unlikely(escaped || length != bytes * 2 ||
+                 !json_unhex(begin, length, data)))
+      return FPTU_EINVAL;
+    switch (type) {
+    case fptu_96:
+      return fptu_insert_96(pt, col, data);
+    case fptu_128:
+      return fptu_insert_128(pt, col, data);
+    case fptu_160:
+      return fptu_insert_160(pt, col, data);
+    default:
+      return fptu_insert_256(pt, col, data);
+    }
+  }
+
+  case fptu_opaque: {
+    const size_t bytes = length / 2;
+    if (unlikely(escaped || length % 2 || bytes > fptu_max_opaque_bytes))
+      return FPTU_EINVAL;
+    const size_t units = bytes2units(bytes) + 1;
+    if (unlikely(json_tail_space(pt) < units2bytes(units)))
+      return FPTU_ENOSPACE;
+    fptu_payload *payload = (fptu_payload *)&pt->units[pt->tail];
+    payload->other.varlen.brutto = (uint16_t)(units - 1);
+    payload->other.varlen.opaque_bytes = (uint16_t)bytes;
+    ((uint32_t *)payload)[units - 1] = 0;
+    if (unlikely(!json_unhex(begin, length, (uint8_t *)payload->other.data)))
+      return FPTU_EINVAL;
+    return json_append_tail(pt, col, fptu_opaque, units);
+  }
+
+  default:
+    return FPTU_EINVAL;
+  }
+}
+
+static int json_number_field(json_parser &p, fptu_rw *pt, unsigned col,
+                             int type) {
+  json_number n;
+  if (unlikely(!json_scan_number(p.ptr, p.end, n)))
+    return FPTU_EINVAL;
+
+  int64_t i64;
+  uint64_t u64;
+  double fp64;
+  float fp32;
+  switch (type) {
+  case json_infer:
+    if (json_signed(n, INT64_MIN, INT64_MAX, i64))
+      return fptu_insert_int64(pt, col, i64);
+    if (json_unsigned(n, UINT64_MAX, u64))
+      return fptu_insert_uint64(pt, col, u64);
+    __fallthrough;
+  case fptu_fp64:
+    return json_fp64(n, fp64) ? fptu_insert_fp64(pt, col, fp64)
+                              : FPTU_EINVAL;
+  case fptu_fp32:
+    return json_fp32(n, fp32) ? fptu_insert_fp32(pt, col, fp32)
+                              : FPTU_EINVAL;
+  case fptu_uint16:
+    return json_unsigned(n, UINT16_MAX, u64)
+               ? fptu_insert_uint16(pt, col, (uint_fast16_t)u64)
+               : FPTU_EINVAL;
+  case fptu_int32:
+    return json_signed(n, INT32_MIN, INT32_MAX, i64)
+               ? fptu_insert_int32(pt, col, (int_fast32_t)i64)
+               : FPTU_EINVAL;
+  case fptu_uint32:
+    return json_unsigned(n, UINT32_MAX, u64)
+               ? fptu_insert_uint32(pt, col, (uint_fast32_t)u64)
+               : FPTU_EINVAL;
+  case fptu_int64:
+    return json_signed(n, INT64_MIN, INT64_MAX, i64)
+               ? fptu_insert_int64(pt, col, i64)
+               : FPTU_EINVAL;
+  case fptu_uint64:
+    return json_unsigned(n, UINT64_MAX, u64)
+               ? fptu_insert_uint64(pt, col, u64)
+               : FPTU_EINVAL;
+  default:
+    return FPTU_EINVAL;
+  }
+}
+
+/* Добавляет поле по значению, либо коллекцию полей по массиву. */
+static int json_field(json_parser &p, fptu_rw *pt, unsigned col, int type,
+                      bool in_array) {
+  p.skip_ws();
+  if (unlikely(p.ptr == p.end))
+    return FPTU_EINVAL;
+
+  switch (*p.ptr) {
+  case '{':
+    if (unlikely(type != json_infer && type != fptu_nested))
+      return FPTU_EINVAL;
+    return json_nested(p, pt, col);
+
+  case '[':
+    if (unlikely(in_array))
+      return FPTU_EINVAL;
+    ++p.ptr;
+    if (p.expect(']'))
+      return FPTU_OK;
+    for (;;) {
+      const int rc = json_field(p, pt, col, type, true);
+      if (unlikely(rc != FPTU_OK))
+        return rc;
+      if (p.expect(']'))
+        return FPTU_OK;
+      if (unlikely(!p.expect(',')))
+        return FPTU_EINVAL;
+    }
+
+  case '"':
+    return json_string(p, pt, col, type);
+
+  case 't':
+  case 'f': {
+    /* логические значения как uint16 */
+    const bool value = *p.ptr == 't';
+    if (unlikely(value ? !p.literal("true", 4) : !p.literal("false", 5)))
+      return FPTU_EINVAL;
+    if (unlikely(type != json_infer && type != fptu_uint16))
+      return FPTU_EINVAL;
+    return fptu_insert_uint16(pt, col, value);
+  }
+
+  case 'n':
+    if (unlikely(!p.literal("null", 4)))
+      return FPTU_EINVAL;
+    switch (type) {
+    case json_infer:
+    case fptu_null:
+      return json_append_tail(pt, col, fptu_null, 0);
+    /* NaN и бесконечности выводятся как null */
+    case fptu_fp64:
+      return fptu_insert_fp64(pt, col,
+                              std::numeric_limits<double>::quiet_NaN());
+    case fptu_fp32:
+      return fptu_insert_fp32(pt, col,
+                              std::numeric_limits<float>::quiet_NaN());
+    default:
+      return FPTU_EINVAL;
+    }
+
+  default:
+    return json_number_field(p, pt, col, type);
+  }
+}
+
+/* Определяет тег по имени, либо возвращает json_skip для пропуска поля.
+ * Имена из чисел без схемы являются номерами колонок. */
+static int json_resolve(const json_parser &p, const char *name, size_t length,
+                        unsigned &col, int &type) {
+  if (p.name2tag) {
+    const int tag = p.name2tag(p.schema_ctx, name, length);
+    if (tag >= 0) {
+      col = fptu_get_colnum((uint_fast16_t)tag);
+      type = fptu_get_type((uint_fast16_t)tag);
+      return FPTU_OK;
+    }
+  }
+  if (p.options & fptu_json_skip_unknown) {
+    type = json_skip;
+    return FPTU_OK;
+  }
+
+  if (unlikely(length < 1 || length > 4 || (name[0] == '0' && length > 1)))
+    return FPTU_ENOFIELD;
+  col = 0;
+  for (size_t i = 0; i < length; ++i) {
+    if (unlikely(!json_isdigit(name[i])))
+      return FPTU_ENOFIELD;
+    col = col * 10 + (unsigned)(name[i] - '0');
+  }
+  if (unlikely(col > fptu_max_cols))
+    return FPTU_ENOFIELD;
+  type = json_infer;
+  return FPTU_OK;
+}
+
+static int json_object(json_parser &p, fptu_rw *pt) {
+  if (unlikely(!p.expect('{') || ++p.depth > json_depth_max))
+    return FPTU_EINVAL;
+  if (p.expect('}')) {
+    --p.depth;
+    return FPTU_OK;
+  }
+
+  for (;;) {
+    bool escaped;
+    const char *const name = p.expect('"') ? p.ptr : nullptr;
+    const char *const close =
+        name ? json_scan_string(name, p.end, escaped) : nullptr;
+    if (unlikely(!close))
+      return FPTU_EINVAL;
+    p.ptr = close + 1;
+    if (unlikely(!p.expect(':')))
+      return FPTU_EINVAL;
+
+    unsigned col = 0;
+    int type, rc;
+    if (likely(!escaped))
+      rc = json_resolve(p, name, (size_t)(close - name), col, type);
+    else {
+      /* имя декодируется в свободное место за хвостом */
+      if (unlikely(json_tail_space(pt) < (size_t)(close - name)))
+        return FPTU_ENOSPACE;
+      char *const out = (char *)&pt->units[pt->tail];
+      const char *const out_end = json_unescape(name, close, out);
+      if (unlikely(!out_end))
+        return FPTU_EINVAL;
+      rc = json_resolve(p, out, (size_t)(out_end - out), col, type);
+    }
+    if (unlikely(rc != FPTU_OK))
+      return rc;
+
+    if (type == json_skip) {
+      json_estimate unused = {0, 0, 0};
+      rc = json_measure_value(p, unused, false);
+    } else
+      rc = json_field(p, pt, col, type, false);
+    if (unlikely(rc != FPTU_OK))
+      return rc;
+
+    if (p.expect('}'))
+      break;
+    if (unlikely(!p.expect(',')))
+      return FPTU_EINVAL;
+  }
+
+  --p.depth;
+  return FPTU_OK;
+}
+
+} /* anonymous namespace */
+
+//----------------------------------------------------------------------------
+
+int fptu_json_estimate(const char *json, size_t length, size_t *items,
+                       size_t *data_bytes) {
+  if (unlikely(json == nullptr || items == nullptr || data_bytes == nullptr))
+    return FPTU_EINVAL;
+
+  json_parser p(json, length, nullptr, nullptr, nullptr, fptu_json_default);
+  json_estimate estimate = {0, 0, 0};
+  int rc = json_measure_object(p, estimate);
+  if (likely(rc == FPTU_OK)) {
+    p.skip_ws();
+    if (unlikely(p.ptr != p.end))
+      rc = FPTU_EINVAL;
+  }
+  *items = estimate.items;
+  *data_bytes = estimate.data_bytes;
+  return rc;
+}
+
+int fptu_json2tuple(fptu_rw *pt, const char *json, size_t length,
+                    fptu_name2tag_func *name2tag, fptu_nested_func *nested,
+                    const void *schema_ctx, unsigned options) {
+  if (unlikely(pt == nullptr || json == nullptr))
+    return FPTU_EINVAL;
+
+  json_parser p(json, length, name2tag, nested, schema_ctx, options);
+  const int rc = json_object(p, pt);
+  if (unlikely(rc != FPTU_OK))
+    return rc;
+  p.skip_ws();
+  return likely(p.ptr == p.end) ? FPTU_OK : FPTU_EINVAL;
+}
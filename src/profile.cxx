@@ -0,0 +1,217 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fast_positive/tuples_internal.h"
+
+#include <algorithm>
+
+unsigned fptu_profile_bucket(size_t n) {
+  unsigned bucket = 0;
+  while (n && bucket < fptu_profile_buckets - 1) {
+    n >>= 1;
+    bucket += 1;
+  }
+  return bucket;
+}
+
+size_t fptu_profile_space(size_t tags_limit) {
+  if (tags_limit < 1)
+    tags_limit = 1;
+  return sizeof(fptu_profile) + (tags_limit - 1) * sizeof(fptu_profile_tag);
+}
+
+fptu_profile *fptu_profile_init(void *space, size_t buffer_bytes,
+                                size_t tags_limit) {
+  if (unlikely(space == nullptr || tags_limit < 1 ||
+               buffer_bytes < fptu_profile_space(tags_limit)))
+    return nullptr;
+
+  fptu_profile *profile = (fptu_profile *)space;
+  memset(profile, 0, fptu_profile_space(tags_limit));
+  profile->tags_limit = tags_limit;
+  return profile;
+}
+
+fptu_profile *fptu_profile_alloc(size_t tags_limit) {
+  if (unlikely(tags_limit < 1))
+    return nullptr;
+
+  size_t size = fptu_profile_space(tags_limit);
+  void *buffer = malloc(size);
+  if (unlikely(!buffer))
+    return nullptr;
+
+  fptu_profile *profile = fptu_profile_init(buffer, size, tags_limit);
+  assert(profile != nullptr);
+
+  return profile;
+}
+
+//----------------------------------------------------------------------------
+
+/* Слоты тегов образуют хэш-таблицу с открытой адресацией, в которой
+ * свободные слоты имеют нулевой счетчик полей. */
+static __inline size_t fptu_profile_slot(const fptu_profile *profile,
+                                         uint_fast16_t tag) {
+  return (size_t)(tag * UINT32_C(2654435761)) % profile->tags_limit;
+}
+
+static fptu_profile_tag *fptu_profile_find(const fptu_profile *profile,
+                                           uint_fast16_t tag, bool *found) {
+  fptu_profile_tag *const tags = (fptu_profile_tag *)profile->tags;
+  size_t slot = fptu_profile_slot(profile, tag);
+  for (size_t n = profile->tags_limit; n > 0; --n) {
+    if (tags[slot].fields == 0 || tags[slot].tag == tag) {
+      *found = tags[slot].fields != 0;
+      return &tags[slot];
+    }
+    if (++slot == profile->tags_limit)
+      slot = 0;
+  }
+  *found = false;
+  return nullptr;
+}
+
+const fptu_profile_tag *fptu_profile_lookup(const fptu_profile *profile,
+                                            uint_fast16_t tag) {
+  bool found;
+  const fptu_profile_tag *entry = fptu_profile_find(profile, tag, &found);
+  return found ? entry : nullptr;
+}
+
+namespace {
+/* Состояние учета одного кортежа. */
+struct fptu_profile_sample {
+  const fptu_field *begin;
+  size_t data_units;
+};
+} /* anonymous namespace */
+
+/* Фильтр для fptu_field_count_ro_ex(), учитывающий каждое живое поле. */
+static bool fptu_profile_field(const fptu_field *pf, void *context,
+                               void *param) {
+  fptu_profile *profile = (fptu_profile *)context;
+  fptu_profile_sample *sample = (fptu_profile_sample *)param;
+
+  const size_t units = fptu_field_units(pf);
+  sample->data_units += units;
+  if (!ct_is_fixedsize(pf->ct))
+    profile->varlen_histogram[fptu_profile_bucket(units2bytes(units))] += 1;
+
+  bool found;
+  fptu_profile_tag *entry = fptu_profile_find(profile, pf->ct, &found);
+  if (unlikely(entry == nullptr)) {
+    profile->tags_overflow += 1;
+    return true;
+  }
+  if (!found) {
+    entry->tag = (uint16_t)pf->ct;
+    profile->tags_used += 1;
+  }
+
+  /* повторы тега (коллекции) учитываются в samples однократно */
+  const size_t position = pf - sample->begin;
+  if (entry->last_sample != profile->samples) {
+    entry->last_sample = profile->samples;
+    entry->samples += 1;
+  }
+  entry->fields += 1;
+  entry->first_line += position < fptu_profile_line_items;
+  entry->position += position;
+  return true;
+}
+
+int fptu_profile_add(fptu_profile *profile, fptu_ro ro) {
+  const fptu_field *const begin = fptu_begin_ro(ro);
+  if (unlikely(profile == nullptr || (!begin && ro.total_bytes)))
+    return FPTU_EINVAL;
+
+  profile->samples += 1;
+  profile->total_bytes += ro.total_bytes;
+
+  fptu_profile_sample sample;
+  sample.begin = begin;
+  sample.data_units = 0;
+  const size_t fields =
+      begin ? fptu_field_count_ro_ex(ro, fptu_profile_field, profile, &sample)
+            : 0;
+
+  profile->fields_total += fields;
+  profile->fields_histogram[fptu_profile_bucket(fields)] += 1;
+  if (profile->items_max < fields)
+    profile->items_max = fields;
+  if (profile->data_bytes_max < units2bytes(sample.data_units))
+    profile->data_bytes_max = units2bytes(sample.data_units);
+
+  if (begin) {
+    /* мертвые поля пропускаются итератором, поэтому их объем
+     * вычисляется как остаток от размера кортежа, за вычетом служебного
+     * поля (дескриптор и 8 байт данных), которое также пропускается */
+    const size_t items = fptu_end_ro(ro) - begin;
+    const size_t service_units =
+        fptu_service_field(ro) ? 1 + bytes2units(sizeof(uint64_t)) : 0;
+    const size_t payload_units =
+        ro.units[0].varlen.brutto - items - service_units;
+    profile->junk_items += items - fields;
+    profile->junk_bytes += units2bytes(payload_units - sample.data_units);
+  }
+  return FPTU_OK;
+}
+
+//----------------------------------------------------------------------------
+
+size_t fptu_profile_order(const fptu_profile *profile, uint16_t *tags,
+                          size_t limit) {
+  if (unlikely(profile == nullptr || tags == nullptr))
+    return 0;
+
+  /* количество тегов задается пользователем через tags_limit и может
+   * быть велико, поэтому порядок строится не на стеке */
+  const size_t used = profile->tags_used;
+  const fptu_profile_tag **const order = (const fptu_profile_tag **)malloc(
+      sizeof(const fptu_profile_tag *) * (used + 1));
+  if (unlikely(order == nullptr))
+    return 0;
+
+  const fptu_profile_tag *const slots = profile->tags;
+  size_t count = 0;
+  for (size_t slot = 0; slot < profile->tags_limit; ++slot) {
+    if (slots[slot].fields)
+      order[count++] = &slots[slot];
+  }
+  assert(count == used);
+
+  /* от редких к частым, при равенстве ближе к началу кортежа (т.е. к
+   * концу порядка добавления) оказываются поля с большим количеством
+   * экземпляров, затем с меньшим тегом */
+  std::sort(order, order + count,
+            [](const fptu_profile_tag *a, const fptu_profile_tag *b) {
+              if (a->samples != b->samples)
+                return a->samples < b->samples;
+              if (a->fields != b->fields)
+                return a->fields < b->fields;
+              return a->tag > b->tag;
+            });
+
+  const size_t skip = (count > limit) ? count - limit : 0;
+  for (size_t i = skip; i < count; ++i)
+    tags[i - skip] = order[i]->tag;
+  free(order);
+  return count - skip;
+}
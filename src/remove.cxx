@@ -38,6 +38,7 @@ void fptu_erase_field(fptu_rw *pt, fptu_field *pf) {
   if (pf != &pt->units[pt->head].field || !fptu_is_tailed(pt, pf, units)) {
     // account junk
     pt->junk += (unsigned)units + 1;
+    FPTU_STAT_ADD(junk_units, units + 1);
     return;
   }
 
@@ -0,0 +1,389 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fast_positive/tuples_internal.h"
+
+#include <algorithm>
+
+/* Совершенная хэш-функция строится методом "hash and displace": хэш имени
+ * выбирает корзину, а затравка корзины (подбираемая при создании схемы)
+ * перемешивает хэш в номер слота. Корзины обрабатываются от больших к
+ * меньшим, а слотов вдвое больше чем колонок, поэтому подбор затравки
+ * сходится быстро. */
+struct fptu_schema {
+  size_t count;
+  unsigned buckets_mask, slots_mask;
+  unsigned columns_limit; /* максимальный номер колонки + 1 */
+  uint32_t *lengths;      /* длины имен колонок */
+  uint16_t *seeds;        /* затравки корзин */
+  uint16_t *slots;        /* индексы колонок, либо UINT16_MAX */
+  uint16_t *by_column;    /* первая колонка с данным номером */
+  uint16_t *next;         /* следующая колонка с тем же номером */
+  fptu_schema_column columns[1];
+};
+
+enum fptu_schema_defs { fptu_schema_none = UINT16_MAX };
+
+static uint64_t fptu_schema_hash(const char *name, size_t length) {
+  /* FNV-1a, старшие биты которого плохо перемешаны для коротких имен,
+   * поэтому дополнительно финализатор MurmurHash3 */
+  uint64_t hash = UINT64_C(14695981039346656037);
+  for (size_t i = 0; i < length; ++i)
+    hash = (hash ^ (uint8_t)name[i]) * UINT64_C(1099511628211);
+  hash ^= hash >> 33;
+  hash *= UINT64_C(0xFF51AFD7ED558CCD);
+  hash ^= hash >> 33;
+  hash *= UINT64_C(0xC4CEB9FE1A85EC53);
+  hash ^= hash >> 33;
+  return hash;
+}
+
+static __inline unsigned fptu_schema_slot(uint64_t hash, unsigned seed,
+                                          unsigned mask) {
+  /* финализатор MurmurHash3 */
+  uint32_t x = (uint32_t)hash ^ (seed * UINT32_C(0x9E3779B9));
+  x ^= x >> 16;
+  x *= UINT32_C(0x85EBCA6B);
+  x ^= x >> 13;
+  x *= UINT32_C(0xC2B2AE35);
+  x ^= x >> 16;
+  return x & mask;
+}
+
+static __inline unsigned fptu_schema_bucket(uint64_t hash, unsigned mask) {
+  return (unsigned)(hash >> 32) & mask;
+}
+
+static unsigned fptu_schema_pow2(size_t n) {
+  unsigned pow2 = 1;
+  while (pow2 < n)
+    pow2 <<= 1;
+  return pow2;
+}
+
+struct fptu_schema_layout {
+  unsigned buckets, slots, columns_limit;
+  size_t names_offset, bytes;
+};
+
+static bool fptu_schema_layout_of(const fptu_schema_column *columns,
+                                  size_t count, fptu_schema_layout &layout) {
+  if (unlikely(count < 1 || count >= fptu_schema_none ||
+               columns == nullptr))
+    return false;
+
+  size_t names_bytes = 0;
+  layout.columns_limit = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (unlikely(columns[i].name == nullptr))
+      return false;
+    const size_t length = strlen(columns[i].name);
+    if (unlikely(length > UINT32_MAX))
+      return false;
+    names_bytes += length + 1;
+    const unsigned col = fptu_get_colnum(columns[i].tag);
+    if (unlikely(col > fptu_max_cols || (columns[i].tag & fptu_fr_mask)))
+      return false;
+    if (layout.columns_limit <= col)
+      layout.columns_limit = col + 1;
+  }
+
+  layout.slots = fptu_schema_pow2(count * 2);
+  layout.buckets = fptu_schema_pow2((count + 1) / 2);
+  layout.names_offset =
+      sizeof(fptu_schema) + (count - 1) * sizeof(fptu_schema_column) +
+      sizeof(uint32_t) * count +
+      sizeof(uint16_t) * (layout.buckets + layout.slots +
+                          layout.columns_limit + count);
+  layout.bytes = layout.names_offset + names_bytes;
+  return true;
+}
+
+size_t fptu_schema_space(const fptu_schema_column *columns, size_t count) {
+  fptu_schema_layout layout;
+  return fptu_schema_layout_of(columns, count, layout) ? layout.bytes : 0;
+}
+
+/* Рабочая память для построения схемы: хэши имен и их сортированная
+ * копия, пробы слотов, а также размеры, смещения и порядок корзин и
+ * колонки по корзинам. */
+static size_t fptu_schema_scratch_bytes(size_t count, unsigned buckets) {
+  return sizeof(uint64_t) * count * 2 + sizeof(unsigned) * count +
+         sizeof(uint16_t) * (buckets * 3 + 1 + count);
+}
+
+/* Подбирает затравки корзин, возвращает false если это не удалось. */
+static bool fptu_schema_build(fptu_schema *schema, const uint64_t *hashes,
+                              void *scratch) {
+  const size_t count = schema->count;
+  const unsigned buckets = schema->buckets_mask + 1;
+
+  unsigned *const probe = (unsigned *)scratch;
+  uint16_t *const sizes = (uint16_t *)(probe + count);
+  uint16_t *const offsets = sizes + buckets;
+  uint16_t *const order = offsets + buckets + 1;
+  uint16_t *const items = order + buckets;
+
+  /* раскладка колонок по корзинам подсчетом */
+  memset(sizes, 0, sizeof(uint16_t) * buckets);
+  for (size_t i = 0; i < count; ++i)
+    sizes[fptu_schema_bucket(hashes[i], schema->buckets_mask)] += 1;
+  offsets[0] = 0;
+  for (unsigned b = 0; b < buckets; ++b) {
+    offsets[b + 1] = (uint16_t)(offsets[b] + sizes[b]);
+    order[b] = (uint16_t)b;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    const unsigned b = fptu_schema_bucket(hashes[i], schema->buckets_mask);
+    items[offsets[b + 1] - sizes[b]] = (uint16_t)i;
+    sizes[b] -= 1;
+  }
+  for (unsigned b = 0; b < buckets; ++b)
+    sizes[b] = (uint16_t)(offsets[b + 1] - offsets[b]);
+  std::sort(order, order + buckets, [&sizes](uint16_t a, uint16_t b) {
+    return sizes[a] > sizes[b] || (sizes[a] == sizes[b] && a < b);
+  });
+
+  for (unsigned n = 0; n < buckets && sizes[order[n]]; ++n) {
+    const unsigned b = order[n];
+    const uint16_t *const bucket = items + offsets[b];
+    const unsigned size = sizes[b];
+    unsigned seed = 0;
+    for (;; ++seed) {
+      if (unlikely(seed > UINT16_MAX))
+        return false;
+      unsigned i = 0;
+      for (; i < size; ++i) {
+        probe[i] =
+            fptu_schema_slot(hashes[bucket[i]], seed, schema->slots_mask);
+        if (schema->slots[probe[i]] != fptu_schema_none)
+          break;
+        if (std::find(probe, probe + i, probe[i]) != probe + i)
+          break;
+      }
+      if (i == size)
+        break;
+    }
+    schema->seeds[b] = (uint16_t)seed;
+    for (unsigned i = 0; i < size; ++i)
+      schema->slots[probe[i]] = bucket[i];
+  }
+  return true;
+}
+
+/* Копирует колонки и имена, связывает колонки по номерам и вычисляет
+ * хэши имен. Возвращает false при неверных подсхемах, повторах тегов
+ * или хэшей имен. */
+static bool fptu_schema_fill(fptu_schema *schema,
+                             const fptu_schema_column *columns, char *names,
+                             uint64_t *hashes) {
+  const size_t count = schema->count;
+  for (size_t i = 0; i < count; ++i) {
+    const fptu_schema_column &src = columns[i];
+    if (unlikely(src.nested && fptu_get_type(src.tag) != fptu_nested))
+      return false;
+
+    const unsigned col = fptu_get_colnum(src.tag);
+    for (unsigned j = schema->by_column[col]; j != fptu_schema_none;
+         j = schema->next[j])
+      if (unlikely(schema->columns[j].tag == src.tag))
+        return false;
+    schema->next[i] = schema->by_column[col];
+    schema->by_column[col] = (uint16_t)i;
+
+    const size_t length = strlen(src.name);
+    fptu_schema_column &dst = schema->columns[i];
+    dst = src;
+    dst.name = (const char *)memcpy(names, src.name, length + 1);
+    names += length + 1;
+    schema->lengths[i] = (uint32_t)length;
+    hashes[i] = fptu_schema_hash(dst.name, length);
+  }
+
+  /* одинаковые хэши, в том числе повторы имен, не разделить затравкой */
+  uint64_t *const sorted = hashes + count;
+  std::copy(hashes, hashes + count, sorted);
+  std::sort(sorted, sorted + count);
+  return std::adjacent_find(sorted, sorted + count) == sorted + count;
+}
+
+fptu_schema *fptu_schema_init(void *space, size_t buffer_bytes,
+                              const fptu_schema_column *columns,
+                              size_t count) {
+  fptu_schema_layout layout;
+  if (unlikely(space == nullptr ||
+               !fptu_schema_layout_of(columns, count, layout) ||
+               buffer_bytes < layout.bytes))
+    return nullptr;
+
+  fptu_schema *schema = (fptu_schema *)space;
+  schema->count = count;
+  schema->buckets_mask = layout.buckets - 1;
+  schema->slots_mask = layout.slots - 1;
+  schema->columns_limit = layout.columns_limit;
+  schema->lengths = (uint32_t *)&schema->columns[count];
+  schema->seeds = (uint16_t *)&schema->lengths[count];
+  schema->slots = schema->seeds + layout.buckets;
+  schema->by_column = schema->slots + layout.slots;
+  schema->next = schema->by_column + layout.columns_limit;
+  memset(schema->seeds, 0, sizeof(uint16_t) * layout.buckets);
+  memset(schema->slots, 0xff, sizeof(uint16_t) * layout.slots);
+  memset(schema->by_column, 0xff, sizeof(uint16_t) * layout.columns_limit);
+
+  /* количество колонок задается пользователем и может быть велико,
+   * поэтому рабочие массивы размещаются не на стеке */
+  uint64_t *const hashes =
+      (uint64_t *)malloc(fptu_schema_scratch_bytes(count, layout.buckets));
+  if (unlikely(hashes == nullptr))
+    return nullptr;
+
+  const bool ok =
+      fptu_schema_fill(schema, columns, (char *)space + layout.names_offset,
+                       hashes) &&
+      fptu_schema_build(schema, hashes, hashes + count * 2);
+  free(hashes);
+  return likely(ok) ? schema : nullptr;
+}
+
+fptu_schema *fptu_schema_alloc(const fptu_schema_column *columns,
+                               size_t count) {
+  size_t size = fptu_schema_space(columns, count);
+  if (unlikely(size == 0))
+    return nullptr;
+
+  void *buffer = malloc(size);
+  if (unlikely(!buffer))
+    return nullptr;
+
+  fptu_schema *schema = fptu_schema_init(buffer, size, columns, count);
+  if (unlikely(!schema))
+    free(buffer);
+  return schema;
+}
+
+//----------------------------------------------------------------------------
+
+const fptu_schema_column *fptu_schema_find(const fptu_schema *schema,
+                                           const char *name, size_t length) {
+  if (unlikely(schema == nullptr || name == nullptr))
+    return nullptr;
+
+  const uint64_t hash = fptu_schema_hash(name, length);
+  const unsigned seed =
+      schema->seeds[fptu_schema_bucket(hash, schema->buckets_mask)];
+  const unsigned index =
+      schema->slots[fptu_schema_slot(hash, seed, schema->slots_mask)];
+  if (index == fptu_schema_none)
+    return nullptr;
+
+  /* сначала длина, чтобы не читать за пределами более короткого имени */
+  const fptu_schema_column *column = &schema->columns[index];
+  if (schema->lengths[index] != length ||
+      memcmp(column->name, name, length) != 0)
+    return nullptr;
+  return column;
+}
+
+const fptu_schema_column *fptu_schema_get(const fptu_schema *schema,
+                                          uint_fast16_t tag) {
+  if (unlikely(schema == nullptr))
+    return nullptr;
+
+  const unsigned col = fptu_get_colnum(tag);
+  if (col >= schema->columns_limit)
+    return nullptr;
+  for (unsigned i = schema->by_column[col]; i != fptu_schema_none;
+       i = schema->next[i])
+    if (schema->columns[i].tag == tag)
+      return &schema->columns[i];
+  return nullptr;
+}
+
+size_t fptu_schema_count(const fptu_schema *schema) {
+  return schema ? schema->count : 0;
+}
+
+const fptu_schema_column *fptu_schema_columns(const fptu_schema *schema) {
+  return schema ? schema->columns : nullptr;
+}
+
+int fptu_schema_name2tag(const void *schema, const char *name,
+                         size_t length) {
+  const fptu_schema_column *column =
+      fptu_schema_find((const fptu_schema *)schema, name, length);
+  return column ? column->tag : -1;
+}
+
+const char *fptu_schema_tag2name(const void *schema, uint_fast16_t tag) {
+  const fptu_schema_column *column =
+      fptu_schema_get((const fptu_schema *)schema, tag);
+  return column ? column->name : nullptr;
+}
+
+const void *fptu_schema_nested(const void *schema, uint_fast16_t tag) {
+  const fptu_schema_column *column =
+      fptu_schema_get((const fptu_schema *)schema, tag);
+  return (column && column->nested) ? column->nested : schema;
+}
+
+//----------------------------------------------------------------------------
+
+int fptu_schema_check_field(const fptu_schema *schema, uint_fast16_t tag) {
+  if (unlikely(schema == nullptr))
+    return FPTU_EINVAL;
+  return fptu_schema_get(schema, tag) ? FPTU_OK : FPTU_ENOFIELD;
+}
+
+int fptu_schema_check(const fptu_schema *schema, fptu_ro ro) {
+  if (unlikely(schema == nullptr))
+    return FPTU_EINVAL;
+
+  const fptu_field *const begin = fptu_begin_ro(ro);
+  const fptu_field *const end = fptu_end_ro(ro);
+  if (unlikely(!begin && ro.total_bytes))
+    return FPTU_EINVAL;
+
+  const size_t items = (size_t)(end - begin);
+#ifdef _MSC_VER /* FIXME: mustdie */
+  uint16_t *const tags = (uint16_t *)_malloca(sizeof(uint16_t) * (items + 1));
+#else
+  uint16_t tags[items + 1];
+#endif
+
+  size_t live = 0;
+  for (const fptu_field *pf = begin; pf < end; ++pf) {
+    if (ct_is_dead(pf->ct))
+      continue;
+    const fptu_schema_column *column = fptu_schema_get(schema, pf->ct);
+    if (unlikely(column == nullptr))
+      return FPTU_ENOFIELD;
+    if (!column->collection)
+      tags[live++] = pf->ct;
+    if (column->nested) {
+      const int rc = fptu_schema_check(column->nested, fptu_field_nested(pf));
+      if (unlikely(rc != FPTU_OK))
+        return rc;
+    }
+  }
+
+  /* повторы допускаются только для коллекций */
+  std::sort(tags, tags + live);
+  return (std::adjacent_find(tags, tags + live) == tags + live) ? FPTU_OK
+                                                                : FPTU_EINVAL;
+}
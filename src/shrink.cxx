@@ -26,6 +26,9 @@ enum {
   fptu_mesh = 8
 };
 
+/* Наибольшая пустота, которую описывает одно удаленное поле fptu_opaque. */
+enum { fptu_hole_max_units = fptu_max_opaque_bytes / fptu_unit_size };
+
 static unsigned fptu_state(const fptu_rw *pt) {
   const fptu_field *const begin = fptu_begin_rw(pt);
   const fptu_field *const end = fptu_end_rw(pt);
@@ -68,6 +71,7 @@ bool fptu_shrink(fptu_rw *pt) {
     assert(0 && "ordered/mesh tuples NOT yet supported");
   }
 
+  FPTU_STAT_ADD(shrinks, 1);
   fptu_field *begin = &pt->units[pt->head].field;
   void *pivot = &pt->units[pt->pivot];
 
@@ -86,15 +90,19 @@ bool fptu_shrink(fptu_rw *pt) {
       size_t u = fptu_field_units(h);
       uint32_t *p = (uint32_t *)fptu_field_payload(h);
       assert(t <= p);
-      if (t != p)
+      if (t != p) {
         memmove(t, p, units2bytes(u));
+        FPTU_STAT_ADD(shrink_moved_bytes, units2bytes(u));
+      }
       size_t offset = (size_t)(t - h[shift].body);
       assert(offset <= fptu_limit);
       f.offset = (uint16_t)offset;
       t += u;
     }
-    if (h[shift].header != f.header)
+    if (h[shift].header != f.header) {
       h[shift].header = f.header;
+      FPTU_STAT_ADD(shrink_moved_bytes, sizeof(f.header));
+    }
   }
 
   assert(t <= &pt->units[pt->end].data);
@@ -103,3 +111,131 @@ bool fptu_shrink(fptu_rw *pt) {
   pt->junk = 0;
   return true;
 }
+
+/* Размещает в дескрипторе pf удаленное поле fptu_opaque, которое
+ * занимает пустоту в данных из units юнитов начиная с hole. */
+static void fptu_hole_field(fptu_field *pf, uint32_t *hole, size_t units) {
+  assert(units > 0 && units <= fptu_hole_max_units);
+  fptu_varlen *varlen = (fptu_varlen *)hole;
+  varlen->brutto = (uint16_t)(units - 1);
+  varlen->opaque_bytes = (uint16_t)units2bytes(units - 1);
+  pf->ct = (uint16_t)((fptu_co_dead << fptu_co_shift) | fptu_opaque);
+  pf->offset = (uint16_t)(hole - pf->body);
+}
+
+bool fptu_shrink_header(fptu_rw *pt) {
+  unsigned state = fptu_state(pt);
+  if ((state & fptu_junk_header) == 0)
+    return false;
+
+  if (state & fptu_mesh) {
+    // TODO: support for ordered tuples;
+    assert(0 && "ordered/mesh tuples NOT yet supported");
+  }
+
+  fptu_field *begin = &pt->units[pt->head].field;
+  fptu_field *w = &pt->units[pt->pivot].field;
+  uint32_t *hole = nullptr;
+  size_t hole_units = 0;
+  unsigned junk = 0;
+
+  /* Живые дескрипторы сдвигаются к pivot с пересчетом смещений, а данные
+   * остаются на месте. Подряд идущие данные удаленных полей объединяются
+   * в одно удаленное поле, так как в данных не допускается пустот. */
+  for (fptu_field *h = w; --h >= begin;) {
+    fptu_field f;
+    f.header = h->header;
+    if (fptu_get_type(f.ct) <= fptu_uint16) {
+      if (ct_is_dead(f.ct))
+        continue;
+    } else {
+      uint32_t *payload = (uint32_t *)fptu_field_payload(h);
+      if (ct_is_dead(f.ct)) {
+        const size_t units = fptu_field_units(h);
+        if (hole && hole_units + units > fptu_hole_max_units) {
+          fptu_hole_field(--w, hole, hole_units);
+          junk += 1 + (unsigned)hole_units;
+          hole = nullptr;
+        }
+        if (units <= fptu_hole_max_units) {
+          if (!hole) {
+            hole = payload;
+            hole_units = 0;
+          }
+          assert(hole + hole_units == payload);
+          hole_units += units;
+          continue;
+        }
+        junk += 1 + (unsigned)units;
+      } else if (hole) {
+        assert(hole + hole_units == payload);
+        fptu_hole_field(--w, hole, hole_units);
+        junk += 1 + (unsigned)hole_units;
+        hole = nullptr;
+      }
+      f.offset = (uint16_t)(f.offset - (size_t)(w - 1 - h));
+    }
+    *--w = f;
+  }
+
+  if (hole) {
+    /* пустота в конце данных отрезается */
+    assert(hole + hole_units == &pt->units[pt->tail].data);
+    pt->tail -= (unsigned)hole_units;
+  }
+  pt->head = (unsigned)(w - &pt->units[0].field);
+  pt->junk = junk;
+  return true;
+}
+
+fptu_ro fptu_take_compact_into(const fptu_rw *pt, void *dst, size_t dst_size) {
+  fptu_ro tuple;
+  tuple.units = nullptr;
+  tuple.total_bytes = 0;
+
+  /* размер считается по живым полям, а не по pt->junk, который после
+   * fptu_fetch() кортежа с удаленными полями может быть занижен */
+  const fptu_field *const begin = &pt->units[pt->head].field;
+  const fptu_field *const pivot = &pt->units[pt->pivot].field;
+  size_t items = 0, payload_units = 0;
+  for (const fptu_field *pf = begin; pf < pivot; ++pf) {
+    if (ct_is_dead(pf->ct))
+      continue;
+    items += 1;
+    if (fptu_get_type(pf->ct) > fptu_uint16)
+      payload_units += fptu_field_units(pf);
+  }
+
+  const size_t total_bytes = units2bytes(1 + items + payload_units);
+  assert(total_bytes <= units2bytes(pt->tail - pt->head + 1 - pt->junk));
+  if (unlikely(dst == nullptr || dst_size < total_bytes))
+    return tuple;
+
+  /* тот же перенос, что и в fptu_shrink(), но в другой буфер */
+  fptu_unit *const units = (fptu_unit *)dst;
+  fptu_field *h = &units[1 + items].field;
+  uint32_t *t = &units[1 + items].data;
+  for (const fptu_field *pf = pivot; --pf >= begin;) {
+    fptu_field f;
+    f.header = pf->header;
+    if (ct_is_dead(f.ct))
+      continue;
+
+    --h;
+    if (fptu_get_type(f.ct) > fptu_uint16) {
+      const size_t u = fptu_field_units(pf);
+      memcpy(t, fptu_field_payload(pf), units2bytes(u));
+      f.offset = (uint16_t)(t - h->body);
+      t += u;
+    }
+    h->header = f.header;
+  }
+
+  assert(h == &units[1].field);
+  assert((char *)t - (char *)units == (ptrdiff_t)total_bytes);
+  units[0].varlen.brutto = (uint16_t)(t - &units[1].data);
+  units[0].varlen.tuple_items = (uint16_t)items;
+  tuple.units = units;
+  tuple.total_bytes = total_bytes;
+  return tuple;
+}
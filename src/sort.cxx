@@ -87,6 +87,42 @@ __hot bool fptu_is_ordered(const fptu_field *begin, const fptu_field *end) {
  *    - по старшему биту получаем верхний предел для размера битовой карты.
  */
 
+/* Сжатие значений тегов для индексации битовой карты, см. пункт 3. */
+struct fptu_tags_squeeze {
+  unsigned blank, lo_part, hi_part;
+  size_t top;
+
+  explicit fptu_tags_squeeze(unsigned have) {
+    /* вполне вероятно, что резерный бит всегда нулевой, также возможно что
+     * нет массивов, тогда размер карты можно сократить в 4 раза. */
+    blank = (have & fptu_fr_mask) ? 0u : (unsigned)fptu_ct_reserve_bits +
+                                             ((have & fptu_farray) ? 0u : 1u);
+    lo_part = (1 << (fptu_typeid_bits + fptu_ct_reserve_bits)) - 1;
+    hi_part = lo_part ^ UINT16_MAX;
+    assert((lo_part >> blank) >= (have & lo_part));
+    top = (have & lo_part) + ((have & hi_part) >> blank) + 1;
+  }
+
+  size_t operator()(size_t ct) const {
+    assert((lo_part >> blank) >= (ct & lo_part));
+    ct = (ct & lo_part) + ((ct & hi_part) >> blank);
+    assert(ct < top);
+    return ct;
+  }
+};
+
+static const size_t fptu_bm_word_bits = sizeof(size_t) * 8;
+
+static __inline bool fptu_bm_test(const size_t *bm, size_t n) {
+  return (bm[n / fptu_bm_word_bits] & ((size_t)1 << (n % fptu_bm_word_bits)))
+             ? true
+             : false;
+}
+
+static __inline void fptu_bm_set(size_t *bm, size_t n) {
+  bm[n / fptu_bm_word_bits] |= (size_t)1 << (n % fptu_bm_word_bits);
+}
+
 static __noinline uint16_t *fptu_tags_slowpath(uint16_t *const first,
                                                uint16_t *tail,
                                                const fptu_field *const pos,
@@ -98,22 +134,14 @@ static __noinline uint16_t *fptu_tags_slowpath(uint16_t *const first,
   for (auto i = pos; i < end; ++i)
     have |= i->ct;
 
-  /* вполне вероятно, что резерный бит всегда нулевой, также возможно что
-   * нет массивов, тогда размер карты можно сократить в 4 раза. */
-  const unsigned blank =
-      (have & fptu_fr_mask) ? 0u : (unsigned)fptu_ct_reserve_bits +
-                                       ((have & fptu_farray) ? 0u : 1u);
-  const unsigned lo_part = (1 << (fptu_typeid_bits + fptu_ct_reserve_bits)) - 1;
-  const unsigned hi_part = lo_part ^ UINT16_MAX;
-  assert((lo_part >> blank) >= (have & lo_part));
-  const auto top = (have & lo_part) + ((have & hi_part) >> blank) + 1;
-  const auto word_bits = sizeof(size_t) * 8;
+  const fptu_tags_squeeze squeeze(have);
 
   /* std::bitset прекрасен, но требует инстанцирования под максимальный
    * размер. При этом на стеке будет выделено и заполнено нулями 4K,
    * в итоге расходы превысят экономию. */
 
-  const size_t n_words = (top + word_bits - 1) / word_bits;
+  const size_t n_words = (squeeze.top + fptu_bm_word_bits - 1) /
+                         fptu_bm_word_bits;
 #ifdef _MSC_VER /* FIXME: mustdie */
   size_t *const bm = (size_t *)_malloca(sizeof(size_t) * n_words);
 #else
@@ -122,24 +150,14 @@ static __noinline uint16_t *fptu_tags_slowpath(uint16_t *const first,
   memset(bm, 0, sizeof(size_t) * n_words);
 
   /* отмечаем обработанное */
-  for (auto i = first; i < tail; ++i) {
-    size_t n = *i;
-    assert((lo_part >> blank) >= (n & lo_part));
-    n = (n & lo_part) + ((n & hi_part) >> blank);
-    assert(n < top);
-
-    bm[n / word_bits] |= (size_t)1 << (n % word_bits);
-  }
+  for (auto i = first; i < tail; ++i)
+    fptu_bm_set(bm, squeeze(*i));
 
   /* обрабатываем неупорядоченный остаток */
   for (auto i = pos; i < end; ++i) {
-    size_t n = i->ct;
-    assert((lo_part >> blank) >= (n & lo_part));
-    n = (n & lo_part) + ((n & hi_part) >> blank);
-    assert(n < top);
-
-    if ((bm[n / word_bits] & ((size_t)1 << (n % word_bits))) == 0) {
-      bm[n / word_bits] |= (size_t)1 << (n % word_bits);
+    const size_t n = squeeze(i->ct);
+    if (!fptu_bm_test(bm, n)) {
+      fptu_bm_set(bm, n);
       *tail++ = i->ct;
     }
   }
@@ -180,3 +198,102 @@ uint16_t *fptu_tags(uint16_t *const first, const fptu_field *const begin,
   }
   return tail;
 }
+
+//----------------------------------------------------------------------------
+
+/* Подсчет полей для заданного набора тегов за один проход.
+ *
+ * Запрошенные теги отмечаются в битовой карте, сжатой как в
+ * fptu_tags_slowpath(), но по маске самих запрошенных тегов. Поэтому
+ * большинство лишних дескрипторов отсеивается проверкой битов маски,
+ * остальные проверкой по карте. Для найденных индекс счетчика
+ * определяется двоичным поиском в упорядоченной копии запроса. */
+size_t fptu_tags_count(const fptu_field *const begin,
+                       const fptu_field *const end, const uint16_t *tags,
+                       size_t n_tags, size_t *counts) {
+  if (unlikely(n_tags == 0))
+    return 0;
+  /* размер буферов на стеке и позиция в младшей половине ключа */
+  if (unlikely(n_tags > fptu_max_fields)) {
+    memset(counts, 0, sizeof(size_t) * n_tags);
+    return 0;
+  }
+
+  unsigned have = 0;
+  for (size_t i = 0; i < n_tags; ++i)
+    have |= tags[i];
+  const fptu_tags_squeeze squeeze(have);
+
+  const size_t n_words = (squeeze.top + fptu_bm_word_bits - 1) /
+                         fptu_bm_word_bits;
+#ifdef _MSC_VER /* FIXME: mustdie */
+  size_t *const bm = (size_t *)_malloca(sizeof(size_t) * n_words);
+  uint32_t *const keys = (uint32_t *)_malloca(sizeof(uint32_t) * n_tags);
+  size_t *const hits = (size_t *)_malloca(sizeof(size_t) * n_tags);
+#else
+  size_t bm[n_words];
+  uint32_t keys[n_tags];
+  size_t hits[n_tags];
+#endif
+  memset(bm, 0, sizeof(size_t) * n_words);
+  memset(hits, 0, sizeof(size_t) * n_tags);
+
+  /* в старшей половине ключа тег, в младшей его позиция в запросе */
+  for (size_t i = 0; i < n_tags; ++i) {
+    fptu_bm_set(bm, squeeze(tags[i]));
+    keys[i] = (uint32_t)tags[i] << 16 | (uint32_t)i;
+  }
+  std::sort(keys, keys + n_tags);
+
+  size_t total = 0;
+  for (auto i = begin; i < end; ++i) {
+    const unsigned ct = i->ct;
+    if ((ct & ~have) != 0 || ct_is_dead(ct) ||
+        !fptu_bm_test(bm, squeeze(ct)))
+      continue;
+
+    const uint32_t *const key =
+        std::lower_bound(keys, keys + n_tags, (uint32_t)ct << 16);
+    assert(key < keys + n_tags && *key >> 16 == ct);
+    hits[key - keys] += 1;
+    total += 1;
+  }
+
+  /* повторы в запросе получают одинаковые значения */
+  for (size_t i = 0, run = 0; i < n_tags; ++i) {
+    if (keys[i] >> 16 != keys[run] >> 16)
+      run = i;
+    counts[keys[i] & UINT16_MAX] = hits[run];
+  }
+  return total;
+}
+
+/* Формирует упорядоченный список тегов без дубликатов, как fptu_tags(),
+ * одновременно подсчитывая количество полей для каждого тега.
+ *
+ * Теги переливаются в буфер в порядке добавления полей, после чего
+ * при необходимости сортируются, а повторы сворачиваются в счетчики.
+ * Удаленные поля не учитываются. */
+uint16_t *fptu_tags_histogram(uint16_t *const first, size_t *counts,
+                              const fptu_field *const begin,
+                              const fptu_field *const end) {
+  uint16_t *tail = first;
+  for (auto i = end; i > begin;) {
+    --i;
+    if (!ct_is_dead(i->ct))
+      *tail++ = i->ct;
+  }
+  if (!std::is_sorted(first, tail))
+    std::sort(first, tail);
+
+  uint16_t *out = first;
+  for (const uint16_t *run = first; run < tail; ++out) {
+    const uint16_t *next = run;
+    while (++next < tail && *next == *run)
+      ;
+    *out = *run;
+    counts[out - first] = (size_t)(next - run);
+    run = next;
+  }
+  return out;
+}
@@ -20,6 +20,10 @@
 #include "fast_positive/tuples_internal.h"
 
 static __hot fptu_field *fptu_find_dead(fptu_rw *pt, size_t units) {
+  /* без мусора удаленных полей нет, а значит и перебор не нужен */
+  if (likely(pt->junk == 0))
+    return nullptr;
+
   fptu_field *end = &pt->units[pt->pivot].field;
   for (fptu_field *pf = &pt->units[pt->head].field; pf < end; ++pf) {
     if (ct_is_dead(pf->ct) && fptu_field_units(pf) == units)
@@ -33,20 +37,24 @@ static __hot fptu_field *fptu_append(fptu_rw *pt, uint_fast16_t ct,
   fptu_field *pf = fptu_find_dead(pt, units);
   if (pf) {
     pf->ct = (uint16_t)ct;
-    assert(pt->junk > 1 + units);
+    assert(pt->junk >= 1 + units);
     pt->junk -= 1 + (unsigned)units;
     return pf;
   }
 
-  if (unlikely(pt->head < 2 || pt->tail + units > pt->end))
+  if (unlikely(pt->head < 2 || pt->tail + units > pt->end)) {
+    FPTU_STAT_ADD(enospace, 1);
     return nullptr;
+  }
 
   pt->head -= 1;
   pf = &pt->units[pt->head].field;
   if (likely(units)) {
     size_t offset = (size_t)(&pt->units[pt->tail].data - pf->body);
-    if (unlikely(offset > fptu_limit))
+    if (unlikely(offset > fptu_limit)) {
+      FPTU_STAT_ADD(enospace, 1);
       return nullptr;
+    }
     pf->offset = (uint16_t)offset;
     pt->tail += (unsigned)units;
   } else {
@@ -57,6 +65,32 @@ static __hot fptu_field *fptu_append(fptu_rw *pt, uint_fast16_t ct,
   return pf;
 }
 
+/* Добавляет копию поля (возможно из другого кортежа), не затрагивая
+ * одноименные поля, т.е. как fptu_insert_xyz(). */
+fptu_field *fptu_append_copy(fptu_rw *pt, const fptu_field *src) {
+  const size_t units = fptu_field_units(src);
+  fptu_field *pf = fptu_append(pt, src->ct, units);
+  if (likely(pf)) {
+    if (units)
+      memcpy((void *)pf->payload(), src->payload(), units2bytes(units));
+    else
+      pf->offset = src->offset;
+  }
+  return pf;
+}
+
+/* Добавляет поле, данные которого уже размещены в свободном месте сразу
+ * за хвостом, т.е. там где их разместил бы fptu_append(). Позволяет
+ * формировать данные поля без промежуточного буфера. */
+fptu_field *fptu_append_tail(fptu_rw *pt, uint_fast16_t ct, size_t units) {
+  const fptu_unit *data = &pt->units[pt->tail];
+  fptu_field *pf = fptu_append(pt, ct, units);
+  if (likely(pf) && units && (const void *)pf->payload() != data)
+    /* задействовано место удаленного поля */
+    memcpy((void *)pf->payload(), data, units2bytes(units));
+  return pf;
+}
+
 static __hot fptu_field *fptu_emplace(fptu_rw *pt, uint_fast16_t ct,
                                       size_t units) {
   fptu_field *pf = fptu_lookup_ct(pt, ct);
@@ -138,6 +172,78 @@ static __inline void fptu_cstrcpy(fptu_field *pf, size_t units,
   memcpy(payload, text, length);
 }
 
+/* Суммарный размер фрагментов. Возвращает SIZE_MAX, если вектор
+ * некорректен или суммарный размер превышает limit. */
+static size_t fptu_iov_bytes(const struct iovec *iov, size_t iovcnt,
+                             size_t limit) {
+  if (unlikely(iov == nullptr && iovcnt != 0))
+    return SIZE_MAX;
+
+  size_t bytes = 0;
+  for (size_t i = 0; i < iovcnt; ++i) {
+    if (unlikely(iov[i].iov_base == nullptr && iov[i].iov_len != 0))
+      return SIZE_MAX;
+    if (unlikely(iov[i].iov_len > limit - bytes))
+      return SIZE_MAX;
+    bytes += iov[i].iov_len;
+  }
+  return bytes;
+}
+
+/* Копирует первые bytes байт из фрагментов подряд в dst. */
+static void fptu_iov_gather(void *dst, size_t bytes, const struct iovec *iov,
+                            size_t iovcnt) {
+  uint8_t *ptr = (uint8_t *)dst;
+  for (; bytes > 0; ++iov) {
+    assert(iovcnt > 0);
+    --iovcnt;
+    size_t chunk = (iov->iov_len < bytes) ? iov->iov_len : bytes;
+    memcpy(ptr, iov->iov_base, chunk);
+    ptr += chunk;
+    bytes -= chunk;
+  }
+  (void)iovcnt;
+}
+
+static __inline void fptu_string_fill(fptu_field *pf, size_t units,
+                                        size_t length,
+                                        const struct iovec *iov,
+                                        size_t iovcnt) {
+  assert(units > 0);
+  assert(bytes2units(length + 1) == units);
+  uint32_t *payload = (uint32_t *)fptu_field_payload(pf);
+  payload[units - 1] = 0; // clean last unit
+  fptu_iov_gather(payload, length, iov, iovcnt);
+  assert(strnlen((const char *)payload, length) == length);
+}
+
+static __inline void fptu_opaque_fill(fptu_field *pf, size_t units,
+                                        size_t bytes,
+                                        const struct iovec *iov,
+                                        size_t iovcnt) {
+  assert(bytes2units(bytes) + 1 == units);
+  fptu_payload *payload = fptu_field_payload(pf);
+  payload->other.varlen.brutto = (uint16_t)(units - 1);
+  payload->other.varlen.opaque_bytes = (uint16_t)bytes;
+
+  ((uint32_t *)payload)[units - 1] =
+      0; // clear a padding for rid an `uninitialized` from memory-checkers.
+  fptu_iov_gather(payload->other.data, bytes, iov, iovcnt);
+}
+
+/* Размер вложенного кортежа в юнитах по заголовку из первого фрагмента(ов),
+ * либо 0 если суммарный размер не соответствует заголовку. */
+static size_t fptu_nested_units(const struct iovec *iov, size_t iovcnt,
+                                size_t bytes) {
+  if (unlikely(bytes < fptu_unit_size))
+    return 0;
+
+  fptu_unit head;
+  fptu_iov_gather(&head, fptu_unit_size, iov, iovcnt);
+  size_t units = (size_t)head.varlen.brutto + 1;
+  return likely(bytes == units2bytes(units)) ? units : 0;
+}
+
 //============================================================================
 
 int fptu_upsert_null(fptu_rw *pt, unsigned col) {
@@ -350,7 +456,64 @@ int fptu_upsert_opaque(fptu_rw *pt, unsigned col, const void *value,
 
 int fptu_upsert_opaque_iov(fptu_rw *pt, unsigned column,
                            const struct iovec value) {
-  return fptu_upsert_opaque(pt, column, value.iov_base, value.iov_len);
+  return fptu_upsert_opaque_gather(pt, column, &value, 1);
+}
+
+int fptu_upsert_opaque_gather(fptu_rw *pt, unsigned col,
+                              const struct iovec *iov, size_t iovcnt) {
+  if (unlikely(col > fptu_max_cols))
+    return FPTU_EINVAL;
+
+  size_t bytes = fptu_iov_bytes(iov, iovcnt, fptu_max_opaque_bytes);
+  if (unlikely(bytes > fptu_max_opaque_bytes))
+    return FPTU_EINVAL;
+
+  size_t units = bytes2units(bytes) + 1;
+  fptu_field *pf = fptu_emplace(pt, fptu_pack_coltype(col, fptu_opaque), units);
+  if (unlikely(pf == nullptr))
+    return FPTU_ENOSPACE;
+
+  fptu_opaque_fill(pf, units, bytes, iov, iovcnt);
+  return FPTU_SUCCESS;
+}
+
+int fptu_upsert_string_gather(fptu_rw *pt, unsigned col,
+                              const struct iovec *iov, size_t iovcnt) {
+  if (unlikely(col > fptu_max_cols))
+    return FPTU_EINVAL;
+
+  size_t length = fptu_iov_bytes(iov, iovcnt, fptu_max_field_bytes - 1);
+  if (unlikely(length >= fptu_max_field_bytes))
+    return FPTU_EINVAL;
+
+  size_t units = bytes2units(length + 1);
+  fptu_field *pf = fptu_emplace(pt, fptu_pack_coltype(col, fptu_cstr), units);
+  if (unlikely(pf == nullptr))
+    return FPTU_ENOSPACE;
+
+  fptu_string_fill(pf, units, length, iov, iovcnt);
+  return FPTU_SUCCESS;
+}
+
+int fptu_upsert_nested_gather(fptu_rw *pt, unsigned col,
+                              const struct iovec *iov, size_t iovcnt) {
+  if (unlikely(col > fptu_max_cols))
+    return FPTU_EINVAL;
+
+  size_t bytes = fptu_iov_bytes(iov, iovcnt, fptu_max_opaque_bytes);
+  if (unlikely(bytes > fptu_max_opaque_bytes))
+    return FPTU_EINVAL;
+
+  size_t units = fptu_nested_units(iov, iovcnt, bytes);
+  if (unlikely(units == 0))
+    return FPTU_EINVAL;
+
+  fptu_field *pf = fptu_emplace(pt, fptu_pack_coltype(col, fptu_nested), units);
+  if (unlikely(pf == nullptr))
+    return FPTU_ENOSPACE;
+
+  fptu_iov_gather(fptu_field_payload(pf), bytes, iov, iovcnt);
+  return FPTU_SUCCESS;
 }
 
 int fptu_upsert_nested(fptu_rw *pt, unsigned col, fptu_ro ro) {
@@ -600,7 +763,67 @@ int fptu_update_opaque(fptu_rw *pt, unsigned col, const void *value,
 
 int fptu_update_opaque_iov(fptu_rw *pt, unsigned column,
                            const struct iovec value) {
-  return fptu_update_opaque(pt, column, value.iov_base, value.iov_len);
+  return fptu_update_opaque_gather(pt, column, &value, 1);
+}
+
+int fptu_update_opaque_gather(fptu_rw *pt, unsigned col,
+                              const struct iovec *iov, size_t iovcnt) {
+  if (unlikely(col > fptu_max_cols))
+    return FPTU_EINVAL;
+
+  size_t bytes = fptu_iov_bytes(iov, iovcnt, fptu_max_opaque_bytes);
+  if (unlikely(bytes > fptu_max_opaque_bytes))
+    return FPTU_EINVAL;
+
+  size_t units = bytes2units(bytes) + 1;
+  fptu_takeover_result result =
+      fptu_takeover(pt, fptu_pack_coltype(col, fptu_opaque), units);
+  if (likely(result.error == FPTU_SUCCESS)) {
+    assert(result.pf != nullptr);
+    fptu_opaque_fill(result.pf, units, bytes, iov, iovcnt);
+  }
+  return result.error;
+}
+
+int fptu_update_string_gather(fptu_rw *pt, unsigned col,
+                              const struct iovec *iov, size_t iovcnt) {
+  if (unlikely(col > fptu_max_cols))
+    return FPTU_EINVAL;
+
+  size_t length = fptu_iov_bytes(iov, iovcnt, fptu_max_field_bytes - 1);
+  if (unlikely(length >= fptu_max_field_bytes))
+    return FPTU_EINVAL;
+
+  size_t units = bytes2units(length + 1);
+  fptu_takeover_result result =
+      fptu_takeover(pt, fptu_pack_coltype(col, fptu_cstr), units);
+  if (likely(result.error == FPTU_SUCCESS)) {
+    assert(result.pf != nullptr);
+    fptu_string_fill(result.pf, units, length, iov, iovcnt);
+  }
+  return result.error;
+}
+
+int fptu_update_nested_gather(fptu_rw *pt, unsigned col,
+                              const struct iovec *iov, size_t iovcnt) {
+  if (unlikely(col > fptu_max_cols))
+    return FPTU_EINVAL;
+
+  size_t bytes = fptu_iov_bytes(iov, iovcnt, fptu_max_opaque_bytes);
+  if (unlikely(bytes > fptu_max_opaque_bytes))
+    return FPTU_EINVAL;
+
+  size_t units = fptu_nested_units(iov, iovcnt, bytes);
+  if (unlikely(units == 0))
+    return FPTU_EINVAL;
+
+  fptu_takeover_result result =
+      fptu_takeover(pt, fptu_pack_coltype(col, fptu_nested), units);
+  if (likely(result.error == FPTU_SUCCESS)) {
+    assert(result.pf != nullptr);
+    fptu_iov_gather(fptu_field_payload(result.pf), bytes, iov, iovcnt);
+  }
+  return result.error;
 }
 
 int fptu_update_nested(fptu_rw *pt, unsigned col, fptu_ro ro) {
@@ -827,7 +1050,64 @@ int fptu_insert_opaque(fptu_rw *pt, unsigned col, const void *value,
 
 int fptu_insert_opaque_iov(fptu_rw *pt, unsigned column,
                            const struct iovec value) {
-  return fptu_insert_opaque(pt, column, value.iov_base, value.iov_len);
+  return fptu_insert_opaque_gather(pt, column, &value, 1);
+}
+
+int fptu_insert_opaque_gather(fptu_rw *pt, unsigned col,
+                              const struct iovec *iov, size_t iovcnt) {
+  if (unlikely(col > fptu_max_cols))
+    return FPTU_EINVAL;
+
+  size_t bytes = fptu_iov_bytes(iov, iovcnt, fptu_max_opaque_bytes);
+  if (unlikely(bytes > fptu_max_opaque_bytes))
+    return FPTU_EINVAL;
+
+  size_t units = bytes2units(bytes) + 1;
+  fptu_field *pf = fptu_append(pt, fptu_pack_coltype(col, fptu_opaque), units);
+  if (unlikely(pf == nullptr))
+    return FPTU_ENOSPACE;
+
+  fptu_opaque_fill(pf, units, bytes, iov, iovcnt);
+  return FPTU_SUCCESS;
+}
+
+int fptu_insert_string_gather(fptu_rw *pt, unsigned col,
+                              const struct iovec *iov, size_t iovcnt) {
+  if (unlikely(col > fptu_max_cols))
+    return FPTU_EINVAL;
+
+  size_t length = fptu_iov_bytes(iov, iovcnt, fptu_max_field_bytes - 1);
+  if (unlikely(length >= fptu_max_field_bytes))
+    return FPTU_EINVAL;
+
+  size_t units = bytes2units(length + 1);
+  fptu_field *pf = fptu_append(pt, fptu_pack_coltype(col, fptu_cstr), units);
+  if (unlikely(pf == nullptr))
+    return FPTU_ENOSPACE;
+
+  fptu_string_fill(pf, units, length, iov, iovcnt);
+  return FPTU_SUCCESS;
+}
+
+int fptu_insert_nested_gather(fptu_rw *pt, unsigned col,
+                              const struct iovec *iov, size_t iovcnt) {
+  if (unlikely(col > fptu_max_cols))
+    return FPTU_EINVAL;
+
+  size_t bytes = fptu_iov_bytes(iov, iovcnt, fptu_max_opaque_bytes);
+  if (unlikely(bytes > fptu_max_opaque_bytes))
+    return FPTU_EINVAL;
+
+  size_t units = fptu_nested_units(iov, iovcnt, bytes);
+  if (unlikely(units == 0))
+    return FPTU_EINVAL;
+
+  fptu_field *pf = fptu_append(pt, fptu_pack_coltype(col, fptu_nested), units);
+  if (unlikely(pf == nullptr))
+    return FPTU_ENOSPACE;
+
+  fptu_iov_gather(fptu_field_payload(pf), bytes, iov, iovcnt);
+  return FPTU_SUCCESS;
 }
 
 int fptu_insert_nested(fptu_rw *pt, unsigned col, fptu_ro ro) {
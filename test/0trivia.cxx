@@ -375,6 +375,43 @@ TEST(Trivia, time_grain) {
 
 //----------------------------------------------------------------------------
 
+TEST(Trivia, Statistics) {
+  fptu_stat_reset();
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, fptu_space(2, 16), 2);
+  ASSERT_NE(nullptr, pt);
+  EXPECT_EQ(FPTU_OK, fptu_upsert_uint64(pt, 1, 1));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_uint64(pt, 2, 2));
+  EXPECT_EQ(FPTU_ENOSPACE, fptu_upsert_uint64(pt, 3, 3));
+  EXPECT_NE(nullptr, fptu_lookup(pt, 1, fptu_uint64));
+  EXPECT_EQ(nullptr, fptu_lookup_ro(fptu_take_noshrink(pt), 4, fptu_uint64));
+  EXPECT_EQ(1, fptu_erase(pt, 1, fptu_uint64));
+  EXPECT_TRUE(fptu_shrink(pt));
+  EXPECT_EQ(fptu_eq, fptu_cmp_tuples(fptu_take(pt), fptu_take(pt)));
+
+  fptu_stat stat;
+  if (fptu_stat_snapshot(&stat)) {
+    EXPECT_TRUE(HAVE_FPTU_STATISTICS);
+    EXPECT_LE(1u, stat.lookup_hits);
+    EXPECT_LE(1u, stat.lookup_misses);
+    EXPECT_LE(stat.lookup_hits + stat.lookup_misses, stat.lookup_scanned);
+    EXPECT_EQ(1u, stat.enospace);
+    EXPECT_EQ(3u, stat.junk_units);
+    EXPECT_EQ(1u, stat.shrinks);
+    EXPECT_EQ(12u, stat.shrink_moved_bytes);
+    EXPECT_EQ(1u, stat.cmp_fastpath + stat.cmp_slowpath);
+
+    fptu_stat_reset();
+    ASSERT_TRUE(fptu_stat_snapshot(&stat));
+    EXPECT_EQ(0u, stat.lookup_hits + stat.lookup_scanned + stat.shrinks);
+  } else {
+    EXPECT_FALSE(HAVE_FPTU_STATISTICS);
+    EXPECT_EQ(0u, stat.lookup_scanned);
+  }
+}
+
+//----------------------------------------------------------------------------
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,260 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fptu_test.h"
+
+#ifdef _MSC_VER
+#pragma warning(push, 1)
+#endif /* _MSC_VER */
+
+#include <random>
+#include <string>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+/* Применяет дельту к копии old и сверяет результат с expected. */
+static void check_patch(fptu_ro old_ro, fptu_ro diff, fptu_ro expected) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_fetch(old_ro, space, sizeof(space), fptu_max_fields / 2);
+  ASSERT_NE(nullptr, pt);
+  ASSERT_EQ(FPTU_OK, fptu_patch(pt, diff));
+  ASSERT_STREQ(nullptr, fptu_check(pt));
+  EXPECT_EQ(fptu_eq, fptu_cmp_tuples(fptu_take(pt), expected));
+}
+
+TEST(Diff, Basic) {
+  char old_space[fptu_buffer_enough];
+  fptu_rw *old_pt = fptu_init(old_space, sizeof(old_space), fptu_max_fields);
+  ASSERT_NE(nullptr, old_pt);
+  const std::string big(1000, 'x');
+  EXPECT_EQ(FPTU_OK, fptu_upsert_cstr(old_pt, 1, big.c_str()));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_int32(old_pt, 2, 42));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_fp64(old_pt, 3, 0.0));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_uint16(old_pt, 4, 7));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_null(old_pt, 5));
+  const fptu_ro old_ro = fptu_take(old_pt);
+
+  /* новая версия с другим порядком полей: изменено одно поле, одно
+   * удалено и одно добавлено */
+  char new_space[fptu_buffer_enough];
+  fptu_rw *new_pt = fptu_init(new_space, sizeof(new_space), fptu_max_fields);
+  ASSERT_NE(nullptr, new_pt);
+  EXPECT_EQ(FPTU_OK, fptu_upsert_null(new_pt, 5));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_fp64(new_pt, 3, -0.0));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_int32(new_pt, 2, 42));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_cstr(new_pt, 1, big.c_str()));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_uint64(new_pt, 6, 1));
+  const fptu_ro new_ro = fptu_take(new_pt);
+
+  char diff_space[fptu_buffer_enough];
+  fptu_rw *diff = fptu_init(diff_space, sizeof(diff_space), fptu_max_fields);
+  ASSERT_NE(nullptr, diff);
+  ASSERT_EQ(FPTU_OK, fptu_diff(old_ro, new_ro, diff));
+  const fptu_ro diff_ro = fptu_take(diff);
+  /* fp64 (-0.0), uint64 и маркеры удаления uint16 и изменения fp64 */
+  EXPECT_EQ(4u, fptu_field_count_ro(diff_ro, fptu_max_cols, fptu_uint16) +
+                    fptu_field_count_ro(diff_ro, 3, fptu_fp64) +
+                    fptu_field_count_ro(diff_ro, 6, fptu_uint64));
+  EXPECT_LT(diff_ro.total_bytes * 10, new_ro.total_bytes);
+  check_patch(old_ro, diff_ro, new_ro);
+
+  /* обратная дельта */
+  ASSERT_EQ(FPTU_OK, fptu_diff(new_ro, old_ro, diff));
+  check_patch(new_ro, fptu_take(diff), old_ro);
+
+  /* одинаковые кортежи и пустые дельты */
+  ASSERT_EQ(FPTU_OK, fptu_diff(new_ro, new_ro, diff));
+  EXPECT_EQ(fptu_end_ro(fptu_take(diff)), fptu_begin_ro(fptu_take(diff)));
+  check_patch(old_ro, fptu_take(diff), old_ro);
+  fptu_ro empty;
+  empty.sys.iov_base = nullptr;
+  empty.sys.iov_len = 0;
+  check_patch(old_ro, empty, old_ro);
+  ASSERT_EQ(FPTU_OK, fptu_diff(empty, new_ro, diff));
+  check_patch(empty, fptu_take(diff), new_ro);
+  ASSERT_EQ(FPTU_OK, fptu_diff(new_ro, empty, diff));
+  check_patch(new_ro, fptu_take(diff), empty);
+}
+
+TEST(Diff, Collections) {
+  char old_space[fptu_buffer_enough];
+  fptu_rw *old_pt = fptu_init(old_space, sizeof(old_space), fptu_max_fields);
+  ASSERT_NE(nullptr, old_pt);
+  for (unsigned i = 0; i < 5; ++i) {
+    EXPECT_EQ(FPTU_OK, fptu_insert_uint32(old_pt, 1, i));
+    EXPECT_EQ(FPTU_OK, fptu_insert_cstr(old_pt, 2, std::to_string(i).c_str()));
+  }
+  const fptu_ro old_ro = fptu_take(old_pt);
+
+  /* меняем порядок элементов одной коллекции, вторая не изменяется */
+  char new_space[fptu_buffer_enough];
+  fptu_rw *new_pt = fptu_init(new_space, sizeof(new_space), fptu_max_fields);
+  ASSERT_NE(nullptr, new_pt);
+  for (unsigned i = 0; i < 5; ++i) {
+    EXPECT_EQ(FPTU_OK, fptu_insert_cstr(new_pt, 2, std::to_string(i).c_str()));
+    EXPECT_EQ(FPTU_OK, fptu_insert_uint32(new_pt, 1, 4 - i));
+  }
+  const fptu_ro new_ro = fptu_take(new_pt);
+  ASSERT_NE(fptu_eq, fptu_cmp_tuples(old_ro, new_ro));
+
+  char diff_space[fptu_buffer_enough];
+  fptu_rw *diff = fptu_init(diff_space, sizeof(diff_space), fptu_max_fields);
+  ASSERT_NE(nullptr, diff);
+  ASSERT_EQ(FPTU_OK, fptu_diff(old_ro, new_ro, diff));
+  const fptu_ro diff_ro = fptu_take(diff);
+  EXPECT_EQ(0u, fptu_field_count_ro(diff_ro, 2, fptu_cstr));
+  EXPECT_EQ(5u, fptu_field_count_ro(diff_ro, 1, fptu_uint32));
+  check_patch(old_ro, diff_ro, new_ro);
+}
+
+TEST(Diff, Random) {
+  std::mt19937 rng(2017);
+  char old_space[fptu_buffer_enough], new_space[fptu_buffer_enough];
+  char diff_space[fptu_buffer_enough];
+  for (unsigned round = 0; round < 2000; ++round) {
+    fptu_rw *old_pt =
+        fptu_init(old_space, sizeof(old_space), fptu_max_fields / 4);
+    ASSERT_NE(nullptr, old_pt);
+    for (unsigned n = rng() % 32; n > 0; --n) {
+      const unsigned col = rng() % 8;
+      EXPECT_EQ(FPTU_OK, (rng() & 1)
+                             ? fptu_insert_int64(old_pt, col, rng() % 4)
+                             : fptu_insert_cstr(old_pt, col,
+                                                std::to_string(rng()).c_str()));
+    }
+    const fptu_ro old_ro = fptu_take(old_pt);
+
+    /* новая версия получается случайными изменениями старой, в том
+     * числе вставками в дыры после удалений */
+    fptu_rw *new_pt =
+        fptu_fetch(old_ro, new_space, sizeof(new_space), fptu_max_fields / 4);
+    ASSERT_NE(nullptr, new_pt);
+    for (unsigned n = rng() % 8; n > 0; --n) {
+      const unsigned col = rng() % 8;
+      switch (rng() % 4) {
+      case 0:
+        fptu_erase(new_pt, col, fptu_int64);
+        break;
+      case 1:
+        EXPECT_EQ(FPTU_OK, fptu_upsert_int64(new_pt, col, rng() % 4));
+        break;
+      case 2:
+        EXPECT_EQ(FPTU_OK, fptu_insert_int64(new_pt, col, rng() % 4));
+        break;
+      default:
+        fptu_erase(new_pt, col, fptu_cstr | fptu_filter);
+        break;
+      }
+    }
+
+    /* мертвые поля при построении дельты игнорируются, но их учитывает
+     * fptu_cmp_tuples(), поэтому сверяемся с дефрагментированной формой */
+    fptu_rw *diff =
+        fptu_init(diff_space, sizeof(diff_space), fptu_max_fields / 4);
+    ASSERT_NE(nullptr, diff);
+    ASSERT_EQ(FPTU_OK, fptu_diff(old_ro, fptu_take_noshrink(new_pt), diff));
+    const fptu_ro diff_ro = fptu_take(diff);
+    const fptu_ro new_ro = fptu_take(new_pt);
+    if (fptu_cmp_tuples(old_ro, new_ro) == fptu_eq) {
+      EXPECT_EQ(fptu_end_ro(diff_ro), fptu_begin_ro(diff_ro));
+    }
+    check_patch(old_ro, diff_ro, new_ro);
+  }
+}
+
+TEST(Diff, Invalid) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+  EXPECT_EQ(FPTU_OK, fptu_upsert_uint16(pt, fptu_max_cols, 1));
+  const fptu_ro ro = fptu_take(pt);
+
+  char diff_space[fptu_buffer_enough];
+  fptu_rw *diff = fptu_init(diff_space, sizeof(diff_space), fptu_max_fields);
+  ASSERT_NE(nullptr, diff);
+  EXPECT_EQ(FPTU_EINVAL, fptu_diff(ro, ro, diff));
+  EXPECT_EQ(FPTU_EINVAL, fptu_diff(ro, ro, nullptr));
+  EXPECT_EQ(FPTU_EINVAL, fptu_patch(nullptr, ro));
+
+  /* при нехватке места кортеж не изменяется */
+  char old_space[fptu_buffer_enough];
+  fptu_rw *old_pt = fptu_init(old_space, sizeof(old_space), fptu_max_fields);
+  ASSERT_NE(nullptr, old_pt);
+  EXPECT_EQ(FPTU_OK, fptu_upsert_int32(old_pt, 1, 1));
+  const fptu_ro old_ro = fptu_take(old_pt);
+
+  char new_space[fptu_buffer_enough];
+  fptu_rw *new_pt = fptu_init(new_space, sizeof(new_space), fptu_max_fields);
+  ASSERT_NE(nullptr, new_pt);
+  const std::string big(1000, 'x');
+  EXPECT_EQ(FPTU_OK, fptu_upsert_cstr(new_pt, 2, big.c_str()));
+  ASSERT_EQ(FPTU_OK, fptu_diff(old_ro, fptu_take(new_pt), diff));
+
+  char small_space[fptu_buffer_enough];
+  fptu_rw *small = fptu_fetch(old_ro, small_space, fptu_space(2, 100), 1);
+  ASSERT_NE(nullptr, small);
+  EXPECT_EQ(FPTU_ENOSPACE, fptu_patch(small, fptu_take(diff)));
+  EXPECT_EQ(fptu_eq, fptu_cmp_tuples(fptu_take(small), old_ro));
+}
+
+TEST(Diff, FetchedWithDead) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+  for (unsigned col = 1; col <= 4; ++col)
+    EXPECT_EQ(FPTU_OK, fptu_insert_uint32(pt, col, col));
+  const fptu_ro old_ro = fptu_take_noshrink(pt);
+
+  char new_space[fptu_buffer_enough];
+  fptu_rw *new_pt = fptu_fetch(old_ro, new_space, sizeof(new_space), 1);
+  ASSERT_NE(nullptr, new_pt);
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint32(new_pt, 5, 5));
+
+  char diff_space[fptu_buffer_enough];
+  fptu_rw *diff = fptu_init(diff_space, sizeof(diff_space), fptu_max_fields);
+  ASSERT_NE(nullptr, diff);
+  ASSERT_EQ(FPTU_OK, fptu_diff(old_ro, fptu_take(new_pt), diff));
+
+  /* удаленное поле попадает в копию, но не учитывается в pt->junk,
+   * а места без него не хватает */
+  EXPECT_EQ(1, fptu_erase(pt, 2, fptu_uint32));
+  const fptu_ro dead_ro = fptu_take_noshrink(pt);
+  char fetched_space[fptu_buffer_enough];
+  fptu_rw *fetched =
+      fptu_fetch(dead_ro, fetched_space, sizeof(fetched_space), 0);
+  ASSERT_NE(nullptr, fetched);
+  EXPECT_EQ(0u, fetched->junk);
+  EXPECT_EQ(0u, fptu_space4items(fetched));
+
+  EXPECT_EQ(FPTU_OK, fptu_patch(fetched, fptu_take(diff)));
+  EXPECT_STREQ(nullptr, fptu_check(fetched));
+  int error = FPTU_OK;
+  EXPECT_EQ(5u, fptu_get_uint32(fptu_take_noshrink(fetched), 5, &error));
+  EXPECT_EQ(FPTU_OK, error);
+  EXPECT_EQ(1u, fptu_get_uint32(fptu_take_noshrink(fetched), 1, &error));
+  fptu_get_uint32(fptu_take_noshrink(fetched), 2, &error);
+  EXPECT_EQ(FPTU_ENOFIELD, error);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fptu_test.h"
+
+#ifdef _MSC_VER
+#pragma warning(push, 1)
+#endif /* _MSC_VER */
+
+#include <set>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+static uint_fast16_t tag(unsigned column, fptu_type type) {
+  return (uint_fast16_t)type + (column << fptu_co_shift);
+}
+
+TEST(Profile, Basic) {
+  EXPECT_EQ(0u, fptu_profile_bucket(0));
+  EXPECT_EQ(1u, fptu_profile_bucket(1));
+  EXPECT_EQ(2u, fptu_profile_bucket(3));
+  EXPECT_EQ(3u, fptu_profile_bucket(4));
+  EXPECT_EQ(fptu_profile_buckets - 1u, fptu_profile_bucket(~size_t(0)));
+
+  fptu_profile *profile = fptu_profile_alloc(16);
+  ASSERT_NE(nullptr, profile);
+  EXPECT_EQ(FPTU_EINVAL, fptu_profile_add(nullptr, fptu_ro()));
+
+  char space[fptu_buffer_enough];
+  size_t bytes_max = 0;
+  for (unsigned i = 0; i < 10; ++i) {
+    fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+    ASSERT_NE(nullptr, pt);
+    EXPECT_EQ(FPTU_OK, fptu_insert_uint32(pt, 1, i));
+    if (i % 2) {
+      EXPECT_EQ(FPTU_OK,
+                fptu_insert_cstr(pt, 2, std::string(i * 10, 'x').c_str()));
+    }
+    for (unsigned n = 0; n < i % 3; ++n)
+      EXPECT_EQ(FPTU_OK, fptu_insert_int64(pt, 3, n));
+    const fptu_ro ro = fptu_take(pt);
+    bytes_max = std::max(bytes_max, ro.total_bytes);
+    EXPECT_EQ(FPTU_OK, fptu_profile_add(profile, ro));
+  }
+  fptu_ro empty;
+  empty.sys.iov_base = nullptr;
+  empty.sys.iov_len = 0;
+  EXPECT_EQ(FPTU_OK, fptu_profile_add(profile, empty));
+
+  EXPECT_EQ(11u, profile->samples);
+  EXPECT_EQ(10u + 5u + 9u, profile->fields_total);
+  EXPECT_EQ(3u, profile->tags_used);
+  EXPECT_EQ(0u, profile->tags_overflow);
+  EXPECT_EQ(0u, profile->junk_items);
+  EXPECT_EQ(0u, profile->junk_bytes);
+  EXPECT_EQ(1u, profile->fields_histogram[0]);
+  uint64_t total = 0, varlen = 0;
+  for (unsigned i = 0; i < fptu_profile_buckets; ++i) {
+    total += profile->fields_histogram[i];
+    varlen += profile->varlen_histogram[i];
+  }
+  EXPECT_EQ(profile->samples, total);
+  EXPECT_EQ(5u, varlen);
+
+  const fptu_profile_tag *hot =
+      fptu_profile_lookup(profile, tag(1, fptu_uint32));
+  ASSERT_NE(nullptr, hot);
+  EXPECT_EQ(10u, hot->samples);
+  EXPECT_EQ(10u, hot->fields);
+  EXPECT_EQ(10u, hot->first_line);
+  const fptu_profile_tag *coll =
+      fptu_profile_lookup(profile, tag(3, fptu_int64));
+  ASSERT_NE(nullptr, coll);
+  EXPECT_EQ(6u, coll->samples);
+  EXPECT_EQ(9u, coll->fields);
+  EXPECT_EQ(nullptr, fptu_profile_lookup(profile, tag(4, fptu_int64)));
+
+  /* от редких к частым */
+  uint16_t order[3];
+  ASSERT_EQ(3u, fptu_profile_order(profile, order, 3));
+  EXPECT_EQ(tag(2, fptu_cstr), order[0]);
+  EXPECT_EQ(tag(3, fptu_int64), order[1]);
+  EXPECT_EQ(tag(1, fptu_uint32), order[2]);
+  ASSERT_EQ(1u, fptu_profile_order(profile, order, 1));
+  EXPECT_EQ(tag(1, fptu_uint32), order[0]);
+
+  /* рекомендуемых резервов достаточно для любого из кортежей */
+  EXPECT_EQ(4u, profile->items_max);
+  const size_t reserve =
+      fptu_space(profile->items_max, profile->data_bytes_max);
+  EXPECT_LE(bytes_max, reserve - sizeof(fptu_rw) + fptu_unit_size);
+  free(profile);
+}
+
+TEST(Profile, Order) {
+  /* горячее поле добавляется первым и оказывается в конце заголовка */
+  const unsigned count = fptu_profile_line_items * 2;
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+  for (unsigned col = 0; col < count; ++col)
+    EXPECT_EQ(FPTU_OK, fptu_insert_uint32(pt, col, col));
+
+  char profile_space[fptu_buffer_enough];
+  fptu_profile *profile =
+      fptu_profile_init(profile_space, sizeof(profile_space), count * 2);
+  ASSERT_NE(nullptr, profile);
+  EXPECT_EQ(nullptr, fptu_profile_init(profile_space, 1, count));
+  for (unsigned i = 0; i < 3; ++i)
+    EXPECT_EQ(FPTU_OK, fptu_profile_add(profile, fptu_take(pt)));
+  /* во второй выборке только поле 0 */
+  ASSERT_EQ(FPTU_OK, fptu_clear(pt));
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint32(pt, 0, 0));
+  EXPECT_EQ(FPTU_OK, fptu_profile_add(profile, fptu_take(pt)));
+
+  const fptu_profile_tag *hot =
+      fptu_profile_lookup(profile, tag(0, fptu_uint32));
+  ASSERT_NE(nullptr, hot);
+  EXPECT_EQ(4u, hot->samples);
+  EXPECT_EQ(1u, hot->first_line);
+  EXPECT_EQ((count - 1) * 3u, hot->position);
+
+  /* первая кэш-линия вмещает заголовок и 15 дескрипторов */
+  EXPECT_EQ(15u, (unsigned)fptu_profile_line_items);
+  const fptu_profile_tag *last = fptu_profile_lookup(
+      profile, tag(count - fptu_profile_line_items, fptu_uint32));
+  ASSERT_NE(nullptr, last);
+  EXPECT_EQ(3u, last->first_line);
+  const fptu_profile_tag *beyond = fptu_profile_lookup(
+      profile, tag(count - fptu_profile_line_items - 1, fptu_uint32));
+  ASSERT_NE(nullptr, beyond);
+  EXPECT_EQ(0u, beyond->first_line);
+
+  /* в рекомендуемом порядке поле 0 идет последним */
+  uint16_t order[count];
+  ASSERT_EQ(count, fptu_profile_order(profile, order, count));
+  EXPECT_EQ(tag(0, fptu_uint32), order[count - 1]);
+
+  ASSERT_EQ(FPTU_OK, fptu_clear(pt));
+  for (unsigned i = 0; i < count; ++i)
+    EXPECT_EQ(FPTU_OK, fptu_insert_uint32(pt, fptu_get_colnum(order[i]), i));
+  const fptu_ro ro = fptu_take(pt);
+  EXPECT_EQ(fptu_begin_ro(ro), fptu_lookup_ro(ro, 0, fptu_uint32));
+
+  /* большой профиль со многими тегами */
+  fptu_profile *big = fptu_profile_alloc(fptu_max_fields * 4);
+  ASSERT_NE(nullptr, big);
+  ASSERT_EQ(FPTU_OK, fptu_clear(pt));
+  for (unsigned col = 0; col < fptu_max_cols; col += 1) {
+    EXPECT_EQ(FPTU_OK, fptu_insert_uint32(pt, col, col));
+    EXPECT_EQ(FPTU_OK, fptu_insert_int64(pt, col, col));
+  }
+  EXPECT_EQ(FPTU_OK, fptu_profile_add(big, fptu_take(pt)));
+  ASSERT_EQ(FPTU_OK, fptu_insert_uint32(pt, fptu_max_cols, 0));
+  EXPECT_EQ(FPTU_OK, fptu_profile_add(big, fptu_take(pt)));
+  const size_t distinct = fptu_max_cols * 2u + 1;
+  EXPECT_EQ(distinct, big->tags_used);
+  std::vector<uint16_t> big_order(distinct);
+  ASSERT_EQ(distinct,
+            fptu_profile_order(big, big_order.data(), big_order.size()));
+  EXPECT_EQ(tag(fptu_max_cols, fptu_uint32), big_order.front());
+  EXPECT_EQ(distinct, std::set<uint16_t>(big_order.begin(),
+                                         big_order.end()).size());
+  free(big);
+}
+
+TEST(Profile, Junk) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint32(pt, 1, 1));
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(pt, 2, "junk"));
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint64(pt, 3, 3));
+  EXPECT_EQ(1, fptu_erase(pt, 2, fptu_cstr));
+
+  fptu_profile *profile = fptu_profile_alloc(1);
+  ASSERT_NE(nullptr, profile);
+  EXPECT_EQ(FPTU_OK, fptu_profile_add(profile, fptu_take_noshrink(pt)));
+  EXPECT_EQ(1u, profile->junk_items);
+  EXPECT_EQ(8u, profile->junk_bytes);
+  EXPECT_EQ(2u, profile->items_max);
+  EXPECT_EQ(12u, profile->data_bytes_max);
+  /* место только для одного тега */
+  EXPECT_EQ(1u, profile->tags_used);
+  EXPECT_EQ(1u, profile->tags_overflow);
+  free(profile);
+}
+
+TEST(Profile, Service) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint32(pt, 1, 1));
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(pt, 2, "junk"));
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint64(pt, 3, 3));
+
+  /* служебное поле не является ни данными, ни мусором */
+  fptu_profile *profile = fptu_profile_alloc(4);
+  ASSERT_NE(nullptr, profile);
+  const fptu_ro bloomed = fptu_take_bloom(pt);
+  ASSERT_NE(nullptr, fptu_bloom_field(bloomed));
+  EXPECT_EQ(FPTU_OK, fptu_profile_add(profile, bloomed));
+  EXPECT_EQ(0u, profile->junk_items);
+  EXPECT_EQ(0u, profile->junk_bytes);
+  EXPECT_EQ(3u, profile->items_max);
+  EXPECT_EQ(20u, profile->data_bytes_max);
+
+  char fixed_space[fptu_buffer_enough];
+  fptu_rw *fixed = fptu_init(fixed_space, sizeof(fixed_space), 2);
+  ASSERT_NE(nullptr, fixed);
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint32(fixed, 1, 1));
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint64(fixed, 3, 3));
+  const fptu_ro tmpl = fptu_take(fixed);
+  std::string image(fptu_layout_space(tmpl), '\0');
+  const fptu_ro stamped = fptu_layout_stamp(tmpl, &image[0], image.size());
+  ASSERT_NE(nullptr, stamped.units);
+  EXPECT_EQ(FPTU_OK, fptu_profile_add(profile, stamped));
+  EXPECT_EQ(0u, profile->junk_items);
+  EXPECT_EQ(0u, profile->junk_bytes);
+
+  /* а мусор удаленных полей учитывается как и без карты */
+  EXPECT_EQ(1, fptu_erase(pt, 2, fptu_cstr));
+  const fptu_ro junky = fptu_take_bloom_noshrink(pt);
+  ASSERT_NE(nullptr, fptu_bloom_field(junky));
+  EXPECT_EQ(FPTU_OK, fptu_profile_add(profile, junky));
+  EXPECT_EQ(1u, profile->junk_items);
+  EXPECT_EQ(8u, profile->junk_bytes);
+  free(profile);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,456 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fptu_test.h"
+
+#ifdef _MSC_VER
+#pragma warning(push, 1)
+#endif /* _MSC_VER */
+
+#include <cfloat>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+static std::string fp64_json(double value) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), 1);
+  EXPECT_EQ(FPTU_OK, fptu_upsert_fp64(pt, 0, value));
+  const std::string json = fptu::to_json(fptu_take(pt));
+  return json.substr(5, json.size() - 6);
+}
+
+static std::string fp32_json(float value) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), 1);
+  EXPECT_EQ(FPTU_OK, fptu_upsert_fp32(pt, 0, value));
+  const std::string json = fptu::to_json(fptu_take(pt));
+  return json.substr(5, json.size() - 6);
+}
+
+TEST(Json, Numbers) {
+  EXPECT_EQ("0.0", fp64_json(0.0));
+  EXPECT_EQ("-0.0", fp64_json(-0.0));
+  EXPECT_EQ("1.0", fp64_json(1.0));
+  EXPECT_EQ("0.1", fp64_json(0.1));
+  EXPECT_EQ("-123.456", fp64_json(-123.456));
+  EXPECT_EQ("100000000000000000000.0", fp64_json(1e20));
+  EXPECT_EQ("1e21", fp64_json(1e21));
+  EXPECT_EQ("1.5e-7", fp64_json(1.5e-7));
+  EXPECT_EQ("0.000001", fp64_json(1e-6));
+  EXPECT_EQ("5e-324", fp64_json(5e-324));
+  EXPECT_EQ("1.7976931348623157e308", fp64_json(DBL_MAX));
+  EXPECT_EQ("null", fp64_json(std::numeric_limits<double>::quiet_NaN()));
+  EXPECT_EQ("null", fp64_json(-std::numeric_limits<double>::infinity()));
+  EXPECT_EQ("0.1", fp32_json(0.1f));
+  EXPECT_EQ("3.4028235e38", fp32_json(FLT_MAX));
+  EXPECT_EQ("1e-45", fp32_json(1e-45f));
+
+  /* точное обратное преобразование */
+  std::mt19937_64 rng(2017);
+  for (unsigned i = 0; i < 100000; ++i) {
+    double value;
+    uint64_t bits = rng();
+    memcpy(&value, &bits, sizeof(value));
+    if (!std::isfinite(value))
+      continue;
+    const std::string text = fp64_json(value);
+    const double parsed = strtod(text.c_str(), nullptr);
+    ASSERT_EQ(0, memcmp(&value, &parsed, sizeof(value))) << text;
+    ASSERT_LE(text.size(), 25u) << text;
+
+    float value32;
+    uint32_t bits32 = (uint32_t)bits;
+    memcpy(&value32, &bits32, sizeof(value32));
+    if (!std::isfinite(value32))
+      continue;
+    const std::string text32 = fp32_json(value32);
+    const float parsed32 = strtof(text32.c_str(), nullptr);
+    ASSERT_EQ(0, memcmp(&value32, &parsed32, sizeof(value32))) << text32;
+  }
+
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint16(pt, 1, 65535));
+  EXPECT_EQ(FPTU_OK, fptu_insert_int32(pt, 2, INT32_MIN));
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint32(pt, 3, UINT32_MAX));
+  EXPECT_EQ(FPTU_OK, fptu_insert_int64(pt, 4, INT64_MIN));
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint64(pt, 5, UINT64_MAX));
+  EXPECT_EQ(FPTU_OK, fptu_insert_int64(pt, 6, 0));
+  EXPECT_EQ("{\"1\":65535,\"2\":-2147483648,\"3\":4294967295,"
+            "\"4\":-9223372036854775808,\"5\":18446744073709551615,\"6\":0}",
+            fptu::to_json(fptu_take(pt)));
+}
+
+static const char *schema_name(const void *schema_ctx, uint_fast16_t tag) {
+  (void)schema_ctx;
+  switch (tag >> fptu_co_shift) {
+  case 1:
+    return "name";
+  case 2:
+    return "tags";
+  case 3:
+    return "nested";
+  case 4:
+    return "when";
+  default:
+    return nullptr;
+  }
+}
+
+TEST(Json, Tuple) {
+  fptu_ro empty;
+  empty.sys.iov_base = nullptr;
+  empty.sys.iov_len = 0;
+  EXPECT_EQ("{}", fptu::to_json(empty));
+
+  char nested_space[fptu_buffer_enough];
+  fptu_rw *nested = fptu_init(nested_space, sizeof(nested_space), 8);
+  ASSERT_NE(nullptr, nested);
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(nested, 1, "inner"));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_null(nested, 9));
+
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(pt, 1, "q\"b\\s\n\x01/\xd0\xaf"));
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(pt, 2, "a"));
+  EXPECT_EQ(FPTU_OK, fptu_insert_nested(pt, 3, fptu_take(nested)));
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(pt, 2, "b"));
+  fptu_time when;
+  when.fixedpoint = (UINT64_C(1490013296) << 32) | (UINT64_C(1) << 31);
+  EXPECT_EQ(FPTU_OK, fptu_insert_datetime(pt, 4, when));
+  const uint8_t bytes[] = {0x01, 0xAB, 0xFF};
+  EXPECT_EQ(FPTU_OK, fptu_insert_opaque(pt, 5, bytes, sizeof(bytes)));
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(pt, 2, "c"));
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint16(pt, 6, 42));
+  EXPECT_EQ(1, fptu_erase(pt, 6, fptu_uint16));
+  const fptu_ro ro = fptu_take_noshrink(pt);
+
+  EXPECT_EQ("{\"1\":\"q\\\"b\\\\s\\n\\u0001/\xd0\xaf\","
+            "\"2\":[\"a\",\"b\",\"c\"],"
+            "\"3\":{\"1\":\"inner\",\"9\":null},"
+            "\"4\":\"2017-03-20T12:34:56.500000000Z\",\"5\":\"01abff\"}",
+            fptu::to_json(ro));
+  EXPECT_EQ("{\"name\":\"q\\\"b\\\\s\\n\\u0001/\xd0\xaf\","
+            "\"tags\":[\"a\",\"b\",\"c\"],"
+            "\"nested\":{\"name\":\"inner\"},"
+            "\"when\":\"2017-03-20T12:34:56.500000000Z\"}",
+            fptu::to_json(ro, schema_name, nullptr, nullptr,
+                          fptu_json_skip_unknown));
+}
+
+static int emit_limited(void *output_ctx, const char *text, size_t length) {
+  std::string *output = static_cast<std::string *>(output_ctx);
+  if (output->size() + length > 600)
+    return FPTU_ENOSPACE;
+  output->append(text, length);
+  return FPTU_OK;
+}
+
+TEST(Json, Output) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+  for (unsigned col = 0; col < 100; ++col) {
+    const std::string value(col, 'x');
+    EXPECT_EQ(FPTU_OK, fptu_insert_cstr(pt, col, value.c_str()));
+  }
+  const fptu_ro ro = fptu_take(pt);
+  const std::string expected = fptu::to_json(ro);
+  ASSERT_LT(1024u, expected.size());
+
+  std::vector<char> buffer(expected.size() + 1);
+  size_t length = 0;
+  EXPECT_EQ(FPTU_OK, fptu_tuple2json_buffer(ro, buffer.data(), buffer.size(),
+                                            &length, nullptr, nullptr,
+                                            nullptr, 0));
+  EXPECT_EQ(expected.size(), length);
+  EXPECT_EQ(expected, std::string(buffer.data()));
+
+  /* при нехватке места выдается полный размер */
+  for (size_t bytes = 1; bytes < 1000; bytes += 111) {
+    length = 0;
+    EXPECT_EQ(FPTU_ENOSPACE, fptu_tuple2json_buffer(ro, buffer.data(), bytes,
+                                                    &length, nullptr, nullptr,
+                                                    nullptr, 0));
+    EXPECT_EQ(expected.size(), length);
+  }
+  EXPECT_EQ(FPTU_EINVAL, fptu_tuple2json_buffer(ro, buffer.data(), 0, &length,
+                                                nullptr, nullptr, nullptr, 0));
+
+  /* ошибка приемника прерывает вывод */
+  std::string output;
+  EXPECT_EQ(FPTU_ENOSPACE, fptu_tuple2json(ro, emit_limited, &output, nullptr,
+                                           nullptr, nullptr, 0));
+  EXPECT_GE(600u, output.size());
+  EXPECT_EQ(0u, expected.find(output));
+  EXPECT_EQ(FPTU_EINVAL,
+            fptu_tuple2json(ro, nullptr, nullptr, nullptr, nullptr, nullptr,
+                            0));
+}
+
+//----------------------------------------------------------------------------
+
+struct json_column {
+  const char *name;
+  uint16_t tag;
+};
+
+static const json_column json_schema[] = {
+    {"u16", fptu_uint16 | 1 << fptu_co_shift},
+    {"i32", fptu_int32 | 2 << fptu_co_shift},
+    {"u32", fptu_uint32 | 3 << fptu_co_shift},
+    {"i64", fptu_int64 | 4 << fptu_co_shift},
+    {"u64", fptu_uint64 | 5 << fptu_co_shift},
+    {"f32", fptu_fp32 | 6 << fptu_co_shift},
+    {"f64", fptu_fp64 | 7 << fptu_co_shift},
+    {"when", fptu_datetime | 8 << fptu_co_shift},
+    {"b96", fptu_96 | 9 << fptu_co_shift},
+    {"b256", fptu_256 | 10 << fptu_co_shift},
+    {"str", fptu_cstr | 11 << fptu_co_shift},
+    {"blob", fptu_opaque | 12 << fptu_co_shift},
+    {"sub", fptu_nested | 13 << fptu_co_shift},
+    {"none", fptu_null | 14 << fptu_co_shift}};
+
+static const char *json_tag2name(const void *schema_ctx, uint_fast16_t tag) {
+  (void)schema_ctx;
+  for (const json_column &column : json_schema)
+    if (column.tag == tag)
+      return column.name;
+  return nullptr;
+}
+
+static int json_name2tag(const void *schema_ctx, const char *name,
+                         size_t length) {
+  (void)schema_ctx;
+  for (const json_column &column : json_schema)
+    if (strlen(column.name) == length && !memcmp(column.name, name, length))
+      return column.tag;
+  return -1;
+}
+
+/* Разбирает JSON в буфер по оценке fptu_json_estimate(). */
+static int json_parse(std::vector<char> &space, const std::string &json,
+                      fptu_rw *&pt, unsigned options = fptu_json_default) {
+  size_t items, data_bytes;
+  int rc = fptu_json_estimate(json.data(), json.size(), &items, &data_bytes);
+  if (rc != FPTU_OK)
+    return rc;
+  space.resize(fptu_space(items, data_bytes));
+  pt = fptu_init(space.data(), space.size(), items);
+  if (!pt)
+    return FPTU_ENOSPACE;
+  return fptu_json2tuple(pt, json.data(), json.size(), json_name2tag, nullptr,
+                         nullptr, options);
+}
+
+TEST(Json, Parse) {
+  char nested_space[fptu_buffer_enough];
+  fptu_rw *nested = fptu_init(nested_space, sizeof(nested_space), 8);
+  ASSERT_NE(nullptr, nested);
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(nested, 11, "inner \"\\\n"));
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint32(nested, 3, 42));
+
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint16(pt, 1, 65535));
+  EXPECT_EQ(FPTU_OK, fptu_insert_int32(pt, 2, INT32_MIN));
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint32(pt, 3, UINT32_MAX));
+  EXPECT_EQ(FPTU_OK, fptu_insert_int64(pt, 4, INT64_MIN));
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint64(pt, 5, UINT64_MAX));
+  EXPECT_EQ(FPTU_OK, fptu_insert_fp32(pt, 6, 0.1f));
+  EXPECT_EQ(FPTU_OK, fptu_insert_fp64(pt, 7, -1.5e-300));
+  EXPECT_EQ(FPTU_OK, fptu_insert_fp64(pt, 7, 1e21));
+  fptu_time when;
+  when.fixedpoint = (UINT64_C(1490013296) << 32) | (UINT64_C(1) << 31);
+  EXPECT_EQ(FPTU_OK, fptu_insert_datetime(pt, 8, when));
+  uint8_t bin[32];
+  for (unsigned i = 0; i < sizeof(bin); ++i)
+    bin[i] = (uint8_t)(i * 37);
+  EXPECT_EQ(FPTU_OK, fptu_insert_96(pt, 9, bin));
+  EXPECT_EQ(FPTU_OK, fptu_insert_256(pt, 10, bin));
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(pt, 11, ""));
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(pt, 11, "\xd0\xaf \x01\t"));
+  EXPECT_EQ(FPTU_OK, fptu_insert_opaque(pt, 12, bin, 7));
+  EXPECT_EQ(FPTU_OK, fptu_insert_nested(pt, 13, fptu_take(nested)));
+  EXPECT_EQ(FPTU_OK, fptu_insert_nested(pt, 13, fptu_take(nested)));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_null(pt, 14));
+  const fptu_ro origin = fptu_take(pt);
+
+  /* обратное преобразование с той же схемой */
+  const std::string json = fptu::to_json(origin, json_tag2name);
+  std::vector<char> buffer;
+  fptu_rw *parsed = nullptr;
+  ASSERT_EQ(FPTU_OK, json_parse(buffer, json, parsed)) << json;
+  EXPECT_EQ(fptu_eq, fptu_cmp_tuples(origin, fptu_take(parsed))) << json;
+  EXPECT_EQ(json, fptu::to_json(fptu_take(parsed), json_tag2name));
+
+  /* без схемы по номерам колонок с выводом типов */
+  const std::string untyped =
+      " {\"1\" : \"abc\", \"2\":[1, -2, 3.5, 18446744073709551615],\n"
+      "\t\"3\":{\"4\":true,\"5\":[]}, \"5\":null, \"1022\":1e400}";
+  ASSERT_EQ(FPTU_OK, json_parse(buffer, untyped, parsed));
+  const fptu_ro ro = fptu_take(parsed);
+  EXPECT_EQ(7u, fptu_field_count_ro(ro, 2, fptu_any) +
+                    fptu_field_count_ro(ro, 1, fptu_any) +
+                    fptu_field_count_ro(ro, 3, fptu_any) +
+                    fptu_field_count_ro(ro, 5, fptu_any));
+  EXPECT_STREQ("abc", fptu_field_cstr(fptu_lookup_ro(ro, 1, fptu_cstr)));
+  EXPECT_EQ(2u, fptu_field_count_ro(ro, 2, fptu_int64));
+  EXPECT_EQ(1u, fptu_field_count_ro(ro, 2, fptu_fp64));
+  EXPECT_EQ(UINT64_MAX,
+            fptu_field_uint64(fptu_lookup_ro(ro, 2, fptu_uint64)));
+  EXPECT_NE(nullptr, fptu_lookup_ro(ro, 5, fptu_null));
+  EXPECT_TRUE(std::isinf(fptu_field_fp64(fptu_lookup_ro(ro, 1022, fptu_fp64))));
+  const fptu_ro sub = fptu_field_nested(fptu_lookup_ro(ro, 3, fptu_nested));
+  EXPECT_EQ(1u, fptu_field_uint16(fptu_lookup_ro(sub, 4, fptu_uint16)));
+  EXPECT_EQ(1u, fptu_field_count_ro(sub, 4, fptu_any));
+
+  /* escape-последовательности в именах и значениях */
+  ASSERT_EQ(FPTU_OK,
+            json_parse(buffer,
+                       "{\"s\\u0074r\":\"\\u00e9\\ud83d\\ude00\\/\\\"\"}",
+                       parsed));
+  EXPECT_STREQ("\xc3\xa9\xf0\x9f\x98\x80/\"",
+               fptu_field_cstr(fptu_lookup_ro(fptu_take(parsed), 11,
+                                              fptu_cstr)));
+}
+
+TEST(Json, ParseNumbers) {
+  std::mt19937_64 rng(2017);
+  std::vector<char> buffer;
+  fptu_rw *parsed = nullptr;
+  for (unsigned i = 0; i < 100000; ++i) {
+    double value;
+    uint64_t bits = rng();
+    memcpy(&value, &bits, sizeof(value));
+    if (!std::isfinite(value))
+      continue;
+    const std::string json = "{\"f64\":" + fp64_json(value) + "}";
+    ASSERT_EQ(FPTU_OK, json_parse(buffer, json, parsed)) << json;
+    const double back =
+        fptu_field_fp64(fptu_lookup_ro(fptu_take(parsed), 7, fptu_fp64));
+    ASSERT_EQ(0, memcmp(&value, &back, sizeof(value))) << json;
+
+    float value32;
+    const uint32_t bits32 = (uint32_t)bits;
+    memcpy(&value32, &bits32, sizeof(value32));
+    if (!std::isfinite(value32))
+      continue;
+    const std::string json32 = "{\"f32\":" + fp32_json(value32) + "}";
+    ASSERT_EQ(FPTU_OK, json_parse(buffer, json32, parsed)) << json32;
+    const float back32 =
+        fptu_field_fp32(fptu_lookup_ro(fptu_take(parsed), 6, fptu_fp32));
+    ASSERT_EQ(0, memcmp(&value32, &back32, sizeof(value32))) << json32;
+  }
+
+  ASSERT_EQ(FPTU_OK, json_parse(buffer,
+                                "{\"f64\":[0.1,-0,1E2,123456789012345678901,"
+                                "0.30000000000000000000000000001,null]}",
+                                parsed));
+  const fptu_ro ro = fptu_take(parsed);
+  std::vector<double> values;
+  for (const fptu_field *pf = fptu_end_ro(ro); --pf >= fptu_begin_ro(ro);)
+    values.push_back(fptu_field_fp64(pf));
+  ASSERT_EQ(6u, values.size());
+  EXPECT_EQ(0.1, values[0]);
+  EXPECT_TRUE(values[1] == 0 && std::signbit(values[1]));
+  EXPECT_EQ(100.0, values[2]);
+  EXPECT_EQ(123456789012345678901.0, values[3]);
+  EXPECT_EQ(0.3, values[4]);
+  EXPECT_TRUE(std::isnan(values[5]));
+
+  /* контроль диапазона */
+  EXPECT_EQ(FPTU_OK, json_parse(buffer, "{\"u16\":65535}", parsed));
+  EXPECT_EQ(FPTU_EINVAL, json_parse(buffer, "{\"u16\":65536}", parsed));
+  EXPECT_EQ(FPTU_EINVAL, json_parse(buffer, "{\"u16\":-1}", parsed));
+  EXPECT_EQ(FPTU_OK, json_parse(buffer, "{\"i32\":-2147483648}", parsed));
+  EXPECT_EQ(FPTU_EINVAL, json_parse(buffer, "{\"i32\":2147483648}", parsed));
+  EXPECT_EQ(FPTU_EINVAL, json_parse(buffer, "{\"u32\":1.0}", parsed));
+  EXPECT_EQ(FPTU_EINVAL,
+            json_parse(buffer, "{\"i64\":9223372036854775808}", parsed));
+  EXPECT_EQ(FPTU_EINVAL,
+            json_parse(buffer, "{\"u64\":18446744073709551616}", parsed));
+  EXPECT_EQ(FPTU_OK, json_parse(buffer, "{\"u64\":-0}", parsed));
+}
+
+TEST(Json, ParseErrors) {
+  std::vector<char> buffer;
+  fptu_rw *parsed = nullptr;
+  static const char *const malformed[] = {
+      "", "[]", "{", "{}}", "{\"1\"}", "{\"1\":}", "{\"1\":1,}",
+      "{\"1\":01}", "{\"1\":1.}", "{\"1\":.5}", "{\"1\":1e}", "{\"1\":+1}",
+      "{\"1\":tru}", "{\"1\":\"\\x\"}", "{\"1\":\"\\u00\"}",
+      "{\"1\":\"\\ud800\"}", "{\"1\":\"\\u0000\"}", "{\"1\":\"\t\"}",
+      "{\"1\":[[1]]}", "{\"1\":\"abc}", "{1:1}", "{\"1\":1 \"2\":2}",
+      "{\"when\":\"2017-02-29T00:00:00Z\"}",
+      "{\"when\":\"1969-12-31T23:59:59Z\"}", "{\"b96\":\"00\"}",
+      "{\"blob\":\"abc\"}", "{\"blob\":\"zz\"}", "{\"sub\":1}",
+      "{\"none\":0}", "{\"str\":1}"};
+  for (const char *json : malformed)
+    EXPECT_EQ(FPTU_EINVAL, json_parse(buffer, json, parsed)) << json;
+
+  std::string deep;
+  for (unsigned i = 0; i < 100; ++i)
+    deep += "{\"1\":";
+  deep += "1" + std::string(100, '}');
+  EXPECT_EQ(FPTU_EINVAL, json_parse(buffer, deep, parsed));
+
+  /* политика для неизвестных имен */
+  const std::string unknown = "{\"str\":\"a\",\"x\":{\"y\":[1]},\"7\":1}";
+  EXPECT_EQ(FPTU_ENOFIELD, json_parse(buffer, unknown, parsed));
+  ASSERT_EQ(FPTU_OK,
+            json_parse(buffer, unknown, parsed, fptu_json_skip_unknown));
+  const fptu_ro ro = fptu_take(parsed);
+  EXPECT_EQ(1, fptu_end_ro(ro) - fptu_begin_ro(ro));
+  EXPECT_NE(nullptr, fptu_lookup_ro(ro, 11, fptu_cstr));
+
+  /* оценка размера является верхней границей, а при нехватке места
+   * возвращается FPTU_ENOSPACE */
+  const std::string json =
+      "{\"sub\":{\"sub\":{\"str\":\"abcdefghijklmnopq\\n\",\"u16\":[1,2]}},"
+      "\"\\u0073tr\":\"x\"}";
+  ASSERT_EQ(FPTU_OK, json_parse(buffer, json, parsed));
+  const size_t used = units2bytes(parsed->tail - parsed->head);
+  EXPECT_GE(buffer.size(), sizeof(fptu_rw) + used);
+  for (size_t bytes = sizeof(fptu_rw) + 16; bytes < buffer.size(); ++bytes) {
+    fptu_rw *pt = fptu_init(buffer.data(), bytes, 4);
+    ASSERT_NE(nullptr, pt);
+    const int rc = fptu_json2tuple(pt, json.data(), json.size(), json_name2tag,
+                                   nullptr, nullptr, 0);
+    EXPECT_TRUE(rc == FPTU_OK || rc == FPTU_ENOSPACE) << rc;
+    if (bytes < sizeof(fptu_rw) + used) {
+      EXPECT_EQ(FPTU_ENOSPACE, rc);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fptu_test.h"
+
+#ifdef _MSC_VER
+#pragma warning(push, 1)
+#endif /* _MSC_VER */
+
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+static uint16_t tag(unsigned column, fptu_type type) {
+  return (uint16_t)(type + (column << fptu_co_shift));
+}
+
+TEST(Schema, Lookup) {
+  /* много колонок, в том числе с одним номером и разными типами */
+  const unsigned count = 1000;
+  std::vector<std::string> names(count);
+  std::vector<fptu_schema_column> columns(count);
+  for (unsigned i = 0; i < count; ++i) {
+    names[i] = "column_" + std::to_string(i);
+    columns[i].name = names[i].c_str();
+    columns[i].nested = nullptr;
+    columns[i].tag = tag(i / 2, (i & 1) ? fptu_cstr : fptu_uint32);
+    columns[i].collection = false;
+  }
+
+  const size_t bytes = fptu_schema_space(columns.data(), count);
+  ASSERT_LT(0u, bytes);
+  std::vector<char> space(bytes);
+  EXPECT_EQ(nullptr,
+            fptu_schema_init(space.data(), bytes - 1, columns.data(), count));
+  fptu_schema *schema =
+      fptu_schema_init(space.data(), bytes, columns.data(), count);
+  ASSERT_NE(nullptr, schema);
+  /* имена скопированы внутрь схемы */
+  names.clear();
+
+  EXPECT_EQ(count, fptu_schema_count(schema));
+  for (unsigned i = 0; i < count; ++i) {
+    const std::string name = "column_" + std::to_string(i);
+    const fptu_schema_column *column =
+        fptu_schema_find(schema, name.data(), name.size());
+    ASSERT_NE(nullptr, column) << name;
+    EXPECT_EQ(&fptu_schema_columns(schema)[i], column);
+    EXPECT_EQ(name, column->name);
+    EXPECT_EQ(columns[i].tag,
+              fptu_schema_name2tag(schema, name.data(), name.size()));
+    EXPECT_EQ(column, fptu_schema_get(schema, columns[i].tag));
+    EXPECT_STREQ(column->name, fptu_schema_tag2name(schema, column->tag));
+  }
+
+  EXPECT_EQ(nullptr, fptu_schema_find(schema, "column_", 7));
+  EXPECT_EQ(nullptr, fptu_schema_find(schema, "column_1000", 11));
+  EXPECT_EQ(nullptr, fptu_schema_find(schema, "column_1x", 9));
+  EXPECT_EQ(-1, fptu_schema_name2tag(schema, "", 0));
+  /* имя длиннее хранимого, в том числе с нулем внутри */
+  EXPECT_EQ(nullptr, fptu_schema_find(schema, "column_1\0xyz", 12));
+  EXPECT_EQ(nullptr, fptu_schema_find(schema, "column_10000", 12));
+  EXPECT_EQ(nullptr, fptu_schema_get(schema, tag(0, fptu_int64)));
+  EXPECT_EQ(nullptr, fptu_schema_get(schema, tag(fptu_max_cols, fptu_cstr)));
+  EXPECT_EQ(nullptr, fptu_schema_tag2name(schema, tag(500, fptu_uint32)));
+}
+
+TEST(Schema, Invalid) {
+  fptu_schema_column columns[2] = {{"a", nullptr, tag(1, fptu_int32), false},
+                                   {"b", nullptr, tag(2, fptu_int32), false}};
+  fptu_schema *schema = fptu_schema_alloc(columns, 2);
+  ASSERT_NE(nullptr, schema);
+  free(schema);
+
+  EXPECT_EQ(nullptr, fptu_schema_alloc(columns, 0));
+  EXPECT_EQ(nullptr, fptu_schema_alloc(nullptr, 2));
+  EXPECT_EQ(0u, fptu_schema_space(columns, 0));
+
+  /* повтор имени */
+  columns[1].name = "a";
+  EXPECT_EQ(nullptr, fptu_schema_alloc(columns, 2));
+  columns[1].name = "b";
+
+  /* повтор тега */
+  columns[1].tag = columns[0].tag;
+  EXPECT_EQ(nullptr, fptu_schema_alloc(columns, 2));
+  columns[1].tag = tag(2, fptu_int32);
+
+  /* подсхема только для вложенных кортежей */
+  fptu_schema *nested = fptu_schema_alloc(columns, 1);
+  ASSERT_NE(nullptr, nested);
+  columns[1].nested = nested;
+  EXPECT_EQ(nullptr, fptu_schema_alloc(columns, 2));
+  free(nested);
+}
+
+static int wrapped_name2tag(const void *schema, const char *name,
+                            size_t length) {
+  return fptu_schema_name2tag(schema, name, length);
+}
+
+static const char *wrapped_tag2name(const void *schema, uint_fast16_t tag) {
+  return fptu_schema_tag2name(schema, tag);
+}
+
+static const void *wrapped_nested(const void *schema, uint_fast16_t tag) {
+  return fptu_schema_nested(schema, tag);
+}
+
+TEST(Schema, Check) {
+  fptu_schema_column inner_columns[] = {
+      {"id", nullptr, tag(1, fptu_uint32), false},
+      {"label", nullptr, tag(2, fptu_cstr), false}};
+  fptu_schema *inner = fptu_schema_alloc(inner_columns, 2);
+  ASSERT_NE(nullptr, inner);
+
+  /* во внешней схеме колонка 1 имеет другой тип и имя */
+  fptu_schema_column outer_columns[] = {
+      {"name", nullptr, tag(1, fptu_cstr), false},
+      {"tags", nullptr, tag(2, fptu_cstr), true},
+      {"item", inner, tag(3, fptu_nested), true}};
+  fptu_schema *outer = fptu_schema_alloc(outer_columns, 3);
+  ASSERT_NE(nullptr, outer);
+
+  char nested_space[fptu_buffer_enough];
+  fptu_rw *nested = fptu_init(nested_space, sizeof(nested_space), 8);
+  ASSERT_NE(nullptr, nested);
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint32(nested, 1, 42));
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(nested, 2, "answer"));
+
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+  EXPECT_EQ(FPTU_OK, fptu_schema_check_field(outer, tag(1, fptu_cstr)));
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(pt, 1, "outer"));
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(pt, 2, "x"));
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(pt, 2, "y"));
+  EXPECT_EQ(FPTU_OK, fptu_insert_nested(pt, 3, fptu_take(nested)));
+  EXPECT_EQ(FPTU_OK, fptu_insert_nested(pt, 3, fptu_take(nested)));
+  EXPECT_EQ(FPTU_OK, fptu_schema_check(outer, fptu_take(pt)));
+
+  /* имена вложенных кортежей берутся из подсхемы */
+  const std::string json =
+      fptu::to_json(fptu_take(pt), fptu_schema_tag2name, fptu_schema_nested,
+                    outer);
+  EXPECT_EQ("{\"name\":\"outer\",\"tags\":[\"x\",\"y\"],"
+            "\"item\":[{\"id\":42,\"label\":\"answer\"},"
+            "{\"id\":42,\"label\":\"answer\"}]}",
+            json);
+  char parsed_space[fptu_buffer_enough];
+  fptu_rw *parsed =
+      fptu_init(parsed_space, sizeof(parsed_space), fptu_max_fields);
+  ASSERT_NE(nullptr, parsed);
+  EXPECT_EQ(FPTU_OK, fptu_json2tuple(parsed, json.data(), json.size(),
+                                     fptu_schema_name2tag, fptu_schema_nested,
+                                     outer, 0));
+  EXPECT_EQ(fptu_eq, fptu_cmp_tuples(fptu_take(pt), fptu_take(parsed)));
+
+  /* подсхемы доступны и через обертки над функциями схемы */
+  EXPECT_EQ(json, fptu::to_json(fptu_take(pt), wrapped_tag2name,
+                                wrapped_nested, outer));
+  parsed = fptu_init(parsed_space, sizeof(parsed_space), fptu_max_fields);
+  ASSERT_NE(nullptr, parsed);
+  EXPECT_EQ(FPTU_OK,
+            fptu_json2tuple(parsed, json.data(), json.size(), wrapped_name2tag,
+                            wrapped_nested, outer, 0));
+  EXPECT_EQ(fptu_eq, fptu_cmp_tuples(fptu_take(pt), fptu_take(parsed)));
+
+  /* нарушения схемы */
+  EXPECT_EQ(FPTU_ENOFIELD, fptu_schema_check_field(outer, tag(1, fptu_int32)));
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(pt, 1, "again"));
+  EXPECT_EQ(FPTU_EINVAL, fptu_schema_check(outer, fptu_take(pt)));
+  EXPECT_EQ(1, fptu_erase(pt, 1, fptu_cstr));
+  EXPECT_EQ(FPTU_OK, fptu_schema_check(outer, fptu_take_noshrink(pt)));
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(nested, 3, "unknown"));
+  EXPECT_EQ(FPTU_OK, fptu_insert_nested(pt, 3, fptu_take(nested)));
+  EXPECT_EQ(FPTU_ENOFIELD, fptu_schema_check(outer, fptu_take(pt)));
+
+  free(outer);
+  free(inner);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fptu_test.h"
+
+/* генерируется утилитой fptu_gen из 14codegen.fptu */
+#include "test/14codegen.h"
+
+static_assert(codegen::person::fields::age::tag ==
+                  ((2 << fptu_co_shift) | fptu_uint16),
+              "tag must be a compile-time constant");
+
+TEST(Codegen, Accessors) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+  codegen::person::rw person(pt);
+
+  EXPECT_FALSE(person.view().has_name());
+  int error = FPTU_OK;
+  EXPECT_EQ(FPTU_DENIL_UINT16, person.view().age(&error));
+  EXPECT_EQ(FPTU_ENOFIELD, error);
+
+  EXPECT_EQ(FPTU_OK, person.set_name("Ivan"));
+  EXPECT_EQ(FPTU_OK, person.set_age(42));
+  EXPECT_EQ(FPTU_OK, person.set_balance(-1.5));
+  EXPECT_EQ(FPTU_OK, person.set_id(INT64_MIN + 1));
+  const fptu_time born = {UINT64_C(0x5A5A5A5A12345678)};
+  EXPECT_EQ(FPTU_OK, person.set_born(born));
+  EXPECT_EQ(FPTU_OK, person.set_photo("\1\2\3", 3));
+  EXPECT_EQ(FPTU_OK, person.add_phone("+7 111"));
+  EXPECT_EQ(FPTU_OK, person.add_phone("+7 222"));
+  EXPECT_EQ(FPTU_OK, person.set_vip());
+
+  char nested_space[fptu_buffer_enough];
+  fptu_rw *nested = fptu_init(nested_space, sizeof(nested_space), 8);
+  ASSERT_NE(nullptr, nested);
+  codegen::address::rw address(nested);
+  const uint8_t location[16] = {1, 2, 3, 4, 5, 6, 7, 8,
+                                9, 10, 11, 12, 13, 14, 15, 16};
+  EXPECT_EQ(FPTU_OK, address.set_city("Moscow"));
+  EXPECT_EQ(FPTU_OK, address.set_zip(123456));
+  EXPECT_EQ(FPTU_OK, address.set_location(location));
+  EXPECT_EQ(FPTU_OK, person.set_home(fptu_take(nested)));
+  EXPECT_STREQ(nullptr, fptu_check(pt));
+
+  const codegen::person::ro view(fptu_take(pt));
+  EXPECT_STREQ("Ivan", view.name(&error));
+  EXPECT_EQ(FPTU_OK, error);
+  EXPECT_EQ(42u, view.age());
+  EXPECT_EQ(-1.5, view.balance());
+  EXPECT_EQ(INT64_MIN + 1, view.id());
+  EXPECT_EQ(born.fixedpoint, view.born().fixedpoint);
+  EXPECT_EQ(3u, view.photo().iov_len);
+  EXPECT_EQ(0, memcmp("\1\2\3", view.photo().iov_base, 3));
+  EXPECT_EQ(2u, fptu_field_count_ro(view.tuple(), 6, fptu_cstr));
+  EXPECT_EQ('+', view.phone()[0]);
+  EXPECT_TRUE(view.has_vip());
+  EXPECT_FALSE(view.has_archive());
+  EXPECT_EQ(FPTU_OK, fptu_schema_check(codegen::person::schema(),
+                                       view.tuple()));
+
+  /* та же колонка с другим типом не видна */
+  EXPECT_EQ(view.balance(), fptu_get_fp64(view.tuple(), 3, nullptr));
+  EXPECT_EQ(view.id(), fptu_get_int64(view.tuple(), 3, nullptr));
+
+  EXPECT_TRUE(view.has_home());
+  EXPECT_STREQ("Moscow", view.home().city());
+  EXPECT_EQ(123456u, view.home().zip());
+  EXPECT_EQ(0, memcmp(location, view.home().location(), 16));
+
+  EXPECT_EQ(1, person.erase_vip());
+  EXPECT_EQ(2, person.erase_phone());
+  EXPECT_EQ(0, person.erase_phone());
+  EXPECT_FALSE(person.view().has_vip());
+  EXPECT_EQ(nullptr, codegen::person::fields::phone::lookup(pt));
+}
+
+TEST(Codegen, Schema) {
+  const fptu_schema *schema = codegen::person::schema();
+  ASSERT_NE(nullptr, schema);
+  EXPECT_EQ(schema, codegen::person::schema());
+  EXPECT_EQ(10u, fptu_schema_count(schema));
+
+  const fptu_schema_column *phone = fptu_schema_find(schema, "phone", 5);
+  ASSERT_NE(nullptr, phone);
+  EXPECT_EQ(codegen::person::fields::phone::tag, phone->tag);
+  EXPECT_TRUE(phone->collection);
+
+  const fptu_schema_column *home = fptu_schema_find(schema, "home", 4);
+  ASSERT_NE(nullptr, home);
+  EXPECT_EQ(codegen::address::schema(), home->nested);
+  EXPECT_FALSE(home->collection);
+
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+  const char json[] = "{\"name\":\"Petr\",\"phone\":[\"1\",\"2\"],"
+                      "\"home\":{\"city\":\"Tver\",\"zip\":170000}}";
+  EXPECT_EQ(FPTU_OK, fptu_json2tuple(pt, json, sizeof(json) - 1,
+                                     fptu_schema_name2tag, fptu_schema_nested,
+                                     schema, 0));
+  const codegen::person::ro view(fptu_take(pt));
+  EXPECT_STREQ("Petr", view.name());
+  EXPECT_STREQ("Tver", view.home().city());
+  EXPECT_EQ(170000u, view.home().zip());
+  EXPECT_EQ(json, fptu::to_json(view.tuple(), fptu_schema_tag2name,
+                                fptu_schema_nested, schema));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fptu_test.h"
+
+static uint_fast16_t tag(unsigned column, fptu_type type) {
+  return (uint_fast16_t)((column << fptu_co_shift) | type);
+}
+
+/* Аллокатор со счетчиком выделенных юнитов */
+template <typename T> struct counting_allocator : public std::allocator<T> {
+  typedef T value_type;
+  size_t *counter;
+
+  template <typename U> struct rebind {
+    typedef counting_allocator<U> other;
+  };
+  explicit counting_allocator(size_t *counter) : counter(counter) {}
+  template <typename U>
+  counting_allocator(const counting_allocator<U> &other)
+      : counter(other.counter) {}
+
+  T *allocate(size_t n) {
+    *counter += n;
+    return std::allocator<T>::allocate(n);
+  }
+  void deallocate(T *p, size_t n) {
+    *counter -= n;
+    std::allocator<T>::deallocate(p, n);
+  }
+};
+
+TEST(Tuple, GetSet) {
+  fptu::tuple_rw rw;
+  ASSERT_TRUE(rw.valid());
+  EXPECT_FALSE(rw.has(tag(1, fptu_uint32)));
+  int error = FPTU_OK;
+  EXPECT_EQ(0u, rw.get<unsigned>(tag(1, fptu_uint32), &error));
+  EXPECT_EQ(FPTU_ENOFIELD, error);
+
+  EXPECT_EQ(FPTU_OK, rw.set(tag(1, fptu_uint32), 42u));
+  EXPECT_EQ(FPTU_OK, rw.set(tag(2, fptu_uint16), 65535));
+  EXPECT_EQ(FPTU_OK, rw.set(tag(3, fptu_int64), INT64_C(-1234567890123)));
+  EXPECT_EQ(FPTU_OK, rw.set(tag(4, fptu_fp32), 0.0));
+  EXPECT_EQ(FPTU_OK, rw.set(tag(5, fptu_fp64), -0.5));
+  EXPECT_EQ(FPTU_OK, rw.set(tag(6, fptu_cstr), "cstr"));
+  EXPECT_EQ(FPTU_OK, rw.set(tag(7, fptu_cstr), std::string("string")));
+  const fptu_time now = fptu_now_fine();
+  EXPECT_EQ(FPTU_OK, rw.set(tag(8, fptu_datetime), now));
+  struct iovec opaque = {(void *)"\0\1\2", 3};
+  EXPECT_EQ(FPTU_OK, rw.set(tag(9, fptu_opaque), opaque));
+  /* тип значения не соответствует тегу */
+  EXPECT_EQ(FPTU_EINVAL, rw.set(tag(10, fptu_cstr), 1));
+  EXPECT_EQ(FPTU_EINVAL, rw.set(tag(10, fptu_uint32), "1"));
+  EXPECT_STREQ(nullptr, rw.check());
+
+  EXPECT_EQ(42u, rw.get<unsigned>(tag(1, fptu_uint32), &error));
+  EXPECT_EQ(FPTU_OK, error);
+  EXPECT_EQ(42.0, rw.get<double>(tag(1, fptu_uint32)));
+  EXPECT_EQ(65535, rw.get<int>(tag(2, fptu_uint16)));
+  EXPECT_EQ(INT64_C(-1234567890123), rw.get<int64_t>(tag(3, fptu_int64)));
+  EXPECT_EQ(0.0f, rw.get<float>(tag(4, fptu_fp32)));
+  EXPECT_EQ(-0.5, rw.get<double>(tag(5, fptu_fp64)));
+  EXPECT_STREQ("cstr", rw.get<const char *>(tag(6, fptu_cstr)));
+  EXPECT_EQ("string", rw.get<std::string>(tag(7, fptu_cstr)));
+  EXPECT_EQ(now.fixedpoint,
+            rw.get<fptu_time>(tag(8, fptu_datetime)).fixedpoint);
+  EXPECT_EQ(3u, rw.get<struct iovec>(tag(9, fptu_opaque)).iov_len);
+
+  /* обновление не добавляет поля */
+  EXPECT_EQ(FPTU_OK, rw.set(tag(1, fptu_uint32), 43u));
+  EXPECT_EQ(43u, rw.get<unsigned>(tag(1, fptu_uint32)));
+  EXPECT_EQ(1u, fptu_field_count(rw.rw(), 1, fptu_uint32));
+
+  /* коллекция */
+  EXPECT_EQ(FPTU_OK, rw.insert(tag(11, fptu_int32), -1));
+  EXPECT_EQ(FPTU_OK, rw.insert(tag(11, fptu_int32), -2));
+  EXPECT_EQ(FPTU_OK, rw.insert(tag(11, fptu_cstr), "x"));
+  EXPECT_EQ(2, rw.erase(tag(11, fptu_int32)));
+  EXPECT_EQ(0, rw.erase(tag(11, fptu_int32)));
+  EXPECT_TRUE(rw.has(tag(11, fptu_cstr)));
+
+  /* представление для чтения */
+  const fptu::tuple_ro ro = rw.take();
+  EXPECT_STREQ(nullptr, ro.check());
+  EXPECT_EQ(43u, ro.get<unsigned>(tag(1, fptu_uint32)));
+  EXPECT_EQ("string", ro.get<std::string>(tag(7, fptu_cstr)));
+  EXPECT_FALSE(ro.has(tag(1, fptu_int32)));
+  EXPECT_EQ(std::string(), ro.get<std::string>(tag(1, fptu_cstr), &error));
+  EXPECT_EQ(FPTU_ENOFIELD, error);
+  /* тип поля не приводится к T */
+  EXPECT_EQ(0u, ro.get<unsigned>(tag(7, fptu_cstr), &error));
+  EXPECT_EQ(FPTU_EINVAL, error);
+  EXPECT_EQ(std::string(), ro.get<std::string>(tag(1, fptu_uint32), &error));
+  EXPECT_EQ(FPTU_EINVAL, error);
+  EXPECT_EQ(43u, ro.get<unsigned>(tag(1, fptu_uint32), &error));
+  EXPECT_EQ(FPTU_SUCCESS, error);
+  size_t count = 0;
+  for (const fptu_field &field : ro)
+    count += ct_is_dead(field.ct) ? 0 : 1;
+  EXPECT_EQ(10u, count);
+
+  /* копия из сериализованной формы */
+  fptu::tuple_rw copy(ro.ro());
+  ASSERT_TRUE(copy.valid());
+  EXPECT_EQ(fptu_eq, fptu_cmp_tuples(ro, copy.take()));
+  EXPECT_EQ(FPTU_OK, copy.set(tag(12, fptu_nested), ro.ro()));
+  EXPECT_EQ(43u, fptu::tuple_ro(copy.get<fptu_ro>(tag(12, fptu_nested)))
+                     .get<unsigned>(tag(1, fptu_uint32)));
+}
+
+TEST(Tuple, Invalid) {
+  /* источник для копирования некорректен, размер не соответствует
+   * заголовку */
+  fptu_unit units[2];
+  memset(units, 0, sizeof(units));
+  fptu_ro bad;
+  bad.units = units;
+  bad.total_bytes = sizeof(units);
+  fptu::tuple_rw rw(bad);
+  ASSERT_FALSE(rw.valid());
+  EXPECT_EQ(FPTU_EINVAL, rw.set(tag(1, fptu_uint32), 42u));
+  EXPECT_EQ(FPTU_EINVAL, rw.insert(tag(2, fptu_cstr), "string"));
+  EXPECT_EQ(-FPTU_EINVAL, rw.erase(tag(1, fptu_uint32)));
+  EXPECT_FALSE(rw.reserve(1, 1));
+  EXPECT_FALSE(rw.shrink());
+  EXPECT_EQ(0u, rw.take().size());
+  EXPECT_EQ(0u, rw.take_noshrink().size());
+  EXPECT_FALSE(rw.has(tag(1, fptu_uint32)));
+  int error = FPTU_OK;
+  EXPECT_EQ(0u, rw.get<unsigned>(tag(1, fptu_uint32), &error));
+  EXPECT_EQ(FPTU_ENOFIELD, error);
+}
+
+TEST(Tuple, Grow) {
+  size_t allocated = 0;
+  {
+    typedef fptu::basic_tuple_rw<counting_allocator<char>> tuple_rw;
+    tuple_rw rw(1, 0, counting_allocator<char>(&allocated));
+    ASSERT_TRUE(rw.valid());
+    EXPECT_EQ(rw.capacity(), allocated * fptu_unit_size);
+    const size_t initial = rw.capacity();
+
+    for (unsigned i = 0; i < 500; ++i)
+      ASSERT_EQ(FPTU_OK, rw.insert(tag(i % 100, fptu_uint64), i));
+    const std::string big(60000, 'x');
+    ASSERT_EQ(FPTU_OK, rw.set(tag(100, fptu_cstr), big));
+    EXPECT_LT(initial, rw.capacity());
+    EXPECT_EQ(rw.capacity(), allocated * fptu_unit_size);
+    EXPECT_STREQ(nullptr, rw.check());
+    EXPECT_EQ(big, rw.get<std::string>(tag(100, fptu_cstr)));
+    EXPECT_EQ(5u, fptu_field_count(rw.rw(), 7, fptu_uint64));
+
+    /* предельный размер кортежа */
+    int rc;
+    unsigned n = 0;
+    while ((rc = rw.insert(tag(101, fptu_cstr), big)) == FPTU_OK)
+      ++n;
+    EXPECT_EQ(FPTU_ENOSPACE, rc);
+    EXPECT_EQ(fptu_max_tuple_bytes / big.size() - 1, n);
+    EXPECT_STREQ(nullptr, rw.check());
+    EXPECT_FALSE(rw.reserve(fptu_max_fields + 1, 0));
+    EXPECT_TRUE(rw.reserve(10, 1000));
+    EXPECT_LE(10u, fptu_space4items(rw.rw()));
+    EXPECT_LE(1000u, fptu_space4data(rw.rw()));
+
+    /* перемещение */
+    tuple_rw moved(std::move(rw));
+    EXPECT_FALSE(rw.valid());
+    EXPECT_EQ(nullptr, rw.take().data());
+    EXPECT_EQ(0u, rw.take_noshrink().size());
+    EXPECT_FALSE(rw.shrink());
+    EXPECT_EQ(FPTU_EINVAL, rw.set(tag(1, fptu_uint32), 1u));
+    EXPECT_TRUE(moved.valid());
+    EXPECT_EQ(big, moved.get<std::string>(tag(100, fptu_cstr)));
+    tuple_rw other(1, 0, counting_allocator<char>(&allocated));
+    other = std::move(moved);
+    EXPECT_EQ(big, other.get<std::string>(tag(100, fptu_cstr)));
+    EXPECT_EQ(other.capacity() + moved.capacity(),
+              allocated * fptu_unit_size);
+  }
+  EXPECT_EQ(0u, allocated);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fptu_test.h"
+
+#include "fast_positive/tuples_inline.h"
+
+#include <vector>
+
+TEST(Inline, Lookup) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+
+  /* совпадающие колонки с разными типами и повторы */
+  for (unsigned col = 0; col < 42; ++col) {
+    ASSERT_EQ(FPTU_OK, fptu_insert_uint32(pt, col, col));
+    ASSERT_EQ(FPTU_OK, fptu_insert_int64(pt, col, -(int64_t)col));
+    ASSERT_EQ(FPTU_OK, fptu_insert_uint32(pt, col, col + 1));
+  }
+  ASSERT_EQ(1, fptu_erase(pt, 7, fptu_int64));
+  const fptu_ro ro = fptu_take_noshrink(pt);
+
+  for (unsigned col = 0; col < 45; ++col) {
+    EXPECT_EQ(fptu_lookup_ro(ro, col, fptu_uint32),
+              fptu_inline_lookup_ro(ro, col, fptu_uint32));
+    EXPECT_EQ(fptu_lookup_ro(ro, col, fptu_int64),
+              fptu_inline_lookup_ro(ro, col, fptu_int64));
+    EXPECT_EQ(fptu_lookup_ro(ro, col, fptu_any_int),
+              fptu_inline_lookup_ro(ro, col, fptu_any_int));
+    EXPECT_EQ(fptu_lookup_ro(ro, col, fptu_any),
+              fptu_inline_lookup_ro(ro, col, fptu_any));
+  }
+  EXPECT_EQ(nullptr, fptu_inline_lookup_ro(ro, fptu_max_cols + 1, fptu_any));
+
+  /* поврежденный или пустой кортеж */
+  fptu_ro bad = ro;
+  bad.total_bytes -= fptu_unit_size;
+  EXPECT_EQ(nullptr, fptu_inline_lookup_ro(bad, 1, fptu_uint32));
+  bad.total_bytes = 0;
+  EXPECT_EQ(nullptr, fptu_inline_lookup_ro(bad, 1, fptu_uint32));
+}
+
+TEST(Inline, LookupHint) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+
+  for (unsigned col = 0; col < 16; ++col) {
+    ASSERT_EQ(FPTU_OK, fptu_insert_uint32(pt, col, col));
+    ASSERT_EQ(FPTU_OK, fptu_insert_cstr(pt, col, "x"));
+  }
+  const fptu_ro ro = fptu_take_noshrink(pt);
+
+  /* подсказки от кортежа той же формы */
+  std::vector<unsigned> hints(16, 0), inline_hints(16, ~0u);
+  for (int pass = 0; pass < 2; ++pass) {
+    for (unsigned col = 0; col < 16; ++col) {
+      const fptu_field *pf = fptu_lookup_ro(ro, col, fptu_uint32);
+      EXPECT_EQ(pf, fptu_lookup_ro_hint(ro, col, fptu_uint32, &hints[col]));
+      EXPECT_EQ(pf, fptu_inline_lookup_ro_hint(ro, col, fptu_uint32,
+                                               &inline_hints[col]));
+      EXPECT_EQ(pf, &fptu_begin_ro(ro)[hints[col]]);
+      EXPECT_EQ(hints[col], inline_hints[col]);
+    }
+  }
+
+  /* подсказка для другого поля или вне кортежа */
+  unsigned hint = hints[3];
+  EXPECT_EQ(fptu_lookup_ro(ro, 5, fptu_any_number),
+            fptu_lookup_ro_hint(ro, 5, fptu_any_number, &hint));
+  EXPECT_EQ(hints[5], hint);
+  EXPECT_EQ(fptu_lookup_ro(ro, 5, fptu_cstr),
+            fptu_inline_lookup_ro_hint(ro, 5, fptu_cstr, &hint));
+  EXPECT_NE(hints[5], hint);
+  hint = fptu_max_fields;
+  EXPECT_EQ(fptu_lookup_ro(ro, 7, fptu_uint32),
+            fptu_lookup_ro_hint(ro, 7, fptu_uint32, &hint));
+  EXPECT_EQ(hints[7], hint);
+
+  /* при отсутствии поля подсказка сохраняется */
+  EXPECT_EQ(nullptr, fptu_lookup_ro_hint(ro, 7, fptu_int64, &hint));
+  EXPECT_EQ(nullptr, fptu_inline_lookup_ro_hint(ro, 42, fptu_uint32, &hint));
+  EXPECT_EQ(nullptr, fptu_lookup_ro_hint(ro, fptu_max_cols + 1, fptu_any,
+                                         &hint));
+  EXPECT_EQ(hints[7], hint);
+
+  /* подсказка указывает на удаленное поле */
+  ASSERT_EQ(1, fptu_erase(pt, 7, fptu_uint32));
+  EXPECT_EQ(nullptr,
+            fptu_lookup_ro_hint(fptu_take_noshrink(pt), 7, fptu_uint32, &hint));
+  ASSERT_EQ(FPTU_OK, fptu_insert_uint32(pt, 7, 77));
+  const fptu_ro changed = fptu_take_noshrink(pt);
+  EXPECT_EQ(fptu_lookup_ro(changed, 7, fptu_uint32),
+            fptu_lookup_ro_hint(changed, 7, fptu_uint32, &hint));
+  EXPECT_EQ(77u, fptu_get_uint32(changed, 7, nullptr));
+}
+
+TEST(Inline, Get) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+
+  const uint8_t bin[32] = {1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11,
+                           12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22,
+                           23, 24, 25, 26, 27, 28, 29, 30, 31, 32};
+  const fptu_time now = fptu_now_fine();
+  char nested_space[fptu_buffer_enough];
+  fptu_rw *nested = fptu_init(nested_space, sizeof(nested_space), 8);
+  ASSERT_NE(nullptr, nested);
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(nested, 1, "nested"));
+
+  EXPECT_EQ(FPTU_OK, fptu_upsert_uint16(pt, 1, 0xBEEF));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_int32(pt, 2, -42));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_uint32(pt, 3, 42));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_int64(pt, 4, INT64_MIN + 1));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_uint64(pt, 5, UINT64_MAX - 1));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_fp32(pt, 6, 0.5f));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_fp64(pt, 7, -0.25));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_datetime(pt, 8, now));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_96(pt, 9, bin));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_128(pt, 10, bin));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_160(pt, 11, bin));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_256(pt, 12, bin));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_cstr(pt, 13, "string"));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_opaque(pt, 14, bin, 5));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_nested(pt, 15, fptu_take(nested)));
+  const fptu_ro ro = fptu_take(pt);
+
+  int error = FPTU_ENOFIELD;
+  EXPECT_EQ(0xBEEFu, fptu_inline_get_uint16(ro, 1, &error));
+  EXPECT_EQ(FPTU_OK, error);
+  EXPECT_EQ(-42, fptu_inline_get_int32(ro, 2, nullptr));
+  EXPECT_EQ(42u, fptu_inline_get_uint32(ro, 3, nullptr));
+  EXPECT_EQ(INT64_MIN + 1, fptu_inline_get_int64(ro, 4, nullptr));
+  EXPECT_EQ(UINT64_MAX - 1, fptu_inline_get_uint64(ro, 5, nullptr));
+  EXPECT_EQ(0.5f, fptu_inline_get_fp32(ro, 6, nullptr));
+  EXPECT_EQ(-0.25, fptu_inline_get_fp64(ro, 7, nullptr));
+  EXPECT_EQ(now.fixedpoint,
+            fptu_inline_get_datetime(ro, 8, nullptr).fixedpoint);
+  EXPECT_EQ(fptu_get_96(ro, 9, nullptr), fptu_inline_get_96(ro, 9, nullptr));
+  EXPECT_EQ(fptu_get_128(ro, 10, nullptr),
+            fptu_inline_get_128(ro, 10, nullptr));
+  EXPECT_EQ(fptu_get_160(ro, 11, nullptr),
+            fptu_inline_get_160(ro, 11, nullptr));
+  EXPECT_EQ(fptu_get_256(ro, 12, nullptr),
+            fptu_inline_get_256(ro, 12, nullptr));
+  EXPECT_STREQ("string", fptu_inline_get_cstr(ro, 13, nullptr));
+  const struct iovec opaque = fptu_inline_get_opaque(ro, 14, nullptr);
+  EXPECT_EQ(5u, opaque.iov_len);
+  EXPECT_EQ(fptu_get_opaque(ro, 14, nullptr).iov_base, opaque.iov_base);
+  const fptu_ro inner = fptu_inline_get_nested(ro, 15, nullptr);
+  EXPECT_EQ(fptu_get_nested(ro, 15, nullptr).units, inner.units);
+  EXPECT_EQ(fptu_get_nested(ro, 15, nullptr).total_bytes, inner.total_bytes);
+  EXPECT_STREQ("nested", fptu_inline_get_cstr(inner, 1, nullptr));
+
+  /* отсутствующие поля */
+  EXPECT_EQ(FPTU_DENIL_UINT16, fptu_inline_get_uint16(ro, 2, &error));
+  EXPECT_EQ(FPTU_ENOFIELD, error);
+  EXPECT_EQ(FPTU_DENIL_INT32, fptu_inline_get_int32(ro, 1, nullptr));
+  EXPECT_EQ(FPTU_DENIL_UINT32, fptu_inline_get_uint32(ro, 1, nullptr));
+  EXPECT_EQ(FPTU_DENIL_INT64, fptu_inline_get_int64(ro, 1, nullptr));
+  EXPECT_EQ(FPTU_DENIL_UINT64, fptu_inline_get_uint64(ro, 1, nullptr));
+  EXPECT_TRUE(std::isnan(fptu_inline_get_fp32(ro, 1, nullptr)));
+  EXPECT_TRUE(std::isnan(fptu_inline_get_fp64(ro, 1, nullptr)));
+  EXPECT_EQ(FPTU_DENIL_TIME_BIN,
+            fptu_inline_get_datetime(ro, 1, nullptr).fixedpoint);
+  EXPECT_EQ(nullptr, fptu_inline_get_96(ro, 1, nullptr));
+  EXPECT_EQ(nullptr, fptu_inline_get_cstr(ro, 1, nullptr));
+  EXPECT_EQ(0u, fptu_inline_get_opaque(ro, 1, nullptr).iov_len);
+  EXPECT_EQ(0u, fptu_inline_get_nested(ro, 1, &error).total_bytes);
+  EXPECT_EQ(FPTU_ENOFIELD, error);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fptu_test.h"
+
+#include "fast_positive/tuples_inline.h"
+
+#include <string>
+#include <vector>
+
+/* Поиск без учета карты присутствия, как в версиях без ее поддержки. */
+static const fptu_field *legacy_lookup(fptu_ro ro, uint_fast16_t ct) {
+  const fptu_field *begin = &ro.units[1].field;
+  const fptu_field *end =
+      begin + (ro.units[0].varlen.tuple_items & fptu_lt_mask);
+  for (const fptu_field *pf = begin; pf < end; ++pf)
+    if (pf->ct == ct)
+      return pf;
+  return nullptr;
+}
+
+TEST(Bloom, Lookup) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+
+  for (unsigned col = 0; col < 36; col += 3) {
+    ASSERT_EQ(FPTU_OK, fptu_insert_uint32(pt, col, col));
+    ASSERT_EQ(FPTU_OK, fptu_insert_cstr(pt, col + 1,
+                                        std::to_string(col).c_str()));
+  }
+  ASSERT_EQ(1, fptu_erase(pt, 30, fptu_uint32));
+  /* копия без карты, ибо fptu_take() затирает карту в буфере */
+  const std::string plain((const char *)fptu_take(pt).units,
+                          fptu_take(pt).total_bytes);
+  fptu_ro plain_ro;
+  plain_ro.units = (const fptu_unit *)plain.data();
+  plain_ro.total_bytes = plain.size();
+
+  const fptu_ro ro = fptu_take_bloom(pt);
+  ASSERT_STREQ(nullptr, fptu_check_ro(ro));
+  ASSERT_NE(nullptr, fptu_bloom_field(ro));
+  EXPECT_EQ(plain.size() + 12, ro.total_bytes);
+  EXPECT_EQ(plain.size() / fptu_unit_size + 2,
+            (size_t)ro.units[0].varlen.brutto);
+
+  size_t rejected = 0;
+  size_t misses = 0;
+  for (unsigned col = 0; col < 100; ++col) {
+    for (fptu_type type : {fptu_uint32, fptu_cstr, fptu_int64}) {
+      SCOPED_TRACE("col " + std::to_string(col) + ", type " +
+                   std::to_string(type));
+      const uint_fast16_t ct = (uint_fast16_t)(col << fptu_co_shift | type);
+      const fptu_field *expected = legacy_lookup(ro, ct);
+      EXPECT_EQ(expected, fptu_lookup_ro(ro, col, type));
+      EXPECT_EQ(expected, fptu_inline_lookup_ro(ro, col, type));
+      if (expected)
+        EXPECT_TRUE(fptu_bloom_test(fptu_bloom_field(ro), ct));
+      else {
+        ++misses;
+        rejected += fptu_bloom_test(fptu_bloom_field(ro), ct) ? 0 : 1;
+      }
+    }
+  }
+  /* большинство промахов отсекаются картой */
+  EXPECT_LT(misses / 2, rejected);
+  EXPECT_EQ(33u, fptu_get_uint32(ro, 33, nullptr));
+  EXPECT_EQ(nullptr, fptu_lookup_ro(ro, 30, fptu_uint32));
+  EXPECT_NE(nullptr, fptu_lookup_ro(ro, 31, fptu_any));
+
+  /* карта не является полем */
+  EXPECT_EQ(&ro.units[2].field, fptu_begin_ro(ro));
+  EXPECT_EQ(fptu_field_count_ro(ro, 0, fptu_any), 1u);
+  EXPECT_EQ(fptu_eq, fptu_cmp_tuples(ro, plain_ro));
+  EXPECT_EQ(fptu::to_json(plain_ro), fptu::to_json(ro));
+
+  /* после fptu_fetch() карты нет */
+  std::vector<char> fetched(fptu_get_buffer_size(ro, 0, 0));
+  fptu_rw *copy = fptu_fetch(ro, fetched.data(), fetched.size(), 0);
+  ASSERT_NE(nullptr, copy);
+  ASSERT_STREQ(nullptr, fptu_check(copy));
+  const fptu_ro copy_ro = fptu_take_noshrink(copy);
+  EXPECT_EQ(nullptr, fptu_bloom_field(copy_ro));
+  EXPECT_EQ(plain, std::string((const char *)copy_ro.units,
+                               copy_ro.total_bytes));
+
+  const uint16_t hot = (uint16_t)(3 << fptu_co_shift | fptu_uint32);
+  copy = fptu_fetch_hot(ro, fetched.data(), fetched.size(), 0, &hot, 1);
+  ASSERT_NE(nullptr, copy);
+  ASSERT_STREQ(nullptr, fptu_check(copy));
+  EXPECT_EQ(fptu_eq, fptu_cmp_tuples(ro, fptu_take(copy)));
+
+  /* после изменения карта перестраивается */
+  ASSERT_EQ(FPTU_OK, fptu_upsert_uint32(pt, 30, 42));
+  const fptu_ro updated = fptu_take_bloom(pt);
+  ASSERT_STREQ(nullptr, fptu_check_ro(updated));
+  EXPECT_EQ(42u, fptu_get_uint32(updated, 30, nullptr));
+}
+
+TEST(Bloom, Fallback) {
+  /* без свободного дескриптора карта не добавляется */
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), 2);
+  ASSERT_NE(nullptr, pt);
+  ASSERT_EQ(FPTU_OK, fptu_insert_uint32(pt, 1, 1));
+  EXPECT_NE(nullptr, fptu_bloom_field(fptu_take_bloom(pt)));
+  ASSERT_EQ(FPTU_OK, fptu_insert_uint32(pt, 2, 2));
+  const fptu_ro ro = fptu_take_bloom(pt);
+  EXPECT_EQ(nullptr, fptu_bloom_field(ro));
+  EXPECT_EQ(0u, ro.units[0].varlen.tuple_items & fptu_lx_mask);
+  EXPECT_STREQ(nullptr, fptu_check_ro(ro));
+
+  /* пустой кортеж с картой не содержит полей */
+  ASSERT_EQ(FPTU_OK, fptu_clear(pt));
+  const fptu_ro empty = fptu_take_bloom(pt);
+  EXPECT_STREQ(nullptr, fptu_check_ro(empty));
+  EXPECT_EQ(fptu_begin_ro(empty), fptu_end_ro(empty));
+  EXPECT_EQ(nullptr, fptu_lookup_ro(empty, 1, fptu_uint32));
+}
+
+TEST(Bloom, Check) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), 8);
+  ASSERT_NE(nullptr, pt);
+  ASSERT_EQ(FPTU_OK, fptu_insert_uint32(pt, 1, 1));
+  ASSERT_EQ(FPTU_OK, fptu_insert_cstr(pt, 2, "2"));
+  const fptu_ro ro = fptu_take_bloom(pt);
+  ASSERT_STREQ(nullptr, fptu_check_ro(ro));
+
+  fptu_field *bloom = (fptu_field *)fptu_bloom_field(ro);
+  ASSERT_NE(nullptr, bloom);
+  const uint64_t bits = fptu_field_payload(bloom)->u64;
+  fptu_field_payload(bloom)->u64 = 0;
+  EXPECT_STREQ("tuple.bloom is inconsistent", fptu_check_ro(ro));
+  fptu_field_payload(bloom)->u64 = bits;
+
+  bloom->ct = (uint16_t)(fptu_co_dead << fptu_co_shift | fptu_uint64);
+  EXPECT_STREQ("tuple.service is missing", fptu_check_ro(ro));
+  bloom->ct = fptu_bloom_ct;
+  ASSERT_STREQ(nullptr, fptu_check_ro(ro));
+
+  /* читатель без поддержки карты видит удаленное поле */
+  EXPECT_EQ(1u, fptu_field_uint32(
+                    legacy_lookup(ro, 1 << fptu_co_shift | fptu_uint32)));
+  EXPECT_STREQ("2", fptu_field_cstr(
+                        legacy_lookup(ro, 2 << fptu_co_shift | fptu_cstr)));
+  EXPECT_TRUE(ct_is_dead(ro.units[1].field.ct));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
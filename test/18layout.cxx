@@ -0,0 +1,171 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fptu_test.h"
+
+#include "fptu_test.h"
+
+#include <string>
+#include <vector>
+
+/* Шаблон записи телеметрии из полей фиксированного размера. */
+static fptu_ro make_template(fptu_rw *pt) {
+  const uint8_t zero[16] = {0};
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint16(pt, 1, 0));
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint32(pt, 2, 0));
+  EXPECT_EQ(FPTU_OK, fptu_insert_int64(pt, 3, 0));
+  EXPECT_EQ(FPTU_OK, fptu_insert_fp64(pt, 4, 0));
+  EXPECT_EQ(FPTU_OK, fptu_insert_datetime(pt, 5, fptu_now_coarse()));
+  EXPECT_EQ(FPTU_OK, fptu_insert_128(pt, 6, zero));
+  return fptu_take(pt);
+}
+
+TEST(Layout, Stamp) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), 16);
+  ASSERT_NE(nullptr, pt);
+  const fptu_ro tmpl = make_template(pt);
+  EXPECT_EQ(0u, fptu_layout_fingerprint(tmpl));
+
+  std::vector<char> image(fptu_layout_space(tmpl));
+  ASSERT_EQ(tmpl.total_bytes + 12, image.size());
+  const fptu_ro stamped = fptu_layout_stamp(tmpl, image.data(), image.size());
+  ASSERT_NE(nullptr, stamped.units);
+  ASSERT_STREQ(nullptr, fptu_check_ro(stamped));
+  const uint64_t fingerprint = fptu_layout_fingerprint(stamped);
+  EXPECT_NE(0u, fingerprint);
+
+  const size_t off_u16 = fptu_layout_offset(stamped, 1, fptu_uint16);
+  const size_t off_u32 = fptu_layout_offset(stamped, 2, fptu_uint32);
+  const size_t off_i64 = fptu_layout_offset(stamped, 3, fptu_int64);
+  const size_t off_f64 = fptu_layout_offset(stamped, 4, fptu_fp64);
+  EXPECT_NE(0u, off_u16 * off_u32 * off_i64 * off_f64);
+  EXPECT_EQ(0u, fptu_layout_offset(stamped, 2, fptu_int32));
+  EXPECT_EQ(0u, fptu_layout_offset(stamped, 7, fptu_uint32));
+  EXPECT_EQ(0u, fptu_layout_offset(stamped, 2, fptu_cstr));
+
+  /* записи формируются копированием образа и записью значений */
+  for (unsigned i = 0; i < 3; ++i) {
+    std::vector<char> record(image);
+    char *const base = record.data();
+    *(uint16_t *)(base + off_u16) = (uint16_t)(i + 1000);
+    *(uint32_t *)(base + off_u32) = i + 42;
+    *(int64_t *)(base + off_i64) = -(int64_t)i;
+    *(double *)(base + off_f64) = i / 2.0;
+    fptu_ro ro;
+    ro.units = (const fptu_unit *)base;
+    ro.total_bytes = record.size();
+
+    ASSERT_STREQ(nullptr, fptu_check_ro(ro));
+    EXPECT_EQ(fingerprint, fptu_layout_fingerprint(ro));
+    /* обычные читатели видят те же значения */
+    EXPECT_EQ(i + 1000, fptu_get_uint16(ro, 1, nullptr));
+    EXPECT_EQ(i + 42, fptu_get_uint32(ro, 2, nullptr));
+    EXPECT_EQ(-(int64_t)i, fptu_get_int64(ro, 3, nullptr));
+    EXPECT_EQ(i / 2.0, fptu_get_fp64(ro, 4, nullptr));
+    size_t count = 0;
+    for (const fptu_field *pf = fptu_begin_ro(ro); pf < fptu_end_ro(ro); ++pf)
+      count += ct_is_dead(pf->ct) ? 0 : 1;
+    EXPECT_EQ(6u, count);
+    EXPECT_EQ(&ro.units[2].field, fptu_begin_ro(ro));
+
+    /* после fptu_fetch() отпечатка нет */
+    std::vector<char> fetched(fptu_get_buffer_size(ro, 0, 0));
+    fptu_rw *copy = fptu_fetch(ro, fetched.data(), fetched.size(), 0);
+    ASSERT_NE(nullptr, copy);
+    ASSERT_STREQ(nullptr, fptu_check(copy));
+    const fptu_ro plain = fptu_take(copy);
+    EXPECT_EQ(0u, fptu_layout_fingerprint(plain));
+    EXPECT_EQ(fptu_eq, fptu_cmp_tuples(ro, plain));
+    EXPECT_EQ(fptu::to_json(plain), fptu::to_json(ro));
+    EXPECT_EQ(tmpl.total_bytes, plain.total_bytes);
+  }
+
+  /* другая раскладка дает другой отпечаток */
+  ASSERT_EQ(FPTU_OK, fptu_insert_uint32(pt, 7, 0));
+  const fptu_ro wider = fptu_take(pt);
+  std::vector<char> other(fptu_layout_space(wider));
+  const fptu_ro stamped2 = fptu_layout_stamp(wider, other.data(), other.size());
+  ASSERT_NE(nullptr, stamped2.units);
+  EXPECT_NE(fingerprint, fptu_layout_fingerprint(stamped2));
+}
+
+TEST(Layout, Invalid) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), 16);
+  ASSERT_NE(nullptr, pt);
+  std::vector<char> image(fptu_buffer_enough);
+
+  /* пустой шаблон и нехватка места */
+  fptu_ro empty;
+  empty.units = nullptr;
+  empty.total_bytes = 0;
+  EXPECT_EQ(0u, fptu_layout_space(empty));
+  EXPECT_EQ(nullptr,
+            fptu_layout_stamp(empty, image.data(), image.size()).units);
+  const fptu_ro tmpl = make_template(pt);
+  EXPECT_EQ(nullptr, fptu_layout_stamp(tmpl, image.data(),
+                                       fptu_layout_space(tmpl) - 1)
+                         .units);
+
+  /* поля переменной длины */
+  ASSERT_EQ(FPTU_OK, fptu_insert_cstr(pt, 7, "varlen"));
+  EXPECT_EQ(nullptr,
+            fptu_layout_stamp(fptu_take(pt), image.data(), image.size()).units);
+  ASSERT_EQ(1, fptu_erase(pt, 7, fptu_cstr));
+
+  /* удаленные поля и карта присутствия тегов */
+  ASSERT_EQ(1, fptu_erase(pt, 2, fptu_uint32));
+  const fptu_ro junky = fptu_take_noshrink(pt);
+  EXPECT_EQ(nullptr,
+            fptu_layout_stamp(junky, image.data(), image.size()).units);
+  const fptu_ro bloomed = fptu_take_bloom(pt);
+  EXPECT_EQ(nullptr,
+            fptu_layout_stamp(bloomed, image.data(), image.size()).units);
+
+  /* повреждение отпечатка или раскладки выявляет fptu_check_ro() */
+  const fptu_ro stamped =
+      fptu_layout_stamp(fptu_take(pt), image.data(), image.size());
+  ASSERT_NE(nullptr, stamped.units);
+  ASSERT_STREQ(nullptr, fptu_check_ro(stamped));
+  fptu_field *marker = (fptu_field *)&stamped.units[1].field;
+  fptu_field_payload(marker)->u64 ^= 1;
+  EXPECT_STREQ("tuple.layout is inconsistent", fptu_check_ro(stamped));
+  fptu_field_payload(marker)->u64 ^= 1;
+  fptu_field *first = (fptu_field *)&stamped.units[2].field;
+  first->ct ^= 1 << fptu_co_shift;
+  EXPECT_STREQ("tuple.layout is inconsistent", fptu_check_ro(stamped));
+  first->ct ^= 1 << fptu_co_shift;
+  marker->ct = (uint16_t)(fptu_co_dead << fptu_co_shift | fptu_int64);
+  EXPECT_STREQ("tuple.service is missing", fptu_check_ro(stamped));
+  EXPECT_EQ(0u, fptu_layout_fingerprint(stamped));
+
+  /* отпечаток и карта присутствия отмечаются одним битом заголовка,
+   * а различаются тегом служебного дескриптора */
+  marker->ct = fptu_layout_ct;
+  ASSERT_STREQ(nullptr, fptu_check_ro(stamped));
+  EXPECT_EQ(fptu_lx_bloom, stamped.units[0].varlen.tuple_items & fptu_lx_mask);
+  EXPECT_EQ(nullptr, fptu_bloom_field(stamped));
+  EXPECT_EQ(marker, fptu_service_field(stamped));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -20,6 +20,7 @@
 #include "fptu_test.h"
 
 #include <stdlib.h>
+#include <string>
 
 #ifdef _MSC_VER
 #pragma warning(disable : 4738) /* storing 32-bit float result in memory... */
@@ -1061,6 +1062,112 @@ TEST(Upsert, InsertUpdate) {
   free(pt);
 }
 
+TEST(Upsert, Gather) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+
+  /* фрагменты разной длины, включая пустой и некратные юниту */
+  const char blob[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+  struct iovec iov[5] = {{(void *)blob, 3},
+                         {(void *)(blob + 3), 0},
+                         {(void *)(blob + 3), 6},
+                         {(void *)(blob + 9), 1},
+                         {(void *)(blob + 10), 26}};
+  EXPECT_EQ(FPTU_OK, fptu_insert_opaque_gather(pt, 1, iov, 5));
+  EXPECT_EQ(FPTU_OK, fptu_insert_opaque_gather(pt, 0, iov, 4));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_opaque_gather(pt, 2, iov, 0));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_string_gather(pt, 3, iov, 5));
+  EXPECT_EQ(FPTU_OK, fptu_insert_string_gather(pt, 4, iov, 1));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_string_gather(pt, 5, nullptr, 0));
+  ASSERT_STREQ(nullptr, fptu_check(pt));
+
+  fptu_ro ro = fptu_take_noshrink(pt);
+  ASSERT_STREQ(nullptr, fptu_check_ro(ro));
+  EXPECT_EQ(fptu_eq, fptu_cmp_opaque(ro, 1, blob, 36));
+  EXPECT_EQ(fptu_eq, fptu_cmp_opaque(ro, 0, blob, 10));
+  EXPECT_EQ(0u, fptu_get_opaque(ro, 2, nullptr).iov_len);
+  EXPECT_STREQ(blob, fptu_get_cstr(ro, 3, nullptr));
+  EXPECT_STREQ("012", fptu_get_cstr(ro, 4, nullptr));
+  EXPECT_STREQ("", fptu_get_cstr(ro, 5, nullptr));
+
+  /* результат совпадает с вставкой из непрерывной памяти */
+  char reference_space[fptu_buffer_enough];
+  fptu_rw *reference =
+      fptu_init(reference_space, sizeof(reference_space), fptu_max_fields);
+  ASSERT_NE(nullptr, reference);
+  EXPECT_EQ(FPTU_OK, fptu_insert_opaque(reference, 1, blob, 36));
+  EXPECT_EQ(FPTU_OK, fptu_insert_opaque(reference, 0, blob, 10));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_opaque(reference, 2, nullptr, 0));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_cstr(reference, 3, blob));
+  EXPECT_EQ(FPTU_OK, fptu_insert_string(reference, 4, blob, 3));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_cstr(reference, 5, ""));
+  const fptu_ro reference_ro = fptu_take_noshrink(reference);
+  EXPECT_EQ(fptu_eq, fptu_cmp_tuples(reference_ro, ro));
+  ASSERT_EQ(reference_ro.total_bytes, ro.total_bytes);
+  EXPECT_EQ(0, memcmp(reference_ro.units, ro.units, ro.total_bytes));
+
+  /* обновление существующих полей */
+  EXPECT_EQ(FPTU_OK, fptu_update_opaque_gather(pt, 2, iov + 2, 2));
+  EXPECT_EQ(FPTU_OK, fptu_update_string_gather(pt, 5, iov + 4, 1));
+  EXPECT_EQ(FPTU_ENOFIELD, fptu_update_opaque_gather(pt, 6, iov, 1));
+  EXPECT_EQ(FPTU_ENOFIELD, fptu_update_string_gather(pt, 6, iov, 1));
+  ASSERT_STREQ(nullptr, fptu_check(pt));
+  ro = fptu_take_noshrink(pt);
+  EXPECT_EQ(fptu_eq, fptu_cmp_opaque(ro, 2, blob + 3, 7));
+  EXPECT_STREQ(blob + 10, fptu_get_cstr(ro, 5, nullptr));
+
+  /* вложенный кортеж с заголовком, разбитым между фрагментами */
+  const std::string nested((const char *)reference_ro.units,
+                           reference_ro.total_bytes);
+  struct iovec parts[3] = {{(void *)nested.data(), 1},
+                           {(void *)(nested.data() + 1), 6},
+                           {(void *)(nested.data() + 7), nested.size() - 7}};
+  EXPECT_EQ(FPTU_OK, fptu_insert_nested_gather(pt, 7, parts, 3));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_nested_gather(pt, 8, parts, 3));
+  EXPECT_EQ(FPTU_OK, fptu_update_nested_gather(pt, 8, parts, 3));
+  EXPECT_EQ(FPTU_ENOFIELD, fptu_update_nested_gather(pt, 9, parts, 3));
+  ASSERT_STREQ(nullptr, fptu_check(pt));
+  ro = fptu_take_noshrink(pt);
+  for (unsigned col = 7; col <= 8; ++col) {
+    const fptu_ro inner = fptu_get_nested(ro, col, nullptr);
+    ASSERT_EQ(nested.size(), inner.total_bytes);
+    EXPECT_EQ(0, memcmp(nested.data(), inner.units, inner.total_bytes));
+    EXPECT_EQ(fptu_eq, fptu_cmp_tuples(reference_ro, inner));
+  }
+
+  /* размер не соответствует заголовку вложенного кортежа */
+  EXPECT_EQ(FPTU_EINVAL, fptu_insert_nested_gather(pt, 9, parts, 2));
+  EXPECT_EQ(FPTU_EINVAL, fptu_upsert_nested_gather(pt, 9, parts, 1));
+  EXPECT_EQ(FPTU_EINVAL, fptu_insert_nested_gather(pt, 9, nullptr, 0));
+
+  /* ошибочные аргументы */
+  struct iovec bad[2] = {{(void *)blob, 1}, {nullptr, 1}};
+  EXPECT_EQ(FPTU_EINVAL, fptu_insert_opaque_gather(pt, 9, bad, 2));
+  EXPECT_EQ(FPTU_EINVAL, fptu_insert_string_gather(pt, 9, bad, 2));
+  EXPECT_EQ(FPTU_EINVAL, fptu_insert_opaque_gather(pt, 9, nullptr, 1));
+  EXPECT_EQ(FPTU_EINVAL,
+            fptu_insert_opaque_gather(pt, fptu_max_cols + 1, iov, 5));
+  std::string big(fptu_max_field_bytes / 2 + 1, 'x');
+  struct iovec huge[2] = {{(void *)big.data(), big.size()},
+                          {(void *)big.data(), big.size()}};
+  EXPECT_EQ(FPTU_EINVAL, fptu_insert_opaque_gather(pt, 9, huge, 2));
+  EXPECT_EQ(FPTU_EINVAL, fptu_upsert_string_gather(pt, 9, huge, 2));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_opaque_gather(pt, 9, huge, 1));
+  ASSERT_STREQ(nullptr, fptu_check(pt));
+
+  /* нехватка места обнаруживается до копирования фрагментов */
+  const size_t small_bytes = fptu_space(2, 40);
+  std::string small(small_bytes, '\0');
+  pt = fptu_init(&small[0], small_bytes, 2);
+  ASSERT_NE(nullptr, pt);
+  EXPECT_EQ(FPTU_OK, fptu_insert_opaque_gather(pt, 1, iov, 5));
+  EXPECT_EQ(FPTU_ENOSPACE, fptu_insert_opaque_gather(pt, 1, iov, 5));
+  EXPECT_EQ(FPTU_ENOSPACE, fptu_upsert_string_gather(pt, 2, iov, 5));
+  EXPECT_EQ(1u, fptu_field_count(pt, 1, fptu_opaque));
+  ASSERT_STREQ(nullptr, fptu_check(pt));
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
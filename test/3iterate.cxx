@@ -21,6 +21,12 @@
 
 #include <stdlib.h>
 
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
 static bool field_filter_any(const fptu_field *, void *context, void *param) {
   (void)context;
   (void)param;
@@ -206,6 +212,159 @@ TEST(Iterate, Filter) {
   }
 }
 
+TEST(Iterate, Range) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+
+  for (unsigned n = 0; n < 10; n++) {
+    EXPECT_EQ(FPTU_OK, fptu_insert_int32(pt, n, -(int)n));
+    EXPECT_EQ(FPTU_OK, fptu_insert_uint32(pt, n, n));
+    EXPECT_EQ(FPTU_OK, fptu_insert_int64(pt, n, n * 10));
+    EXPECT_EQ(FPTU_OK, fptu_insert_cstr(pt, n % 3, "cstr"));
+  }
+  EXPECT_EQ(1, fptu_erase(pt, 5, fptu_int64));
+  ASSERT_STREQ(nullptr, fptu_check(pt));
+  const fptu_ro ro = fptu_take_noshrink(pt);
+
+  size_t count = 0;
+  int64_t sum = 0;
+  for (const fptu_field &field : fptu::fields<fptu_any_int>(ro)) {
+    EXPECT_FALSE(ct_is_dead(field.ct));
+    sum += fptu_field_type(&field) == fptu_int32 ? fptu_field_int32(&field)
+                                                 : fptu_field_int64(&field);
+    count++;
+  }
+  EXPECT_EQ(19u, count);
+  EXPECT_EQ(-45 + 450 - 50, sum);
+  EXPECT_EQ(fptu_field_count_ro(ro, 1, fptu_cstr),
+            (size_t)std::distance(fptu::fields<fptu_cstr>(ro, 1).begin(),
+                                  fptu::fields<fptu_cstr>(ro, 1).end()));
+
+  for (unsigned n = 0; n < 11; n++) {
+    SCOPED_TRACE("n = " + std::to_string(n));
+    const auto range = fptu::fields<fptu_any>(pt, n);
+    EXPECT_EQ(fptu_field_count(pt, n, fptu_any),
+              (size_t)std::distance(range.begin(), range.end()));
+  }
+
+  count = 0;
+  for (const fptu_field &field : fptu::fields<fptu_uint32>(pt))
+    count += fptu_field_uint32(&field);
+  EXPECT_EQ(45u, count);
+
+  const unsigned column = 7;
+  count = 0;
+  const auto after = [column](const fptu_field *pf) {
+    return pf->colnum() > column;
+  };
+  for (const fptu_field &field : fptu::fields(ro, after))
+    count += field.colnum();
+  EXPECT_EQ((8u + 9u) * 3u, count);
+
+  /* пустой и поврежденный кортежи */
+  EXPECT_TRUE(fptu::fields<fptu_any>(fptu_ro()).begin() ==
+              fptu::fields<fptu_any>(fptu_ro()).end());
+  fptu_ro bad = ro;
+  bad.total_bytes -= fptu_unit_size;
+  const auto broken = fptu::fields<fptu_any>(bad);
+  EXPECT_TRUE(broken.begin() == broken.end());
+}
+
+TEST(Iterate, CountTags) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+
+  /* вразнобой, с коллекциями и удаленными полями */
+  std::mt19937 rnd(42);
+  for (unsigned n = 0; n < 500; n++) {
+    const unsigned col = rnd() % 100;
+    switch (rnd() % 3) {
+    case 0:
+      EXPECT_EQ(FPTU_OK, fptu_insert_uint32(pt, col, n));
+      break;
+    case 1:
+      EXPECT_EQ(FPTU_OK, fptu_insert_int64(pt, col, n));
+      break;
+    default:
+      EXPECT_EQ(FPTU_OK, fptu_insert_uint16(pt, col + 900, n));
+    }
+  }
+  for (unsigned col = 0; col < 100; col += 7)
+    fptu_erase(pt, col, fptu_uint32);
+  ASSERT_STREQ(nullptr, fptu_check(pt));
+  const fptu_ro ro = fptu_take_noshrink(pt);
+
+  std::map<uint16_t, size_t> expected;
+  for (const fptu_field *pf = fptu_begin_ro(ro); pf < fptu_end_ro(ro); ++pf)
+    if (!ct_is_dead(pf->ct))
+      expected[pf->ct] += 1;
+
+  std::vector<uint16_t> tags;
+  for (unsigned col = 0; col < 1010; col += 3) {
+    tags.push_back((uint16_t)((col << fptu_co_shift) | fptu_uint32));
+    tags.push_back((uint16_t)((col << fptu_co_shift) | fptu_uint16));
+  }
+  /* повтор и отсутствующие типы */
+  tags.push_back(tags.front());
+  tags.push_back((uint16_t)((5 << fptu_co_shift) | fptu_cstr));
+  tags.push_back((uint16_t)((fptu_max_cols << fptu_co_shift) | fptu_fp64));
+
+  std::vector<size_t> counts(tags.size(), ~size_t(0));
+  /* каждое поле учитывается однократно, даже при повторе тега */
+  size_t total = 0;
+  for (uint16_t tag : std::set<uint16_t>(tags.begin(), tags.end()))
+    total += expected.count(tag) ? expected[tag] : 0;
+  EXPECT_EQ(total, fptu_field_count_tags_ro(ro, tags.data(), tags.size(),
+                                            counts.data()));
+  for (size_t i = 0; i < tags.size(); i++) {
+    SCOPED_TRACE("tag = " + std::to_string(tags[i]));
+    EXPECT_EQ(expected.count(tags[i]) ? expected[tags[i]] : 0, counts[i]);
+    EXPECT_EQ(fptu_field_count(pt, tags[i] >> fptu_co_shift,
+                               tags[i] & fptu_ty_mask),
+              counts[i]);
+  }
+  EXPECT_EQ(0u, fptu_field_count_tags(pt, tags.data(), 0, counts.data()));
+
+  /* запрос больше fptu_max_fields отвергается */
+  std::vector<uint16_t> many(fptu_max_fields + 1, tags.front());
+  std::vector<size_t> many_counts(many.size(), ~size_t(0));
+  EXPECT_EQ(0u, fptu_field_count_tags_ro(ro, many.data(), many.size(),
+                                         many_counts.data()));
+  EXPECT_EQ(0u, *std::max_element(many_counts.begin(), many_counts.end()));
+  many.pop_back();
+  many_counts.pop_back();
+  EXPECT_EQ(counts.front(), fptu_field_count_tags_ro(ro, many.data(),
+                                                     many.size(),
+                                                     many_counts.data()));
+  EXPECT_EQ(counts.front(), many_counts.back());
+
+  const size_t items = (size_t)(fptu_end_ro(ro) - fptu_begin_ro(ro));
+  std::vector<uint16_t> hist_tags(items);
+  std::vector<size_t> hist_counts(items);
+  uint16_t *const hist_end =
+      fptu_tags_histogram(hist_tags.data(), hist_counts.data(),
+                          fptu_begin_ro(ro), fptu_end_ro(ro));
+  ASSERT_EQ(expected.size(), (size_t)(hist_end - hist_tags.data()));
+  size_t i = 0;
+  for (const auto &pair : expected) {
+    EXPECT_EQ(pair.first, hist_tags[i]);
+    EXPECT_EQ(pair.second, hist_counts[i]);
+    ++i;
+  }
+
+  /* совпадает с fptu_tags() без повторов */
+  std::vector<uint16_t> unique(items);
+  fptu_shrink(pt);
+  const fptu_ro shrinked = fptu_take_noshrink(pt);
+  EXPECT_EQ(hist_end - hist_tags.data(),
+            fptu_tags(unique.data(), fptu_begin_ro(shrinked),
+                      fptu_end_ro(shrinked)) -
+                unique.data());
+  EXPECT_TRUE(std::equal(hist_tags.data(), hist_end, unique.data()));
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
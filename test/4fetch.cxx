@@ -382,6 +382,125 @@ TEST(Fetch, Variate) {
   }
 }
 
+TEST(Fetch, Hot) {
+  char origin_space[fptu_buffer_enough];
+  fptu_rw *origin =
+      fptu_init(origin_space, sizeof(origin_space), fptu_max_fields);
+  ASSERT_NE(nullptr, origin);
+  for (unsigned col = 0; col < 40; ++col) {
+    switch (col % 3) {
+    case 0:
+      EXPECT_EQ(FPTU_OK, fptu_insert_uint32(origin, col, col));
+      break;
+    case 1:
+      EXPECT_EQ(FPTU_OK, fptu_insert_uint16(origin, col, col));
+      break;
+    default:
+      EXPECT_EQ(FPTU_OK, fptu_insert_cstr(origin, col, "hot"));
+      EXPECT_EQ(FPTU_OK, fptu_insert_cstr(origin, col, "hot hot hot"));
+      break;
+    }
+  }
+  EXPECT_EQ(1, fptu_erase(origin, 3, fptu_uint32));
+  const fptu_ro junky = fptu_take_noshrink(origin);
+  ASSERT_STREQ(nullptr, fptu_check_ro(junky));
+
+  /* от холодных к горячим */
+  const uint16_t hot[] = {
+      (uint16_t)(fptu_cstr + (5 << fptu_co_shift)),
+      (uint16_t)(fptu_uint16 + (1 << fptu_co_shift)),
+      (uint16_t)(fptu_uint32 + (3 << fptu_co_shift)),
+      (uint16_t)(fptu_uint32 + (0 << fptu_co_shift)),
+  };
+  const size_t bytes = fptu_get_buffer_size(junky, 1, 0);
+  std::vector<char> space(bytes);
+  EXPECT_EQ(nullptr, fptu_fetch_hot(junky, space.data(), bytes - 1, 1, hot,
+                                    FPT_ARRAY_LENGTH(hot)));
+  EXPECT_EQ(nullptr, fptu_fetch_hot(junky, space.data(), bytes, 1, nullptr, 1));
+  fptu_rw *pt = fptu_fetch_hot(junky, space.data(), bytes, 1, hot,
+                               FPT_ARRAY_LENGTH(hot));
+  ASSERT_NE(nullptr, pt);
+  ASSERT_STREQ(nullptr, fptu_check(pt));
+  EXPECT_EQ(0u, fptu_junkspace(pt));
+  EXPECT_EQ(2u, fptu_space4items(pt));
+
+  const fptu_ro ro = fptu_take_noshrink(pt);
+  const fptu_field *pf = fptu_begin_ro(ro);
+  EXPECT_EQ(hot[3], pf[0].ct);
+  EXPECT_EQ(hot[1], pf[1].ct);
+  EXPECT_EQ(hot[0], pf[2].ct);
+  EXPECT_STREQ("hot hot hot", fptu_field_cstr(&pf[2]));
+  EXPECT_EQ(hot[0], pf[3].ct);
+  EXPECT_STREQ("hot", fptu_field_cstr(&pf[3]));
+  EXPECT_EQ(fptu_eq, fptu_cmp_tuples(ro, fptu_take(origin)));
+
+  /* переупорядоченный кортеж пригоден для дальнейших изменений */
+  EXPECT_EQ(1, fptu_erase(pt, 1, fptu_uint16));
+  EXPECT_EQ(FPTU_OK, fptu_upsert_cstr(pt, 40, "new"));
+  EXPECT_TRUE(fptu_shrink(pt));
+  ASSERT_STREQ(nullptr, fptu_check(pt));
+  EXPECT_EQ(0u, fptu_field_count(pt, 1, fptu_uint16));
+  EXPECT_EQ(52, fptu_end_rw(pt) - fptu_begin_rw(pt));
+  EXPECT_STREQ("new", fptu_get_cstr(fptu_take(pt), 40, nullptr));
+  EXPECT_STREQ("hot hot hot", fptu_get_cstr(fptu_take(pt), 38, nullptr));
+}
+
+/* Штамповка записей одинаковой формы из шаблона посредством fptu_fetch() */
+TEST(Fetch, Template) {
+  char tmpl_space[fptu_buffer_enough];
+  fptu_rw *tmpl = fptu_init(tmpl_space, sizeof(tmpl_space), 8);
+  ASSERT_NE(nullptr, tmpl);
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint32(tmpl, 1, 0));
+  EXPECT_EQ(FPTU_OK, fptu_insert_int64(tmpl, 2, 0));
+  EXPECT_EQ(FPTU_OK, fptu_insert_cstr(tmpl, 3, "default"));
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint16(tmpl, 4, 0));
+  const fptu_ro ro = fptu_take(tmpl);
+
+  const size_t bytes = fptu_get_buffer_size(ro, 2, 16);
+  std::vector<char> space(bytes);
+  EXPECT_EQ(nullptr, fptu_fetch(ro, nullptr, bytes, 2));
+  EXPECT_EQ(nullptr, fptu_fetch(ro, space.data(), sizeof(fptu_rw), 2));
+
+  for (unsigned i = 0; i < 3; ++i) {
+    fptu_rw *pt = fptu_fetch(ro, space.data(), bytes, 2);
+    ASSERT_NE(nullptr, pt);
+    ASSERT_STREQ(nullptr, fptu_check(pt));
+    EXPECT_EQ(fptu_eq, fptu_cmp_tuples(ro, fptu_take_noshrink(pt)));
+    EXPECT_LE(2u, fptu_space4items(pt));
+    EXPECT_LE(16u, fptu_space4data(pt));
+
+    /* значения обновляются на месте или через указатель на поле */
+    EXPECT_EQ(FPTU_OK, fptu_update_uint32(pt, 1, i));
+    EXPECT_EQ(FPTU_OK, fptu_update_cstr(pt, 3, "value"));
+    fptu_field_payload(fptu_lookup(pt, 2, fptu_int64))->i64 = -(int64_t)i;
+    EXPECT_EQ(FPTU_OK, fptu_insert_uint16(pt, 5, i));
+    ASSERT_STREQ(nullptr, fptu_check(pt));
+
+    const fptu_ro result = fptu_take(pt);
+    EXPECT_EQ(i, fptu_get_uint32(result, 1, nullptr));
+    EXPECT_EQ(-(int64_t)i, fptu_get_int64(result, 2, nullptr));
+    EXPECT_STREQ("value", fptu_get_cstr(result, 3, nullptr));
+    EXPECT_EQ(0u, fptu_get_uint16(result, 4, nullptr));
+    EXPECT_EQ(i, fptu_get_uint16(result, 5, nullptr));
+  }
+  EXPECT_STREQ("default", fptu_get_cstr(ro, 3, nullptr));
+
+  /* карта присутствия тегов в шаблоне отбрасывается */
+  const fptu_ro bloomed = fptu_take_bloom(tmpl);
+  fptu_rw *pt = fptu_fetch(bloomed, space.data(), bytes, 0);
+  ASSERT_NE(nullptr, pt);
+  ASSERT_STREQ(nullptr, fptu_check(pt));
+  EXPECT_EQ(fptu_take(tmpl).total_bytes, fptu_take_noshrink(pt).total_bytes);
+
+  /* пустой шаблон */
+  fptu_ro empty;
+  empty.units = nullptr;
+  empty.total_bytes = 0;
+  pt = fptu_fetch(empty, space.data(), bytes, 2);
+  ASSERT_NE(nullptr, pt);
+  EXPECT_EQ(fptu_end_rw(pt), fptu_begin_rw(pt));
+}
+
 TEST(Fetch, DeNils) {
   EXPECT_EQ(fptu_null, fptu_field_type(nullptr));
   EXPECT_EQ(-1, fptu_field_column(nullptr));
@@ -21,6 +21,9 @@
 
 #include "shuffle6.hpp"
 
+#include <random>
+#include <string>
+
 static bool field_filter_any(const fptu_field *, void *context, void *param) {
   (void)context;
   (void)param;
@@ -89,6 +92,158 @@ TEST(Shrink, Base) {
   EXPECT_EQ(-555, fptu_field_int64(fp));
 }
 
+TEST(Shrink, Header) {
+  char space[fptu_buffer_enough], space2[fptu_buffer_enough];
+  std::mt19937 rnd(42);
+
+  for (unsigned iter = 0; iter < 1000; ++iter) {
+    fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+    ASSERT_NE(nullptr, pt);
+    const unsigned n = 1 + rnd() % 64;
+    for (unsigned col = 0; col < n; ++col) {
+      switch (rnd() % 4) {
+      case 0:
+        EXPECT_EQ(FPTU_OK, fptu_insert_uint16(pt, col, col));
+        break;
+      case 1:
+        EXPECT_EQ(FPTU_OK, fptu_insert_int32(pt, col, -(int)col));
+        break;
+      case 2:
+        EXPECT_EQ(FPTU_OK, fptu_insert_uint64(pt, col, col));
+        break;
+      default:
+        EXPECT_EQ(FPTU_OK, fptu_insert_cstr(
+                               pt, col, std::string(col, 'x').c_str()));
+        break;
+      }
+    }
+    for (unsigned col = 0; col < n; ++col) {
+      if (rnd() % 3 == 0) {
+        EXPECT_EQ(1, fptu_erase(pt, col, fptu_any));
+      }
+    }
+    ASSERT_STREQ(nullptr, fptu_check(pt));
+
+    /* эталон после полной дефрагментации */
+    const fptu_ro junky = fptu_take_noshrink(pt);
+    fptu_rw *ref = fptu_fetch(junky, space2, sizeof(space2), 0);
+    ASSERT_NE(nullptr, ref);
+    fptu_shrink(ref);
+    const size_t junk = fptu_junkspace(pt);
+
+    const bool changed = fptu_shrink_header(pt);
+    ASSERT_STREQ(nullptr, fptu_check(pt));
+    ASSERT_STREQ(nullptr, fptu_check_ro(fptu_take_noshrink(pt)));
+    EXPECT_EQ(changed, junk != 0);
+    EXPECT_LE(fptu_junkspace(pt), junk);
+    EXPECT_EQ(fptu::to_json(fptu_take_noshrink(ref)),
+              fptu::to_json(fptu_take_noshrink(pt)));
+
+    /* мертвыми остаются только поля, занимающие пустоты в данных */
+    size_t dead = 0, prev_dead = 0;
+    for (const fptu_field *pf = fptu_begin_rw(pt); pf < fptu_end_rw(pt);
+         ++pf) {
+      if (ct_is_dead(pf->ct)) {
+        EXPECT_LT(fptu_uint16, fptu_get_type(pf->ct));
+        EXPECT_EQ(0u, prev_dead);
+        ++dead;
+      }
+      prev_dead = ct_is_dead(pf->ct) ? 1 : 0;
+    }
+    EXPECT_FALSE(fptu_shrink_header(pt) && dead == 0);
+
+    /* полная дефрагментация дает тот же результат */
+    fptu_shrink(pt);
+    ASSERT_STREQ(nullptr, fptu_check(pt));
+    EXPECT_EQ(0u, fptu_junkspace(pt));
+    const fptu_ro expected = fptu_take_noshrink(ref);
+    const fptu_ro result = fptu_take_noshrink(pt);
+    ASSERT_EQ(expected.total_bytes, result.total_bytes);
+    EXPECT_EQ(0, memcmp(expected.units, result.units, result.total_bytes));
+  }
+
+  /* пустота больше предельного размера поля */
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+  const std::string blob(fptu_max_opaque_bytes - 8, 'b');
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint32(pt, 1, 1));
+  for (unsigned col = 2; col < 5; ++col)
+    EXPECT_EQ(FPTU_OK, fptu_insert_opaque(pt, col, blob.data(), blob.size()));
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint16(pt, 5, 5));
+  EXPECT_EQ(FPTU_OK, fptu_insert_uint32(pt, 6, 6));
+  EXPECT_EQ(1, fptu_erase(pt, 2, fptu_opaque));
+  EXPECT_EQ(1, fptu_erase(pt, 3, fptu_opaque));
+  EXPECT_EQ(1, fptu_erase(pt, 5, fptu_uint16));
+  const size_t junk = fptu_junkspace(pt);
+  EXPECT_TRUE(fptu_shrink_header(pt));
+  ASSERT_STREQ(nullptr, fptu_check(pt));
+  EXPECT_EQ(junk - fptu_unit_size, fptu_junkspace(pt));
+  EXPECT_EQ(1u, fptu_get_uint32(fptu_take_noshrink(pt), 1, nullptr));
+  EXPECT_EQ(6u, fptu_get_uint32(fptu_take_noshrink(pt), 6, nullptr));
+  EXPECT_EQ(blob.size(),
+            fptu_get_opaque(fptu_take_noshrink(pt), 4, nullptr).iov_len);
+  EXPECT_TRUE(fptu_shrink(pt));
+  ASSERT_STREQ(nullptr, fptu_check(pt));
+  EXPECT_EQ(3, fptu_end_rw(pt) - fptu_begin_rw(pt));
+}
+
+TEST(Shrink, TakeCompact) {
+  char space[fptu_buffer_enough], space2[fptu_buffer_enough];
+  std::mt19937 rnd(7);
+
+  for (unsigned iter = 0; iter < 1000; ++iter) {
+    fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+    ASSERT_NE(nullptr, pt);
+    const unsigned n = rnd() % 64;
+    for (unsigned col = 0; col < n; ++col) {
+      switch (rnd() % 3) {
+      case 0:
+        EXPECT_EQ(FPTU_OK, fptu_insert_uint16(pt, col, col));
+        break;
+      case 1:
+        EXPECT_EQ(FPTU_OK, fptu_insert_fp64(pt, col, col));
+        break;
+      default:
+        EXPECT_EQ(FPTU_OK, fptu_insert_cstr(
+                               pt, col, std::string(col, 'x').c_str()));
+        break;
+      }
+    }
+    for (unsigned col = 0; col < n; ++col) {
+      if (rnd() % 3 == 0) {
+        EXPECT_EQ(1, fptu_erase(pt, col, fptu_any));
+      }
+    }
+
+    const fptu_ro junky = fptu_take_noshrink(pt);
+    const std::string origin((const char *)pt, sizeof(fptu_rw) +
+                                                   units2bytes(pt->tail));
+    const size_t bytes = junky.total_bytes - fptu_junkspace(pt);
+    std::vector<char> dst(bytes);
+    EXPECT_EQ(nullptr, fptu_take_compact_into(pt, dst.data(), bytes - 1).units);
+    const fptu_ro compact = fptu_take_compact_into(pt, dst.data(), bytes);
+    ASSERT_EQ((const fptu_unit *)dst.data(), compact.units);
+    ASSERT_EQ(bytes, compact.total_bytes);
+    ASSERT_STREQ(nullptr, fptu_check_ro(compact));
+
+    /* источник не изменяется, а результат совпадает с fptu_shrink() */
+    EXPECT_EQ(origin, std::string((const char *)pt, origin.size()));
+    fptu_rw *ref = fptu_fetch(junky, space2, sizeof(space2), 0);
+    ASSERT_NE(nullptr, ref);
+    /* fptu_fetch() не учитывает мусор, но результат должен совпасть */
+    std::vector<char> refetched(fptu_take_noshrink(ref).total_bytes);
+    const fptu_ro again =
+        fptu_take_compact_into(ref, refetched.data(), refetched.size());
+    ASSERT_STREQ(nullptr, fptu_check_ro(again));
+    ASSERT_EQ(compact.total_bytes, again.total_bytes);
+    EXPECT_EQ(0, memcmp(compact.units, again.units, again.total_bytes));
+    fptu_shrink(ref);
+    const fptu_ro expected = fptu_take_noshrink(ref);
+    ASSERT_EQ(expected.total_bytes, compact.total_bytes);
+    EXPECT_EQ(0, memcmp(expected.units, compact.units, compact.total_bytes));
+  }
+}
+
 TEST(Shrink, Shuffle) {
   char space[fptu_buffer_enough];
 
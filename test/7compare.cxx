@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <set>
 #include <string>
+#include <vector>
 
 #ifdef _MSC_VER
 #pragma warning(pop)
@@ -350,6 +351,208 @@ TEST(Compare, DISABLED_Shuffle)
   }
 }
 
+/* API для создания массивов пока нет, поэтому массив вставляется как opaque
+ * и затем "перекрашивается" в требуемый тип с установкой array_length. */
+static const fptu_field *insert_array(fptu_rw *pt, unsigned column,
+                                      fptu_type type, const void *items,
+                                      size_t bytes, unsigned length) {
+  if (fptu_insert_opaque(pt, column, items, bytes) != FPTU_OK)
+    return nullptr;
+  fptu_field *pf = fptu_lookup(pt, column, fptu_opaque);
+  if (pf == nullptr)
+    return nullptr;
+  fptu_payload *payload = const_cast<fptu_payload *>(fptu_field_payload(pf));
+  payload->other.varlen.array_length = (uint16_t)length;
+  pf->ct = (uint16_t)fptu_pack_coltype(column, type | fptu_farray);
+  return pf;
+}
+
+template <typename native>
+static void probe_array(fptu_type type, const std::vector<native> &major,
+                        const std::vector<native> &minor) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+
+  const fptu_field *l = insert_array(pt, 1, type, major.data(),
+                                     major.size() * sizeof(native),
+                                     (unsigned)major.size());
+  ASSERT_NE(nullptr, l);
+  const fptu_field *r = insert_array(pt, 2, type, minor.data(),
+                                     minor.size() * sizeof(native),
+                                     (unsigned)minor.size());
+  ASSERT_NE(nullptr, r);
+
+  EXPECT_EQ(fptu_eq, fptu_cmp_fields(l, l));
+  EXPECT_EQ(fptu_eq, fptu_cmp_fields(r, r));
+  EXPECT_EQ(fptu_gt, fptu_cmp_fields(l, r));
+  EXPECT_EQ(fptu_lt, fptu_cmp_fields(r, l));
+}
+
+TEST(Compare, ArrayNative) {
+  probe_array<int32_t>(fptu_int32, {1, 2, 3}, {1, 2});
+  probe_array<int32_t>(fptu_int32, {1, 2, 3}, {1, 2, -3});
+  probe_array<int32_t>(fptu_int32, {2}, {1, 2, 3});
+  probe_array<uint16_t>(fptu_uint16, {1, 0x100}, {1, 0xFF});
+  probe_array<uint64_t>(fptu_uint64, {UINT64_MAX}, {1, 2, 3});
+  probe_array<double>(fptu_fp64, {0.0, 1.5}, {-0.0, 1.25});
+
+  // длинные массивы, отличие в разных позициях относительно SWAR-блоков
+  for (size_t at = 0; at < 77; ++at) {
+    SCOPED_TRACE("mismatch at " + std::to_string(at));
+    std::vector<int64_t> major(77), minor(77);
+    for (size_t i = 0; i < major.size(); ++i)
+      major[i] = minor[i] = (int64_t)(i * 0x0101010101010101ull);
+    major[at] += 1;
+    minor[at] -= 0x100;
+    probe_array<int64_t>(fptu_int64, major, minor);
+
+    std::vector<uint16_t> hi(77, 42), lo(77, 42);
+    hi[at] = 0x0100, lo[at] = 0x00FF;
+    probe_array<uint16_t>(fptu_uint16, hi, lo);
+  }
+
+  // +0.0 и -0.0 побитово отличаются, но равны
+  std::vector<double> plus = {1, 0.0, 3}, minus = {1, -0.0, 2};
+  probe_array<double>(fptu_fp64, plus, minus);
+}
+
+TEST(Compare, ArrayVarlen) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+
+  static const char major_str[] = "abc\0xyz";
+  static const char minor_str[] = "abc\0xy\0zz";
+  const fptu_field *l = insert_array(pt, 1, fptu_cstr, major_str,
+                                     sizeof(major_str), 2);
+  const fptu_field *r = insert_array(pt, 2, fptu_cstr, minor_str,
+                                     sizeof(minor_str), 3);
+  ASSERT_NE(nullptr, l);
+  ASSERT_NE(nullptr, r);
+  EXPECT_EQ(fptu_eq, fptu_cmp_fields(l, l));
+  EXPECT_EQ(fptu_gt, fptu_cmp_fields(l, r));
+  EXPECT_EQ(fptu_lt, fptu_cmp_fields(r, l));
+
+  /* массив opaque: каждый элемент предваряется varlen-заголовком */
+  fptu_unit major_opaque[4], minor_opaque[4];
+  memset(major_opaque, 0, sizeof(major_opaque));
+  memset(minor_opaque, 0, sizeof(minor_opaque));
+  major_opaque[0].varlen.brutto = 1;
+  major_opaque[0].varlen.opaque_bytes = 3;
+  memcpy(&major_opaque[1], "abc", 3);
+  major_opaque[2].varlen.brutto = 1;
+  major_opaque[2].varlen.opaque_bytes = 1;
+  memcpy(&major_opaque[3], "z", 1);
+  minor_opaque[0] = major_opaque[0];
+  minor_opaque[1] = major_opaque[1];
+  minor_opaque[2].varlen.brutto = 1;
+  minor_opaque[2].varlen.opaque_bytes = 2;
+  memcpy(&minor_opaque[3], "yz", 2);
+
+  l = insert_array(pt, 3, fptu_opaque, major_opaque, sizeof(major_opaque), 2);
+  r = insert_array(pt, 4, fptu_opaque, minor_opaque, sizeof(minor_opaque), 2);
+  ASSERT_NE(nullptr, l);
+  ASSERT_NE(nullptr, r);
+  EXPECT_EQ(fptu_eq, fptu_cmp_fields(l, l));
+  EXPECT_EQ(fptu_gt, fptu_cmp_fields(l, r));
+  EXPECT_EQ(fptu_lt, fptu_cmp_fields(r, l));
+
+  /* массивы вложенных кортежей */
+  char space4nested[fptu_buffer_enough];
+  fptu_rw *nested = fptu_init(space4nested, sizeof(space4nested), 8);
+  ASSERT_NE(nullptr, nested);
+  ASSERT_EQ(FPTU_OK, fptu_insert_uint32(nested, 1, 42));
+  const fptu_ro major_item = fptu_take_noshrink(nested);
+  const std::string major_nested((const char *)major_item.sys.iov_base,
+                                 major_item.sys.iov_len);
+  ASSERT_EQ(FPTU_OK, fptu_upsert_uint32(nested, 1, 41));
+  const fptu_ro minor_item = fptu_take_noshrink(nested);
+  const std::string minor_nested =
+      major_nested + std::string((const char *)minor_item.sys.iov_base,
+                                 minor_item.sys.iov_len);
+
+  l = insert_array(pt, 5, fptu_nested, major_nested.data(),
+                   major_nested.size(), 1);
+  r = insert_array(pt, 6, fptu_nested, minor_nested.data(),
+                   minor_nested.size(), 2);
+  ASSERT_NE(nullptr, l);
+  ASSERT_NE(nullptr, r);
+  EXPECT_EQ(fptu_eq, fptu_cmp_fields(r, r));
+  EXPECT_EQ(fptu_lt, fptu_cmp_fields(l, r));
+  EXPECT_EQ(fptu_gt, fptu_cmp_fields(r, l));
+}
+
+TEST(Compare, MixedNumbers) {
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+
+  // одно и то же значение в разных колонках разных типов
+  ASSERT_EQ(FPTU_OK, fptu_upsert_uint16(pt, 0, 42));
+  ASSERT_EQ(FPTU_OK, fptu_upsert_int32(pt, 1, 42));
+  ASSERT_EQ(FPTU_OK, fptu_upsert_uint32(pt, 2, 42));
+  ASSERT_EQ(FPTU_OK, fptu_upsert_fp32(pt, 3, 42));
+  ASSERT_EQ(FPTU_OK, fptu_upsert_int64(pt, 4, 42));
+  ASSERT_EQ(FPTU_OK, fptu_upsert_uint64(pt, 5, 42));
+  ASSERT_EQ(FPTU_OK, fptu_upsert_fp64(pt, 6, 42));
+  const fptu_field *same[] = {
+      fptu_lookup(pt, 0, fptu_uint16), fptu_lookup(pt, 1, fptu_int32),
+      fptu_lookup(pt, 2, fptu_uint32), fptu_lookup(pt, 3, fptu_fp32),
+      fptu_lookup(pt, 4, fptu_int64),  fptu_lookup(pt, 5, fptu_uint64),
+      fptu_lookup(pt, 6, fptu_fp64)};
+  for (auto l : same) {
+    ASSERT_NE(nullptr, l);
+    for (auto r : same)
+      EXPECT_EQ(fptu_eq, fptu_cmp_fields(l, r));
+  }
+
+  // значения, которые сравниваются неверно при наивном приведении типов
+  ASSERT_EQ(FPTU_OK, fptu_upsert_int32(pt, 10, -1));
+  ASSERT_EQ(FPTU_OK, fptu_upsert_uint64(pt, 11, UINT64_MAX));
+  ASSERT_EQ(FPTU_OK, fptu_upsert_int64(pt, 12, INT64_MAX));
+  ASSERT_EQ(FPTU_OK, fptu_upsert_fp64(pt, 13, 9223372036854775808.0));
+  ASSERT_EQ(FPTU_OK, fptu_upsert_uint64(pt, 14, (UINT64_C(1) << 53) + 1));
+  ASSERT_EQ(FPTU_OK, fptu_upsert_fp64(pt, 15, (double)(UINT64_C(1) << 53)));
+  ASSERT_EQ(FPTU_OK, fptu_upsert_fp32(pt, 16, 41.5f));
+  ASSERT_EQ(FPTU_OK, fptu_upsert_fp64(pt, 17, -0.5));
+  ASSERT_EQ(FPTU_OK, fptu_upsert_fp64(pt, 18, NAN));
+  ASSERT_EQ(FPTU_OK, fptu_upsert_cstr(pt, 19, "42"));
+
+  const fptu_field *minus_one = fptu_lookup(pt, 10, fptu_int32);
+  const fptu_field *u64_max = fptu_lookup(pt, 11, fptu_uint64);
+  const fptu_field *i64_max = fptu_lookup(pt, 12, fptu_int64);
+  const fptu_field *two_pow63 = fptu_lookup(pt, 13, fptu_fp64);
+  const fptu_field *odd53 = fptu_lookup(pt, 14, fptu_uint64);
+  const fptu_field *two_pow53 = fptu_lookup(pt, 15, fptu_fp64);
+  const fptu_field *fraction = fptu_lookup(pt, 16, fptu_fp32);
+  const fptu_field *minus_half = fptu_lookup(pt, 17, fptu_fp64);
+  const fptu_field *nan = fptu_lookup(pt, 18, fptu_fp64);
+  const fptu_field *str = fptu_lookup(pt, 19, fptu_cstr);
+
+  EXPECT_EQ(fptu_lt, fptu_cmp_fields(minus_one, u64_max));
+  EXPECT_EQ(fptu_gt, fptu_cmp_fields(u64_max, minus_one));
+  EXPECT_EQ(fptu_lt, fptu_cmp_fields(minus_one, same[0]));
+  EXPECT_EQ(fptu_lt, fptu_cmp_fields(i64_max, u64_max));
+  EXPECT_EQ(fptu_lt, fptu_cmp_fields(i64_max, two_pow63));
+  EXPECT_EQ(fptu_gt, fptu_cmp_fields(two_pow63, i64_max));
+  EXPECT_EQ(fptu_gt, fptu_cmp_fields(u64_max, two_pow63));
+  EXPECT_EQ(fptu_gt, fptu_cmp_fields(odd53, two_pow53));
+  EXPECT_EQ(fptu_lt, fptu_cmp_fields(two_pow53, odd53));
+  for (auto r : same) {
+    EXPECT_EQ(fptu_lt, fptu_cmp_fields(fraction, r));
+    EXPECT_EQ(fptu_gt, fptu_cmp_fields(r, fraction));
+    EXPECT_EQ(fptu_gt, fptu_cmp_fields(r, minus_half));
+  }
+  EXPECT_EQ(fptu_lt, fptu_cmp_fields(minus_one, minus_half));
+  EXPECT_EQ(fptu_gt, fptu_cmp_fields(minus_half, minus_one));
+
+  EXPECT_EQ(fptu_ic, fptu_cmp_fields(nan, same[1]));
+  EXPECT_EQ(fptu_ic, fptu_cmp_fields(same[5], nan));
+  EXPECT_EQ(fptu_ic, fptu_cmp_fields(str, same[1]));
+  EXPECT_EQ(fptu_ic, fptu_cmp_fields(same[6], str));
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
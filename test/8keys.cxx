@@ -0,0 +1,189 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fptu_test.h"
+
+#ifdef _MSC_VER
+#pragma warning(push, 1)
+#endif /* _MSC_VER */
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+static int sign(int value) { return (value > 0) - (value < 0); }
+
+static int lge2sign(fptu_lge cmp) {
+  switch (cmp) {
+  case fptu_lt:
+    return -1;
+  case fptu_gt:
+    return 1;
+  case fptu_eq:
+    return 0;
+  default:
+    ADD_FAILURE() << "unexpected " << std::to_string(cmp);
+    return 42;
+  }
+}
+
+TEST(Keys, Spec) {
+  const fptu_keydef good[] = {{1, fptu_int32, 0, 0}, {2, fptu_cstr, 1, 8}};
+  EXPECT_EQ(1u + 4 + 1 + 8, fptu_key_size(good, 2));
+
+  const fptu_keydef nested[] = {{1, fptu_nested, 0, 0}};
+  EXPECT_EQ(0u, fptu_key_size(nested, 1));
+  const fptu_keydef array[] = {{1, fptu_int32 | fptu_farray, 0, 0}};
+  EXPECT_EQ(0u, fptu_key_size(array, 1));
+  const fptu_keydef column[] = {{fptu_max_cols + 1, fptu_int32, 0, 0}};
+  EXPECT_EQ(0u, fptu_key_size(column, 1));
+  EXPECT_EQ(0u, fptu_key_size(nullptr, 0));
+
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), fptu_max_fields);
+  ASSERT_NE(nullptr, pt);
+  const fptu_ro ro = fptu_take_noshrink(pt);
+  uint8_t key[32];
+  EXPECT_EQ(FPTU_EINVAL, fptu_key_build(ro, nested, 1, key, sizeof(key)));
+  EXPECT_EQ(FPTU_ENOSPACE, fptu_key_build(ro, good, 2, key, 5));
+  EXPECT_EQ(FPTU_OK, fptu_key_build(ro, good, 2, key, sizeof(key)));
+  EXPECT_EQ(fptu_ic, fptu_cmp_keys(ro, ro, nested, 1));
+  EXPECT_EQ(fptu_eq, fptu_cmp_keys(ro, ro, good, 2));
+
+  /* количество колонок ключа ограничено */
+  std::vector<fptu_keydef> wide(fptu_max_fields + 1, good[0]);
+  EXPECT_EQ(0u, fptu_key_size(wide.data(), wide.size()));
+  EXPECT_EQ(FPTU_EINVAL,
+            fptu_key_build(ro, wide.data(), wide.size(), key, sizeof(key)));
+  EXPECT_EQ(fptu_ic, fptu_cmp_keys(ro, ro, wide.data(), wide.size()));
+  EXPECT_EQ(5u * fptu_max_fields,
+            fptu_key_size(wide.data(), fptu_max_fields));
+  EXPECT_EQ(fptu_eq, fptu_cmp_keys(ro, ro, wide.data(), fptu_max_fields));
+}
+
+TEST(Keys, Normalized) {
+  /* Для набора кортежей проверяем, что порядок нормализованных ключей
+   * совпадает с результатом fptu_cmp_keys() для всех пар. */
+  const fptu_keydef spec[] = {
+      {1, fptu_int32, 0, 0},  {2, fptu_fp64, 1, 0},   {3, fptu_cstr, 0, 6},
+      {4, fptu_opaque, 1, 4}, {5, fptu_uint64, 0, 0}, {6, fptu_fp32, 0, 0},
+      {7, fptu_int64, 1, 0}};
+  const fptu::key_comparator comparator(spec);
+  const size_t key_size = comparator.key_size();
+  ASSERT_EQ(size_t(7 + 4 + 8 + 6 + 6 + 8 + 4 + 8), key_size);
+
+  static const int32_t i32[] = {INT32_MIN, -1, 0, 1, INT32_MAX};
+  static const double fp64[] = {-INFINITY, -1e100, -1, -0.0, 0, 1e-300, 2};
+  static const char *const str[] = {"", "a", "ab", "abc", "b", "zzzzz"};
+  static const char *const opaque[] = {"", "\0", "\0\0", "x", "xy"};
+  static const size_t opaque_len[] = {0, 1, 2, 1, 2};
+  static const uint64_t u64[] = {0, 1, UINT64_MAX};
+  static const float fp32[] = {-1.5f, 0, 1.5f};
+  static const int64_t i64[] = {INT64_MIN, 0, INT64_MAX};
+
+  std::mt19937 rng(42);
+  std::vector<std::string> tuples;
+  for (unsigned n = 0; n < 500; ++n) {
+    char space[fptu_buffer_enough];
+    fptu_rw *pt = fptu_init(space, sizeof(space), 16);
+    ASSERT_NE(nullptr, pt);
+    /* каждое поле может отсутствовать */
+    if (rng() % 8) {
+      ASSERT_EQ(FPTU_OK, fptu_upsert_int32(pt, 1, i32[rng() % 5]));
+    }
+    if (rng() % 8) {
+      ASSERT_EQ(FPTU_OK, fptu_upsert_fp64(pt, 2, fp64[rng() % 7]));
+    }
+    if (rng() % 8) {
+      ASSERT_EQ(FPTU_OK, fptu_upsert_cstr(pt, 3, str[rng() % 6]));
+    }
+    if (rng() % 8) {
+      const unsigned i = rng() % 5;
+      ASSERT_EQ(FPTU_OK, fptu_upsert_opaque(pt, 4, opaque[i], opaque_len[i]));
+    }
+    if (rng() % 8) {
+      ASSERT_EQ(FPTU_OK, fptu_upsert_uint64(pt, 5, u64[rng() % 3]));
+    }
+    if (rng() % 8) {
+      ASSERT_EQ(FPTU_OK, fptu_upsert_fp32(pt, 6, fp32[rng() % 3]));
+    }
+    if (rng() % 8) {
+      ASSERT_EQ(FPTU_OK, fptu_upsert_int64(pt, 7, i64[rng() % 3]));
+    }
+    /* посторонние поля не влияют на ключ */
+    ASSERT_EQ(FPTU_OK, fptu_upsert_uint32(pt, 8, rng()));
+
+    const fptu_ro ro = fptu_take_noshrink(pt);
+    tuples.push_back(
+        std::string((const char *)ro.sys.iov_base, ro.sys.iov_len));
+  }
+
+  std::vector<fptu_ro> ro(tuples.size());
+  std::vector<std::string> keys(tuples.size());
+  for (size_t i = 0; i < tuples.size(); ++i) {
+    ro[i].sys.iov_base = &tuples[i][0];
+    ro[i].sys.iov_len = tuples[i].size();
+    keys[i] = comparator.make_key(ro[i]);
+    ASSERT_EQ(key_size, keys[i].size());
+  }
+
+  for (size_t i = 0; i < ro.size(); ++i)
+    for (size_t j = 0; j < ro.size(); ++j) {
+      const int by_fields = lge2sign(comparator.compare(ro[i], ro[j]));
+      const int by_keys =
+          sign(memcmp(keys[i].data(), keys[j].data(), key_size));
+      ASSERT_EQ(by_fields, by_keys) << i << " vs " << j;
+    }
+
+  std::vector<fptu_ro> sorted(ro);
+  std::sort(sorted.begin(), sorted.end(), comparator);
+  for (size_t i = 1; i < sorted.size(); ++i)
+    EXPECT_NE(fptu_gt, comparator.compare(sorted[i - 1], sorted[i]));
+}
+
+TEST(Keys, Truncated) {
+  const fptu_keydef spec[] = {{1, fptu_cstr, 0, 3}};
+  char space[fptu_buffer_enough];
+  fptu_rw *pt = fptu_init(space, sizeof(space), 16);
+  ASSERT_NE(nullptr, pt);
+
+  ASSERT_EQ(FPTU_OK, fptu_upsert_cstr(pt, 1, "abcd"));
+  const fptu_ro ro1 = fptu_take_noshrink(pt);
+  const std::string t1((const char *)ro1.sys.iov_base, ro1.sys.iov_len);
+  ASSERT_EQ(FPTU_OK, fptu_upsert_cstr(pt, 1, "abce"));
+  const fptu_ro ro2 = fptu_take_noshrink(pt);
+
+  fptu_ro left;
+  left.sys.iov_base = (void *)t1.data();
+  left.sys.iov_len = t1.size();
+  const fptu::key_comparator comparator(spec);
+  /* ключи урезаны и совпадают, а полное сравнение различает */
+  EXPECT_EQ(comparator.make_key(left), comparator.make_key(ro2));
+  EXPECT_EQ(fptu_lt, comparator.compare(left, ro2));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fptu_test.h"
+#include "utils/xsort.h"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+static std::string temp_path(const char *suffix) {
+  const char *env = getenv("TMPDIR");
+  return std::string((env && *env) ? env : "/tmp") + "/fptu-ut-xsort-" +
+         std::to_string(getpid()) + suffix;
+}
+
+static std::vector<std::string> make_tuples(unsigned count, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::vector<std::string> tuples;
+  for (unsigned n = 0; n < count; ++n) {
+    char space[fptu_buffer_enough];
+    fptu_rw *pt = fptu_init(space, sizeof(space), 16);
+    EXPECT_NE(nullptr, pt);
+    /* немного повторов ключей, чтобы проверить стабильность */
+    EXPECT_EQ(FPTU_OK, fptu_upsert_int32(pt, 1, (int32_t)(rng() % 97) - 48));
+    if (rng() % 4) {
+      const std::string str = std::to_string(rng() % 1000);
+      EXPECT_EQ(FPTU_OK, fptu_upsert_cstr(pt, 2, str.c_str()));
+    }
+    EXPECT_EQ(FPTU_OK, fptu_upsert_uint32(pt, 3, n));
+    const fptu_ro ro = fptu_take(pt);
+    tuples.push_back(
+        std::string((const char *)ro.sys.iov_base, ro.sys.iov_len));
+  }
+  return tuples;
+}
+
+static void write_file(const std::string &path,
+                       const std::vector<std::string> &tuples) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  for (const auto &tuple : tuples)
+    out.write(tuple.data(), (std::streamsize)tuple.size());
+}
+
+static std::vector<std::string> read_file(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  const std::string data = buffer.str();
+
+  std::vector<std::string> tuples;
+  for (size_t offset = 0; offset < data.size();) {
+    EXPECT_GE(data.size() - offset, fptu_unit_size);
+    const fptu_unit *header = (const fptu_unit *)(data.data() + offset);
+    const size_t bytes = fptu_unit_size * (1 + (size_t)header->varlen.brutto);
+    tuples.push_back(data.substr(offset, bytes));
+    offset += bytes;
+  }
+  return tuples;
+}
+
+static fptu_ro as_ro(const std::string &tuple) {
+  fptu_ro ro;
+  ro.sys.iov_base = (void *)tuple.data();
+  ro.sys.iov_len = tuple.size();
+  return ro;
+}
+
+static void check_sort(const fptu::xsort_options &options, unsigned count) {
+  const std::string input = temp_path(".in"), output = temp_path(".out");
+  std::vector<std::string> tuples = make_tuples(count, count);
+  write_file(input, tuples);
+
+  std::string error;
+  fptu::xsort_stat stat;
+  ASSERT_EQ(FPTU_OK,
+            fptu::xsort(input.c_str(), output.c_str(), options, error, &stat))
+      << error;
+  EXPECT_EQ(count, stat.tuples);
+  const size_t bytes = stat.bytes;
+  EXPECT_GE(std::max<size_t>(1, (bytes + options.run_bytes - 1) /
+                                    options.run_bytes),
+            stat.runs);
+  if (bytes > options.run_bytes) {
+    EXPECT_LT(1u, stat.runs);
+  }
+
+  /* сортировка стабильная, поэтому результат должен в точности совпасть */
+  std::stable_sort(tuples.begin(), tuples.end(),
+                   [&options](const std::string &a, const std::string &b) {
+                     return (options.keys.empty()
+                                 ? fptu_cmp_tuples(as_ro(a), as_ro(b))
+                                 : fptu_cmp_keys(as_ro(a), as_ro(b),
+                                                 options.keys.data(),
+                                                 options.keys.size())) ==
+                            fptu_lt;
+                   });
+  EXPECT_TRUE(tuples == read_file(output));
+
+  unlink(input.c_str());
+  unlink(output.c_str());
+}
+
+TEST(XSort, Empty) {
+  fptu::xsort_options options;
+  check_sort(options, 0);
+}
+
+TEST(XSort, SingleRun) {
+  fptu::xsort_options options;
+  check_sort(options, 1000);
+}
+
+TEST(XSort, ParallelRuns) {
+  fptu::xsort_options options;
+  options.run_bytes = 4096;
+  options.threads = 4;
+  check_sort(options, 5000);
+}
+
+TEST(XSort, ByKeys) {
+  fptu::xsort_options options;
+  options.run_bytes = 2000;
+  options.threads = 3;
+  const fptu_keydef by_int[] = {{1, fptu_int32, 1, 0}};
+  options.keys.assign(by_int, by_int + 1);
+  check_sort(options, 3000);
+
+  const fptu_keydef by_str[] = {{2, fptu_cstr, 0, 4}, {1, fptu_int32, 0, 0}};
+  options.keys.assign(by_str, by_str + 2);
+  check_sort(options, 3000);
+}
+
+TEST(XSort, InPlace) {
+  /* выходной файл совпадает со входным как для одной, так и для
+   * нескольких серий */
+  const std::string path = temp_path(".inplace");
+  for (size_t run_bytes : {size_t(64) << 20, size_t(4096)}) {
+    std::vector<std::string> tuples = make_tuples(2000, 7);
+    write_file(path, tuples);
+
+    std::string error;
+    fptu::xsort_options options;
+    options.run_bytes = run_bytes;
+    ASSERT_EQ(FPTU_OK,
+              fptu::xsort(path.c_str(), path.c_str(), options, error))
+        << error;
+    std::stable_sort(tuples.begin(), tuples.end(),
+                     [](const std::string &a, const std::string &b) {
+                       return fptu_cmp_tuples(as_ro(a), as_ro(b)) == fptu_lt;
+                     });
+    EXPECT_TRUE(tuples == read_file(path));
+    EXPECT_NE(0, access((path + ".tmp").c_str(), F_OK));
+  }
+  unlink(path.c_str());
+}
+
+TEST(XSort, Invalid) {
+  const std::string input = temp_path(".in"), output = temp_path(".out");
+  std::vector<std::string> tuples = make_tuples(10, 42);
+  tuples.back().resize(tuples.back().size() - fptu_unit_size);
+  write_file(input, tuples);
+
+  std::string error;
+  fptu::xsort_options options;
+  EXPECT_EQ(FPTU_EINVAL,
+            fptu::xsort(input.c_str(), output.c_str(), options, error));
+  EXPECT_NE(std::string::npos, error.find("truncated"));
+  EXPECT_NE(0, access(output.c_str(), F_OK));
+
+  error.clear();
+  EXPECT_NE(FPTU_OK,
+            fptu::xsort((input + ".nonexistent").c_str(), output.c_str(),
+                        options, error));
+  EXPECT_FALSE(error.empty());
+  unlink(input.c_str());
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
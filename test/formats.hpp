@@ -0,0 +1,521 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/* Минимальные эталонные кодировщики для сравнительного бенчмарка:
+ *  - MessagePack: map из целочисленных ключей, с выбором наиболее
+ *    компактного представления как в "настоящих" реализациях;
+ *  - Protocol Buffers: wire-формат с varint/zigzag, fixed64 и
+ *    length-delimited строками;
+ *  - FlatBuffers-подобный: таблица смещений (vtable) и выровненные
+ *    значения, доступ к полю без разбора.
+ *
+ * Кодировщики не претендуют на полноту, а реализуют ровно то, что
+ * требуется для синтетических записей, но без упрощений влияющих на
+ * производительность. Все форматы используют одну "схему": тип колонки
+ * определяется её номером, см. formats::kind_of(). */
+
+namespace formats {
+
+enum kind { k_uint32, k_int64, k_fp64, k_str };
+
+static inline kind kind_of(unsigned col) { return (kind)(col % 4); }
+
+struct value {
+  unsigned col;
+  kind type;
+  union {
+    uint32_t u32;
+    int64_t i64;
+    double fp64;
+  };
+  const char *str;
+  size_t len;
+};
+
+typedef std::vector<value> record;
+
+/* Синтетическая запись из count полей с колонками 0..count-1. */
+class dataset {
+  std::vector<std::string> strings_;
+
+public:
+  record fields;
+
+  explicit dataset(unsigned count) : strings_(count) {
+    for (unsigned col = 0; col < count; ++col) {
+      value v = value();
+      v.col = col;
+      v.type = kind_of(col);
+      switch (v.type) {
+      case k_uint32:
+        v.u32 = col * 1000003u;
+        break;
+      case k_int64:
+        v.i64 = -(int64_t)col * 1000000007;
+        break;
+      case k_fp64:
+        v.fp64 = col / 3.0;
+        break;
+      case k_str:
+        strings_[col] = "value-" + std::to_string(col);
+        v.str = strings_[col].c_str();
+        v.len = strings_[col].size();
+        break;
+      }
+      fields.push_back(v);
+    }
+  }
+};
+
+/* Контрольная сумма, не зависящая от порядка полей. */
+static inline uint64_t checksum(const value &v) {
+  uint64_t bits = 0;
+  switch (v.type) {
+  case k_uint32:
+    bits = v.u32;
+    break;
+  case k_int64:
+    bits = (uint64_t)v.i64;
+    break;
+  case k_fp64:
+    memcpy(&bits, &v.fp64, sizeof(bits));
+    break;
+  case k_str:
+    bits = UINT64_C(14695981039346656037);
+    for (size_t i = 0; i < v.len; ++i)
+      bits = (bits ^ (uint8_t)v.str[i]) * UINT64_C(1099511628211);
+    break;
+  }
+  return (bits + v.col) * UINT64_C(0x9E3779B97F4A7C15);
+}
+
+static inline uint64_t checksum(const record &fields) {
+  uint64_t sum = 0;
+  for (const auto &v : fields)
+    sum += checksum(v);
+  return sum;
+}
+
+//----------------------------------------------------------------------------
+
+namespace msgpack {
+
+static inline uint8_t *put_be(uint8_t *ptr, uint64_t value, unsigned bytes) {
+  for (unsigned i = bytes; i > 0; --i)
+    *ptr++ = (uint8_t)(value >> ((i - 1) * 8));
+  return ptr;
+}
+
+static inline uint64_t get_be(const uint8_t *&ptr, unsigned bytes) {
+  uint64_t value = 0;
+  for (unsigned i = 0; i < bytes; ++i)
+    value = (value << 8) | *ptr++;
+  return value;
+}
+
+static inline uint8_t *put_uint(uint8_t *ptr, uint64_t value) {
+  if (value < 128)
+    *ptr++ = (uint8_t)value;
+  else if (value <= UINT8_MAX) {
+    *ptr++ = 0xcc;
+    *ptr++ = (uint8_t)value;
+  } else if (value <= UINT16_MAX) {
+    *ptr++ = 0xcd;
+    ptr = put_be(ptr, value, 2);
+  } else if (value <= UINT32_MAX) {
+    *ptr++ = 0xce;
+    ptr = put_be(ptr, value, 4);
+  } else {
+    *ptr++ = 0xcf;
+    ptr = put_be(ptr, value, 8);
+  }
+  return ptr;
+}
+
+static inline uint8_t *put_int(uint8_t *ptr, int64_t value) {
+  if (value >= 0)
+    return put_uint(ptr, (uint64_t)value);
+  if (value >= -32)
+    *ptr++ = (uint8_t)value;
+  else if (value >= INT8_MIN) {
+    *ptr++ = 0xd0;
+    *ptr++ = (uint8_t)value;
+  } else if (value >= INT16_MIN) {
+    *ptr++ = 0xd1;
+    ptr = put_be(ptr, (uint64_t)value, 2);
+  } else if (value >= INT32_MIN) {
+    *ptr++ = 0xd2;
+    ptr = put_be(ptr, (uint64_t)value, 4);
+  } else {
+    *ptr++ = 0xd3;
+    ptr = put_be(ptr, (uint64_t)value, 8);
+  }
+  return ptr;
+}
+
+static inline size_t encode(const record &fields, uint8_t *buffer) {
+  uint8_t *ptr = buffer;
+  const size_t n = fields.size();
+  if (n < 16)
+    *ptr++ = (uint8_t)(0x80 | n);
+  else {
+    *ptr++ = 0xde;
+    ptr = put_be(ptr, n, 2);
+  }
+
+  for (const auto &v : fields) {
+    ptr = put_uint(ptr, v.col);
+    switch (v.type) {
+    case k_uint32:
+      ptr = put_uint(ptr, v.u32);
+      break;
+    case k_int64:
+      ptr = put_int(ptr, v.i64);
+      break;
+    case k_fp64: {
+      uint64_t bits;
+      memcpy(&bits, &v.fp64, sizeof(bits));
+      *ptr++ = 0xcb;
+      ptr = put_be(ptr, bits, 8);
+    } break;
+    case k_str:
+      if (v.len < 32)
+        *ptr++ = (uint8_t)(0xa0 | v.len);
+      else if (v.len <= UINT8_MAX) {
+        *ptr++ = 0xd9;
+        *ptr++ = (uint8_t)v.len;
+      } else {
+        *ptr++ = 0xda;
+        ptr = put_be(ptr, v.len, 2);
+      }
+      memcpy(ptr, v.str, v.len);
+      ptr += v.len;
+      break;
+    }
+  }
+  return (size_t)(ptr - buffer);
+}
+
+/* Разбор одного объекта (целого, double или строки). */
+static inline const uint8_t *decode_object(const uint8_t *ptr, value &v) {
+  const uint8_t tag = *ptr++;
+  if (tag < 0x80) {
+    v.i64 = tag;
+  } else if (tag >= 0xe0) {
+    v.i64 = (int8_t)tag;
+  } else if ((tag & 0xe0) == 0xa0) {
+    v.len = tag & 31;
+    v.str = (const char *)ptr;
+    ptr += v.len;
+  } else {
+    switch (tag) {
+    case 0xcc:
+    case 0xcd:
+    case 0xce:
+    case 0xcf:
+      v.i64 = (int64_t)get_be(ptr, 1u << (tag - 0xcc));
+      break;
+    case 0xd0:
+      v.i64 = (int8_t)get_be(ptr, 1);
+      break;
+    case 0xd1:
+      v.i64 = (int16_t)get_be(ptr, 2);
+      break;
+    case 0xd2:
+      v.i64 = (int32_t)get_be(ptr, 4);
+      break;
+    case 0xd3:
+      v.i64 = (int64_t)get_be(ptr, 8);
+      break;
+    case 0xcb: {
+      const uint64_t bits = get_be(ptr, 8);
+      memcpy(&v.fp64, &bits, sizeof(bits));
+    } break;
+    case 0xd9:
+    case 0xda:
+      v.len = (size_t)get_be(ptr, tag - 0xd8u);
+      v.str = (const char *)ptr;
+      ptr += v.len;
+      break;
+    default:
+      assert(false);
+    }
+  }
+  if (v.type == k_uint32)
+    v.u32 = (uint32_t)v.i64;
+  return ptr;
+}
+
+static inline size_t map_size(const uint8_t *&ptr) {
+  const uint8_t tag = *ptr++;
+  return (tag == 0xde) ? (size_t)get_be(ptr, 2) : (size_t)(tag & 15);
+}
+
+static inline void decode(const uint8_t *ptr, record &fields) {
+  fields.resize(map_size(ptr));
+  for (auto &v : fields) {
+    value key = value();
+    key.type = k_int64;
+    ptr = decode_object(ptr, key);
+    v.col = (unsigned)key.i64;
+    v.type = kind_of(v.col);
+    ptr = decode_object(ptr, v);
+  }
+}
+
+/* Поиск нескольких полей за один последовательный проход. */
+static inline uint64_t read(const uint8_t *ptr, const unsigned *cols,
+                            size_t ncols) {
+  uint64_t sum = 0;
+  size_t found = 0;
+  for (size_t n = map_size(ptr); n > 0 && found < ncols; --n) {
+    value key = value(), v = value();
+    key.type = k_int64;
+    ptr = decode_object(ptr, key);
+    v.col = (unsigned)key.i64;
+    v.type = kind_of(v.col);
+    ptr = decode_object(ptr, v);
+    for (size_t i = 0; i < ncols; ++i)
+      if (cols[i] == v.col) {
+        sum += checksum(v);
+        ++found;
+      }
+  }
+  return sum;
+}
+
+} /* namespace msgpack */
+
+//----------------------------------------------------------------------------
+
+namespace protobuf {
+
+static inline uint8_t *put_varint(uint8_t *ptr, uint64_t value) {
+  while (value >= 128) {
+    *ptr++ = (uint8_t)(value | 128);
+    value >>= 7;
+  }
+  *ptr++ = (uint8_t)value;
+  return ptr;
+}
+
+static inline uint64_t get_varint(const uint8_t *&ptr) {
+  uint64_t value = 0;
+  for (unsigned shift = 0;; shift += 7) {
+    const uint8_t byte = *ptr++;
+    value |= (uint64_t)(byte & 127) << shift;
+    if (byte < 128)
+      return value;
+  }
+}
+
+enum wire { wt_varint = 0, wt_fixed64 = 1, wt_bytes = 2 };
+
+static inline size_t encode(const record &fields, uint8_t *buffer) {
+  uint8_t *ptr = buffer;
+  for (const auto &v : fields) {
+    const uint64_t number = (uint64_t)v.col + 1;
+    switch (v.type) {
+    case k_uint32:
+      ptr = put_varint(ptr, number << 3 | wt_varint);
+      ptr = put_varint(ptr, v.u32);
+      break;
+    case k_int64: /* sint64, т.е. zigzag */
+      ptr = put_varint(ptr, number << 3 | wt_varint);
+      ptr = put_varint(ptr, ((uint64_t)v.i64 << 1) ^ (uint64_t)(v.i64 >> 63));
+      break;
+    case k_fp64:
+      ptr = put_varint(ptr, number << 3 | wt_fixed64);
+      memcpy(ptr, &v.fp64, 8);
+      ptr += 8;
+      break;
+    case k_str:
+      ptr = put_varint(ptr, number << 3 | wt_bytes);
+      ptr = put_varint(ptr, v.len);
+      memcpy(ptr, v.str, v.len);
+      ptr += v.len;
+      break;
+    }
+  }
+  return (size_t)(ptr - buffer);
+}
+
+static inline const uint8_t *decode_field(const uint8_t *ptr, value &v) {
+  const uint64_t key = get_varint(ptr);
+  v.col = (unsigned)(key >> 3) - 1;
+  v.type = kind_of(v.col);
+  switch (v.type) {
+  case k_uint32:
+    v.u32 = (uint32_t)get_varint(ptr);
+    break;
+  case k_int64: {
+    const uint64_t zigzag = get_varint(ptr);
+    v.i64 = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+  } break;
+  case k_fp64:
+    memcpy(&v.fp64, ptr, 8);
+    ptr += 8;
+    break;
+  case k_str:
+    v.len = (size_t)get_varint(ptr);
+    v.str = (const char *)ptr;
+    ptr += v.len;
+    break;
+  }
+  return ptr;
+}
+
+static inline void decode(const uint8_t *ptr, size_t bytes, record &fields) {
+  fields.clear();
+  const uint8_t *const end = ptr + bytes;
+  while (ptr < end) {
+    value v = value();
+    ptr = decode_field(ptr, v);
+    fields.push_back(v);
+  }
+}
+
+static inline uint64_t read(const uint8_t *ptr, size_t bytes,
+                            const unsigned *cols, size_t ncols) {
+  uint64_t sum = 0;
+  size_t found = 0;
+  const uint8_t *const end = ptr + bytes;
+  while (ptr < end && found < ncols) {
+    value v = value();
+    ptr = decode_field(ptr, v);
+    for (size_t i = 0; i < ncols; ++i)
+      if (cols[i] == v.col) {
+        sum += checksum(v);
+        ++found;
+      }
+  }
+  return sum;
+}
+
+} /* namespace protobuf */
+
+//----------------------------------------------------------------------------
+
+namespace flat {
+
+/* Раскладка: uint16 количество слотов, затем uint16 смещения значений
+ * от начала буфера (0 - поле отсутствует), далее выровненные значения.
+ * Строки хранятся как uint32 длина и байты с завершающим нулем. */
+
+static inline size_t align(size_t offset, size_t alignment) {
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+static inline size_t encode(const record &fields, uint8_t *buffer) {
+  unsigned slots = 0;
+  for (const auto &v : fields)
+    if (slots <= v.col)
+      slots = v.col + 1;
+
+  uint16_t *const vtable = (uint16_t *)buffer;
+  vtable[0] = (uint16_t)slots;
+  memset(vtable + 1, 0, slots * sizeof(uint16_t));
+  size_t offset = align(sizeof(uint16_t) * (1 + slots), 8);
+  for (const auto &v : fields) {
+    switch (v.type) {
+    case k_uint32:
+      offset = align(offset, 4);
+      memcpy(buffer + offset, &v.u32, 4);
+      vtable[1 + v.col] = (uint16_t)offset;
+      offset += 4;
+      break;
+    case k_int64:
+    case k_fp64:
+      offset = align(offset, 8);
+      memcpy(buffer + offset, &v.i64, 8);
+      vtable[1 + v.col] = (uint16_t)offset;
+      offset += 8;
+      break;
+    case k_str: {
+      offset = align(offset, 4);
+      const uint32_t len = (uint32_t)v.len;
+      memcpy(buffer + offset, &len, 4);
+      memcpy(buffer + offset + 4, v.str, v.len);
+      buffer[offset + 4 + v.len] = 0;
+      vtable[1 + v.col] = (uint16_t)offset;
+      offset += 4 + v.len + 1;
+    } break;
+    }
+    assert(offset <= UINT16_MAX);
+  }
+  return offset;
+}
+
+static inline bool get(const uint8_t *buffer, unsigned col, value &v) {
+  const uint16_t *const vtable = (const uint16_t *)buffer;
+  if (col >= vtable[0] || vtable[1 + col] == 0)
+    return false;
+  const uint8_t *const ptr = buffer + vtable[1 + col];
+  v.col = col;
+  v.type = kind_of(col);
+  switch (v.type) {
+  case k_uint32:
+    memcpy(&v.u32, ptr, 4);
+    break;
+  case k_int64:
+  case k_fp64:
+    memcpy(&v.i64, ptr, 8);
+    break;
+  case k_str: {
+    uint32_t len;
+    memcpy(&len, ptr, 4);
+    v.len = len;
+    v.str = (const char *)ptr + 4;
+  } break;
+  }
+  return true;
+}
+
+static inline void decode(const uint8_t *buffer, record &fields) {
+  fields.clear();
+  const unsigned slots = *(const uint16_t *)buffer;
+  for (unsigned col = 0; col < slots; ++col) {
+    value v = value();
+    if (get(buffer, col, v))
+      fields.push_back(v);
+  }
+}
+
+static inline uint64_t read(const uint8_t *buffer, const unsigned *cols,
+                            size_t ncols) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < ncols; ++i) {
+    value v = value();
+    if (get(buffer, cols[i], v))
+      sum += checksum(v);
+  }
+  return sum;
+}
+
+} /* namespace flat */
+
+} /* namespace formats */
@@ -0,0 +1,553 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fast_positive/tuples.h"
+#include "fast_positive/tuples_inline.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+/* Тестовые кортежи из N полей с номерами колонок 0..N-1 и смесью типов:
+ * uint32, int64, fp64 и короткие строки. Для запуска и сохранения
+ * результатов в JSON предназначена цель `perf`, либо непосредственно:
+ *   pt_fptu_perf --benchmark_format=json */
+
+static const size_t perf_data_bytes = 16;
+
+static std::vector<unsigned> perf_columns(unsigned count, bool ordered) {
+  std::vector<unsigned> columns(count);
+  for (unsigned i = 0; i < count; ++i)
+    columns[i] = i;
+  if (!ordered)
+    std::shuffle(columns.begin(), columns.end(), std::mt19937(count));
+  return columns;
+}
+
+static int perf_insert(fptu_rw *pt, unsigned col) {
+  switch (col % 4) {
+  case 0:
+    return fptu_insert_uint32(pt, col, col);
+  case 1:
+    return fptu_insert_int64(pt, col, -(int64_t)col);
+  case 2:
+    return fptu_insert_fp64(pt, col, col / 3.0);
+  default:
+    return fptu_insert_cstr(pt, col, ("value-" + std::to_string(col)).c_str());
+  }
+}
+
+/* Кортеж вместе с буфером, в котором он размещен. */
+class perf_tuple {
+  std::vector<char> space_;
+  fptu_rw *pt_;
+
+public:
+  /* с запасом на одно поле для изменения кортежа */
+  perf_tuple(unsigned count, bool ordered = true)
+      : space_(fptu_space(count + 1, (count + 1) * perf_data_bytes)) {
+    pt_ = fptu_init(space_.data(), space_.size(), count + 1);
+    for (unsigned col : perf_columns(count, ordered))
+      if (perf_insert(pt_, col) != FPTU_OK)
+        abort();
+  }
+
+  fptu_rw *rw() { return pt_; }
+  fptu_ro ro() { return fptu_take(pt_); }
+  const std::vector<char> &space() const { return space_; }
+};
+
+//----------------------------------------------------------------------------
+
+static void Build(benchmark::State &state) {
+  const unsigned count = (unsigned)state.range(0);
+  const std::vector<unsigned> columns = perf_columns(count, true);
+  std::vector<char> space(fptu_space(count, count * perf_data_bytes));
+  for (auto _ : state) {
+    fptu_rw *pt = fptu_init(space.data(), space.size(), count);
+    for (unsigned col : columns)
+      perf_insert(pt, col);
+    benchmark::DoNotOptimize(fptu_take(pt));
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(Build)->Arg(8)->Arg(64)->Arg(512);
+
+/* Запись из полей фиксированного размера: построение вставками
+ * и копированием образа фиксированной раскладки. */
+static void BuildFixed(benchmark::State &state) {
+  const unsigned count = (unsigned)state.range(0);
+  std::vector<char> space(fptu_space(count, count * 8));
+  uint64_t value = 0;
+  for (auto _ : state) {
+    fptu_rw *pt = fptu_init(space.data(), space.size(), count);
+    for (unsigned col = 0; col < count; ++col)
+      fptu_insert_uint64(pt, col, ++value);
+    benchmark::DoNotOptimize(fptu_take(pt));
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BuildFixed)->Arg(8)->Arg(64)->Arg(512);
+
+static void StampFixed(benchmark::State &state) {
+  const unsigned count = (unsigned)state.range(0);
+  std::vector<char> space(fptu_space(count, count * 8));
+  fptu_rw *pt = fptu_init(space.data(), space.size(), count);
+  for (unsigned col = 0; col < count; ++col)
+    fptu_insert_uint64(pt, col, 0);
+  const fptu_ro tmpl = fptu_take(pt);
+  std::vector<char> image(fptu_layout_space(tmpl));
+  const fptu_ro stamped = fptu_layout_stamp(tmpl, image.data(), image.size());
+  std::vector<size_t> offsets(count);
+  for (unsigned col = 0; col < count; ++col)
+    offsets[col] = fptu_layout_offset(stamped, col, fptu_uint64);
+
+  std::vector<char> record(image.size());
+  uint64_t value = 0;
+  for (auto _ : state) {
+    memcpy(record.data(), image.data(), image.size());
+    for (size_t offset : offsets)
+      *(uint64_t *)(record.data() + offset) = ++value;
+    benchmark::DoNotOptimize(record.data());
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(StampFixed)->Arg(8)->Arg(64)->Arg(512);
+
+/* Та же запись, что и в Build, но из шаблона с записью значений
+ * по индексам дескрипторов, которые у всех копий шаблона совпадают. */
+static void StampTemplate(benchmark::State &state) {
+  const unsigned count = (unsigned)state.range(0);
+  perf_tuple tuple(count);
+  const fptu_ro tmpl = tuple.ro();
+  std::vector<char> space(fptu_space(count, count * perf_data_bytes));
+  std::vector<size_t> index;
+  for (unsigned col = 0; col < count; col += 4)
+    index.push_back((size_t)(fptu_lookup_ro(tmpl, col, fptu_uint32) -
+                             fptu_begin_ro(tmpl)));
+  unsigned value = 0;
+  for (auto _ : state) {
+    fptu_rw *pt = fptu_fetch(tmpl, space.data(), space.size(), 0);
+    fptu_field *begin = &pt->units[pt->head].field;
+    for (size_t i : index)
+      fptu_field_payload(begin + i)->u32 = ++value;
+    benchmark::DoNotOptimize(fptu_take(pt));
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(StampTemplate)->Arg(8)->Arg(64)->Arg(512);
+
+static void Upsert(benchmark::State &state) {
+  const unsigned count = (unsigned)state.range(0);
+  perf_tuple tuple(count);
+  fptu_rw *pt = tuple.rw();
+  unsigned col = 0, value = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(fptu_upsert_uint32(pt, col, ++value));
+    col = (col + 4 < count) ? col + 4 : 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Upsert)->Arg(8)->Arg(64)->Arg(512);
+
+static void Take(benchmark::State &state) {
+  perf_tuple tuple((unsigned)state.range(0));
+  fptu_rw *pt = tuple.rw();
+  for (auto _ : state)
+    benchmark::DoNotOptimize(fptu_take(pt));
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(Take)->Arg(8)->Arg(64)->Arg(512);
+
+static void LookupHit(benchmark::State &state) {
+  const unsigned count = (unsigned)state.range(0);
+  perf_tuple tuple(count, false);
+  const fptu_ro ro = tuple.ro();
+  unsigned col = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(fptu_lookup_ro(ro, col, fptu_uint32));
+    col = (col + 4 < count) ? col + 4 : 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(LookupHit)->Arg(8)->Arg(64)->Arg(512);
+
+static void LookupMiss(benchmark::State &state) {
+  const unsigned count = (unsigned)state.range(0);
+  perf_tuple tuple(count, false);
+  const fptu_ro ro = tuple.ro();
+  for (auto _ : state)
+    benchmark::DoNotOptimize(fptu_lookup_ro(ro, count, fptu_uint32));
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(LookupMiss)->Arg(8)->Arg(64)->Arg(512);
+
+/* Промах по кортежу с картой присутствия тегов. */
+static void LookupMissBloom(benchmark::State &state) {
+  const unsigned count = (unsigned)state.range(0);
+  perf_tuple tuple(count, false);
+  const fptu_ro ro = fptu_take_bloom(tuple.rw());
+  for (auto _ : state)
+    benchmark::DoNotOptimize(fptu_lookup_ro(ro, count, fptu_uint32));
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(LookupMissBloom)->Arg(8)->Arg(64)->Arg(512);
+
+/* Чтение всех uint32 полей экспортируемыми и встраиваемыми функциями. */
+static void GetExported(benchmark::State &state) {
+  const unsigned count = (unsigned)state.range(0);
+  perf_tuple tuple(count, false);
+  const fptu_ro ro = tuple.ro();
+  for (auto _ : state)
+    for (unsigned col = 0; col < count; col += 4)
+      benchmark::DoNotOptimize(fptu_get_uint32(ro, col, nullptr));
+  state.SetItemsProcessed(state.iterations() * ((count + 3) / 4));
+}
+BENCHMARK(GetExported)->Arg(8)->Arg(64)->Arg(512);
+
+static void GetInline(benchmark::State &state) {
+  const unsigned count = (unsigned)state.range(0);
+  perf_tuple tuple(count, false);
+  const fptu_ro ro = tuple.ro();
+  for (auto _ : state)
+    for (unsigned col = 0; col < count; col += 4)
+      benchmark::DoNotOptimize(fptu_inline_get_uint32(ro, col, nullptr));
+  state.SetItemsProcessed(state.iterations() * ((count + 3) / 4));
+}
+BENCHMARK(GetInline)->Arg(8)->Arg(64)->Arg(512);
+
+/* Поиск в потоке кортежей одной формы с подсказками от предыдущего. */
+static void LookupHint(benchmark::State &state) {
+  const unsigned count = (unsigned)state.range(0);
+  perf_tuple tuple(count, false);
+  const std::vector<char> copy((const char *)tuple.ro().units,
+                               (const char *)tuple.ro().units +
+                                   tuple.ro().total_bytes);
+  const fptu_ro stream[2] = {tuple.ro(),
+                             {(const fptu_unit *)copy.data(), copy.size()}};
+  std::vector<unsigned> hints(count, 0);
+  unsigned n = 0;
+  for (auto _ : state) {
+    const fptu_ro &ro = stream[++n & 1];
+    for (unsigned col = 0; col < count; col += 4)
+      benchmark::DoNotOptimize(
+          fptu_lookup_ro_hint(ro, col, fptu_uint32, &hints[col]));
+  }
+  state.SetItemsProcessed(state.iterations() * ((count + 3) / 4));
+}
+BENCHMARK(LookupHint)->Arg(8)->Arg(64)->Arg(512);
+
+/* Перебор целочисленных полей через fptu_first_ex() с функцией-фильтром
+ * и через fptu::fields<> со встраиваемым фильтром. */
+static bool perf_filter_int(const fptu_field *pf, void *, void *) {
+  return (fptu_any_int & (1 << fptu_field_type(pf))) != 0;
+}
+
+static void IterateCallback(benchmark::State &state) {
+  perf_tuple tuple((unsigned)state.range(0));
+  const fptu_ro ro = tuple.ro();
+  const fptu_field *const end = fptu_end_ro(ro);
+  for (auto _ : state) {
+    size_t count = 0;
+    for (const fptu_field *pf = fptu_first_ex(fptu_begin_ro(ro), end,
+                                              perf_filter_int, nullptr,
+                                              nullptr);
+         pf != end;
+         pf = fptu_next_ex(pf, end, perf_filter_int, nullptr, nullptr))
+      ++count;
+    benchmark::DoNotOptimize(count);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(IterateCallback)->Arg(8)->Arg(64)->Arg(512);
+
+static void IterateRange(benchmark::State &state) {
+  perf_tuple tuple((unsigned)state.range(0));
+  const fptu_ro ro = tuple.ro();
+  for (auto _ : state) {
+    size_t count = 0;
+    for (const fptu_field &field : fptu::fields<fptu_any_int>(ro)) {
+      (void)field;
+      ++count;
+    }
+    benchmark::DoNotOptimize(count);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(IterateRange)->Arg(8)->Arg(64)->Arg(512);
+
+/* Подсчет полей для 20 тегов по одному и за один проход. */
+static std::vector<uint16_t> perf_tags(unsigned count) {
+  std::vector<uint16_t> tags;
+  for (unsigned i = 0; i < 20; ++i)
+    tags.push_back((uint16_t)(((i * count / 20) << fptu_co_shift) |
+                              fptu_uint32));
+  return tags;
+}
+
+static void CountEach(benchmark::State &state) {
+  const unsigned count = (unsigned)state.range(0);
+  perf_tuple tuple(count, false);
+  const fptu_ro ro = tuple.ro();
+  const std::vector<uint16_t> tags = perf_tags(count);
+  for (auto _ : state)
+    for (uint16_t tag : tags)
+      benchmark::DoNotOptimize(fptu_field_count_ro(
+          ro, tag >> fptu_co_shift, tag & fptu_ty_mask));
+  state.SetItemsProcessed(state.iterations() * tags.size());
+}
+BENCHMARK(CountEach)->Arg(8)->Arg(64)->Arg(512);
+
+static void CountTags(benchmark::State &state) {
+  const unsigned count = (unsigned)state.range(0);
+  perf_tuple tuple(count, false);
+  const fptu_ro ro = tuple.ro();
+  const std::vector<uint16_t> tags = perf_tags(count);
+  std::vector<size_t> counts(tags.size());
+  for (auto _ : state)
+    benchmark::DoNotOptimize(fptu_field_count_tags_ro(
+        ro, tags.data(), tags.size(), counts.data()));
+  state.SetItemsProcessed(state.iterations() * tags.size());
+}
+BENCHMARK(CountTags)->Arg(8)->Arg(64)->Arg(512);
+
+/* Поиск поля, добавленного первым, т.е. с последним дескриптором, до и
+ * после переупорядочивания посредством fptu_fetch_hot(). */
+static void lookup_first(benchmark::State &state, bool hot) {
+  const unsigned count = (unsigned)state.range(0);
+  perf_tuple tuple(count);
+  fptu_ro ro = tuple.ro();
+  std::vector<char> space(fptu_get_buffer_size(ro, 0, 0));
+  if (hot) {
+    const uint16_t tag = fptu_uint32;
+    fptu_rw *pt = fptu_fetch_hot(ro, space.data(), space.size(), 0, &tag, 1);
+    if (!pt)
+      abort();
+    ro = fptu_take_noshrink(pt);
+  }
+  for (auto _ : state)
+    benchmark::DoNotOptimize(fptu_lookup_ro(ro, 0, fptu_uint32));
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void LookupCold(benchmark::State &state) { lookup_first(state, false); }
+BENCHMARK(LookupCold)->Arg(8)->Arg(64)->Arg(512);
+
+static void LookupHot(benchmark::State &state) { lookup_first(state, true); }
+BENCHMARK(LookupHot)->Arg(8)->Arg(64)->Arg(512);
+
+static void Fetch(benchmark::State &state) {
+  const unsigned count = (unsigned)state.range(0);
+  perf_tuple tuple(count);
+  const fptu_ro ro = tuple.ro();
+  std::vector<char> space(fptu_space(count, count * perf_data_bytes));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(fptu_fetch(ro, space.data(), space.size(), 0));
+  state.SetBytesProcessed(state.iterations() * ro.total_bytes);
+}
+BENCHMARK(Fetch)->Arg(8)->Arg(64)->Arg(512);
+
+/* Дефрагментация кортежа после удаления каждого второго поля. Поскольку
+ * fptu_shrink() изменяет кортеж, то в каждой итерации он восстанавливается
+ * копированием, что также учитывается в результатах. */
+static void shrink_every_second(benchmark::State &state,
+                                bool (*shrink)(fptu_rw *)) {
+  const unsigned count = (unsigned)state.range(0);
+  perf_tuple tuple(count);
+  for (unsigned col = 0; col < count; col += 2)
+    fptu_erase(tuple.rw(), col, fptu_any);
+  const std::vector<char> &origin = tuple.space();
+  std::vector<char> space(origin.size());
+  for (auto _ : state) {
+    memcpy(space.data(), origin.data(), origin.size());
+    benchmark::DoNotOptimize(shrink((fptu_rw *)space.data()));
+  }
+  state.SetBytesProcessed(state.iterations() * origin.size());
+}
+
+static void Shrink(benchmark::State &state) {
+  shrink_every_second(state, fptu_shrink);
+}
+BENCHMARK(Shrink)->Arg(8)->Arg(64)->Arg(512);
+
+static void ShrinkHeader(benchmark::State &state) {
+  shrink_every_second(state, fptu_shrink_header);
+}
+BENCHMARK(ShrinkHeader)->Arg(8)->Arg(64)->Arg(512);
+
+/* Получение кортежа без мусора в буфер для отправки: дефрагментация
+ * на месте с последующим копированием, либо за один проход. */
+static void ShrinkThenCopy(benchmark::State &state) {
+  const unsigned count = (unsigned)state.range(0);
+  perf_tuple tuple(count);
+  for (unsigned col = 0; col < count; col += 2)
+    fptu_erase(tuple.rw(), col, fptu_any);
+  const std::vector<char> &origin = tuple.space();
+  std::vector<char> space(origin.size()), send(origin.size());
+  for (auto _ : state) {
+    memcpy(space.data(), origin.data(), origin.size());
+    const fptu_ro ro = fptu_take((fptu_rw *)space.data());
+    memcpy(send.data(), ro.units, ro.total_bytes);
+    benchmark::DoNotOptimize(send.data());
+  }
+  state.SetBytesProcessed(state.iterations() * origin.size());
+}
+BENCHMARK(ShrinkThenCopy)->Arg(8)->Arg(64)->Arg(512);
+
+static void TakeCompact(benchmark::State &state) {
+  const unsigned count = (unsigned)state.range(0);
+  perf_tuple tuple(count);
+  for (unsigned col = 0; col < count; col += 2)
+    fptu_erase(tuple.rw(), col, fptu_any);
+  const std::vector<char> &origin = tuple.space();
+  std::vector<char> space(origin.size()), send(origin.size());
+  for (auto _ : state) {
+    /* копирование исходника только для паритета с ShrinkThenCopy */
+    memcpy(space.data(), origin.data(), origin.size());
+    benchmark::DoNotOptimize(fptu_take_compact_into(
+        (const fptu_rw *)space.data(), send.data(), send.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * origin.size());
+}
+BENCHMARK(TakeCompact)->Arg(8)->Arg(64)->Arg(512);
+
+/* Большое значение, разбитое на state.range(0) фрагментов,
+ * как после приема из нескольких сетевых буферов. */
+static std::vector<struct iovec> fragments(benchmark::State &state,
+                                           std::vector<char> &blob) {
+  const size_t count = (size_t)state.range(0);
+  blob.assign(fptu_max_opaque_bytes - fptu_max_opaque_bytes % count, 'x');
+  std::vector<struct iovec> iov(count);
+  for (size_t i = 0; i < count; ++i) {
+    iov[i].iov_base = blob.data() + blob.size() / count * i;
+    iov[i].iov_len = blob.size() / count;
+  }
+  return iov;
+}
+
+static void CoalesceInsert(benchmark::State &state) {
+  std::vector<char> blob, coalesced, space;
+  const std::vector<struct iovec> iov = fragments(state, blob);
+  space.resize(fptu_space(1, fptu_unit_size + blob.size()));
+  coalesced.resize(blob.size());
+  for (auto _ : state) {
+    fptu_rw *pt = fptu_init(space.data(), space.size(), 1);
+    char *ptr = coalesced.data();
+    for (const struct iovec &io : iov) {
+      memcpy(ptr, io.iov_base, io.iov_len);
+      ptr += io.iov_len;
+    }
+    if (fptu_insert_opaque(pt, 1, coalesced.data(), coalesced.size()) !=
+        FPTU_OK)
+      abort();
+  }
+  state.SetBytesProcessed(state.iterations() * blob.size());
+}
+BENCHMARK(CoalesceInsert)->Arg(8)->Arg(64)->Arg(512);
+
+static void GatherInsert(benchmark::State &state) {
+  std::vector<char> blob, space;
+  const std::vector<struct iovec> iov = fragments(state, blob);
+  space.resize(fptu_space(1, fptu_unit_size + blob.size()));
+  for (auto _ : state) {
+    fptu_rw *pt = fptu_init(space.data(), space.size(), 1);
+    if (fptu_insert_opaque_gather(pt, 1, iov.data(), iov.size()) != FPTU_OK)
+      abort();
+  }
+  state.SetBytesProcessed(state.iterations() * blob.size());
+}
+BENCHMARK(GatherInsert)->Arg(8)->Arg(64)->Arg(512);
+
+static void CheckRo(benchmark::State &state) {
+  perf_tuple tuple((unsigned)state.range(0));
+  const fptu_ro ro = tuple.ro();
+  for (auto _ : state)
+    benchmark::DoNotOptimize(fptu_check_ro(ro));
+  state.SetBytesProcessed(state.iterations() * ro.total_bytes);
+}
+BENCHMARK(CheckRo)->Arg(8)->Arg(64)->Arg(512);
+
+static void ToJson(benchmark::State &state) {
+  perf_tuple tuple((unsigned)state.range(0));
+  const fptu_ro ro = tuple.ro();
+  std::vector<char> buffer(ro.total_bytes * 8);
+  size_t length = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(fptu_tuple2json_buffer(
+        ro, buffer.data(), buffer.size(), &length, nullptr, nullptr, nullptr,
+        0));
+  state.SetBytesProcessed(state.iterations() * length);
+}
+BENCHMARK(ToJson)->Arg(8)->Arg(64)->Arg(512);
+
+static void FromJson(benchmark::State &state) {
+  perf_tuple tuple((unsigned)state.range(0));
+  const std::string json = fptu::to_json(tuple.ro());
+  size_t items, data_bytes;
+  if (fptu_json_estimate(json.data(), json.size(), &items, &data_bytes) !=
+      FPTU_OK)
+    abort();
+  std::vector<char> space(fptu_space(items, data_bytes));
+  for (auto _ : state) {
+    fptu_rw *pt = fptu_init(space.data(), space.size(), items);
+    benchmark::DoNotOptimize(fptu_json2tuple(pt, json.data(), json.size(),
+                                             nullptr, nullptr, nullptr, 0));
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(FromJson)->Arg(8)->Arg(64)->Arg(512);
+
+static void ToString(benchmark::State &state) {
+  perf_tuple tuple((unsigned)state.range(0));
+  const fptu_ro ro = tuple.ro();
+  for (auto _ : state)
+    benchmark::DoNotOptimize(std::to_string(ro));
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(ToString)->Arg(8)->Arg(64)->Arg(512);
+
+/* Сравнение кортежей, отличающихся только последним (по порядку
+ * сравнения) полем, т.е. с перебором всех полей и без срабатывания
+ * fastpath для побайтно равных кортежей. */
+static void compare(benchmark::State &state, bool ordered) {
+  const unsigned count = (unsigned)state.range(0);
+  perf_tuple left(count, ordered), right(count, ordered);
+  if (fptu_upsert_cstr(right.rw(), count - 1, "~") != FPTU_OK)
+    abort();
+  const fptu_ro l_ro = left.ro(), r_ro = right.ro();
+  if (fptu_is_ordered(fptu_begin_ro(l_ro), fptu_end_ro(l_ro)) != ordered ||
+      fptu_is_ordered(fptu_begin_ro(r_ro), fptu_end_ro(r_ro)) != ordered ||
+      fptu_cmp_tuples(l_ro, r_ro) != fptu_lt)
+    state.SkipWithError("unexpected tuples layout");
+  for (auto _ : state)
+    benchmark::DoNotOptimize(fptu_cmp_tuples(l_ro, r_ro));
+  state.SetBytesProcessed(state.iterations() * l_ro.total_bytes * 2);
+}
+
+static void CmpOrdered(benchmark::State &state) { compare(state, true); }
+BENCHMARK(CmpOrdered)->Arg(8)->Arg(64)->Arg(512);
+
+static void CmpUnordered(benchmark::State &state) { compare(state, false); }
+BENCHMARK(CmpUnordered)->Arg(8)->Arg(64)->Arg(512);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,263 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fast_positive/tuples.h"
+#include "formats.hpp"
+
+#include <benchmark/benchmark.h>
+
+/* Сравнение libfptu с эталонными кодировщиками из formats.hpp на одних
+ * и тех же синтетических записях из 8, 64 и 512 полей. Для каждого
+ * формата измеряется:
+ *  - Build: формирование сериализованной записи;
+ *  - Read: чтение 4-х полей разных типов;
+ *  - Decode: полный разбор записи;
+ * а счетчик `bytes` показывает размер сериализованной записи.
+ *
+ * Запуск и сохранение результатов в JSON посредством цели `perf`. */
+
+using formats::record;
+using formats::value;
+
+class codec_fptu {
+  std::vector<char> space_;
+  fptu_ro ro_;
+
+public:
+  explicit codec_fptu(size_t count)
+      : space_(fptu_space(count, count * 32)) {
+    ro_.sys.iov_base = nullptr;
+    ro_.sys.iov_len = 0;
+  }
+
+  size_t encode(const record &fields) {
+    fptu_rw *pt = fptu_init(space_.data(), space_.size(), fields.size());
+    for (const auto &v : fields) {
+      switch (v.type) {
+      case formats::k_uint32:
+        fptu_insert_uint32(pt, v.col, v.u32);
+        break;
+      case formats::k_int64:
+        fptu_insert_int64(pt, v.col, v.i64);
+        break;
+      case formats::k_fp64:
+        fptu_insert_fp64(pt, v.col, v.fp64);
+        break;
+      case formats::k_str:
+        fptu_insert_cstr(pt, v.col, v.str);
+        break;
+      }
+    }
+    ro_ = fptu_take(pt);
+    return ro_.total_bytes;
+  }
+
+  uint64_t read(const unsigned *cols, size_t ncols) const {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < ncols; ++i) {
+      value v = value();
+      v.col = cols[i];
+      v.type = formats::kind_of(v.col);
+      int error;
+      switch (v.type) {
+      case formats::k_uint32:
+        v.u32 = fptu_get_uint32(ro_, v.col, &error);
+        break;
+      case formats::k_int64:
+        v.i64 = fptu_get_int64(ro_, v.col, &error);
+        break;
+      case formats::k_fp64:
+        v.fp64 = fptu_get_fp64(ro_, v.col, &error);
+        break;
+      case formats::k_str:
+        v.str = fptu_get_cstr(ro_, v.col, &error);
+        v.len = strlen(v.str);
+        break;
+      }
+      if (error == FPTU_OK)
+        sum += formats::checksum(v);
+    }
+    return sum;
+  }
+
+  void decode(record &fields) const {
+    fields.clear();
+    const fptu_field *const end = fptu_end_ro(ro_);
+    for (const fptu_field *pf = fptu_begin_ro(ro_); pf < end; ++pf) {
+      value v = value();
+      v.col = (unsigned)pf->colnum();
+      switch (pf->type()) {
+      case fptu_uint32:
+        v.type = formats::k_uint32;
+        v.u32 = (uint32_t)fptu_field_uint32(pf);
+        break;
+      case fptu_int64:
+        v.type = formats::k_int64;
+        v.i64 = fptu_field_int64(pf);
+        break;
+      case fptu_fp64:
+        v.type = formats::k_fp64;
+        v.fp64 = fptu_field_fp64(pf);
+        break;
+      case fptu_cstr:
+        v.type = formats::k_str;
+        v.str = fptu_field_cstr(pf);
+        v.len = strlen(v.str);
+        break;
+      default:
+        continue;
+      }
+      fields.push_back(v);
+    }
+  }
+};
+
+/* Общая часть эталонных кодировщиков: буфер и размер записи. */
+class codec_buffer {
+protected:
+  std::vector<uint64_t> space_;
+  size_t bytes_;
+
+  uint8_t *buffer() { return (uint8_t *)space_.data(); }
+  const uint8_t *buffer() const { return (const uint8_t *)space_.data(); }
+
+public:
+  explicit codec_buffer(size_t count) : space_(count * 4 + 8), bytes_(0) {}
+};
+
+class codec_msgpack : public codec_buffer {
+public:
+  explicit codec_msgpack(size_t count) : codec_buffer(count) {}
+  size_t encode(const record &fields) {
+    return bytes_ = formats::msgpack::encode(fields, buffer());
+  }
+  uint64_t read(const unsigned *cols, size_t ncols) const {
+    return formats::msgpack::read(buffer(), cols, ncols);
+  }
+  void decode(record &fields) const {
+    formats::msgpack::decode(buffer(), fields);
+  }
+};
+
+class codec_protobuf : public codec_buffer {
+public:
+  explicit codec_protobuf(size_t count) : codec_buffer(count) {}
+  size_t encode(const record &fields) {
+    return bytes_ = formats::protobuf::encode(fields, buffer());
+  }
+  uint64_t read(const unsigned *cols, size_t ncols) const {
+    return formats::protobuf::read(buffer(), bytes_, cols, ncols);
+  }
+  void decode(record &fields) const {
+    formats::protobuf::decode(buffer(), bytes_, fields);
+  }
+};
+
+class codec_flat : public codec_buffer {
+public:
+  explicit codec_flat(size_t count) : codec_buffer(count) {}
+  size_t encode(const record &fields) {
+    return bytes_ = formats::flat::encode(fields, buffer());
+  }
+  uint64_t read(const unsigned *cols, size_t ncols) const {
+    return formats::flat::read(buffer(), cols, ncols);
+  }
+  void decode(record &fields) const { formats::flat::decode(buffer(), fields); }
+};
+
+//----------------------------------------------------------------------------
+
+/* Читаемые поля: по одному каждого типа, из начала, середины и конца. */
+static void read_columns(unsigned count, unsigned cols[4]) {
+  cols[0] = 1;
+  cols[1] = count / 2;
+  cols[2] = count - 2;
+  cols[3] = count - 1;
+}
+
+/* Проверка корректности кодировщика до начала измерений. */
+template <class codec>
+static bool verify(benchmark::State &state, codec &subject,
+                   const formats::dataset &data) {
+  state.counters["bytes"] = (double)subject.encode(data.fields);
+
+  record decoded;
+  subject.decode(decoded);
+  unsigned cols[4];
+  read_columns((unsigned)data.fields.size(), cols);
+  uint64_t expected = 0;
+  for (unsigned col : cols)
+    expected += formats::checksum(data.fields[col]);
+
+  if (decoded.size() != data.fields.size() ||
+      formats::checksum(decoded) != formats::checksum(data.fields) ||
+      subject.read(cols, 4) != expected) {
+    state.SkipWithError("codec self-check failed");
+    return false;
+  }
+  return true;
+}
+
+template <class codec> static void Build(benchmark::State &state) {
+  const formats::dataset data((unsigned)state.range(0));
+  codec subject(data.fields.size());
+  if (!verify(state, subject, data))
+    return;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(subject.encode(data.fields));
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <class codec> static void Read(benchmark::State &state) {
+  const formats::dataset data((unsigned)state.range(0));
+  codec subject(data.fields.size());
+  if (!verify(state, subject, data))
+    return;
+  unsigned cols[4];
+  read_columns((unsigned)data.fields.size(), cols);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(subject.read(cols, 4));
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <class codec> static void Decode(benchmark::State &state) {
+  const formats::dataset data((unsigned)state.range(0));
+  codec subject(data.fields.size());
+  if (!verify(state, subject, data))
+    return;
+  record decoded;
+  decoded.reserve(data.fields.size());
+  for (auto _ : state) {
+    subject.decode(decoded);
+    benchmark::DoNotOptimize(decoded.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+#define FORMATS_BENCHMARK(codec)                                               \
+  BENCHMARK_TEMPLATE(Build, codec)->Arg(8)->Arg(64)->Arg(512);                 \
+  BENCHMARK_TEMPLATE(Read, codec)->Arg(8)->Arg(64)->Arg(512);                  \
+  BENCHMARK_TEMPLATE(Decode, codec)->Arg(8)->Arg(64)->Arg(512)
+
+FORMATS_BENCHMARK(codec_fptu);
+FORMATS_BENCHMARK(codec_msgpack);
+FORMATS_BENCHMARK(codec_protobuf);
+FORMATS_BENCHMARK(codec_flat);
+
+BENCHMARK_MAIN();
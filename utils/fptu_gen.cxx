@@ -0,0 +1,509 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Генератор C++ классов доступа к полям кортежей по описанию схемы.
+ *
+ * Описание схемы состоит из структур, каждое поле на отдельной строке:
+ *
+ *   # комментарий до конца строки
+ *   struct address {
+ *     city      1  cstr
+ *     zip       2  uint32
+ *   }
+ *   struct person {
+ *     name      1  cstr
+ *     phone     2  cstr    repeated
+ *     home      3  nested  address
+ *   }
+ *
+ * Тип поля задается как в fptu_type_name(), для вложенных кортежей можно
+ * указать ранее описанную структуру, а "repeated" отмечает коллекции.
+ * Ссылки на саму себя или на описанную далее структуру не допускаются.
+ *
+ * Для каждой структуры генерируются:
+ *  - fields::имя, как fptu::column_traits<колонка, тип> с constexpr тегом;
+ *  - ro, представление fptu_ro с методами имя() и has_имя();
+ *  - rw, обертка fptu_rw* с методами set_имя(), add_имя() и erase_имя(),
+ *    причем последний удаляет все экземпляры поля;
+ *  - schema(), экземпляр fptu_schema для JSON и проверки кортежей.
+ *
+ * Номера колонок и типы подставляются в вызовы константами, а поиск полей
+ * в ro выполняется встраиваемыми функциями из tuples_inline.h, поэтому
+ * доступ к полю не дороже написанного вручную fptu_lookup_ro(). */
+
+#include "fast_positive/tuples.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [options] SCHEMA\n"
+          "Generate a header-only C++ accessors for tuples described by "
+          "SCHEMA.\n"
+          "  -o FILE           output file (default: stdout)\n"
+          "  -n NAMESPACE      enclose generated structs into namespace\n",
+          prog);
+}
+
+struct gen_field {
+  std::string name;
+  unsigned column;
+  fptu_type type;
+  int nested; /* индекс структуры вложенного кортежа, либо -1 */
+  bool repeated;
+};
+
+struct gen_struct {
+  std::string name;
+  std::vector<gen_field> fields;
+};
+
+/* Отображение типа поля на C/C++ API */
+struct gen_type {
+  const char *value; /* тип значения для C++ */
+  const char *suffix; /* суффикс функций fptu_upsert_xyz() и т.п. */
+  const char *param;  /* параметры для set_xyz() и add_xyz() */
+  const char *args;   /* аргументы для fptu_upsert_xyz() */
+  const char *denil;  /* значение отсутствующего поля для чисел */
+};
+
+static const gen_type *gen_type_of(fptu_type type) {
+  static const gen_type null = {"bool", "null", "", "", nullptr};
+  static const gen_type uint16 = {"uint_fast16_t", "uint16",
+                                  "uint_fast16_t value", ", value",
+                                  "FPTU_DENIL_UINT16"};
+  static const gen_type int32 = {"int_fast32_t", "int32",
+                                 "int_fast32_t value", ", value",
+                                 "FPTU_DENIL_INT32"};
+  static const gen_type uint32 = {"uint_fast32_t", "uint32",
+                                  "uint_fast32_t value", ", value",
+                                  "FPTU_DENIL_UINT32"};
+  static const gen_type fp32 = {"float_t", "fp32", "float_t value",
+                                ", value", "FPTU_DENIL_FP32"};
+  static const gen_type int64 = {"int_fast64_t", "int64",
+                                 "int_fast64_t value", ", value",
+                                 "FPTU_DENIL_INT64"};
+  static const gen_type uint64 = {"uint_fast64_t", "uint64",
+                                  "uint_fast64_t value", ", value",
+                                  "FPTU_DENIL_UINT64"};
+  static const gen_type fp64 = {"double_t", "fp64", "double_t value",
+                                ", value", "FPTU_DENIL_FP64"};
+  static const gen_type datetime = {"fptu_time", "datetime",
+                                    "const fptu_time value", ", value",
+                                    nullptr};
+  static const gen_type b96 = {"const uint8_t *", "96", "const void *data",
+                               ", data", nullptr};
+  static const gen_type b128 = {"const uint8_t *", "128", "const void *data",
+                                ", data", nullptr};
+  static const gen_type b160 = {"const uint8_t *", "160", "const void *data",
+                                ", data", nullptr};
+  static const gen_type b256 = {"const uint8_t *", "256", "const void *data",
+                                ", data", nullptr};
+  static const gen_type cstr = {"const char *", "cstr", "const char *value",
+                                ", value", nullptr};
+  static const gen_type opaque = {"struct iovec", "opaque",
+                                  "const void *value, size_t bytes",
+                                  ", value, bytes", nullptr};
+  static const gen_type nested = {"fptu_ro", "nested", "fptu_ro value",
+                                  ", value", nullptr};
+
+  switch (type) {
+  default:
+    return nullptr;
+  case fptu_null:
+    return &null;
+  case fptu_uint16:
+    return &uint16;
+  case fptu_int32:
+    return &int32;
+  case fptu_uint32:
+    return &uint32;
+  case fptu_fp32:
+    return &fp32;
+  case fptu_int64:
+    return &int64;
+  case fptu_uint64:
+    return &uint64;
+  case fptu_fp64:
+    return &fp64;
+  case fptu_datetime:
+    return &datetime;
+  case fptu_96:
+    return &b96;
+  case fptu_128:
+    return &b128;
+  case fptu_160:
+    return &b160;
+  case fptu_256:
+    return &b256;
+  case fptu_cstr:
+    return &cstr;
+  case fptu_opaque:
+    return &opaque;
+  case fptu_nested:
+    return &nested;
+  }
+}
+
+/* Имя элемента fptu_type, которое для b96 и т.п. отличается от
+ * fptu_type_name() */
+static std::string gen_enum(fptu_type type) {
+  return std::string("fptu_") + ((type >= fptu_96 && type <= fptu_256)
+                                     ? gen_type_of(type)->suffix
+                                     : fptu_type_name(type));
+}
+
+//----------------------------------------------------------------------------
+
+class gen_parser {
+  const char *const filename_;
+  unsigned line_;
+  std::string error_;
+
+  bool fail(const char *what, const std::string &token) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), ":%u: ", line_);
+    error_ = std::string(filename_) + buf + what + " '" + token + "'";
+    return false;
+  }
+
+  static bool is_identifier(const std::string &token) {
+    if (token.empty() || (token[0] >= '0' && token[0] <= '9'))
+      return false;
+    for (const char c : token)
+      if (!(c == '_' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+            (c >= 'A' && c <= 'Z')))
+        return false;
+    return true;
+  }
+
+  static std::vector<std::string> split(const std::string &line) {
+    std::vector<std::string> tokens;
+    std::string token;
+    for (const char c : line) {
+      if (c == '#')
+        break;
+      if (c == ' ' || c == '\t' || c == '\r' || c == '{' || c == '}') {
+        if (!token.empty())
+          tokens.push_back(token);
+        token.clear();
+        if (c == '{' || c == '}')
+          tokens.push_back(std::string(1, c));
+      } else
+        token.push_back(c);
+    }
+    if (!token.empty())
+      tokens.push_back(token);
+    return tokens;
+  }
+
+  int find_struct(const std::string &name) const {
+    for (size_t i = 0; i < structs.size(); ++i)
+      if (structs[i].name == name)
+        return (int)i;
+    return -1;
+  }
+
+  bool parse_field(const std::vector<std::string> &tokens) {
+    gen_struct &s = structs.back();
+    gen_field field;
+    field.name = tokens[0];
+    if (!is_identifier(field.name))
+      return fail("invalid field name", field.name);
+    for (const gen_field &other : s.fields)
+      if (other.name == field.name)
+        return fail("duplicate field", field.name);
+
+    if (tokens.size() < 3)
+      return fail("expected column and type for field", field.name);
+    char *end;
+    errno = 0;
+    const unsigned long column = strtoul(tokens[1].c_str(), &end, 10);
+    if (errno || *end || end == tokens[1].c_str() || column > fptu_max_cols)
+      return fail("invalid column number", tokens[1]);
+    field.column = (unsigned)column;
+
+    unsigned t;
+    for (t = fptu_null; t < fptu_farray; ++t)
+      if (tokens[2] == fptu_type_name((fptu_type)t))
+        break;
+    if (t == fptu_farray || !gen_type_of((fptu_type)t))
+      return fail("unsupported type", tokens[2]);
+    field.type = (fptu_type)t;
+    for (const gen_field &other : s.fields)
+      if (other.column == field.column && other.type == field.type)
+        return fail("duplicate column and type for field", field.name);
+
+    field.nested = -1;
+    field.repeated = false;
+    for (size_t i = 3; i < tokens.size(); ++i) {
+      if (tokens[i] == "repeated" && !field.repeated)
+        field.repeated = true;
+      else if (field.type == fptu_nested && field.nested < 0) {
+        /* только ранее описанные структуры, иначе schema() вложенной
+         * структуры рекурсивно вызовет саму себя при инициализации */
+        const int nested = find_struct(tokens[i]);
+        if (nested + 1 == (int)structs.size())
+          return fail("self-referencing nested struct", tokens[i]);
+        if (nested < 0)
+          return fail("undefined nested struct", tokens[i]);
+        field.nested = nested;
+      } else
+        return fail("unexpected", tokens[i]);
+    }
+
+    s.fields.push_back(field);
+    return true;
+  }
+
+public:
+  std::vector<gen_struct> structs;
+
+  explicit gen_parser(const char *filename) : filename_(filename), line_(0) {}
+  const std::string &error() const { return error_; }
+
+  bool parse(FILE *in) {
+    bool inside = false;
+    std::string line;
+    for (int c = 0; c != EOF;) {
+      line.clear();
+      while ((c = getc(in)) != EOF && c != '\n')
+        line.push_back((char)c);
+      line_ += 1;
+
+      const std::vector<std::string> tokens = split(line);
+      if (tokens.empty())
+        continue;
+      if (inside) {
+        if (tokens[0] == "}") {
+          if (tokens.size() > 1)
+            return fail("unexpected", tokens[1]);
+          if (structs.back().fields.empty())
+            return fail("empty struct", structs.back().name);
+          inside = false;
+        } else if (!parse_field(tokens))
+          return false;
+      } else {
+        if (tokens.size() != 3 || tokens[0] != "struct" || tokens[2] != "{")
+          return fail("expected 'struct NAME {' instead of", tokens[0]);
+        if (!is_identifier(tokens[1]))
+          return fail("invalid struct name", tokens[1]);
+        if (find_struct(tokens[1]) >= 0)
+          return fail("duplicate struct", tokens[1]);
+        structs.push_back(gen_struct());
+        structs.back().name = tokens[1];
+        inside = true;
+      }
+    }
+    if (ferror(in))
+      return fail("read error", strerror(errno));
+    if (inside)
+      return fail("unterminated struct", structs.back().name);
+    return true;
+  }
+};
+
+//----------------------------------------------------------------------------
+
+static void gen_ro(FILE *out, const std::vector<gen_struct> &structs,
+                   const gen_struct &s) {
+  fprintf(out, "  class ro {\n"
+               "    fptu_ro tuple_;\n\n"
+               "  public:\n"
+               "    explicit ro(const fptu_ro &tuple) : tuple_(tuple) {}\n"
+               "    const fptu_ro &tuple() const { return tuple_; }\n");
+
+  for (const gen_field &f : s.fields) {
+    const char *name = f.name.c_str();
+    const gen_type *t = gen_type_of(f.type);
+    fprintf(out,
+            "\n    bool has_%s() const {\n"
+            "      return fptu_inline_lookup_ro(tuple_, fields::%s::column,\n"
+            "                                   fields::%s::type) != nullptr;\n"
+            "    }\n",
+            name, name, name);
+    if (f.type == fptu_null)
+      continue;
+
+    const std::string value =
+        (f.nested < 0) ? t->value : structs[f.nested].name + "::ro";
+    fprintf(out,
+            "    %s%s%s(int *error = nullptr) const {\n"
+            "      const fptu_field *pf = fptu_inline_get(\n"
+            "          tuple_, fields::%s::column, fields::%s::type, error);\n",
+            value.c_str(), (value.back() == '*') ? "" : " ", name, name, name);
+    if (t->denil)
+      fprintf(out,
+              "      return pf ? fptu::get_number<%s, %s>(pf)\n"
+              "                : %s;\n",
+              gen_enum(f.type).c_str(), t->value, t->denil);
+    else if (f.nested < 0)
+      fprintf(out, "      return fptu_field_%s(pf);\n", t->suffix);
+    else
+      fprintf(out, "      return %s(fptu_field_nested(pf));\n", value.c_str());
+    fprintf(out, "    }\n");
+  }
+  fprintf(out, "  };\n\n");
+}
+
+static void gen_rw(FILE *out, const gen_struct &s) {
+  fprintf(out, "  class rw {\n"
+               "    fptu_rw *pt_;\n\n"
+               "  public:\n"
+               "    explicit rw(fptu_rw *pt) : pt_(pt) {}\n"
+               "    fptu_rw *tuple() const { return pt_; }\n"
+               "    ro view() const { return ro(fptu_take_noshrink(pt_)); }\n");
+
+  for (const gen_field &f : s.fields) {
+    const char *name = f.name.c_str();
+    const gen_type *t = gen_type_of(f.type);
+    fprintf(out,
+            "\n    int set_%s(%s) {\n"
+            "      return fptu_upsert_%s(pt_, fields::%s::column%s);\n"
+            "    }\n",
+            name, t->param, t->suffix, name, t->args);
+    if (f.type != fptu_null)
+      fprintf(out,
+              "    int add_%s(%s) {\n"
+              "      return fptu_insert_%s(pt_, fields::%s::column%s);\n"
+              "    }\n",
+              name, t->param, t->suffix, name, t->args);
+    fprintf(out,
+            "    int erase_%s() {\n"
+            "      return fptu_erase(pt_, fields::%s::column,\n"
+            "                        fptu_filter | (INT32_C(1) << "
+            "fields::%s::type));\n"
+            "    }\n",
+            name, name, name);
+  }
+  fprintf(out, "  };\n\n");
+}
+
+static void gen_schema(FILE *out, const std::vector<gen_struct> &structs,
+                       const gen_struct &s) {
+  fprintf(out, "  static const fptu_schema *schema() {\n"
+               "    static const std::unique_ptr<fptu_schema, void (*)(void "
+               "*)> instance(\n"
+               "        build_schema(), ::free);\n"
+               "    return instance.get();\n"
+               "  }\n\n"
+               "private:\n"
+               "  static fptu_schema *build_schema() {\n"
+               "    const fptu_schema_column columns[] = {\n");
+  for (const gen_field &f : s.fields) {
+    const std::string nested =
+        (f.nested < 0) ? "nullptr" : structs[f.nested].name + "::schema()";
+    fprintf(out, "        {\"%s\", %s, fields::%s::tag, %s},\n",
+            f.name.c_str(), nested.c_str(), f.name.c_str(),
+            f.repeated ? "true" : "false");
+  }
+  fprintf(out, "    };\n"
+               "    return fptu_schema_alloc(columns, %zu);\n"
+               "  }\n",
+               s.fields.size());
+}
+
+static void gen_header(FILE *out, const char *source, const char *ns,
+                       const std::vector<gen_struct> &structs) {
+  fprintf(out,
+          "/* Generated by fptu_gen from %s, do not edit. */\n\n"
+          "#pragma once\n\n"
+          "#include \"fast_positive/tuples.h\"\n"
+          "#include \"fast_positive/tuples_inline.h\"\n\n"
+          "#include <cstdlib>\n"
+          "#include <memory>\n\n",
+          source);
+  if (ns)
+    fprintf(out, "namespace %s {\n\n", ns);
+
+  for (const gen_struct &s : structs) {
+    fprintf(out, "struct %s {\n"
+                 "  struct fields {\n",
+            s.name.c_str());
+    for (const gen_field &f : s.fields)
+      fprintf(out, "    typedef fptu::column_traits<%u, %s> %s;\n", f.column,
+              gen_enum(f.type).c_str(), f.name.c_str());
+    fprintf(out, "  };\n\n");
+    gen_ro(out, structs, s);
+    gen_rw(out, s);
+    gen_schema(out, structs, s);
+    fprintf(out, "};\n\n");
+  }
+
+  if (ns)
+    fprintf(out, "} /* namespace %s */\n", ns);
+}
+
+int main(int argc, char *argv[]) {
+  const char *output = nullptr, *ns = nullptr, *input = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+      output = argv[++i];
+    else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      ns = argv[++i];
+    else if (strcmp(argv[i], "-h") == 0) {
+      usage(argv[0]);
+      return EXIT_SUCCESS;
+    } else if (argv[i][0] != '-' && !input)
+      input = argv[i];
+    else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (!input) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  FILE *in = fopen(input, "r");
+  if (!in) {
+    fprintf(stderr, "%s: %s: %s\n", argv[0], input, strerror(errno));
+    return EXIT_FAILURE;
+  }
+  gen_parser parser(input);
+  const bool ok = parser.parse(in);
+  fclose(in);
+  if (!ok) {
+    fprintf(stderr, "%s: %s\n", argv[0], parser.error().c_str());
+    return EXIT_FAILURE;
+  }
+
+  /* сначала во временный файл, чтобы не оставить обрезанный заголовок */
+  const std::string tmp = output ? std::string(output) + ".tmp" : "";
+  FILE *out = output ? fopen(tmp.c_str(), "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "%s: %s: %s\n", argv[0], tmp.c_str(), strerror(errno));
+    return EXIT_FAILURE;
+  }
+  const char *source = strrchr(input, '/');
+  gen_header(out, source ? source + 1 : input, ns, parser.structs);
+  if (fflush(out) != 0 || ferror(out) ||
+      (output && (fclose(out) != 0 || rename(tmp.c_str(), output) != 0))) {
+    fprintf(stderr, "%s: %s: %s\n", argv[0], output ? output : "stdout",
+            strerror(errno));
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
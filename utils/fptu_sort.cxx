@@ -0,0 +1,135 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/xsort.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [options] INPUT OUTPUT\n"
+          "Sort a file of serialized tuples (as produced by fptu_take()).\n"
+          "  -j THREADS        number of sorting threads (default: all cores)\n"
+          "  -m MEGABYTES      size of an in-memory run (default: 64)\n"
+          "  -T DIRECTORY      directory for temporary runs\n"
+          "  -k COL:TYPE[:desc][:WIDTH]\n"
+          "                    sort key column, may be repeated; by default\n"
+          "                    the whole tuples are compared\n"
+          "  -v                print statistics\n",
+          prog);
+}
+
+/* Разбор "колонка:тип[:desc][:ширина]", тип задается как в
+ * fptu_type_name(), например "int32" или "cstr". */
+static bool parse_key(const char *arg, fptu_keydef &key) {
+  memset(&key, 0, sizeof(key));
+  char *end;
+  const unsigned long column = strtoul(arg, &end, 10);
+  if (end == arg || *end != ':' || column > fptu_max_cols)
+    return false;
+  key.column = (uint16_t)column;
+
+  const char *type = end + 1;
+  const char *type_end = strchr(type, ':');
+  const size_t type_len = type_end ? (size_t)(type_end - type) : strlen(type);
+  unsigned t;
+  for (t = fptu_null; t < fptu_farray; ++t) {
+    const char *name = fptu_type_name((fptu_type)t);
+    if (strlen(name) == type_len && memcmp(name, type, type_len) == 0)
+      break;
+  }
+  if (t == fptu_farray)
+    return false;
+  key.type = (uint8_t)t;
+
+  for (const char *opt = type_end; opt; opt = strchr(opt + 1, ':')) {
+    if (strncmp(opt, ":desc", 5) == 0 && (opt[5] == ':' || opt[5] == 0))
+      key.descending = 1;
+    else {
+      const unsigned long width = strtoul(opt + 1, &end, 10);
+      if (end == opt + 1 || (*end != ':' && *end) || width > UINT16_MAX)
+        return false;
+      key.width = (uint16_t)width;
+    }
+  }
+  return fptu_key_size(&key, 1) != 0;
+}
+
+int main(int argc, char *argv[]) {
+  fptu::xsort_options options;
+  bool verbose = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "j:m:T:k:vh")) != -1) {
+    switch (opt) {
+    case 'j':
+      options.threads = (unsigned)atoi(optarg);
+      break;
+    case 'm':
+      options.run_bytes = (size_t)strtoull(optarg, nullptr, 10) << 20;
+      if (options.run_bytes == 0) {
+        fprintf(stderr, "%s: invalid run size '%s'\n", argv[0], optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'T':
+      options.tmpdir = optarg;
+      break;
+    case 'k': {
+      fptu_keydef key;
+      if (!parse_key(optarg, key)) {
+        fprintf(stderr, "%s: invalid key '%s'\n", argv[0], optarg);
+        return EXIT_FAILURE;
+      }
+      options.keys.push_back(key);
+    } break;
+    case 'v':
+      verbose = true;
+      break;
+    case 'h':
+      usage(argv[0]);
+      return EXIT_SUCCESS;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (argc - optind != 2) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::string error;
+  fptu::xsort_stat stat;
+  const int rc =
+      fptu::xsort(argv[optind], argv[optind + 1], options, error, &stat);
+  if (rc != FPTU_OK) {
+    fprintf(stderr, "%s: %s\n", argv[0], error.c_str());
+    return EXIT_FAILURE;
+  }
+
+  if (verbose)
+    fprintf(stderr, "%zu tuples, %zu bytes, %zu run(s)\n", stat.tuples,
+            stat.bytes, stat.runs);
+  return EXIT_SUCCESS;
+}
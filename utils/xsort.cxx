@@ -0,0 +1,422 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/xsort.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fptu {
+namespace {
+
+/* Файл отображенный в память только для чтения. */
+class mapped_file {
+  void *base_;
+  size_t size_;
+
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+public:
+  mapped_file() : base_(nullptr), size_(0) {}
+  ~mapped_file() { unmap(); }
+
+  int map(int fd) {
+    unmap();
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+      return errno;
+    size_ = (size_t)st.st_size;
+    if (size_ == 0)
+      return FPTU_OK;
+
+    void *ptr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+      size_ = 0;
+      return errno;
+    }
+    base_ = ptr;
+    (void)madvise(base_, size_, MADV_SEQUENTIAL);
+    return FPTU_OK;
+  }
+
+  void unmap() {
+    if (base_)
+      munmap(base_, size_);
+    base_ = nullptr;
+    size_ = 0;
+  }
+
+  const fptu_unit *begin() const { return (const fptu_unit *)base_; }
+  size_t size() const { return size_; }
+};
+
+/* Последовательный разбор самоописывающих кортежей. */
+class tuple_cursor {
+  const char *ptr_;
+  const char *end_;
+
+public:
+  tuple_cursor() : ptr_(nullptr), end_(nullptr) {}
+  tuple_cursor(const void *begin, size_t bytes)
+      : ptr_((const char *)begin), end_((const char *)begin + bytes) {}
+
+  bool empty() const { return ptr_ == end_; }
+  size_t offset(const void *begin) const {
+    return (size_t)(ptr_ - (const char *)begin);
+  }
+
+  /* Возвращает false если остаток данных не является целым кортежем. */
+  bool peek(fptu_ro &ro) const {
+    const size_t left = (size_t)(end_ - ptr_);
+    if (left < fptu_unit_size)
+      return false;
+    const fptu_unit *header = (const fptu_unit *)ptr_;
+    const size_t bytes = fptu_unit_size * (1 + (size_t)header->varlen.brutto);
+    if (bytes > left)
+      return false;
+    ro.units = header;
+    ro.total_bytes = bytes;
+    return true;
+  }
+
+  void skip(const fptu_ro &ro) { ptr_ += ro.total_bytes; }
+};
+
+class comparator {
+  const std::vector<fptu_keydef> &keys_;
+
+public:
+  explicit comparator(const std::vector<fptu_keydef> &keys) : keys_(keys) {}
+
+  bool operator()(const fptu_ro &left, const fptu_ro &right) const {
+    const fptu_lge cmp =
+        keys_.empty() ? fptu_cmp_tuples(left, right)
+                      : fptu_cmp_keys(left, right, keys_.data(), keys_.size());
+    return cmp == fptu_lt;
+  }
+};
+
+/* Буферизированная запись кортежей в файл. */
+class tuple_writer {
+  FILE *file_;
+
+public:
+  tuple_writer() : file_(nullptr) {}
+  ~tuple_writer() {
+    if (file_)
+      fclose(file_);
+  }
+
+  int open(const char *path) {
+    file_ = fopen(path, "wb");
+    return file_ ? FPTU_OK : errno;
+  }
+
+  int open(int fd) {
+    const int copy = dup(fd);
+    if (copy < 0)
+      return errno;
+    file_ = fdopen(copy, "wb");
+    if (file_)
+      return FPTU_OK;
+    const int err = errno;
+    ::close(copy);
+    return err;
+  }
+
+  int write(const fptu_ro &ro) {
+    /* fwrite() не обязана устанавливать errno */
+    errno = 0;
+    if (fwrite(ro.sys.iov_base, 1, ro.sys.iov_len, file_) != ro.sys.iov_len)
+      return errno ? errno : EIO;
+    return FPTU_OK;
+  }
+
+  int close() {
+    FILE *file = file_;
+    file_ = nullptr;
+    return (fclose(file) == 0) ? FPTU_OK : errno;
+  }
+};
+
+/* Отсортированная серия во временном (сразу удаляемом) файле. */
+struct run_file {
+  int fd;
+  mapped_file map;
+  run_file() : fd(-1) {}
+  ~run_file() {
+    if (fd >= 0)
+      ::close(fd);
+  }
+};
+
+/* Дерево проигравших для k-путевого слияния.
+ *
+ * Листья (источники) пронумерованы 0..k-1 и условно размещены в узлах
+ * k..2k-1, во внутренних узлах 1..k-1 хранятся проигравшие, а в нулевом
+ * узле - победитель. После выборки победителя достаточно переиграть
+ * только путь от его листа до корня, т.е. log2(k) сравнений. */
+class loser_tree {
+  std::vector<tuple_cursor> &sources_;
+  std::vector<fptu_ro> heads_;
+  std::vector<size_t> tree_;
+  const comparator &less_;
+
+  /* Кортежи с равными ключами выбираются в порядке номеров серий,
+   * что сохраняет стабильность сортировки. */
+  bool beats(size_t a, size_t b) const {
+    if (sources_[a].empty())
+      return false;
+    if (sources_[b].empty())
+      return true;
+    if (less_(heads_[a], heads_[b]))
+      return true;
+    if (less_(heads_[b], heads_[a]))
+      return false;
+    return a < b;
+  }
+
+  size_t build(size_t node) {
+    const size_t k = sources_.size();
+    if (node >= k)
+      return node - k;
+    const size_t left = build(node * 2);
+    const size_t right = build(node * 2 + 1);
+    if (beats(left, right)) {
+      tree_[node] = right;
+      return left;
+    }
+    tree_[node] = left;
+    return right;
+  }
+
+public:
+  loser_tree(std::vector<tuple_cursor> &sources, const comparator &less)
+      : sources_(sources), heads_(sources.size()), tree_(sources.size()),
+        less_(less) {
+    for (size_t i = 0; i < sources_.size(); ++i)
+      if (!sources_[i].empty())
+        sources_[i].peek(heads_[i]);
+    if (!sources_.empty())
+      tree_[0] = build(1);
+  }
+
+  bool empty() const { return sources_.empty() || sources_[tree_[0]].empty(); }
+  const fptu_ro &top() const { return heads_[tree_[0]]; }
+
+  void pop() {
+    size_t winner = tree_[0];
+    tuple_cursor &source = sources_[winner];
+    source.skip(heads_[winner]);
+    if (!source.empty())
+      source.peek(heads_[winner]);
+
+    for (size_t node = (winner + sources_.size()) / 2; node > 0; node /= 2) {
+      if (beats(tree_[node], winner))
+        std::swap(tree_[node], winner);
+    }
+    tree_[0] = winner;
+  }
+};
+
+static std::string describe(const char *what, const char *path, int err) {
+  return std::string(what) + " '" + path + "': " + strerror(err);
+}
+
+/* Переименовывает записанный временный файл в выходной, а при ошибке
+ * удаляет временный. Входной файл до этого момента остается нетронутым,
+ * даже если он совпадает с выходным. */
+static int finish(int err, const std::string &tmp, const char *output,
+                  std::string &error) {
+  if (err == FPTU_OK && rename(tmp.c_str(), output) != 0) {
+    err = errno;
+    error = describe("cannot rename into", output, err);
+  }
+  if (err != FPTU_OK)
+    unlink(tmp.c_str());
+  return err;
+}
+
+} /* anonymous namespace */
+
+int xsort(const char *input, const char *output, const xsort_options &options,
+          std::string &error, xsort_stat *stat) {
+  xsort_stat local_stat;
+  if (!stat)
+    stat = &local_stat;
+  *stat = xsort_stat();
+
+  if (!options.keys.empty() &&
+      fptu_key_size(options.keys.data(), options.keys.size()) == 0) {
+    error = "invalid sort key specification";
+    return FPTU_EINVAL;
+  }
+
+  /* 1. отображаем входной файл и индексируем кортежи без копирования */
+  mapped_file source;
+  {
+    const int fd = ::open(input, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      const int err = errno;
+      error = describe("cannot open", input, err);
+      return err;
+    }
+    const int err = source.map(fd);
+    ::close(fd);
+    if (err != FPTU_OK) {
+      error = describe("cannot mmap", input, err);
+      return err;
+    }
+  }
+
+  std::vector<fptu_ro> index;
+  for (tuple_cursor cursor(source.begin(), source.size()); !cursor.empty();) {
+    fptu_ro ro;
+    const char *bug = cursor.peek(ro) ? fptu_check_ro(ro) : "truncated tuple";
+    if (bug) {
+      error = std::string("invalid tuple at offset ") +
+              std::to_string(cursor.offset(source.begin())) + ": " + bug;
+      return FPTU_EINVAL;
+    }
+    index.push_back(ro);
+    cursor.skip(ro);
+  }
+  stat->tuples = index.size();
+  stat->bytes = source.size();
+
+  /* 2. делим индекс на серии ограниченного объема */
+  std::vector<size_t> bounds(1, 0);
+  for (size_t i = 0, run_bytes = 0; i < index.size(); ++i) {
+    run_bytes += index[i].total_bytes;
+    if (run_bytes >= options.run_bytes && i + 1 < index.size()) {
+      bounds.push_back(i + 1);
+      run_bytes = 0;
+    }
+  }
+  bounds.push_back(index.size());
+  const size_t nruns = bounds.size() - 1;
+  stat->runs = nruns;
+
+  /* 3. параллельно сортируем серии и сбрасываем их во временные файлы,
+   *    единственная серия сразу записывается в выходной файл */
+  const comparator less(options.keys);
+  std::vector<run_file> runs(nruns > 1 ? nruns : 0);
+  std::vector<int> errors(nruns, FPTU_OK);
+  std::string tmpdir = options.tmpdir;
+  if (tmpdir.empty()) {
+    const char *env = getenv("TMPDIR");
+    tmpdir = (env && *env) ? env : "/tmp";
+  }
+
+  /* результат пишется рядом и переименовывается в конце */
+  const std::string tmp = std::string(output) + ".tmp";
+
+  std::atomic<size_t> next_run(0);
+  auto worker = [&]() {
+    for (;;) {
+      const size_t n = next_run++;
+      if (n >= nruns)
+        break;
+      std::stable_sort(index.begin() + bounds[n], index.begin() + bounds[n + 1],
+                       less);
+
+      tuple_writer writer;
+      int err;
+      if (nruns == 1)
+        err = writer.open(tmp.c_str());
+      else {
+        std::string path = tmpdir + "/fptu-xsort-XXXXXX";
+        runs[n].fd = mkstemp(&path[0]);
+        if (runs[n].fd < 0)
+          err = errno;
+        else {
+          unlink(path.c_str());
+          err = writer.open(runs[n].fd);
+        }
+      }
+      for (size_t i = bounds[n]; err == FPTU_OK && i < bounds[n + 1]; ++i)
+        err = writer.write(index[i]);
+      if (err == FPTU_OK)
+        err = writer.close();
+      if (err == FPTU_OK && nruns > 1)
+        err = runs[n].map.map(runs[n].fd);
+      errors[n] = err;
+    }
+  };
+
+  unsigned nthreads = options.threads ? options.threads
+                                      : std::thread::hardware_concurrency();
+  nthreads = (unsigned)std::max<size_t>(1, std::min<size_t>(nthreads, nruns));
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < nthreads; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (auto &thread : threads)
+    thread.join();
+
+  for (size_t n = 0; n < nruns; ++n) {
+    if (errors[n] != FPTU_OK) {
+      error = describe(nruns > 1 ? "cannot spill run into" : "cannot write",
+                       nruns > 1 ? tmpdir.c_str() : tmp.c_str(), errors[n]);
+      return finish(errors[n], tmp, output, error);
+    }
+  }
+  if (nruns == 1)
+    return finish(FPTU_OK, tmp, output, error);
+
+  /* 4. k-путевое слияние серий */
+  index.clear();
+  index.shrink_to_fit();
+  source.unmap();
+
+  std::vector<tuple_cursor> cursors;
+  cursors.reserve(nruns);
+  for (auto &run : runs)
+    cursors.emplace_back(run.map.begin(), run.map.size());
+
+  tuple_writer writer;
+  int err = writer.open(tmp.c_str());
+  if (err != FPTU_OK) {
+    error = describe("cannot create", tmp.c_str(), err);
+    return err;
+  }
+  for (loser_tree tree(cursors, less); !tree.empty(); tree.pop()) {
+    err = writer.write(tree.top());
+    if (err != FPTU_OK)
+      break;
+  }
+  if (err == FPTU_OK)
+    err = writer.close();
+  if (err != FPTU_OK)
+    error = describe("cannot write", tmp.c_str(), err);
+  return finish(err, tmp, output, error);
+}
+
+} /* namespace fptu */
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2016-2017 libfptu authors: please see AUTHORS file.
+ *
+ * This file is part of libfptu, aka "Fast Positive Tuples".
+ *
+ * libfptu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libfptu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libfptu.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "fast_positive/tuples.h"
+
+#include <string>
+#include <vector>
+
+/* Внешняя сортировка потока сериализованных кортежей.
+ *
+ * Входной файл содержит кортежи в сериализованном виде (как их возвращает
+ * fptu_take()) записанные подряд, без дополнительной разметки. Каждый
+ * кортеж является самоописывающим: размер определяется заголовком и
+ * составляет 4 * (1 + brutto) байт.
+ *
+ * Сортировка выполняется в два этапа:
+ *  1. Входной файл отображается в память, кортежи проверяются посредством
+ *     fptu_check_ro() и индексируются без копирования. Затем индекс
+ *     делится на серии ограниченного объема, которые сортируются
+ *     параллельно и сбрасываются во временные файлы.
+ *  2. Серии сливаются посредством дерева проигравших (loser tree)
+ *     в выходной файл.
+ *
+ * Сортировка стабильная. По умолчанию кортежи сравниваются посредством
+ * fptu_cmp_tuples(), либо согласно спецификации ключа fptu_keydef.
+ *
+ * Результат записывается в файл "<output>.tmp", который по завершении
+ * переименовывается в output. Поэтому входной и выходной файлы могут
+ * совпадать, а при ошибке выходной файл остается прежним. */
+
+namespace fptu {
+
+struct xsort_options {
+  /* количество потоков, 0 - по количеству ядер */
+  unsigned threads;
+  /* объем (в байтах) сортируемой в памяти серии */
+  size_t run_bytes;
+  /* каталог для временных файлов, по умолчанию $TMPDIR или /tmp */
+  std::string tmpdir;
+  /* ключ сортировки, если пуст - используется fptu_cmp_tuples() */
+  std::vector<fptu_keydef> keys;
+
+  xsort_options() : threads(0), run_bytes(size_t(64) << 20) {}
+};
+
+struct xsort_stat {
+  size_t tuples;
+  size_t bytes;
+  size_t runs;
+  xsort_stat() : tuples(0), bytes(0), runs(0) {}
+};
+
+/* Возвращает FPTU_OK, либо код ошибки (errno), при этом в error
+ * помещается описание проблемы. */
+int xsort(const char *input, const char *output, const xsort_options &options,
+          std::string &error, xsort_stat *stat = nullptr);
+
+} /* namespace fptu */